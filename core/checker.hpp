@@ -0,0 +1,540 @@
+// checker.hpp - checked entry points for adding declarations to an Environment
+// (definitions, theorems, axioms, inductive families)
+// (c) 2025 Zachary R. James
+
+#ifndef CHECKER_HPP
+#define CHECKER_HPP
+
+#include "type_checker.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace vl {
+
+// 1 + the largest height of any unfoldable constant in e
+inline std::uint32_t definition_height(const Environment& env, Expr e)
+{
+    const Pool& p = env.pool;
+    std::uint32_t h = 0;
+    std::vector<Expr> todo{e};
+    std::vector<bool> seen(p.size());
+    while(!todo.empty())
+    {
+        Expr x = todo.back(); todo.pop_back();
+        if(seen[x]) continue;
+        seen[x] = true;
+        const ExprNode& n = p[x];
+        switch(n.kind)
+        {
+            case ExprKind::Const:
+                if(auto d = env.find(n.a); d && d->unfoldable()) h = std::max(h, d->height);
+                break;
+            case ExprKind::App: todo.push_back(n.a); todo.push_back(n.b); break;
+            case ExprKind::Lam: case ExprKind::Pi: todo.push_back(n.b); todo.push_back(n.c); break;
+            case ExprKind::Let: todo.push_back(n.b); todo.push_back(n.c); todo.push_back(n.d); break;
+            default: break;
+        }
+    }
+    return h + 1;
+}
+
+// check d against env and add it; throws kernel_exception on failure
+inline void add_decl(Environment& env, Declaration d)
+{
+    Pool& p = env.pool;
+    const std::string& name = p.names.str(d.name);
+    if(env.find(d.name)) throw kernel_exception("already declared '" + name + "'");
+    for(std::size_t i = 0; i < d.lparams.size(); ++i)
+        if(std::find(d.lparams.begin() + i + 1, d.lparams.end(), d.lparams[i]) != d.lparams.end())
+            throw kernel_exception("duplicate universe parameter in '" + name + "'");
+    if(p.has_loose_bvars(d.type) || p.has_fvar(d.type)) throw kernel_exception("type of '" + name + "' is not closed");
+
+    TypeChecker tc(env, d.lparams);
+    tc.ensure_sort(tc.check(d.type));
+
+    switch(d.kind)
+    {
+        case DeclKind::Axiom: break;
+        case DeclKind::Theorem:
+            if(!tc.is_prop(d.type)) throw kernel_exception("theorem '" + name + "' does not state a proposition");
+            [[fallthrough]];
+        case DeclKind::Definition: case DeclKind::Opaque:
+        {
+            if(d.value == no_expr || p.has_loose_bvars(d.value) || p.has_fvar(d.value))
+                throw kernel_exception("value of '" + name + "' is missing or not closed");
+            Expr vt = tc.check(d.value);
+            if(!tc.is_def_eq(vt, d.type))
+                throw kernel_exception("type mismatch in '" + name + "': value has type " + tc.to_string(vt));
+            d.height = d.kind == DeclKind::Definition ? definition_height(env, d.value) : 0;
+            break;
+        }
+        case DeclKind::Quot: throw kernel_exception("quotient primitives come from add_quot");
+        case DeclKind::Inductive: case DeclKind::Constructor: case DeclKind::Recursor:
+            throw kernel_exception("inductive families go through add_inductive");
+    }
+    env.add(std::move(d));
+}
+
+// INDUCTIVE FAMILIES //
+
+struct ConstructorDecl
+{
+    Name name;
+    Expr type; // (params) → (fields) → I params indices
+};
+
+struct InductiveType
+{
+    Name name;
+    Expr type; // (params) → (indices) → Sort l
+    std::vector<ConstructorDecl> ctors;
+};
+
+// one inductive family, or several mutually inductive ones sharing params and universe
+struct InductiveDecl
+{
+    std::vector<Name> lparams;
+    std::uint32_t nparams = 0;
+    std::vector<InductiveType> types;
+};
+
+// checks an InductiveDecl (well typed, strictly positive, universe constraints) and declares
+// the types, their constructors and one recursor per type with its computation rules.
+// every step is a single pass over the declaration with the hash-consed term operations
+class InductiveCompiler
+{
+public:
+    InductiveCompiler(Environment& env, const InductiveDecl& decl)
+        : env_(env), p_(env.pool), d_(decl), tc_(env, decl.lparams) {}
+
+    void run()
+    {
+        if(d_.types.empty()) throw kernel_exception("empty inductive declaration");
+        std::size_t mark = env_.decls().size();
+        try
+        {
+            check_types();
+            declare_types();
+            check_ctors();
+            declare_recursors();
+        }
+        catch(...)
+        {
+            env_.truncate(mark);
+            throw;
+        }
+    }
+
+private:
+    struct RecArg
+    {
+        std::size_t field;       // index into CtorInfo::fields
+        std::vector<Expr> xs;    // telescope of the field type
+        std::size_t k;           // which type of the block it targets
+        std::vector<Expr> idx;   // its indices
+    };
+
+    struct CtorInfo
+    {
+        Name name;
+        std::vector<Expr> fields;
+        std::vector<Expr> idx;   // indices of the result type
+        std::vector<RecArg> rec_args;
+    };
+
+    const std::string& str(Name n) const { return p_.names.str(n); }
+
+    void ensure_closed(Expr e, Name n)
+    {
+        if(p_.has_loose_bvars(e) || p_.has_fvar(e)) throw kernel_exception("type of '" + str(n) + "' is not closed");
+    }
+
+    bool mentions_block(Expr e) const
+    {
+        for(const auto& t : d_.types) if(p_.occurs_const(e, t.name)) return true;
+        return false;
+    }
+
+    bool occurs_fvar(Expr e, Expr x) const
+    {
+        std::vector<Expr> todo{e};
+        while(!todo.empty())
+        {
+            Expr y = todo.back(); todo.pop_back();
+            if(y == x) return true;
+            if(!p_.has_fvar(y)) continue;
+            const ExprNode& n = p_[y];
+            switch(n.kind)
+            {
+                case ExprKind::App: todo.push_back(n.a); todo.push_back(n.b); break;
+                case ExprKind::Lam: case ExprKind::Pi: todo.push_back(n.b); todo.push_back(n.c); break;
+                case ExprKind::Let: todo.push_back(n.b); todo.push_back(n.c); todo.push_back(n.d); break;
+                default: break;
+            }
+        }
+        return false;
+    }
+
+    // params, then indices (peeled with whnf), then the result sort
+    void check_types()
+    {
+        for(Name l : d_.lparams) levels_.push_back(p_.levels.param(l));
+        for(std::size_t j = 0; j < d_.types.size(); ++j)
+        {
+            const InductiveType& it = d_.types[j];
+            ensure_closed(it.type, it.name);
+            tc_.ensure_sort(tc_.check(it.type));
+            Expr t = it.type;
+            for(std::uint32_t i = 0; i < d_.nparams; ++i)
+            {
+                t = tc_.ensure_pi(t);
+                const ExprNode n = p_[t];
+                if(j == 0) params_.push_back(tc_.mk_local(n.a, n.b, n.binfo));
+                else if(!tc_.is_def_eq(n.b, tc_.local(params_[i]).type))
+                    throw kernel_exception("parameters of '" + str(it.name) + "' differ from the rest of the block");
+                t = p_.instantiate(n.c, params_[i]);
+            }
+            std::vector<Expr> idx;
+            for(Expr w = tc_.whnf(t); p_.kind(w) == ExprKind::Pi; w = tc_.whnf(t))
+            {
+                const ExprNode n = p_[w];
+                idx.push_back(tc_.mk_local(n.a, n.b, n.binfo));
+                t = p_.instantiate(n.c, idx.back());
+            }
+            Level l = p_[tc_.ensure_sort(t)].a;
+            if(j == 0) result_lvl_ = l;
+            else if(!p_.levels.is_equiv(l, result_lvl_))
+                throw kernel_exception("mutually inductive types must live in the same universe");
+            indices_.push_back(std::move(idx));
+            consts_.push_back(p_.cnst(it.name, levels_));
+        }
+    }
+
+    void declare_types()
+    {
+        std::vector<Name> all;
+        for(const auto& it : d_.types) all.push_back(it.name);
+
+        // syntactic: some field (after the params) mentions the block
+        bool is_rec = false;
+        for(const auto& it : d_.types)
+            for(const auto& c : it.ctors)
+            {
+                Expr t = c.type;
+                for(std::uint32_t i = 0; p_.kind(t) == ExprKind::Pi; ++i, t = p_[t].c)
+                    if(i >= d_.nparams && mentions_block(p_[t].b)) is_rec = true;
+            }
+
+        for(std::size_t j = 0; j < d_.types.size(); ++j)
+        {
+            const InductiveType& it = d_.types[j];
+            Declaration d;
+            d.kind = DeclKind::Inductive;
+            d.name = it.name;
+            d.lparams = d_.lparams;
+            d.type = it.type;
+            d.nparams = d_.nparams;
+            d.nindices = std::uint32_t(indices_[j].size());
+            d.all = all;
+            for(const auto& c : it.ctors) d.ctors.push_back(c.name);
+            d.is_rec = is_rec;
+            env_.add(std::move(d));
+        }
+    }
+
+    // I_k params idx with exactly the block's params and levels; returns k or npos
+    std::size_t valid_ind_app(Expr t, std::vector<Expr>* idx = nullptr) const
+    {
+        std::vector<Expr> args;
+        Expr f = p_.app_args(t, args);
+        for(std::size_t k = 0; k < consts_.size(); ++k)
+        {
+            if(f != consts_[k]) continue;
+            if(args.size() != d_.nparams + indices_[k].size()) return npos;
+            for(std::uint32_t i = 0; i < d_.nparams; ++i) if(args[i] != params_[i]) return npos;
+            for(std::size_t i = d_.nparams; i < args.size(); ++i) if(mentions_block(args[i])) return npos;
+            if(idx) idx->assign(args.begin() + d_.nparams, args.end());
+            return k;
+        }
+        return npos;
+    }
+
+    // the block may only occur as the result of a field's telescope
+    void check_positivity(Expr t, Name ctor, std::size_t field)
+    {
+        t = tc_.whnf(t);
+        if(!mentions_block(t)) return;
+        if(p_.kind(t) == ExprKind::Pi)
+        {
+            const ExprNode n = p_[t];
+            if(mentions_block(n.b))
+                throw kernel_exception("non positive occurrence in field " + std::to_string(field) + " of '" + str(ctor) + "'");
+            check_positivity(p_.instantiate(n.c, tc_.mk_local(n.a, n.b, n.binfo)), ctor, field);
+            return;
+        }
+        if(valid_ind_app(t) == npos)
+            throw kernel_exception("invalid occurrence of the inductive type in field " + std::to_string(field) +
+                                   " of '" + str(ctor) + "'");
+    }
+
+    // telescope xs → I_k params idx, when the field is recursive
+    std::optional<RecArg> rec_arg(Expr t, std::size_t field)
+    {
+        RecArg r{field, {}, 0, {}};
+        t = tc_.whnf(t);
+        while(p_.kind(t) == ExprKind::Pi)
+        {
+            const ExprNode n = p_[t];
+            r.xs.push_back(tc_.mk_local(n.a, n.b, n.binfo));
+            t = tc_.whnf(p_.instantiate(n.c, r.xs.back()));
+        }
+        r.k = valid_ind_app(t, &r.idx);
+        if(r.k == npos) return std::nullopt;
+        return r;
+    }
+
+    void check_ctors()
+    {
+        bool prop = p_.levels.is_zero(result_lvl_);
+        for(std::size_t j = 0; j < d_.types.size(); ++j)
+        {
+            ctors_.emplace_back();
+            for(std::uint32_t cidx = 0; cidx < d_.types[j].ctors.size(); ++cidx)
+            {
+                const ConstructorDecl& c = d_.types[j].ctors[cidx];
+                ensure_closed(c.type, c.name);
+                tc_.ensure_sort(tc_.check(c.type));
+                CtorInfo info{c.name, {}, {}, {}};
+
+                Expr t = c.type;
+                for(std::uint32_t i = 0; i < d_.nparams; ++i)
+                {
+                    t = tc_.ensure_pi(t);
+                    if(!tc_.is_def_eq(p_[t].b, tc_.local(params_[i]).type))
+                        throw kernel_exception("parameter mismatch in constructor '" + str(c.name) + "'");
+                    t = p_.instantiate(p_[t].c, params_[i]);
+                }
+                for(Expr w = tc_.whnf(t); p_.kind(w) == ExprKind::Pi; w = tc_.whnf(t))
+                {
+                    const ExprNode n = p_[w];
+                    std::size_t field = info.fields.size();
+                    check_positivity(n.b, c.name, field);
+                    if(!prop)
+                    {
+                        Level fl = p_[tc_.ensure_sort(tc_.infer(n.b))].a;
+                        if(!p_.levels.is_geq(result_lvl_, fl))
+                            throw kernel_exception("universe level of field " + std::to_string(field) + " of '" +
+                                                   str(c.name) + "' is too big for the inductive type");
+                    }
+                    if(auto r = rec_arg(n.b, field)) info.rec_args.push_back(std::move(*r));
+                    info.fields.push_back(tc_.mk_local(n.a ? n.a : p_.names.intern("a"), n.b, n.binfo));
+                    t = p_.instantiate(n.c, info.fields.back());
+                }
+                if(valid_ind_app(t, &info.idx) != j)
+                    throw kernel_exception("constructor '" + str(c.name) + "' does not return '" + str(d_.types[j].name) + "'");
+
+                Declaration d;
+                d.kind = DeclKind::Constructor;
+                d.name = c.name;
+                d.lparams = d_.lparams;
+                d.type = c.type;
+                d.nparams = d_.nparams;
+                d.cidx = cidx;
+                d.nfields = std::uint32_t(info.fields.size());
+                d.induct = d_.types[j].name;
+                env_.add(std::move(d));
+                ctors_[j].push_back(std::move(info));
+            }
+        }
+    }
+
+    // Prop-valued families only eliminate into Prop unless they are syntactic subsingletons
+    bool elim_only_at_zero()
+    {
+        if(p_.levels.is_not_zero(result_lvl_)) return false;
+        if(d_.types.size() > 1) return true;
+        const auto& cs = ctors_[0];
+        if(cs.empty()) return false;
+        if(cs.size() > 1) return true;
+        for(Expr x : cs[0].fields)
+        {
+            if(tc_.is_prop(tc_.local(x).type)) continue;
+            bool in_idx = false;
+            for(Expr i : cs[0].idx) in_idx = in_idx || occurs_fvar(i, x);
+            if(!in_idx) return true;
+        }
+        return false;
+    }
+
+    Name fresh_universe()
+    {
+        for(unsigned i = 0;; ++i)
+        {
+            Name n = p_.names.intern(i == 0 ? std::string("u") : "u_" + std::to_string(i));
+            if(std::find(d_.lparams.begin(), d_.lparams.end(), n) == d_.lparams.end()) return n;
+        }
+    }
+
+    static std::string short_name(const std::string& s)
+    {
+        auto dot = s.rfind('.');
+        return dot == std::string::npos ? s : s.substr(dot + 1);
+    }
+
+    void declare_recursors()
+    {
+        std::vector<Name> rec_lparams = d_.lparams;
+        std::vector<Level> rec_levels = levels_;
+        Level elim = p_.levels.zero();
+        if(!elim_only_at_zero())
+        {
+            Name u = fresh_universe();
+            elim = p_.levels.param(u);
+            rec_lparams.insert(rec_lparams.begin(), u);
+            rec_levels.insert(rec_levels.begin(), elim);
+        }
+        std::size_t nctors = 0;
+        for(const auto& cs : ctors_) nctors += cs.size();
+        bool k = p_.levels.is_zero(result_lvl_) && d_.types.size() == 1 && nctors == 1 && ctors_[0][0].fields.empty();
+
+        // motives C_j : (indices) → I_j params indices → Sort elim
+        std::vector<Expr> motives;
+        std::vector<Expr> majors;
+        for(std::size_t j = 0; j < d_.types.size(); ++j)
+        {
+            Expr major = tc_.mk_local("t", p_.app(p_.app(consts_[j], params_), indices_[j]));
+            std::vector<Expr> xs = indices_[j];
+            xs.push_back(major);
+            std::string mname = d_.types.size() == 1 ? "motive" : "motive_" + std::to_string(j + 1);
+            motives.push_back(tc_.mk_local(mname, tc_.mk_pi(xs, p_.sort(elim)), BinderInfo::Implicit));
+            majors.push_back(major);
+        }
+
+        // minor premises, one per constructor of the block
+        std::vector<Expr> minors;
+        std::vector<std::vector<Expr>> ihs;
+        for(std::size_t j = 0; j < d_.types.size(); ++j)
+            for(const CtorInfo& c : ctors_[j])
+            {
+                std::vector<Expr> vs;
+                for(const RecArg& r : c.rec_args)
+                {
+                    Expr b = c.fields[r.field];
+                    Expr goal = p_.app(p_.app(motives[r.k], r.idx), p_.app(b, r.xs));
+                    Name ih = p_.names.intern(str(tc_.local(b).name) + "_ih");
+                    vs.push_back(tc_.mk_local(ih, tc_.mk_pi(r.xs, goal)));
+                }
+                std::vector<Expr> xs = c.fields;
+                xs.insert(xs.end(), vs.begin(), vs.end());
+                Expr ctor_app = p_.app(p_.app(p_.cnst(c.name, levels_), params_), c.fields);
+                Expr goal = p_.app(p_.app(motives[j], c.idx), ctor_app);
+                minors.push_back(tc_.mk_local(short_name(str(c.name)), tc_.mk_pi(xs, goal)));
+                ihs.push_back(std::move(vs));
+            }
+
+        std::vector<Expr> prefix = params_;
+        prefix.insert(prefix.end(), motives.begin(), motives.end());
+        prefix.insert(prefix.end(), minors.begin(), minors.end());
+
+        std::vector<Name> all;
+        for(const auto& it : d_.types) all.push_back(it.name);
+        std::vector<Expr> rec_consts;
+        for(const auto& it : d_.types) rec_consts.push_back(p_.cnst(p_.names.append(it.name, "rec"), rec_levels));
+
+        std::size_t minor_idx = 0;
+        for(std::size_t j = 0; j < d_.types.size(); ++j)
+        {
+            std::vector<Expr> xs = prefix;
+            xs.insert(xs.end(), indices_[j].begin(), indices_[j].end());
+            xs.push_back(majors[j]);
+            Expr goal = p_.app(p_.app(motives[j], indices_[j]), majors[j]);
+
+            Declaration d;
+            d.kind = DeclKind::Recursor;
+            d.name = p_[rec_consts[j]].a;
+            d.lparams = rec_lparams;
+            d.type = tc_.mk_pi(xs, goal);
+            d.nparams = d_.nparams;
+            d.nindices = std::uint32_t(indices_[j].size());
+            d.nmotives = std::uint32_t(motives.size());
+            d.nminors = std::uint32_t(minors.size());
+            d.induct = d_.types[j].name;
+            d.all = all;
+            d.k = k;
+
+            // fun params motives minors fields => minor fields (fun xs => I_k.rec .. idx (b xs))
+            for(const CtorInfo& c : ctors_[j])
+            {
+                std::vector<Expr> args = c.fields;
+                for(const RecArg& r : c.rec_args)
+                {
+                    Expr rec_app = p_.app(p_.app(p_.app(rec_consts[r.k], prefix), r.idx), p_.app(c.fields[r.field], r.xs));
+                    args.push_back(tc_.mk_lambda(r.xs, rec_app));
+                }
+                std::vector<Expr> binders = prefix;
+                binders.insert(binders.end(), c.fields.begin(), c.fields.end());
+                Expr rhs = tc_.mk_lambda(binders, p_.app(minors[minor_idx++], args));
+                d.rules.push_back({c.name, std::uint32_t(c.fields.size()), rhs});
+            }
+            env_.add(std::move(d));
+        }
+    }
+
+    static constexpr std::size_t npos = SIZE_MAX;
+
+    Environment& env_;
+    Pool& p_;
+    const InductiveDecl& d_;
+    TypeChecker tc_;
+    std::vector<Level> levels_;              // the block's universe params as levels
+    std::vector<Expr> params_;               // locals
+    std::vector<std::vector<Expr>> indices_; // locals, per type
+    std::vector<Expr> consts_;               // I_j.{levels_}
+    std::vector<std::vector<CtorInfo>> ctors_;
+    Level result_lvl_ = 0;
+};
+
+inline void add_inductive(Environment& env, const InductiveDecl& decl)
+{
+    InductiveCompiler(env, decl).run();
+}
+
+inline void add_axiom(Environment& env, Name n, std::vector<Name> lparams, Expr type)
+{
+    Declaration d;
+    d.kind = DeclKind::Axiom;
+    d.name = n;
+    d.lparams = std::move(lparams);
+    d.type = type;
+    add_decl(env, std::move(d));
+}
+
+inline void add_definition(Environment& env, Name n, std::vector<Name> lparams, Expr type, Expr value)
+{
+    Declaration d;
+    d.kind = DeclKind::Definition;
+    d.name = n;
+    d.lparams = std::move(lparams);
+    d.type = type;
+    d.value = value;
+    add_decl(env, std::move(d));
+}
+
+inline void add_theorem(Environment& env, Name n, std::vector<Name> lparams, Expr type, Expr value)
+{
+    Declaration d;
+    d.kind = DeclKind::Theorem;
+    d.name = n;
+    d.lparams = std::move(lparams);
+    d.type = type;
+    d.value = value;
+    add_decl(env, std::move(d));
+}
+
+} // namespace vl
+
+#endif // CHECKER_HPP
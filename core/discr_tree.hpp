@@ -0,0 +1,237 @@
+// discr_tree.hpp - discrimination tree over theorem statements, for lemma and rewrite search
+// a term becomes its keys in preorder: a constant or local applied to n arguments is one key followed
+// by the keys of the arguments. a theorem's quantified variables and the implicit arguments of
+// constants (types, instances) are stars matching any subterm; binders, sorts and anything else are
+// one opaque key each. every theorem is entered with its conclusion (to close a goal), and for
+// an Eq conclusion with each side (to rewrite left to right or back).
+// a lookup walks the trie with the query's keys, taking a star edge by skipping a whole subterm, so
+// only lemmas of the right shape come back; they still need matching (the tree ignores repeated
+// variables and does not unfold definitions)
+// (c) 2025 Zachary R. James
+
+#ifndef DISCR_TREE_HPP
+#define DISCR_TREE_HPP
+
+#include "type_checker.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace vl {
+
+// ordered so that star edges come first in a node
+enum class KeyKind : std::uint8_t { Star, Other, Sort, Arrow, Const, Local };
+
+// kind, arity and name (Const) or fvar id (Local), packed so keys compare as integers
+struct DiscrKey
+{
+    std::uint64_t bits = 0;
+
+    DiscrKey() = default;
+    DiscrKey(KeyKind k, std::uint32_t arity = 0, std::uint32_t id = 0)
+        : bits(std::uint64_t(k) << 56 | std::uint64_t(arity & 0xffffff) << 32 | id) {}
+
+    KeyKind kind() const { return KeyKind(bits >> 56); }
+    std::uint32_t arity() const { return std::uint32_t(bits >> 32) & 0xffffff; }
+    std::uint32_t id() const { return std::uint32_t(bits); }
+    auto operator<=>(const DiscrKey&) const = default;
+};
+
+enum class LemmaUse : std::uint8_t
+{
+    Exact,         // the conclusion fits the term
+    Rewrite,       // the left side of an Eq conclusion fits, rewrite it to the right
+    RewriteReverse // the right side fits
+};
+
+struct LemmaMatch
+{
+    Name name;
+    LemmaUse use;
+    bool operator==(const LemmaMatch&) const = default;
+};
+
+class LemmaIndex
+{
+public:
+    struct Edge
+    {
+        DiscrKey key;
+        std::uint32_t child;
+    };
+
+    struct Node
+    {
+        std::vector<Edge> edges; // sorted by key
+        std::vector<LemmaMatch> values;
+    };
+
+    explicit LemmaIndex(const Environment& env) : env_(env), nodes_(1) {}
+
+    // enters the theorems declared since the last call
+    void update()
+    {
+        std::span<const Declaration> ds = env_.decls();
+        for(; indexed_ < ds.size(); ++indexed_) add(ds[indexed_]);
+    }
+
+    void add(const Declaration& d)
+    {
+        if(d.kind != DeclKind::Theorem) return;
+        const Pool& p = env_.pool;
+        Expr c = d.type;
+        while(p.kind(c) == ExprKind::Pi) c = p[c].c;
+        insert(c, {d.name, LemmaUse::Exact});
+
+        std::vector<Expr> args;
+        Expr f = p.app_args(c, args);
+        if(p.kind(f) != ExprKind::Const || args.size() != 3 || p.names.view(p[f].a) != "Eq") return;
+        // a side that is only a variable would fit everything
+        if(p.kind(p.app_fn(args[1])) != ExprKind::BVar) insert(args[1], {d.name, LemmaUse::Rewrite});
+        if(p.kind(p.app_fn(args[2])) != ExprKind::BVar) insert(args[2], {d.name, LemmaUse::RewriteReverse});
+    }
+
+    // lemmas whose pattern fits e, no duplicates
+    std::vector<LemmaMatch> match(Expr e) const
+    {
+        std::vector<LemmaMatch> out;
+        std::vector<Expr> todo{e};
+        walk(0, todo, out);
+        std::sort(out.begin(), out.end(), [](const LemmaMatch& a, const LemmaMatch& b) {
+            return a.name != b.name ? a.name < b.name : a.use < b.use;
+        });
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+        return out;
+    }
+
+    // the keys e is entered under (pattern: loose bvars and implicit arguments are stars)
+    std::vector<DiscrKey> keys(Expr e) const
+    {
+        std::vector<DiscrKey> out;
+        encode(e, out);
+        return out;
+    }
+
+    std::size_t size() const { return entries_; }
+    std::size_t indexed() const { return indexed_; }
+
+    // for storage.hpp: the trie as is, node 0 the root
+    std::span<const Node> nodes() const { return nodes_; }
+    void restore(std::vector<Node> nodes, std::size_t indexed)
+    {
+        nodes_ = std::move(nodes);
+        if(nodes_.empty()) nodes_.resize(1);
+        indexed_ = indexed;
+        entries_ = 0;
+        for(const Node& n : nodes_) entries_ += n.values.size();
+    }
+
+private:
+    // one key for the head of e; args gets what follows it, no_expr for a star
+    DiscrKey head(Expr e, std::vector<Expr>& args, bool pattern) const
+    {
+        const Pool& p = env_.pool;
+        args.clear();
+        Expr f = p.app_args(e, args);
+        auto n = std::uint32_t(args.size());
+        switch(p.kind(f))
+        {
+            case ExprKind::Const:
+                if(pattern)
+                {
+                    std::uint64_t mask = implicit(p[f].a);
+                    for(std::size_t i = 0; i < args.size() && i < 64; ++i)
+                        if(mask >> i & 1) args[i] = no_expr;
+                }
+                return {KeyKind::Const, n, p[f].a};
+            case ExprKind::FVar: return {KeyKind::Local, n, p[f].a};
+            case ExprKind::BVar: args.clear(); return pattern ? KeyKind::Star : KeyKind::Other;
+            case ExprKind::Sort: args.clear(); return n == 0 ? KeyKind::Sort : KeyKind::Other;
+            case ExprKind::Pi: args.clear(); return n == 0 ? KeyKind::Arrow : KeyKind::Other;
+            default: args.clear(); return KeyKind::Other;
+        }
+    }
+
+    void encode(Expr e, std::vector<DiscrKey>& out) const
+    {
+        if(e == no_expr) { out.push_back(KeyKind::Star); return; }
+        std::vector<Expr> args;
+        out.push_back(head(e, args, true));
+        for(Expr a : args) encode(a, out);
+    }
+
+    // bit i: argument i of constant n is implicit (by the binders of its type)
+    std::uint64_t implicit(Name n) const
+    {
+        if(auto it = implicit_.find(n); it != implicit_.end()) return it->second;
+        std::uint64_t mask = 0;
+        if(const Declaration* d = env_.find(n))
+        {
+            const Pool& p = env_.pool;
+            Expr t = d->type;
+            for(unsigned i = 0; i < 64 && p.kind(t) == ExprKind::Pi; ++i, t = p[t].c)
+                if(p[t].binfo != BinderInfo::Default) mask |= std::uint64_t(1) << i;
+        }
+        return implicit_.emplace(n, mask).first->second;
+    }
+
+    void insert(Expr e, LemmaMatch v)
+    {
+        std::uint32_t node = 0;
+        for(DiscrKey k : keys(e))
+        {
+            std::vector<Edge>& edges = nodes_[node].edges;
+            auto it = std::lower_bound(edges.begin(), edges.end(), k, [](const Edge& a, DiscrKey b) { return a.key < b; });
+            if(it != edges.end() && it->key == k)
+            {
+                node = it->child;
+                continue;
+            }
+            auto child = std::uint32_t(nodes_.size());
+            edges.insert(it, {k, child});
+            nodes_.emplace_back(); // may move edges
+            node = child;
+        }
+        nodes_[node].values.push_back(v);
+        ++entries_;
+    }
+
+    // todo holds the query subterms still to be matched, next one at the back
+    void walk(std::uint32_t node, std::vector<Expr>& todo, std::vector<LemmaMatch>& out) const
+    {
+        const Node& n = nodes_[node];
+        if(todo.empty())
+        {
+            out.insert(out.end(), n.values.begin(), n.values.end());
+            return;
+        }
+        if(n.edges.empty()) return;
+        Expr t = todo.back();
+        todo.pop_back();
+        if(n.edges.front().key.kind() == KeyKind::Star) walk(n.edges.front().child, todo, out);
+
+        std::vector<Expr> args;
+        DiscrKey k = head(t, args, false);
+        auto it = std::lower_bound(n.edges.begin(), n.edges.end(), k, [](const Edge& a, DiscrKey b) { return a.key < b; });
+        if(k.kind() != KeyKind::Star && it != n.edges.end() && it->key == k)
+        {
+            std::size_t base = todo.size();
+            todo.insert(todo.end(), args.rbegin(), args.rend());
+            walk(it->child, todo, out);
+            todo.resize(base);
+        }
+        todo.push_back(t);
+    }
+
+    const Environment& env_;
+    std::vector<Node> nodes_;
+    std::size_t indexed_ = 0, entries_ = 0;
+    mutable std::unordered_map<Name, std::uint64_t> implicit_;
+};
+
+} // namespace vl
+
+#endif // DISCR_TREE_HPP
@@ -0,0 +1,411 @@
+// equations.hpp - equation compiler: pattern matching definitions to recursor terms
+//   add n zero     = n
+//   add n (succ m) = succ (add n m)
+// becomes one recursor application on a structural argument, plus one equation lemma per case
+// (add.eq_1 : ∀ n, add n zero = n, ...) proved by Eq.refl and checked by the kernel.
+// not trusted: everything it produces goes through add_definition / add_theorem
+// (c) 2025 Zachary R. James
+
+#ifndef EQUATIONS_HPP
+#define EQUATIONS_HPP
+
+#include "checker.hpp"
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace vl {
+
+// pattern variables are locals (any TypeChecker), patterns are constructor applications over them
+// (params included, as in any term); the function itself appears in rhs as its own constant
+struct Equation
+{
+    std::vector<Expr> lhs;
+    Expr rhs;
+};
+
+struct EquationsDecl
+{
+    Name name;
+    std::vector<Name> lparams;
+    Expr type;
+    std::vector<Equation> eqns;
+};
+
+class EquationCompiler
+{
+public:
+    EquationCompiler(Environment& env, const EquationsDecl& d) : env_(env), p_(env.pool), d_(d), tc_(env, d.lparams) {}
+
+    void run()
+    {
+        if(d_.eqns.empty()) throw kernel_exception("no equations for '" + str(d_.name) + "'");
+        std::size_t n = d_.eqns[0].lhs.size();
+        for(const Equation& e : d_.eqns)
+            if(e.lhs.size() != n) throw kernel_exception("equations of '" + str(d_.name) + "' have different arities");
+        for(std::size_t i = 0; i < d_.eqns.size(); ++i) check_linear(i);
+
+        std::vector<Level> ls;
+        for(Name l : d_.lparams) ls.push_back(p_.levels.param(l));
+        fn_ = p_.cnst(d_.name, ls);
+
+        // args from the type telescope
+        Expr t = d_.type;
+        for(std::size_t i = 0; i < n; ++i)
+        {
+            t = tc_.ensure_pi(t);
+            const ExprNode b = p_[t];
+            xs_.push_back(tc_.mk_local(b.a ? b.a : p_.names.intern("x"), b.b, b.binfo));
+            t = p_.instantiate(b.c, xs_.back());
+        }
+        result_ = t;
+
+        // try structural recursion on columns with constructor patterns first, then the rest
+        std::vector<std::size_t> order;
+        for(int pass = 0; pass < 2; ++pass)
+            for(std::size_t k = 0; k < n; ++k)
+            {
+                bool ctor_col = false;
+                for(const Equation& e : d_.eqns) ctor_col = ctor_col || p_.kind(e.lhs[k]) != ExprKind::FVar;
+                if(ctor_col == (pass == 0)) order.push_back(k);
+            }
+
+        std::string why = "no argument to split on";
+        for(std::size_t k : order)
+        {
+            if(!splittable(xs_[k])) continue;
+            k_ = k;
+            leaves_.clear();
+            ih_.clear();
+            used_.assign(d_.eqns.size(), false);
+            try
+            {
+                std::vector<Row> rows;
+                for(std::size_t i = 0; i < d_.eqns.size(); ++i) rows.push_back({d_.eqns[i].lhs, {}, d_.eqns[i].rhs, i});
+                Expr body = compile(xs_, result_, std::move(rows), xs_, true);
+                for(std::size_t i = 0; i < used_.size(); ++i)
+                    if(!used_[i]) throw kernel_exception("equation " + std::to_string(i + 1) + " of '" + str(d_.name) + "' is redundant");
+                std::size_t mark = env_.decls().size();
+                try
+                {
+                    add_definition(env_, d_.name, d_.lparams, d_.type, tc_.mk_lambda(xs_, body));
+                    add_lemmas();
+                }
+                catch(...)
+                {
+                    env_.truncate(mark); // a failed lemma takes the definition back out
+                    throw;
+                }
+                return;
+            }
+            catch(const not_structural& e) { why = e.what(); }
+        }
+        throw kernel_exception("'" + str(d_.name) + "' is not structurally recursive: " + why);
+    }
+
+private:
+    struct not_structural : kernel_exception { using kernel_exception::kernel_exception; };
+
+    struct Row
+    {
+        std::vector<Expr> pats;                    // one per column
+        std::vector<std::pair<Expr, Expr>> subst;  // pattern var ↦ term over the current columns
+        Expr rhs;
+        std::size_t eqn;
+    };
+
+    struct Leaf
+    {
+        std::vector<Expr> vars;
+        std::vector<Expr> orig; // the original arguments in terms of vars
+        Expr goal;
+        Expr rhs;               // with the recursive calls left as calls
+    };
+
+    const std::string& str(Name n) const { return p_.names.str(n); }
+
+    const Declaration* inductive_of(Expr x)
+    {
+        Expr I = p_.app_fn(tc_.whnf(tc_.local(x).type));
+        if(p_.kind(I) != ExprKind::Const) return nullptr;
+        const Declaration* d = env_.find(p_[I].a);
+        return d && d->kind == DeclKind::Inductive && d->nindices == 0 && d->all.size() == 1 ? d : nullptr;
+    }
+
+    bool splittable(Expr x) { return inductive_of(x) != nullptr; }
+
+    // a pattern variable binds one argument: `same n n` would make both columns the same variable,
+    // which matches any two arguments rather than equal ones
+    void check_linear(std::size_t i)
+    {
+        std::vector<Expr> seen;
+        auto walk = [&](auto& self, Expr pat) -> void {
+            if(p_.kind(pat) == ExprKind::FVar)
+            {
+                if(std::count(seen.begin(), seen.end(), pat))
+                    throw kernel_exception("equation " + std::to_string(i + 1) + " of '" + str(d_.name) +
+                                           "' uses a pattern variable twice");
+                seen.push_back(pat);
+                return;
+            }
+            std::vector<Expr> args;
+            Expr h = p_.app_args(pat, args);
+            const Declaration* c = p_.kind(h) == ExprKind::Const ? env_.find(p_[h].a) : nullptr;
+            if(!c || c->kind != DeclKind::Constructor) return; // split() reports it
+            for(std::size_t a = std::min<std::size_t>(c->nparams, args.size()); a < args.size(); ++a) self(self, args[a]); // params are terms
+        };
+        for(Expr pat : d_.eqns[i].lhs) walk(walk, pat);
+    }
+
+    // replace fvar keys by values
+    Expr subst(Expr e, const std::vector<std::pair<Expr, Expr>>& s)
+    {
+        if(s.empty()) return e;
+        std::vector<Expr> keys, vals;
+        for(const auto& [k, v] : s) { keys.push_back(k); vals.push_back(v); }
+        return p_.instantiate_rev(p_.abstract(e, keys), vals);
+    }
+
+    Expr subst1(Expr e, Expr x, Expr v) { return p_.instantiate(p_.abstract(e, std::span<const Expr>(&x, 1)), v); }
+
+    Expr compile(std::vector<Expr> vars, Expr goal, std::vector<Row> rows, std::vector<Expr> orig, bool top)
+    {
+        if(rows.empty())
+        {
+            std::string lhs;
+            for(Expr o : orig) lhs += " " + tc_.to_string(o);
+            throw kernel_exception("missing case '" + str(d_.name) + lhs + "'");
+        }
+
+        const Row& row0 = rows[0];
+        std::size_t j = top ? k_ : vars.size();
+        if(!top)
+            for(std::size_t c = 0; c < vars.size() && j == vars.size(); ++c)
+                if(p_.kind(row0.pats[c]) != ExprKind::FVar) j = c;
+
+        if(j == vars.size()) return leaf(vars, goal, rows[0], orig);
+        return split(vars, goal, std::move(rows), orig, j, top);
+    }
+
+    Expr leaf(const std::vector<Expr>& vars, Expr goal, Row row, const std::vector<Expr>& orig)
+    {
+        for(std::size_t c = 0; c < vars.size(); ++c) row.subst.emplace_back(row.pats[c], vars[c]);
+        used_[row.eqn] = true;
+        Expr rhs = subst(row.rhs, row.subst);
+        leaves_.push_back({vars, orig, goal, rhs});
+        std::unordered_map<std::uint64_t, Expr> cache;
+        return rewrite_calls(rhs, 0, cache);
+    }
+
+    Expr split(const std::vector<Expr>& vars, Expr goal, std::vector<Row> rows, const std::vector<Expr>& orig,
+               std::size_t j, bool top)
+    {
+        Expr x = vars[j];
+        const Declaration* ind = inductive_of(x);
+        if(!ind) throw not_structural("cannot match on '" + tc_.to_string(x) + "'");
+
+        std::vector<Expr> params;
+        Expr I = p_.app_args(tc_.whnf(tc_.local(x).type), params);
+        std::vector<Level> ind_levels(p_.const_levels(I).begin(), p_.const_levels(I).end());
+
+        std::vector<Expr> others;
+        std::vector<std::size_t> other_cols;
+        for(std::size_t c = 0; c < vars.size(); ++c)
+        {
+            if(c == j) continue;
+            if(occurs(tc_.local(vars[c]).type, x))
+                throw kernel_exception("dependent pattern matching is not supported");
+            others.push_back(vars[c]);
+            other_cols.push_back(c);
+        }
+
+        // motive := fun x => (others) → goal
+        Expr motive_body = tc_.mk_pi(others, goal);
+        Expr motive = tc_.mk_lambda(std::array{x}, motive_body);
+        Level elim = p_[tc_.ensure_sort(tc_.infer(motive_body))].a;
+        const Declaration& rec = env_.get(p_.names.append(ind->name, "rec"));
+        std::vector<Level> rec_levels = ind_levels;
+        if(rec.lparams.size() > ind->lparams.size()) rec_levels.insert(rec_levels.begin(), elim);
+        else if(!p_.levels.is_zero(elim)) throw kernel_exception("'" + str(ind->name) + "' only eliminates into Prop");
+
+        Expr r = p_.app(p_.app(p_.cnst(rec.name, rec_levels), params), motive);
+        for(Name cname : ind->ctors)
+        {
+            const Declaration& c = env_.get(cname);
+            Expr ct = p_.instantiate_lparams(c.type, ind->lparams, ind_levels);
+            for(Expr a : params) ct = p_.instantiate(p_[tc_.ensure_pi(ct)].c, a);
+
+            std::vector<Expr> fields, ihs;
+            std::vector<std::pair<Expr, Expr>> new_ih;
+            for(Expr w = tc_.whnf(ct); p_.kind(w) == ExprKind::Pi; w = tc_.whnf(ct))
+            {
+                const ExprNode b = p_[w];
+                Expr f = tc_.mk_local(b.a ? b.a : p_.names.intern("a"), b.b, b.binfo);
+                fields.push_back(f);
+                ct = p_.instantiate(b.c, f);
+            }
+            Expr ctor_app = p_.app(p_.app(p_.cnst(cname, ind_levels), params), fields);
+
+            // one ih per recursive field (direct or under a telescope), as the recursor expects
+            for(Expr f : fields)
+            {
+                std::vector<Expr> ys;
+                Expr ft = tc_.whnf(tc_.local(f).type);
+                while(p_.kind(ft) == ExprKind::Pi)
+                {
+                    const ExprNode b = p_[ft];
+                    ys.push_back(tc_.mk_local(b.a, b.b, b.binfo));
+                    ft = tc_.whnf(p_.instantiate(b.c, ys.back()));
+                }
+                if(p_.app_fn(ft) != I) continue;
+                Expr fy = p_.app(f, ys);
+                Expr ih = tc_.mk_local(p_.names.intern(str(tc_.local(f).name) + "_ih"),
+                                       tc_.mk_pi(ys, p_.instantiate(p_[motive].c, fy)));
+                ihs.push_back(ih);
+                if(top && ys.empty()) new_ih.emplace_back(f, ih);
+            }
+
+            std::vector<Row> sub;
+            for(const Row& row : rows)
+            {
+                Expr pat = row.pats[j];
+                Row r2{{}, row.subst, row.rhs, row.eqn};
+                for(std::size_t c : other_cols) r2.pats.push_back(row.pats[c]);
+                if(p_.kind(pat) == ExprKind::FVar)
+                {
+                    r2.subst.emplace_back(pat, ctor_app);
+                    r2.pats.insert(r2.pats.end(), fields.begin(), fields.end());
+                }
+                else
+                {
+                    std::vector<Expr> args;
+                    Expr h = p_.app_args(pat, args);
+                    if(p_.kind(h) != ExprKind::Const || !std::count(ind->ctors.begin(), ind->ctors.end(), p_[h].a))
+                        throw kernel_exception("unsupported pattern '" + tc_.to_string(pat) + "'");
+                    if(p_[h].a != cname) continue;
+                    if(args.size() != params.size() + fields.size())
+                        throw kernel_exception("pattern '" + tc_.to_string(pat) + "' has the wrong number of fields");
+                    args.erase(args.begin(), args.begin() + std::ptrdiff_t(params.size())); // fixed by the column's type
+                    r2.pats.insert(r2.pats.end(), args.begin(), args.end());
+                }
+                for(auto& kv : r2.subst) kv.second = subst1(kv.second, x, ctor_app);
+                sub.push_back(std::move(r2));
+            }
+
+            std::vector<Expr> sub_vars = others;
+            sub_vars.insert(sub_vars.end(), fields.begin(), fields.end());
+            std::vector<Expr> sub_orig = orig;
+            for(Expr& o : sub_orig) o = subst1(o, x, ctor_app);
+
+            auto saved = ih_;
+            for(auto& kv : ih_) kv.first = subst1(kv.first, x, ctor_app);
+            ih_.insert(ih_.end(), new_ih.begin(), new_ih.end());
+            Expr body = compile(sub_vars, subst1(goal, x, ctor_app), std::move(sub), sub_orig, false);
+            ih_ = std::move(saved);
+
+            std::vector<Expr> binders = fields;
+            binders.insert(binders.end(), ihs.begin(), ihs.end());
+            binders.insert(binders.end(), others.begin(), others.end());
+            r = p_.app(r, tc_.mk_lambda(binders, body));
+        }
+        return p_.app(p_.app(r, x), others);
+    }
+
+    bool occurs(Expr e, Expr x) const
+    {
+        if(e == x) return true;
+        if(!p_.has_fvar(e)) return false;
+        const ExprNode& n = p_[e];
+        switch(n.kind)
+        {
+            case ExprKind::App: return occurs(n.a, x) || occurs(n.b, x);
+            case ExprKind::Lam: case ExprKind::Pi: return occurs(n.b, x) || occurs(n.c, x);
+            case ExprKind::Let: return occurs(n.b, x) || occurs(n.c, x) || occurs(n.d, x);
+            default: return false;
+        }
+    }
+
+    // f a_1 .. a_n with a_k a structural subterm ↦ ih a_1 .. (no a_k) .. a_n
+    Expr rewrite_calls(Expr e, std::uint32_t off, std::unordered_map<std::uint64_t, Expr>& cache)
+    {
+        if(!p_.occurs_const(e, d_.name)) return e;
+        std::uint64_t key = std::uint64_t(e) << 32 | off;
+        if(auto it = cache.find(key); it != cache.end()) return it->second;
+        const ExprNode n = p_[e];
+        Expr r = e;
+        switch(n.kind)
+        {
+            case ExprKind::Const: throw not_structural("'" + str(d_.name) + "' used without all its arguments");
+            case ExprKind::App:
+            {
+                std::vector<Expr> args;
+                Expr h = p_.app_args(e, args);
+                if(h == fn_ && args.size() >= xs_.size())
+                {
+                    for(Expr& a : args) a = rewrite_calls(a, off, cache);
+                    Expr ih = no_expr;
+                    for(const auto& [k, v] : ih_) if(k == args[k_]) ih = v;
+                    if(ih == no_expr) throw not_structural("call on '" + tc_.to_string(args[k_]) + "'");
+                    r = ih;
+                    for(std::size_t i = 0; i < args.size(); ++i) if(i != k_) r = p_.app(r, args[i]);
+                }
+                else r = p_.app(rewrite_calls(n.a, off, cache), rewrite_calls(n.b, off, cache));
+                break;
+            }
+            case ExprKind::Lam:
+                r = p_.lam(n.a, rewrite_calls(n.b, off, cache), rewrite_calls(n.c, off + 1, cache), n.binfo);
+                break;
+            case ExprKind::Pi:
+                r = p_.pi(n.a, rewrite_calls(n.b, off, cache), rewrite_calls(n.c, off + 1, cache), n.binfo);
+                break;
+            case ExprKind::Let:
+                r = p_.let(n.a, rewrite_calls(n.b, off, cache), rewrite_calls(n.c, off, cache), rewrite_calls(n.d, off + 1, cache));
+                break;
+            default: break;
+        }
+        cache.emplace(key, r);
+        return r;
+    }
+
+    // f.eq_i : ∀ vars, f orig = rhs, by Eq.refl (holds by ι-reduction of the compiled term)
+    void add_lemmas()
+    {
+        Name eq = p_.names.intern("Eq"), refl = p_.names.intern("Eq.refl");
+        if(!env_.find(eq) || !env_.find(refl)) return;
+        for(std::size_t i = 0; i < leaves_.size(); ++i)
+        {
+            const Leaf& lf = leaves_[i];
+            std::array<Level, 1> l{p_[tc_.ensure_sort(tc_.infer(lf.goal))].a};
+            Expr lhs = p_.app(fn_, lf.orig);
+            Expr stmt = p_.app(p_.app(p_.app(p_.cnst(eq, l), lf.goal), lhs), lf.rhs);
+            Expr proof = p_.app(p_.app(p_.cnst(refl, l), lf.goal), lhs);
+            Name n = p_.names.append(d_.name, "eq_" + std::to_string(i + 1));
+            add_theorem(env_, n, d_.lparams, tc_.mk_pi(lf.vars, stmt), tc_.mk_lambda(lf.vars, proof));
+        }
+    }
+
+    Environment& env_;
+    Pool& p_;
+    const EquationsDecl& d_;
+    TypeChecker tc_;
+    Expr fn_ = no_expr;
+    std::vector<Expr> xs_;                      // the function's arguments
+    Expr result_ = no_expr;
+    std::size_t k_ = 0;                         // structural argument
+    std::vector<std::pair<Expr, Expr>> ih_;     // structural subterm ↦ its induction hypothesis
+    std::vector<Leaf> leaves_;
+    std::vector<bool> used_;
+};
+
+inline void add_equations(Environment& env, const EquationsDecl& d)
+{
+    EquationCompiler(env, d).run();
+}
+
+} // namespace vl
+
+#endif // EQUATIONS_HPP
@@ -0,0 +1,606 @@
+// eval.hpp - erased IR and evaluator for everything that computes outside the kernel
+// (TUI #eval, hint search, decision procedures)
+// types, universe levels and proofs are erased before evaluation: constants lose their type and
+// proof binders, any other irrelevant argument becomes □, so a Rat carries its numerator and
+// denominator but never the proof that the denominator is positive.
+// Nat values are machine integers, Nat.add / Nat.sub / Nat.mul run natively; a result that does not
+// fit in 64 bits throws rather than wrapping.
+// (c) 2025 Zachary R. James
+
+#ifndef EVAL_HPP
+#define EVAL_HPP
+
+#include "type_checker.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vl {
+
+// ERASED IR //
+
+enum class IrKind : std::uint8_t { Erased, Var, Lam, App, Const, Let, NatLit };
+
+// Var: a = de Bruijn index | Lam: a = body | App: a = fn, b = arg | Const: a = Name
+// Let: a = value, b = body | NatLit: a = low, b = high 32 bits
+// loose: 1 + the largest loose de Bruijn index, 0 for closed terms (closed λs are built once)
+struct IrNode
+{
+    IrKind kind;
+    std::uint32_t a, b;
+    std::uint32_t loose;
+};
+
+using Ir = std::uint32_t;
+
+// VALUES //
+
+struct Value;
+using ValuePtr = std::shared_ptr<Value>;
+
+struct Value
+{
+    enum class Kind : std::uint8_t { Erased, Nat, Ctor, Closure, Pap, Thunk, Native };
+    Kind kind = Kind::Erased;
+    std::uint64_t nat = 0;
+    Name head = 0;                // Ctor: constructor, Pap: constant
+    std::uint32_t tag = 0;        // Ctor: constructor index
+    Ir body = 0;                  // Closure
+    std::shared_ptr<const struct Frame> env; // Closure
+    std::vector<ValuePtr> items;  // Ctor: every field (□ for erased ones), Pap: args
+    std::function<ValuePtr(ValuePtr)> native;  // Native
+    std::function<ValuePtr()> delayed;         // Thunk, cleared once forced
+    ValuePtr forced;
+};
+
+struct Frame
+{
+    ValuePtr value;
+    std::shared_ptr<const Frame> next;
+};
+
+using FramePtr = std::shared_ptr<const Frame>;
+
+struct eval_exception : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+class Evaluator
+{
+public:
+    explicit Evaluator(Environment& env) : env_(env), p_(env.pool), tc_(env)
+    {
+        erased_ = std::make_shared<Value>();
+        Name nat = p_.names.intern("Nat");
+        nat_ = env_.find(nat) ? nat : 0;
+    }
+
+    // erase and run a closed kernel term
+    ValuePtr eval(Expr e)
+    {
+        std::vector<Expr> ctx;
+        return force(run(erase(e, ctx), nullptr));
+    }
+
+    ValuePtr run(Ir e) { return force(run(e, nullptr)); }
+
+    const std::vector<IrNode>& ir() const { return ir_; }
+
+    // erase a closed kernel term (exposed for tools that emit or inspect the IR)
+    Ir erase(Expr e)
+    {
+        std::vector<Expr> ctx;
+        return erase(e, ctx);
+    }
+
+    // body of a computable definition after erasure, λ per kept binder
+    Ir definition_ir(Name n) { return code(n).body; }
+    const std::vector<bool>& kept_binders(Name n) { return code(n).keep; }
+
+    std::string to_string(ValuePtr v)
+    {
+        v = force(v);
+        switch(v->kind)
+        {
+            case Value::Kind::Erased: return "□";
+            case Value::Kind::Nat: return std::to_string(v->nat);
+            case Value::Kind::Ctor:
+            {
+                std::string s = p_.names.str(v->head), fs;
+                for(const ValuePtr& f : v->items)
+                    if(force(f)->kind != Value::Kind::Erased) fs += " " + to_string(f);
+                return fs.empty() ? s : "(" + s + fs + ")";
+            }
+            default: return "<fun>";
+        }
+    }
+
+    ValuePtr force(ValuePtr v)
+    {
+        while(v->kind == Value::Kind::Thunk)
+        {
+            if(!v->forced)
+            {
+                v->forced = v->delayed();
+                v->delayed = nullptr;
+            }
+            v = v->forced;
+        }
+        return v;
+    }
+
+private:
+    friend class Extractor;
+
+    enum class CodeKind : std::uint8_t { Def, Ctor, Rec, NatZero, NatSucc, NatAdd, NatSub, NatMul, QuotMk, QuotLift, Irrelevant };
+
+    struct RecField
+    {
+        std::uint32_t field, k, arity; // field index, target type in the block, telescope length
+    };
+
+    struct Code
+    {
+        CodeKind kind = CodeKind::Irrelevant;
+        std::vector<bool> keep;          // per binder of the constant's type
+        std::uint32_t arity = 0;         // number of kept binders
+        Ir body = 0;                     // Def
+        Name name = 0;
+        std::uint32_t minor_offset = 0;  // Rec: first minor of this type's ctors
+        std::vector<std::vector<RecField>> rec_fields; // Rec: per ctor of induct
+        ValuePtr value;                  // Def: evaluated once
+    };
+
+    Ir mk(IrKind k, std::uint32_t a = 0, std::uint32_t b = 0)
+    {
+        std::uint32_t loose = 0;
+        auto under = [&](Ir body) { return ir_[body].loose ? ir_[body].loose - 1 : 0; };
+        switch(k)
+        {
+            case IrKind::Var: loose = a + 1; break;
+            case IrKind::Lam: loose = under(a); break;
+            case IrKind::App: loose = std::max(ir_[a].loose, ir_[b].loose); break;
+            case IrKind::Let: loose = std::max(ir_[a].loose, under(b)); break;
+            default: break;
+        }
+        ir_.push_back({k, a, b, loose});
+        return Ir(ir_.size() - 1);
+    }
+
+    // e : T with T = (xs) → Sort u, i.e. e is a type or a type former
+    bool is_type_former_type(Expr t)
+    {
+        t = tc_.whnf(t);
+        while(p_.kind(t) == ExprKind::Pi)
+        {
+            const ExprNode n = p_[t];
+            t = tc_.whnf(p_.instantiate(n.c, tc_.mk_local(n.a, n.b, n.binfo)));
+        }
+        return p_.kind(t) == ExprKind::Sort;
+    }
+
+    bool irrelevant_type(Expr t) { return is_type_former_type(t) || tc_.is_prop(t); }
+    bool irrelevant(Expr e) { return irrelevant_type(tc_.infer(e)); }
+
+    // which binders of a constant's type survive erasure
+    std::vector<bool> keep_mask(Expr type)
+    {
+        std::vector<bool> keep;
+        Expr t = tc_.whnf(type);
+        while(p_.kind(t) == ExprKind::Pi)
+        {
+            const ExprNode n = p_[t];
+            keep.push_back(!irrelevant_type(n.b));
+            t = tc_.whnf(p_.instantiate(n.c, tc_.mk_local(n.a, n.b, n.binfo)));
+        }
+        return keep;
+    }
+
+    static std::uint32_t count(const std::vector<bool>& keep)
+    {
+        std::uint32_t n = 0;
+        for(bool k : keep) n += k;
+        return n;
+    }
+
+    Code& code(Name n)
+    {
+        if(auto it = codes_.find(n); it != codes_.end()) return it->second;
+        Code c;
+        const Declaration& d = env_.get(n);
+        c.name = n;
+        c.keep = keep_mask(d.type);
+        const std::string& s = p_.names.str(n);
+
+        if(is_type_former_type(d.type) || tc_.is_prop(d.type)) c.kind = CodeKind::Irrelevant;
+        else if(nat_ && s == "Nat.zero") c.kind = CodeKind::NatZero;
+        else if(nat_ && s == "Nat.succ") c.kind = CodeKind::NatSucc;
+        else if(nat_ && s == "Nat.add" && d.kind == DeclKind::Definition) c.kind = CodeKind::NatAdd;
+        else if(nat_ && s == "Nat.sub" && d.kind == DeclKind::Definition) c.kind = CodeKind::NatSub;
+        else if(nat_ && s == "Nat.mul" && d.kind == DeclKind::Definition) c.kind = CodeKind::NatMul;
+        else switch(d.kind)
+        {
+            case DeclKind::Definition: case DeclKind::Opaque: case DeclKind::Theorem:
+                c.kind = CodeKind::Def;
+                break;
+            case DeclKind::Constructor:
+                c.kind = CodeKind::Ctor;
+                for(std::uint32_t i = 0; i < d.nparams && i < c.keep.size(); ++i) c.keep[i] = false;
+                break;
+            case DeclKind::Recursor:
+            {
+                c.kind = CodeKind::Rec;
+                c.keep.assign(c.keep.size(), false);
+                for(std::uint32_t i = 0; i < d.nminors; ++i) c.keep[d.nparams + d.nmotives + i] = true;
+                c.keep[d.major_idx()] = true;
+                for(Name t : d.all)
+                {
+                    if(t == d.induct) break;
+                    c.minor_offset += std::uint32_t(env_.get(t).ctors.size());
+                }
+                for(Name cn : env_.get(d.induct).ctors) c.rec_fields.push_back(recursive_fields(env_.get(cn), d));
+                break;
+            }
+            case DeclKind::Quot:
+                if(d.quot == QuotKind::Mk) c.kind = CodeKind::QuotMk;
+                else if(d.quot == QuotKind::Lift) c.kind = CodeKind::QuotLift;
+                break;
+            default:
+                throw eval_exception("cannot evaluate axiom '" + s + "'");
+        }
+        c.arity = count(c.keep);
+        auto& slot = codes_.emplace(n, std::move(c)).first->second;
+        if(slot.kind == CodeKind::Def) slot.body = compile_def(d, slot.keep);
+        return slot;
+    }
+
+    // fields of ctor whose type ends in one of the block's types (they get an ih)
+    std::vector<RecField> recursive_fields(const Declaration& ctor, const Declaration& rec)
+    {
+        std::vector<RecField> out;
+        Expr t = tc_.whnf(ctor.type);
+        std::uint32_t i = 0, field = 0;
+        while(p_.kind(t) == ExprKind::Pi)
+        {
+            const ExprNode n = p_[t];
+            if(i++ >= ctor.nparams)
+            {
+                std::uint32_t arity = 0;
+                Expr ft = tc_.whnf(n.b);
+                while(p_.kind(ft) == ExprKind::Pi)
+                {
+                    const ExprNode m = p_[ft];
+                    ft = tc_.whnf(p_.instantiate(m.c, tc_.mk_local(m.a, m.b, m.binfo)));
+                    ++arity;
+                }
+                Expr h = p_.app_fn(ft);
+                for(std::uint32_t k = 0; k < rec.all.size(); ++k)
+                    if(p_.is_const(h, rec.all[k])) out.push_back({field, k, arity});
+                ++field;
+            }
+            t = tc_.whnf(p_.instantiate(n.c, tc_.mk_local(n.a, n.b, n.binfo)));
+        }
+        return out;
+    }
+
+    Ir compile_def(const Declaration& d, const std::vector<bool>& keep)
+    {
+        std::vector<Expr> xs;
+        Expr t = tc_.whnf(d.type);
+        while(p_.kind(t) == ExprKind::Pi)
+        {
+            const ExprNode n = p_[t];
+            xs.push_back(tc_.mk_local(n.a, n.b, n.binfo));
+            t = tc_.whnf(p_.instantiate(n.c, xs.back()));
+        }
+        // peel the value's lambdas with the same locals, apply the rest (η-expansion)
+        Expr v = d.value;
+        std::size_t i = 0;
+        for(; i < xs.size() && p_.kind(v) == ExprKind::Lam; ++i) v = p_.instantiate(p_[v].c, xs[i]);
+        for(std::size_t j = i; j < xs.size(); ++j) v = p_.app(v, xs[j]);
+
+        std::vector<Expr> ctx;
+        for(std::size_t j = 0; j < xs.size(); ++j) if(keep[j]) ctx.push_back(xs[j]);
+        Ir body = erase(v, ctx);
+        for(std::size_t j = ctx.size(); j-- > 0;) body = mk(IrKind::Lam, body);
+        return body;
+    }
+
+    Ir var(Expr x, const std::vector<Expr>& ctx)
+    {
+        for(std::size_t i = ctx.size(); i-- > 0;)
+            if(ctx[i] == x) return mk(IrKind::Var, std::uint32_t(ctx.size() - 1 - i));
+        return mk(IrKind::Erased); // a removed binder, only reachable in irrelevant positions
+    }
+
+    Ir erase(Expr e, std::vector<Expr>& ctx)
+    {
+        if(irrelevant(e)) return mk(IrKind::Erased);
+        const ExprNode n = p_[e];
+        switch(n.kind)
+        {
+            case ExprKind::FVar: return var(e, ctx);
+            case ExprKind::Const: case ExprKind::App: return erase_app(e, ctx);
+            case ExprKind::Lam:
+            {
+                Expr x = tc_.mk_local(n.a, n.b, n.binfo);
+                ctx.push_back(x);
+                Ir body = erase(p_.instantiate(n.c, x), ctx);
+                ctx.pop_back();
+                return mk(IrKind::Lam, body);
+            }
+            case ExprKind::Let:
+            {
+                Ir v = erase(n.c, ctx);
+                Expr x = tc_.mk_local(n.a, n.b);
+                ctx.push_back(x);
+                Ir body = erase(p_.instantiate(n.d, x), ctx);
+                ctx.pop_back();
+                return mk(IrKind::Let, v, body);
+            }
+            default: return mk(IrKind::Erased);
+        }
+    }
+
+    Ir erase_app(Expr e, std::vector<Expr>& ctx)
+    {
+        std::vector<Expr> args;
+        Expr f = p_.app_args(e, args);
+        Ir r;
+        std::size_t i = 0;
+        if(std::uint64_t k = 0; nat_ && numeral(e, k))
+            return mk(IrKind::NatLit, std::uint32_t(k), std::uint32_t(k >> 32));
+        if(p_.kind(f) == ExprKind::Const)
+        {
+            Code& c = code(p_[f].a);
+            if(c.kind == CodeKind::Irrelevant) return mk(IrKind::Erased);
+            if(args.size() < c.keep.size())
+            {
+                // under-applied constant: η-expand so every binder position is known
+                Expr t = tc_.whnf(tc_.infer(e));
+                std::vector<Expr> ys;
+                while(args.size() + ys.size() < c.keep.size() && p_.kind(t) == ExprKind::Pi)
+                {
+                    const ExprNode n = p_[t];
+                    ys.push_back(tc_.mk_local(n.a, n.b, n.binfo));
+                    t = tc_.whnf(p_.instantiate(n.c, ys.back()));
+                }
+                return erase(tc_.mk_lambda(ys, p_.app(e, ys)), ctx);
+            }
+            r = mk(IrKind::Const, p_[f].a);
+            for(; i < c.keep.size(); ++i) if(c.keep[i]) r = mk(IrKind::App, r, erase(args[i], ctx));
+        }
+        else if(p_.kind(f) == ExprKind::Lam && !args.empty())
+        {
+            // β-redex: let-bind instead of substituting so the argument is evaluated once
+            const ExprNode n = p_[f];
+            Expr x = tc_.mk_local(n.a, n.b, n.binfo);
+            Ir v = erase(args[0], ctx);
+            ctx.push_back(x);
+            Expr rest = p_.app(p_.instantiate(n.c, x), std::span<const Expr>(args).subspan(1));
+            Ir body = erase(rest, ctx);
+            ctx.pop_back();
+            return mk(IrKind::Let, v, body);
+        }
+        else r = erase(f, ctx);
+        for(; i < args.size(); ++i) r = mk(IrKind::App, r, erase(args[i], ctx));
+        return r;
+    }
+
+    // Nat.succ (... (Nat.succ Nat.zero))
+    bool numeral(Expr e, std::uint64_t& k)
+    {
+        Name zero = p_.names.append(nat_, "zero"), succ = p_.names.append(nat_, "succ");
+        for(k = 0; p_.kind(e) == ExprKind::App && p_.is_const(p_[e].a, succ); ++k) e = p_[e].b;
+        return p_.is_const(e, zero);
+    }
+
+    // running //
+
+    ValuePtr mk_nat(std::uint64_t n)
+    {
+        auto v = std::make_shared<Value>();
+        v->kind = Value::Kind::Nat;
+        v->nat = n;
+        return v;
+    }
+
+    ValuePtr lookup(const FramePtr& env, std::uint32_t i)
+    {
+        const Frame* f = env.get();
+        while(i--) f = f->next.get();
+        return f->value;
+    }
+
+    ValuePtr run(Ir e, const FramePtr& env)
+    {
+        const IrNode n = ir_[e];
+        switch(n.kind)
+        {
+            case IrKind::Erased: return erased_;
+            case IrKind::Var: return lookup(env, n.a);
+            case IrKind::NatLit: return mk_nat(std::uint64_t(n.b) << 32 | n.a);
+            case IrKind::Lam:
+            {
+                if(n.loose == 0)
+                    if(auto it = closed_.find(e); it != closed_.end()) return it->second;
+                auto v = std::make_shared<Value>();
+                v->kind = Value::Kind::Closure;
+                v->body = n.a;
+                if(n.loose == 0) closed_.emplace(e, v);
+                else v->env = env;
+                return v;
+            }
+            case IrKind::App:
+            {
+                ValuePtr f = run(n.a, env);
+                return apply(f, run(n.b, env));
+            }
+            case IrKind::Let: return run(n.b, std::make_shared<const Frame>(Frame{run(n.a, env), env}));
+            case IrKind::Const: return constant(n.a);
+        }
+        return erased_;
+    }
+
+    ValuePtr constant(Name n)
+    {
+        Code& c = code(n);
+        if(c.kind == CodeKind::Def)
+        {
+            if(!c.value) c.value = run(c.body, nullptr);
+            return c.value;
+        }
+        if(c.arity == 0) return call(c, {});
+        auto v = std::make_shared<Value>();
+        v->kind = Value::Kind::Pap;
+        v->head = n;
+        return v;
+    }
+
+    ValuePtr apply(ValuePtr f, ValuePtr x)
+    {
+        f = force(f);
+        switch(f->kind)
+        {
+            case Value::Kind::Closure:
+                return run(f->body, std::make_shared<const Frame>(Frame{x, f->env}));
+            case Value::Kind::Native: return f->native(x);
+            case Value::Kind::Pap:
+            {
+                Code& c = code(f->head);
+                std::vector<ValuePtr> args = f->items;
+                args.push_back(x);
+                if(args.size() == c.arity) return call(c, std::move(args));
+                auto v = std::make_shared<Value>();
+                v->kind = Value::Kind::Pap;
+                v->head = f->head;
+                v->items = std::move(args);
+                return v;
+            }
+            case Value::Kind::Erased: return erased_;
+            default: throw eval_exception("applying a non-function value");
+        }
+    }
+
+    // Nat is a machine integer here: a result past 2^64 - 1 is an error, not a wrapped value
+    static std::uint64_t nat_add(std::uint64_t a, std::uint64_t b)
+    {
+        std::uint64_t r;
+        if(__builtin_add_overflow(a, b, &r)) throw eval_exception("Nat overflow");
+        return r;
+    }
+
+    static std::uint64_t nat_mul(std::uint64_t a, std::uint64_t b)
+    {
+        std::uint64_t r;
+        if(__builtin_mul_overflow(a, b, &r)) throw eval_exception("Nat overflow");
+        return r;
+    }
+
+    ValuePtr call(Code& c, std::vector<ValuePtr> args)
+    {
+        switch(c.kind)
+        {
+            case CodeKind::NatZero: return mk_nat(0);
+            case CodeKind::NatSucc: return mk_nat(nat_add(force(args[0])->nat, 1));
+            case CodeKind::NatAdd: return mk_nat(nat_add(force(args[0])->nat, force(args[1])->nat));
+            case CodeKind::NatSub:
+            {
+                std::uint64_t a = force(args[0])->nat, b = force(args[1])->nat;
+                return mk_nat(a > b ? a - b : 0);
+            }
+            case CodeKind::NatMul: return mk_nat(nat_mul(force(args[0])->nat, force(args[1])->nat));
+            case CodeKind::QuotMk: return args[0];
+            case CodeKind::QuotLift: return apply(args[0], args[1]);
+            case CodeKind::Ctor:
+            {
+                // the kept args are the relevant fields; minors take every field, so proofs and
+                // types go back in as □ and items[i] is field i
+                const Declaration& d = env_.get(c.name);
+                auto v = std::make_shared<Value>();
+                v->kind = Value::Kind::Ctor;
+                v->head = c.name;
+                v->tag = d.cidx;
+                std::size_t j = 0;
+                for(std::size_t i = d.nparams; i < c.keep.size(); ++i) v->items.push_back(c.keep[i] ? std::move(args[j++]) : erased_);
+                return v;
+            }
+            case CodeKind::Rec:
+            {
+                ValuePtr major = args.back();
+                args.pop_back();
+                return recurse(c, std::move(args), major);
+            }
+            default: return erased_;
+        }
+    }
+
+    // I.rec minors (c fields) ↦ minor fields ihs, ihs evaluated lazily
+    ValuePtr recurse(Code& c, std::vector<ValuePtr> minors, ValuePtr major)
+    {
+        major = force(major);
+        const Declaration& rec = env_.get(c.name);
+        std::uint32_t tag = 0;
+        std::vector<ValuePtr> fields;
+        if(major->kind == Value::Kind::Nat && rec.induct == nat_)
+        {
+            if(major->nat > 0) { tag = 1; fields.push_back(mk_nat(major->nat - 1)); }
+        }
+        else if(major->kind == Value::Kind::Ctor)
+        {
+            tag = major->tag;
+            fields = major->items;
+        }
+        else if(major->kind == Value::Kind::Erased)
+        {
+            // proof of a one-constructor Prop (Eq.rec and friends): every field is irrelevant
+            const Declaration& ind = env_.get(rec.induct);
+            if(ind.ctors.size() != 1) throw eval_exception("stuck recursor on an erased value");
+            fields.assign(env_.get(ind.ctors[0]).nfields, erased_);
+        }
+        else throw eval_exception("recursor applied to a non-constructor value");
+
+        ValuePtr r = minors[c.minor_offset + tag];
+        for(const ValuePtr& f : fields) r = apply(r, f);
+        for(const RecField& rf : c.rec_fields[tag])
+        {
+            Code& target = code(p_.names.append(rec.all[rf.k], "rec"));
+            ValuePtr field = fields[rf.field];
+            r = apply(r, ih(target, minors, field, rf.arity));
+        }
+        return r;
+    }
+
+    ValuePtr ih(Code& target, const std::vector<ValuePtr>& minors, ValuePtr field, std::uint32_t arity)
+    {
+        auto v = std::make_shared<Value>();
+        if(arity == 0)
+        {
+            v->kind = Value::Kind::Thunk;
+            v->delayed = [this, &target, minors, field] { return recurse(target, minors, field); };
+            return v;
+        }
+        v->kind = Value::Kind::Native;
+        v->native = [this, &target, minors, field, arity](ValuePtr y) { return ih(target, minors, apply(field, y), arity - 1); };
+        return v;
+    }
+
+    Environment& env_;
+    Pool& p_;
+    TypeChecker tc_;
+    Name nat_ = 0;
+    std::vector<IrNode> ir_;
+    std::unordered_map<Name, Code> codes_;
+    std::unordered_map<Ir, ValuePtr> closed_;
+    ValuePtr erased_;
+};
+
+} // namespace vl
+
+#endif // EVAL_HPP
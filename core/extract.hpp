@@ -0,0 +1,466 @@
+// extract.hpp - emit computable definitions as standalone C++23 source
+// works on the erased IR (eval.hpp): every reachable constant becomes a C++ function over a small
+// value type (Nat as a machine integer, constructors and closures on the heap), recursors become
+// tag switches with lazy induction hypotheses, and bench_main wraps closed terms in a timing loop.
+// the output only needs the standard library, so it builds with the host compiler.
+// (c) 2025 Zachary R. James
+
+#ifndef EXTRACT_HPP
+#define EXTRACT_HPP
+
+#include "eval.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace vl {
+
+class Extractor
+{
+public:
+    explicit Extractor(Evaluator& ev) : ev_(ev), p_(ev.p_) {}
+
+    // extract n and everything it reaches
+    void add(Name n)
+    {
+        std::vector<Name> todo{n};
+        while(!todo.empty())
+        {
+            Name c = todo.back();
+            todo.pop_back();
+            if(!seen_.insert(c).second) continue;
+            order_.push_back(c);
+            const Evaluator::Code& code = ev_.code(c);
+            if(code.kind == Evaluator::CodeKind::Def) consts(code.body, todo);
+            if(code.kind == Evaluator::CodeKind::Rec)
+                for(Name t : ev_.env_.get(c).all) todo.push_back(p_.names.append(t, "rec"));
+        }
+    }
+
+    // erase a closed term for bench_main, pulling in the constants it uses
+    Ir add_term(Expr e)
+    {
+        Ir ir = ev_.erase(e);
+        std::vector<Name> todo;
+        consts(ir, todo);
+        for(Name c : todo) add(c);
+        return ir;
+    }
+
+    // translation unit with the runtime and one function per extracted constant (no main)
+    std::string source()
+    {
+        std::string out = runtime;
+        for(Name c : order_) out += "V " + fn(c) + "(" + params(ev_.code(c).arity, false) + ");\n";
+        for(Name c : order_) if(ev_.code(c).kind == Evaluator::CodeKind::Rec) out += "V " + rec_fn(c) + "(Minors ms, V major);\n";
+        out += "\n";
+        for(Name c : order_) out += emit(c);
+        out += "inline const char* const ctor_names[] = {\"□\"";
+        for(const std::string& s : ctor_names_) out += ", \"" + s + "\"";
+        out += "};\n";
+        out += "inline const char* const ctor_shown[] = {\"\"";
+        for(const std::string& s : ctor_shown_) out += ", \"" + s + "\"";
+        out += "};\n\n";
+        out += printer;
+        out += "} // namespace vlx\n";
+        return out;
+    }
+
+    // source() plus a main that times each closed term over `iterations` runs
+    std::string bench_main(const std::vector<std::pair<std::string, Expr>>& terms, std::uint32_t iterations)
+    {
+        std::vector<std::pair<std::string, Ir>> irs;
+        for(const auto& [label, e] : terms) irs.emplace_back(label, add_term(e));
+        std::string body;
+        for(const auto& [label, ir] : irs)
+        {
+            std::vector<std::string> ctx;
+            body += "    bench(\"" + label + "\", [] { return " + expr(ir, ctx) + "; });\n";
+        }
+        return source() + "\nint main()\n{\n    using namespace vlx;\n    constexpr int iterations = " +
+               std::to_string(iterations) + ";\n" + std::string(bench_loop) + body + "    return failed;\n}\n";
+    }
+
+private:
+    static constexpr const char* runtime = R"cpp(// generated by visual_lean extract, do not edit
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace vlx {
+
+struct Obj;
+
+// Nat: o == nullptr and n holds the value, erased values are V{}
+struct V
+{
+    std::uint64_t n = 0;
+    std::shared_ptr<Obj> o;
+};
+
+enum class K : std::uint8_t { Ctor, Fn, Thunk };
+
+struct Obj
+{
+    K k;
+    std::uint32_t tag = 0, name = 0;
+    std::vector<V> fields;
+    std::function<V(V)> fn;
+    std::function<V()> delayed;
+    V forced;
+};
+
+// minor premises of one recursor call, shared by every ih it hands out
+using Minors = std::shared_ptr<const std::vector<V>>;
+
+inline V nat(std::uint64_t n) { return {n, nullptr}; }
+
+inline V ctor(std::uint32_t tag, std::uint32_t name, std::vector<V> fields)
+{
+    auto o = std::make_shared<Obj>();
+    o->k = K::Ctor;
+    o->tag = tag;
+    o->name = name;
+    o->fields = std::move(fields);
+    return {0, std::move(o)};
+}
+
+inline V fn(std::function<V(V)> f)
+{
+    auto o = std::make_shared<Obj>();
+    o->k = K::Fn;
+    o->fn = std::move(f);
+    return {0, std::move(o)};
+}
+
+inline V lazy(std::function<V()> f)
+{
+    auto o = std::make_shared<Obj>();
+    o->k = K::Thunk;
+    o->delayed = std::move(f);
+    return {0, std::move(o)};
+}
+
+inline V force(V v)
+{
+    while(v.o && v.o->k == K::Thunk)
+    {
+        Obj& t = *v.o;
+        if(t.delayed)
+        {
+            t.forced = t.delayed();
+            t.delayed = nullptr;
+        }
+        v = t.forced;
+    }
+    return v;
+}
+
+inline V ap(V f, V x)
+{
+    f = force(f);
+    return f.o ? f.o->fn(std::move(x)) : V{};
+}
+
+// Nat is a machine integer here as in the evaluator: a result past 2^64 - 1 is an error, not a wrapped value
+inline V nat_add(V a, V b)
+{
+    std::uint64_t r;
+    if(__builtin_add_overflow(force(a).n, force(b).n, &r)) throw std::overflow_error("Nat overflow");
+    return nat(r);
+}
+
+inline V nat_mul(V a, V b)
+{
+    std::uint64_t r;
+    if(__builtin_mul_overflow(force(a).n, force(b).n, &r)) throw std::overflow_error("Nat overflow");
+    return nat(r);
+}
+
+)cpp";
+
+    static constexpr const char* printer = R"cpp(inline std::string show(V v)
+{
+    v = force(v);
+    if(!v.o) return std::to_string(v.n);
+    if(v.o->k != K::Ctor) return "<fun>";
+    std::string s = ctor_names[v.o->name], fs;
+    for(std::size_t i = 0; i < v.o->fields.size(); ++i)
+        if(ctor_shown[v.o->name][i] == '1') fs += " " + show(v.o->fields[i]);
+    return fs.empty() ? s : "(" + s + fs + ")";
+}
+
+)cpp";
+
+    // a term whose evaluation fails (Nat overflow) prints the error, and main exits 1
+    static constexpr const char* bench_loop = R"cpp(    int failed = 0;
+    auto bench = [&](const char* label, auto run) {
+        try
+        {
+            V r = force(run());
+            auto t0 = std::chrono::steady_clock::now();
+            for(int i = 0; i < iterations; ++i) r = force(run());
+            double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / iterations;
+            std::printf("%-28s %12.3f us/run  = %s\n", label, us, show(r).c_str());
+        }
+        catch(const std::exception& e)
+        {
+            std::printf("%-28s error: %s\n", label, e.what());
+            failed = 1;
+        }
+    };
+)cpp";
+
+    void consts(Ir e, std::vector<Name>& out) const
+    {
+        const IrNode& n = ev_.ir_[e];
+        switch(n.kind)
+        {
+            case IrKind::Const: out.push_back(n.a); break;
+            case IrKind::Lam: consts(n.a, out); break;
+            case IrKind::App: case IrKind::Let: consts(n.a, out); consts(n.b, out); break;
+            default: break;
+        }
+    }
+
+    // does e mention de Bruijn index i
+    bool uses(Ir e, std::uint32_t i) const
+    {
+        const IrNode& n = ev_.ir_[e];
+        if(n.loose <= i) return false;
+        switch(n.kind)
+        {
+            case IrKind::Var: return n.a == i;
+            case IrKind::Lam: return uses(n.a, i + 1);
+            case IrKind::App: return uses(n.a, i) || uses(n.b, i);
+            case IrKind::Let: return uses(n.a, i) || uses(n.b, i + 1);
+            default: return false;
+        }
+    }
+
+    // Nat.add -> Nat_add, anything outside [A-Za-z0-9_] as _xHH
+    std::string mangle(Name n) const
+    {
+        static const char* hex = "0123456789abcdef";
+        std::string out;
+        for(unsigned char c : p_.names.str(n))
+        {
+            if(std::isalnum(c) || c == '_') out += char(c);
+            else if(c == '.') out += '_';
+            else { out += "_x"; out += hex[c >> 4]; out += hex[c & 15]; }
+        }
+        return out;
+    }
+
+    std::string fn(Name n) const { return "d_" + mangle(n); }
+    std::string rec_fn(Name n) const { return "r_" + mangle(n); }
+
+    static std::string params(std::uint32_t k, bool named)
+    {
+        std::string s;
+        for(std::uint32_t i = 0; i < k; ++i) s += (i ? ", V" : "V") + (named ? " a" + std::to_string(i) : "");
+        return s;
+    }
+
+    std::string fresh() { return "x" + std::to_string(next_++); }
+
+    // shown: a '1' per relevant field, '0' per erased one (which is V{} like Nat 0)
+    std::uint32_t ctor_name(Name n, std::string shown)
+    {
+        auto [it, fresh] = ctor_ids_.emplace(n, std::uint32_t(ctor_names_.size() + 1));
+        if(fresh)
+        {
+            ctor_names_.push_back(p_.names.str(n));
+            ctor_shown_.push_back(std::move(shown));
+        }
+        return it->second;
+    }
+
+    // curried closure over a constant of arity k
+    std::string curried(Name c, std::uint32_t k)
+    {
+        if(k == 0) return fn(c) + "()";
+        std::string call = fn(c) + "(";
+        for(std::uint32_t i = 0; i < k; ++i) call += (i ? ", a" : "a") + std::to_string(i);
+        std::string body = "return " + call + ");";
+        for(std::uint32_t i = k; i-- > 0;)
+        {
+            std::string caps;
+            for(std::uint32_t j = 0; j < i; ++j) caps += (j ? ", a" : "a") + std::to_string(j);
+            body = "return fn([" + caps + "](V a" + std::to_string(i) + ") -> V { " + body + " });";
+        }
+        return "[] { " + body + " }()";
+    }
+
+    std::string expr(Ir e, std::vector<std::string>& ctx)
+    {
+        const IrNode n = ev_.ir_[e];
+        switch(n.kind)
+        {
+            case IrKind::Erased: return "V{}";
+            case IrKind::Var: return ctx[ctx.size() - 1 - n.a];
+            case IrKind::NatLit: return "nat(" + std::to_string(std::uint64_t(n.b) << 32 | n.a) + "ull)";
+            case IrKind::Lam:
+            {
+                std::string x = fresh();
+                ctx.push_back(x);
+                std::string body = expr(n.a, ctx);
+                ctx.pop_back();
+                std::string f = "fn([=](V" + (uses(n.a, 0) ? " " + x : "") + ") -> V { return " + body + "; })";
+                return n.loose ? f : "[] { static const V v = " + f + "; return v; }()";
+            }
+            case IrKind::Let:
+            {
+                std::string v = expr(n.a, ctx), x = fresh();
+                ctx.push_back(x);
+                std::string body = expr(n.b, ctx);
+                ctx.pop_back();
+                return "[&]() -> V { V " + x + " = " + v + "; return " + body + "; }()";
+            }
+            case IrKind::Const: case IrKind::App:
+            {
+                std::vector<Ir> args;
+                Ir h = e;
+                while(ev_.ir_[h].kind == IrKind::App) { args.push_back(ev_.ir_[h].b); h = ev_.ir_[h].a; }
+                std::reverse(args.begin(), args.end());
+                std::string r;
+                std::size_t i = 0;
+                if(ev_.ir_[h].kind == IrKind::Const)
+                {
+                    Name c = ev_.ir_[h].a;
+                    std::uint32_t k = ev_.code(c).arity;
+                    if(args.size() >= k)
+                    {
+                        r = fn(c) + "(";
+                        for(; i < k; ++i) r += (i ? ", " : "") + expr(args[i], ctx);
+                        r += ")";
+                    }
+                    else r = curried(c, k);
+                }
+                else r = expr(h, ctx);
+                for(; i < args.size(); ++i) r = "ap(" + r + ", " + expr(args[i], ctx) + ")";
+                return r;
+            }
+        }
+        return "V{}";
+    }
+
+    std::string emit(Name c)
+    {
+        const Evaluator::Code& code = ev_.code(c);
+        std::string head = "V " + fn(c) + "(" + params(code.arity, true) + ")\n{\n";
+        std::string src = "// " + p_.names.str(c) + "\n";
+        switch(code.kind)
+        {
+            case Evaluator::CodeKind::Def:
+            {
+                // peel the λ per kept binder, the body sees them as a0..ak-1
+                std::vector<std::string> ctx;
+                Ir b = code.body;
+                for(std::uint32_t i = 0; i < code.arity; ++i) { ctx.push_back("a" + std::to_string(i)); b = ev_.ir_[b].a; }
+                head = "V " + fn(c) + "(";
+                for(std::uint32_t i = 0; i < code.arity; ++i)
+                    head += (i ? ", V" : "V") + (uses(b, code.arity - 1 - i) ? " " + ctx[i] : "");
+                head += ")\n{\n";
+                if(code.arity == 0) return src + head + "    static const V v = " + expr(b, ctx) + ";\n    return v;\n}\n\n";
+                return src + head + "    return " + expr(b, ctx) + ";\n}\n\n";
+            }
+            case Evaluator::CodeKind::NatZero: return src + head + "    return nat(0);\n}\n\n";
+            case Evaluator::CodeKind::NatSucc: return src + head + "    return nat_add(a0, nat(1));\n}\n\n";
+            case Evaluator::CodeKind::NatAdd: return src + head + "    return nat_add(a0, a1);\n}\n\n";
+            case Evaluator::CodeKind::NatSub:
+                return src + head + "    std::uint64_t a = force(a0).n, b = force(a1).n;\n    return nat(a > b ? a - b : 0);\n}\n\n";
+            case Evaluator::CodeKind::NatMul: return src + head + "    return nat_mul(a0, a1);\n}\n\n";
+            case Evaluator::CodeKind::QuotMk: return src + head + "    return a0;\n}\n\n";
+            case Evaluator::CodeKind::QuotLift: return src + head + "    return ap(a0, a1);\n}\n\n";
+            case Evaluator::CodeKind::Ctor:
+            {
+                // every field, V{} for the erased ones, as the evaluator lays them out
+                const Declaration& d = ev_.env_.get(c);
+                std::string fields, shown;
+                std::uint32_t j = 0;
+                for(std::size_t i = d.nparams; i < code.keep.size(); ++i)
+                {
+                    fields += i > d.nparams ? ", " : "";
+                    fields += code.keep[i] ? "a" + std::to_string(j++) : "V{}";
+                    shown += code.keep[i] ? '1' : '0';
+                }
+                return src + head + "    return ctor(" + std::to_string(d.cidx) + ", " + std::to_string(ctor_name(c, shown)) +
+                       ", {" + fields + "});\n}\n\n";
+            }
+            case Evaluator::CodeKind::Rec:
+            {
+                std::string ms;
+                for(std::uint32_t i = 0; i + 1 < code.arity; ++i) ms += (i ? ", a" : "a") + std::to_string(i);
+                return src + head + "    return " + rec_fn(c) + "(std::make_shared<const std::vector<V>>(std::vector<V>{" + ms + "}), a" + std::to_string(code.arity - 1) + ");\n}\n\n" +
+                       emit_rec(c, code);
+            }
+            case Evaluator::CodeKind::Irrelevant:
+                return src + "V " + fn(c) + "(" + params(code.arity, false) + ")\n{\n    return V{};\n}\n\n";
+        }
+        return "";
+    }
+
+    std::string ih(const Evaluator::RecField& rf, const std::string& target, const std::string& field, std::uint32_t depth)
+    {
+        if(depth == rf.arity) return "lazy([ms, f = " + field + "] { return " + target + "(ms, f); })";
+        std::string y = "y" + std::to_string(depth);
+        return "fn([ms, g = " + field + "](V " + y + ") -> V { return " +
+               ih(rf, target, "ap(g, " + y + ")", depth + 1) + "; })";
+    }
+
+    // minors applied to the fields of the major, then one ih per recursive field
+    std::string emit_rec(Name c, const Evaluator::Code& code)
+    {
+        const Declaration& rec = ev_.env_.get(c);
+        const Declaration& ind = ev_.env_.get(rec.induct);
+        std::string out = "V " + rec_fn(c) + "(Minors ms, V major)\n{\n    V m = force(major);\n";
+        if(rec.induct == ev_.nat_)
+        {
+            std::string self = rec_fn(c);
+            return out + "    if(m.n == 0) return (*ms)[" + std::to_string(code.minor_offset) + "];\n"
+                   "    V f = nat(m.n - 1);\n"
+                   "    return ap(ap((*ms)[" + std::to_string(code.minor_offset + 1) + "], f), lazy([ms, f] { return " + self +
+                   "(ms, f); }));\n}\n\n";
+        }
+        out += "    std::vector<V> fs = m.o ? m.o->fields : std::vector<V>(" +
+               std::to_string(ind.ctors.size() == 1 ? ev_.env_.get(ind.ctors[0]).nfields : 0) + ");\n";
+        out += "    V r;\n    switch(m.o ? m.o->tag : 0)\n    {\n";
+        for(std::size_t t = 0; t < ind.ctors.size(); ++t)
+        {
+            std::uint32_t nf = ev_.env_.get(ind.ctors[t]).nfields;
+            out += "        case " + std::to_string(t) + ":\n            r = (*ms)[" + std::to_string(code.minor_offset + t) + "];\n";
+            for(std::uint32_t f = 0; f < nf; ++f) out += "            r = ap(r, fs[" + std::to_string(f) + "]);\n";
+            for(const Evaluator::RecField& rf : code.rec_fields[t])
+            {
+                std::string target = rec_fn(p_.names.append(rec.all[rf.k], "rec"));
+                out += "            r = ap(r, " + ih(rf, target, "fs[" + std::to_string(rf.field) + "]", 0) + ");\n";
+            }
+            out += "            return r;\n";
+        }
+        return out + "    }\n    return V{};\n}\n\n";
+    }
+
+    Evaluator& ev_;
+    Pool& p_;
+    std::vector<Name> order_;
+    std::unordered_set<Name> seen_;
+    std::unordered_map<Name, std::uint32_t> ctor_ids_;
+    std::vector<std::string> ctor_names_, ctor_shown_;
+    std::uint32_t next_ = 0;
+};
+
+} // namespace vl
+
+#endif // EXTRACT_HPP
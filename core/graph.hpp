@@ -0,0 +1,774 @@
+// graph.hpp - the declaration dependency graph, for rechecking, impact analysis and the workspace
+// nodes are declarations by their position in env.decls(); d depends on every declaration its type,
+// value or recursor rules mention. both directions are stored compressed (CSR): one offsets array
+// and one array of sorted targets each, so deps(v) and users(v) are a slice, O(degree) to walk
+// (c) 2025 Zachary R. James
+
+#ifndef GRAPH_HPP
+#define GRAPH_HPP
+
+#include "type_checker.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace vl {
+
+using Node = std::uint32_t;
+inline constexpr Node no_node = ~Node(0);
+
+// DEPENDENCY GRAPH //
+
+class DepGraph
+{
+public:
+    DepGraph() = default;
+
+    // one pass over the declarations, split in contiguous blocks over `threads` threads (0: one per
+    // core). the pool is only read, so the blocks need no locking; each collects its edges and the
+    // blocks are then laid end to end. the reverse side is a counting sort of the forward one
+    explicit DepGraph(const Environment& env, unsigned threads = 0)
+    {
+        std::span<const Declaration> ds = env.decls();
+        std::size_t n = ds.size();
+        if(threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = unsigned(std::clamp<std::size_t>(n / 256, 1, threads)); // small graphs stay on one
+
+        struct Block
+        {
+            std::vector<std::uint32_t> degree;
+            std::vector<Node> targets;
+        };
+        std::vector<Block> blocks(threads);
+        auto scan = [&](unsigned t) {
+            Block& b = blocks[t];
+            std::size_t lo = n * t / threads, hi = n * (t + 1) / threads;
+            std::unordered_set<Expr> seen;
+            std::vector<Name> used;
+            for(std::size_t i = lo; i < hi; ++i)
+            {
+                const Declaration& d = ds[i];
+                seen.clear();
+                used.clear();
+                env.pool.consts(d.type, seen, used);
+                if(d.value != no_expr) env.pool.consts(d.value, seen, used);
+                for(const RecRule& r : d.rules) env.pool.consts(r.rhs, seen, used);
+                std::size_t first = b.targets.size();
+                for(Name u : used)
+                    if(const Declaration* e = env.find(u); e && e != &d) b.targets.push_back(Node(e - ds.data()));
+                std::sort(b.targets.begin() + first, b.targets.end());
+                b.targets.erase(std::unique(b.targets.begin() + first, b.targets.end()), b.targets.end());
+                b.degree.push_back(std::uint32_t(b.targets.size() - first));
+            }
+        };
+        if(threads == 1) scan(0);
+        else
+        {
+            std::vector<std::jthread> pool;
+            for(unsigned t = 0; t < threads; ++t) pool.emplace_back(scan, t);
+        }
+
+        fwd_off_.reserve(n + 1);
+        fwd_off_.push_back(0);
+        for(Block& b : blocks)
+        {
+            for(std::uint32_t k : b.degree) fwd_off_.push_back(fwd_off_.back() + k);
+            fwd_.insert(fwd_.end(), b.targets.begin(), b.targets.end());
+            b = {};
+        }
+
+        // sources are visited in order, so each users() list comes out sorted
+        rev_off_.assign(n + 1, 0);
+        for(Node t : fwd_) ++rev_off_[t + 1];
+        for(std::size_t i = 0; i < n; ++i) rev_off_[i + 1] += rev_off_[i];
+        rev_.resize(fwd_.size());
+        std::vector<std::uint32_t> fill(rev_off_.begin(), rev_off_.end() - 1);
+        for(Node v = 0; v < n; ++v)
+            for(Node t : deps(v)) rev_[fill[t]++] = v;
+    }
+
+    std::size_t size() const { return fwd_off_.empty() ? 0 : fwd_off_.size() - 1; }
+    std::size_t edges() const { return fwd_.size(); }
+
+    // what v mentions / what mentions v, each sorted
+    std::span<const Node> deps(Node v) const { return {fwd_.data() + fwd_off_[v], fwd_.data() + fwd_off_[v + 1]}; }
+    std::span<const Node> users(Node v) const { return {rev_.data() + rev_off_[v], rev_.data() + rev_off_[v + 1]}; }
+
+    // the node of declaration n, no_node if env does not have it
+    static Node node(const Environment& env, Name n)
+    {
+        const Declaration* d = env.find(n);
+        return d ? Node(d - env.decls().data()) : no_node;
+    }
+
+    // everything that transitively uses one of `changed` (which come first), each once: what needs
+    // rechecking after an edit. linear in the edges walked
+    std::vector<Node> dependents(std::span<const Node> changed) const
+    {
+        std::vector<bool> seen(size());
+        std::vector<Node> out;
+        for(Node v : changed)
+            if(!seen[v]) { seen[v] = true; out.push_back(v); }
+        for(std::size_t i = 0; i < out.size(); ++i)
+            for(Node u : users(out[i]))
+                if(!seen[u]) { seen[u] = true; out.push_back(u); }
+        return out;
+    }
+
+private:
+    std::vector<std::uint32_t> fwd_off_, rev_off_;
+    std::vector<Node> fwd_, rev_;
+};
+
+// REACHABILITY //
+// "does a depend on b, however indirectly" for a chosen set of targets b (the axioms, say), O(1)
+// per query and for every declaration at once. each node gets a bitset over the targets, the union
+// of its dependencies' bitsets and their own bits, filled in one pass dependencies first. mutual
+// blocks (recursors of mutual inductives use each other) are cycles, so the pass runs over strongly
+// connected components (Tarjan, iterative), and members of one component share a bitset. the
+// targets are taken in chunks of 64 laid out chunk by chunk (one u64 per component each), so a
+// query reads one word and a pass over one chunk walks memory in order.
+// b outside the targets falls back to a walk from a, pruned by level (a component sits above
+// everything it reaches)
+
+class Reachability
+{
+public:
+    Reachability() = default;
+
+    Reachability(const DepGraph& g, std::span<const Node> targets) : targets_(targets.begin(), targets.end())
+    {
+        std::size_t n = g.size();
+        components(g);
+        std::size_t m = level_.size();
+        target_.assign(n, no_node);
+        for(std::size_t i = 0; i < targets_.size(); ++i) target_[targets_[i]] = Node(i);
+        words_ = (targets_.size() + 63) / 64;
+        bits_.assign(words_ * m, 0);
+
+        // components come out of Tarjan dependencies first, so one pass in that order fills them
+        std::vector<Node> members_off(m + 1, 0), members(n);
+        for(Node v = 0; v < n; ++v) ++members_off[comp_[v] + 1];
+        for(std::size_t c = 0; c < m; ++c) members_off[c + 1] += members_off[c];
+        std::vector<Node> fill(members_off.begin(), members_off.end() - 1);
+        for(Node v = 0; v < n; ++v) members[fill[comp_[v]]++] = v;
+        for(Node c = 0; c < m; ++c)
+        {
+            std::uint32_t level = 0;
+            for(Node k = members_off[c]; k < members_off[c + 1]; ++k)
+            {
+                Node v = members[k];
+                for(Node d : g.deps(v))
+                {
+                    Node dc = comp_[d];
+                    if(dc == c)
+                    {
+                        if(target_[d] != no_node) set(c, target_[d]);
+                        continue;
+                    }
+                    level = std::max(level, level_[dc] + 1);
+                    if(target_[d] != no_node) set(c, target_[d]);
+                    for(std::size_t w = 0; w < words_; ++w) bits_[w * m + c] |= bits_[w * m + dc];
+                }
+            }
+            level_[c] = level;
+        }
+    }
+
+    std::size_t size() const { return comp_.size(); }
+    std::span<const Node> targets() const { return targets_; }
+
+    // a reaches b through one or more edges (a itself only when it is in a cycle)
+    bool depends(Node a, Node b) const
+    {
+        if(Node t = target_[b]; t != no_node) return bits_[(t / 64) * level_.size() + comp_[a]] >> (t % 64) & 1;
+        return walk(a, b);
+    }
+
+    // the targets a depends on, in the order they were given
+    std::vector<Node> targets_of(Node a) const
+    {
+        std::vector<Node> out;
+        for(std::size_t w = 0; w < words_; ++w)
+            for(std::uint64_t x = bits_[w * level_.size() + comp_[a]]; x; x &= x - 1)
+                out.push_back(targets_[w * 64 + std::size_t(std::countr_zero(x))]);
+        return out;
+    }
+
+    // how many nodes depend on each target, in target order
+    std::vector<std::size_t> counts() const
+    {
+        std::vector<std::size_t> out(targets_.size());
+        std::size_t m = level_.size();
+        std::vector<std::uint32_t> members(m);
+        for(Node c : comp_) ++members[c];
+        for(std::size_t w = 0; w < words_; ++w)
+            for(std::size_t c = 0; c < m; ++c)
+                for(std::uint64_t x = bits_[w * m + c]; x; x &= x - 1) out[w * 64 + std::size_t(std::countr_zero(x))] += members[c];
+        return out;
+    }
+
+    Node component(Node v) const { return comp_[v]; }
+    std::uint32_t level(Node v) const { return level_[comp_[v]]; }
+
+private:
+    void set(Node c, Node t) { bits_[(t / 64) * level_.size() + c] |= std::uint64_t(1) << (t % 64); }
+
+    // Tarjan over deps edges without recursion; a component is numbered once everything it reaches is
+    void components(const DepGraph& g)
+    {
+        std::size_t n = g.size();
+        comp_.assign(n, no_node);
+        std::vector<Node> index(n, no_node), low(n), stack;
+        std::vector<std::pair<Node, std::uint32_t>> calls; // node, next dependency to look at
+        Node next = 0, count = 0;
+        g_ = &g;
+        for(Node root = 0; root < n; ++root)
+        {
+            if(index[root] != no_node) continue;
+            calls.push_back({root, 0});
+            index[root] = low[root] = next++;
+            stack.push_back(root);
+            while(!calls.empty())
+            {
+                auto& [v, i] = calls.back();
+                std::span<const Node> ds = g.deps(v);
+                if(i < ds.size())
+                {
+                    Node d = ds[i++];
+                    if(index[d] == no_node)
+                    {
+                        index[d] = low[d] = next++;
+                        stack.push_back(d);
+                        calls.push_back({d, 0});
+                    }
+                    else if(comp_[d] == no_node) low[v] = std::min(low[v], index[d]);
+                    continue;
+                }
+                Node done = v;
+                calls.pop_back();
+                if(!calls.empty()) low[calls.back().first] = std::min(low[calls.back().first], low[done]);
+                if(low[done] != index[done]) continue;
+                Node x;
+                do
+                {
+                    x = stack.back();
+                    stack.pop_back();
+                    comp_[x] = count;
+                } while(x != done);
+                ++count;
+            }
+        }
+        level_.assign(count, 0);
+    }
+
+    bool walk(Node a, Node b) const
+    {
+        std::uint32_t floor = level_[comp_[b]];
+        std::vector<bool> seen(comp_.size());
+        std::vector<Node> todo(g_->deps(a).begin(), g_->deps(a).end());
+        while(!todo.empty())
+        {
+            Node x = todo.back();
+            todo.pop_back();
+            if(x == b) return true;
+            if(seen[x] || level_[comp_[x]] < floor) continue;
+            seen[x] = true;
+            for(Node d : g_->deps(x)) todo.push_back(d);
+        }
+        return false;
+    }
+
+    const DepGraph* g_ = nullptr; // for the fallback walk, must outlive the index
+    std::vector<Node> targets_, target_; // target -> node, node -> target or no_node
+    std::vector<Node> comp_;             // node -> component
+    std::vector<std::uint32_t> level_;   // component -> longest path down, in components
+    std::size_t words_ = 0;
+    std::vector<std::uint64_t> bits_;    // chunk-major: word w of component c at w * components + c
+};
+
+// the axioms of env (Quot.sound among them), the usual targets of a Reachability
+inline std::vector<Node> axioms(const Environment& env)
+{
+    std::vector<Node> out;
+    for(std::size_t i = 0; i < env.decls().size(); ++i)
+        if(env.decls()[i].kind == DeclKind::Axiom) out.push_back(Node(i));
+    return out;
+}
+
+// TOPOLOGICAL ORDER //
+// a graph under edits (the workspace's) with a topological order kept up to date: dependencies
+// before their users. an edge that would close a cycle is refused on the spot, with the cycle.
+// adding an edge that goes against the order only reorders the nodes between its ends that reach
+// or are reached from it (Pearce & Kelly 2006): a walk forward from the user and one back from the
+// dependency, both bounded by the two positions, then the nodes found are dealt out over the
+// positions they held. removing an edge never breaks the order
+
+class TopoOrder
+{
+public:
+    TopoOrder() = default;
+    explicit TopoOrder(std::size_t n) { for(std::size_t i = 0; i < n; ++i) add_node(); }
+
+    // a new node, last in the order
+    Node add_node()
+    {
+        Node v = Node(pos_.size());
+        pos_.push_back(v);
+        at_.push_back(v);
+        deps_.emplace_back();
+        users_.emplace_back();
+        mark_.push_back(0);
+        parent_.push_back(v);
+        return v;
+    }
+
+    // u depends on v, so v stays before u. false (and nothing changes) if that closes a cycle, which
+    // is then left in *cycle as v, ..., u: each entry depends on the next one already, except u on v
+    bool add_edge(Node u, Node v, std::vector<Node>* cycle = nullptr)
+    {
+        if(u == v)
+        {
+            if(cycle) *cycle = {u};
+            return false;
+        }
+        if(has_edge(u, v)) return true;
+        if(pos_[v] > pos_[u] && !reorder(u, v, cycle)) return false;
+        deps_[u].push_back(v);
+        users_[v].push_back(u);
+        return true;
+    }
+
+    void remove_edge(Node u, Node v)
+    {
+        auto drop = [](std::vector<Node>& xs, Node x) {
+            if(auto it = std::find(xs.begin(), xs.end(), x); it != xs.end()) { *it = xs.back(); xs.pop_back(); }
+        };
+        drop(deps_[u], v);
+        drop(users_[v], u);
+    }
+
+    bool has_edge(Node u, Node v) const
+    {
+        if(deps_[u].size() <= users_[v].size()) return std::find(deps_[u].begin(), deps_[u].end(), v) != deps_[u].end();
+        return std::find(users_[v].begin(), users_[v].end(), u) != users_[v].end();
+    }
+
+    std::size_t size() const { return pos_.size(); }
+    std::span<const Node> deps(Node v) const { return deps_[v]; }
+    std::span<const Node> users(Node v) const { return users_[v]; }
+
+    // the nodes in order, and a node's place in it
+    std::span<const Node> order() const { return at_; }
+    std::uint32_t position(Node v) const { return pos_[v]; }
+
+private:
+    // makes room for u -> v (u before v in the order, v before u wanted). forward from u through
+    // users up to v's position, back from v through dependencies down to u's
+    bool reorder(Node u, Node v, std::vector<Node>* cycle)
+    {
+        std::uint32_t lo = pos_[u], hi = pos_[v];
+        fwd_.clear();
+        back_.clear();
+        std::vector<Node>& stack = stack_;
+        stack.assign(1, u);
+        mark_[u] = 1;
+        while(!stack.empty())
+        {
+            Node x = stack.back();
+            stack.pop_back();
+            fwd_.push_back(x);
+            for(Node y : users_[x])
+            {
+                if(y == v)
+                {
+                    if(cycle)
+                    {
+                        cycle->assign(1, v);
+                        for(Node z = x;; z = parent_[z])
+                        {
+                            cycle->push_back(z);
+                            if(z == u) break;
+                        }
+                    }
+                    for(Node z : fwd_) mark_[z] = 0;
+                    for(Node z : stack) mark_[z] = 0;
+                    return false;
+                }
+                if(!mark_[y] && pos_[y] < hi)
+                {
+                    mark_[y] = 1;
+                    parent_[y] = x;
+                    stack.push_back(y);
+                }
+            }
+        }
+        stack.assign(1, v);
+        mark_[v] = 2;
+        while(!stack.empty())
+        {
+            Node x = stack.back();
+            stack.pop_back();
+            back_.push_back(x);
+            for(Node y : deps_[x])
+                if(!mark_[y] && pos_[y] > lo)
+                {
+                    mark_[y] = 2;
+                    stack.push_back(y);
+                }
+        }
+
+        // v and what it needs go first, then u and what needs it, each in their old relative order
+        auto by_pos = [&](Node a, Node b) { return pos_[a] < pos_[b]; };
+        std::sort(back_.begin(), back_.end(), by_pos);
+        std::sort(fwd_.begin(), fwd_.end(), by_pos);
+        slots_.clear();
+        for(Node x : back_) slots_.push_back(pos_[x]);
+        for(Node x : fwd_) slots_.push_back(pos_[x]);
+        std::sort(slots_.begin(), slots_.end());
+        std::size_t i = 0;
+        for(const std::vector<Node>* part : {&back_, &fwd_})
+            for(Node x : *part)
+            {
+                pos_[x] = slots_[i++];
+                at_[pos_[x]] = x;
+                mark_[x] = 0;
+            }
+        return true;
+    }
+
+    std::vector<std::uint32_t> pos_; // node -> position
+    std::vector<Node> at_;           // position -> node
+    std::vector<std::vector<Node>> deps_, users_;
+    std::vector<std::uint8_t> mark_;
+    std::vector<Node> fwd_, back_, stack_;
+    std::vector<std::uint32_t> slots_;
+    std::vector<Node> parent_; // in the forward walk, to give back a cycle
+};
+
+// SPATIAL INDEX //
+// which workspace elements lie under the pointer or inside the viewport, without looking at each of
+// them: a bounding volume tree (an R-tree with two children per node) over the elements' boxes, nodes
+// and edges alike under ids the caller picks. a query only descends into boxes that meet it, O(log n
+// + k) for k hits. a leaf keeps its element's box grown by a margin, so an element dragged or nudged
+// by the layout stays in its leaf until it leaves the grown box, and only then is taken out and put
+// back, O(log n). a new leaf goes down the side whose box grows the least (by perimeter) and the path
+// back up is rebalanced by rotations as in an AVL tree, so the height stays logarithmic whatever the
+// order of inserts. build() loads many at once top down, halving at the median of the longer side,
+// which packs tighter than inserting one at a time
+
+struct Box
+{
+    float x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+
+    // w by h centred on (x, y), and the box of the segment from (ax, ay) to (bx, by)
+    static Box around(float x, float y, float w, float h) { return {x - w / 2, y - h / 2, x + w / 2, y + h / 2}; }
+    static Box segment(float ax, float ay, float bx, float by)
+    {
+        return {std::min(ax, bx), std::min(ay, by), std::max(ax, bx), std::max(ay, by)};
+    }
+
+    bool contains(float x, float y) const { return x0 <= x && x <= x1 && y0 <= y && y <= y1; }
+    bool contains(const Box& b) const { return x0 <= b.x0 && y0 <= b.y0 && b.x1 <= x1 && b.y1 <= y1; }
+    bool overlaps(const Box& b) const { return x0 <= b.x1 && b.x0 <= x1 && y0 <= b.y1 && b.y0 <= y1; }
+    float perimeter() const { return 2 * ((x1 - x0) + (y1 - y0)); }
+    Box grown(float m) const { return {x0 - m, y0 - m, x1 + m, y1 + m}; }
+
+    friend Box merge(const Box& a, const Box& b)
+    {
+        return {std::min(a.x0, b.x0), std::min(a.y0, b.y0), std::max(a.x1, b.x1), std::max(a.y1, b.y1)};
+    }
+};
+
+class SpatialIndex
+{
+public:
+    using Id = std::uint32_t;
+
+    // margin: how far an element may move before set() touches the tree (a fraction of a node's size
+    // suits a layout that moves everything a little each frame)
+    explicit SpatialIndex(float margin = 0) : margin_(margin) {}
+
+    // box i under id i for every i, replacing what was there
+    void build(std::span<const Box> boxes)
+    {
+        clear();
+        exact_.assign(boxes.begin(), boxes.end());
+        leaf_.resize(boxes.size());
+        std::vector<std::uint32_t> leaves(boxes.size());
+        for(Id id = 0; id < boxes.size(); ++id)
+        {
+            leaves[id] = leaf_[id] = leaf(id);
+            nodes_[leaf_[id]].box = boxes[id].grown(margin_);
+        }
+        count_ = boxes.size();
+        if(!leaves.empty()) root_ = split(leaves, no_node);
+    }
+
+    // puts id at b, adding it if it is new; true if the tree changed (b is not inside the grown box).
+    // when most elements have moved further than the margin, build() again is cheaper
+    bool set(Id id, const Box& b)
+    {
+        if(id >= leaf_.size())
+        {
+            leaf_.resize(id + 1, no_node);
+            exact_.resize(id + 1);
+        }
+        exact_[id] = b;
+        std::uint32_t l = leaf_[id];
+        if(l == no_node)
+        {
+            l = leaf_[id] = leaf(id);
+            ++count_;
+        }
+        else if(nodes_[l].box.contains(b)) return false;
+        else detach(l);
+        nodes_[l].box = b.grown(margin_);
+        attach(l);
+        return true;
+    }
+
+    void erase(Id id)
+    {
+        if(!contains(id)) return;
+        std::uint32_t l = leaf_[id];
+        detach(l);
+        release(l);
+        leaf_[id] = no_node;
+        --count_;
+    }
+
+    void clear()
+    {
+        nodes_.clear();
+        leaf_.clear();
+        exact_.clear();
+        root_ = free_ = no_node;
+        count_ = 0;
+    }
+
+    bool contains(Id id) const { return id < leaf_.size() && leaf_[id] != no_node; }
+    const Box& box(Id id) const { return exact_[id]; }
+    std::size_t size() const { return count_; }
+    int height() const { return root_ == no_node ? -1 : nodes_[root_].height; }
+
+    // f(id) for each element whose box meets area (the viewport, for culling)
+    template<class F>
+    void query(const Box& area, F&& f) const
+    {
+        if(root_ == no_node) return;
+        // the height is logarithmic, so the walk's stack (at most height + 1 deep) fits
+        std::uint32_t stack[128];
+        std::size_t top = 0;
+        stack[top++] = root_;
+        while(top)
+        {
+            const TreeNode& n = nodes_[stack[--top]];
+            if(!n.box.overlaps(area)) continue;
+            if(n.kid[0] == no_node)
+            {
+                if(exact_[n.id].overlaps(area)) f(n.id);
+            }
+            else
+            {
+                stack[top++] = n.kid[0];
+                stack[top++] = n.kid[1];
+            }
+        }
+    }
+
+    std::vector<Id> query(const Box& area) const
+    {
+        std::vector<Id> out;
+        query(area, [&](Id id) { out.push_back(id); });
+        return out;
+    }
+
+    // hit test: the elements whose box is within slop of (x, y). for an edge the box only says it may
+    // pass close by; the caller measures the distance to the segment
+    std::vector<Id> at(float x, float y, float slop = 0) const { return query(Box{x, y, x, y}.grown(slop)); }
+
+private:
+    struct TreeNode
+    {
+        Box box;                  // grown box on a leaf, union of the children's above
+        std::uint32_t parent = no_node;
+        std::uint32_t kid[2] = {no_node, no_node}; // none on a leaf
+        Id id = 0;                // on a leaf
+        int height = 0;           // leaf 0; on the free list, the next free node is in parent
+    };
+
+    std::uint32_t alloc()
+    {
+        if(free_ == no_node)
+        {
+            nodes_.emplace_back();
+            return std::uint32_t(nodes_.size() - 1);
+        }
+        std::uint32_t i = free_;
+        free_ = nodes_[i].parent;
+        nodes_[i] = {};
+        return i;
+    }
+
+    void release(std::uint32_t i)
+    {
+        nodes_[i].parent = free_;
+        free_ = i;
+    }
+
+    std::uint32_t leaf(Id id)
+    {
+        std::uint32_t l = alloc();
+        nodes_[l].id = id;
+        return l;
+    }
+
+    void fix(std::uint32_t i)
+    {
+        TreeNode& n = nodes_[i];
+        n.box = merge(nodes_[n.kid[0]].box, nodes_[n.kid[1]].box);
+        n.height = 1 + std::max(nodes_[n.kid[0]].height, nodes_[n.kid[1]].height);
+    }
+
+    // i's parent points to j instead
+    void replace(std::uint32_t i, std::uint32_t j)
+    {
+        std::uint32_t p = nodes_[i].parent;
+        nodes_[j].parent = p;
+        if(p == no_node) root_ = j;
+        else nodes_[p].kid[nodes_[p].kid[1] == i] = j;
+    }
+
+    // subtree of the leaves at the median of the longer side of their centres, halves recursively
+    std::uint32_t split(std::span<std::uint32_t> leaves, std::uint32_t parent)
+    {
+        if(leaves.size() == 1)
+        {
+            nodes_[leaves[0]].parent = parent;
+            return leaves[0];
+        }
+        auto centre = [&](std::uint32_t l, bool y) {
+            const Box& b = nodes_[l].box;
+            return y ? b.y0 + b.y1 : b.x0 + b.x1;
+        };
+        float lo[2] = {centre(leaves[0], false), centre(leaves[0], true)}, hi[2] = {lo[0], lo[1]};
+        for(std::uint32_t l : leaves)
+            for(int y = 0; y < 2; ++y)
+            {
+                lo[y] = std::min(lo[y], centre(l, y));
+                hi[y] = std::max(hi[y], centre(l, y));
+            }
+        bool y = hi[1] - lo[1] > hi[0] - lo[0];
+        std::size_t half = leaves.size() / 2;
+        std::nth_element(leaves.begin(), leaves.begin() + std::ptrdiff_t(half), leaves.end(),
+                         [&](std::uint32_t a, std::uint32_t b) { return centre(a, y) < centre(b, y); });
+        std::uint32_t i = alloc();
+        nodes_[i].parent = parent;
+        std::uint32_t a = split(leaves.first(half), i), b = split(leaves.subspan(half), i);
+        nodes_[i].kid[0] = a;
+        nodes_[i].kid[1] = b;
+        fix(i);
+        return i;
+    }
+
+    // leaf l goes in as a sibling of the node where a new parent costs less than going further down:
+    // the perimeter of the new parent, plus what every box above grows by
+    void attach(std::uint32_t l)
+    {
+        if(root_ == no_node)
+        {
+            root_ = l;
+            nodes_[l].parent = no_node;
+            return;
+        }
+        Box b = nodes_[l].box;
+        std::uint32_t s = root_;
+        while(nodes_[s].kid[0] != no_node)
+        {
+            const TreeNode& n = nodes_[s];
+            float joined = merge(n.box, b).perimeter();
+            float here = 2 * joined, above = 2 * (joined - n.box.perimeter());
+            float down[2];
+            for(int k = 0; k < 2; ++k)
+            {
+                const TreeNode& c = nodes_[n.kid[k]];
+                down[k] = merge(c.box, b).perimeter() + above - (c.kid[0] == no_node ? 0 : c.box.perimeter());
+            }
+            if(here < down[0] && here < down[1]) break;
+            s = n.kid[down[1] < down[0]];
+        }
+        std::uint32_t p = alloc();
+        replace(s, p);
+        nodes_[p].kid[0] = s;
+        nodes_[p].kid[1] = l;
+        nodes_[s].parent = nodes_[l].parent = p;
+        refit(p);
+    }
+
+    // takes leaf l out, its sibling moving up into the parent's place
+    void detach(std::uint32_t l)
+    {
+        std::uint32_t p = nodes_[l].parent;
+        if(p == no_node)
+        {
+            root_ = no_node;
+            return;
+        }
+        std::uint32_t sib = nodes_[p].kid[nodes_[p].kid[0] == l];
+        std::uint32_t g = nodes_[p].parent;
+        replace(p, sib);
+        release(p);
+        if(g != no_node) refit(g);
+    }
+
+    // boxes and heights from i up to the root, rotating where one side got two taller than the other
+    void refit(std::uint32_t i)
+    {
+        for(; i != no_node; i = nodes_[i].parent)
+        {
+            i = balance(i);
+            fix(i);
+        }
+    }
+
+    // the taller child c of a takes a's place; a keeps its other child and the shorter of c's two
+    // children, c the taller and a. returns what is now where a was
+    std::uint32_t balance(std::uint32_t a)
+    {
+        TreeNode& n = nodes_[a];
+        if(n.kid[0] == no_node) return a;
+        int h0 = nodes_[n.kid[0]].height, h1 = nodes_[n.kid[1]].height;
+        if(h0 - h1 <= 1 && h1 - h0 <= 1) return a;
+        int t = h1 > h0;
+        std::uint32_t c = n.kid[t];
+        std::uint32_t f = nodes_[c].kid[0], g = nodes_[c].kid[1];
+        if(nodes_[f].height > nodes_[g].height) std::swap(f, g); // g the taller
+        replace(a, c);
+        nodes_[c].kid[0] = a;
+        nodes_[c].kid[1] = g;
+        nodes_[a].parent = c;
+        nodes_[a].kid[t] = f;
+        nodes_[f].parent = a;
+        fix(a);
+        fix(c);
+        return c;
+    }
+
+    float margin_;
+    std::vector<TreeNode> nodes_;
+    std::vector<std::uint32_t> leaf_; // id -> its leaf, no_node if absent
+    std::vector<Box> exact_;          // id -> its box as set
+    std::uint32_t root_ = no_node, free_ = no_node;
+    std::size_t count_ = 0;
+};
+
+} // namespace vl
+
+#endif // GRAPH_HPP
@@ -0,0 +1,565 @@
+// import.hpp - streaming importer for the Lean 4 kernel export format (lean4export, text)
+// one item per line, referring only to earlier items by index (name 0 is anonymous, level 0 zero):
+//   names   <n> #NS <n'> <string>        <n> #NI <n'> <nat>
+//   levels  <u> #US <u'>   <u> #UM <u1> <u2>   <u> #UIM <u1> <u2>   <u> #UP <n>
+//   terms   <e> #EV <i>   #ES <u>   #EC <n> <u>*   #EA <f> <a>   #EL / #EP <binfo> <n> <dom> <body>
+//           #EZ <n> <type> <value> <body>   #EJ <n> <i> <e>   #ELN <nat>   #ELS <hex>*
+//   decls   #AX <n> <type> <lp>*   #DEF <n> <type> <value> <hint> <lp>*   #THM / #OPAQ <n> <type> <value> <lp>*
+//           #QUOT <n> <type> <lp>*   #IND ...   #CTOR ...   #REC ...   <r> #RR <ctor> <nfields> <rhs>
+// declarations go straight into the checker as they complete (inductive blocks once their last
+// constructor arrives; recursors are regenerated, so #REC / #RR only need to agree by name).
+// the file is never held in memory: lines are read on a second thread into a bounded queue and
+// interned and checked on the caller's, since the pool is not shared between threads.
+// the kernel has no projections or string literals, and Nat literals become succ chains: a
+// declaration using any of these (past max_nat_literal) is counted as unsupported and skipped,
+// together with everything that mentions it
+// (c) 2025 Zachary R. James
+
+#ifndef IMPORT_HPP
+#define IMPORT_HPP
+
+#include "storage.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <istream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace vl {
+
+struct ImportOptions
+{
+    bool threaded = true;                 // read lines on a second thread
+    std::uint64_t max_nat_literal = 4096; // larger literals are unsupported (no big Nat in the kernel)
+    ContentStore* store = nullptr;        // when set, hashes it has verified skip the kernel
+    std::size_t max_errors = 20;          // messages kept in ImportStats::errors
+};
+
+struct ImportStats
+{
+    std::size_t lines = 0, decls = 0;
+    std::size_t checked = 0;     // in the environment
+    std::size_t unsupported = 0; // projections, string literals, big Nat literals
+    std::size_t dependents = 0;  // mention a declaration that was not imported
+    std::size_t failed = 0;      // rejected by the kernel
+    std::vector<std::string> errors;
+};
+
+class ExportImporter
+{
+public:
+    explicit ExportImporter(Environment& env, ImportOptions opts = {}) : env_(env), p_(env.pool), opts_(opts)
+    {
+        names_.push_back(0);
+        levels_.push_back(p_.levels.zero());
+    }
+
+    const ImportStats& stats() const { return stats_; }
+
+    void line(std::string_view s)
+    {
+        ++stats_.lines;
+        toks_.clear();
+        for(std::size_t i = 0; i < s.size();)
+        {
+            std::size_t j = s.find(' ', i);
+            if(j == std::string_view::npos) j = s.size();
+            if(j > i) toks_.push_back(s.substr(i, j - i));
+            i = j + 1;
+        }
+        if(toks_.empty()) return;
+        if(toks_[0][0] == '#') { decl(); return; }
+        if(toks_.size() < 2 || toks_[1][0] != '#')
+        {
+            if(stats_.lines == 1) return; // format version
+            fail("expected '<index> #<kind>'");
+        }
+        std::string_view kind = toks_[1];
+        if(kind.size() < 2) fail("expected '<index> #<kind>'");
+        if(kind == "#NS" || kind == "#NI") name(s);
+        else if(kind[1] == 'U') level(kind);
+        else if(kind[1] == 'E') expr(kind);
+        else if(kind == "#RR") return;
+        else fail("unknown item " + std::string(kind));
+    }
+
+    // after the last line: inductive blocks still waiting for constructors are errors
+    void finish()
+    {
+        for(Block& b : blocks_)
+            if(!b.done) finish_block(b, Outcome::Failed, "incomplete inductive block '" + p_.names.str(b.all.front()) + "'");
+    }
+
+private:
+    // why a term or declaration could not be imported; ok terms are pool slots
+    enum class Outcome : std::uint8_t { Ok, Dependent, Unsupported, Failed };
+    static constexpr Expr dependent_expr = no_expr - 1, unsupported_expr = no_expr - 2;
+
+    struct Block
+    {
+        std::vector<Name> lparams, all;
+        std::uint32_t nparams = 0;
+        std::vector<InductiveType> types; // by position in all, filled as #IND / #CTOR lines arrive
+        std::size_t missing = 0;          // #IND and #CTOR lines still to come
+        Expr bad = 0;                     // worst sentinel seen in a type
+        bool done = false;
+    };
+
+    [[noreturn]] void fail(const std::string& msg)
+    {
+        throw storage_exception("export line " + std::to_string(stats_.lines) + ": " + msg);
+    }
+
+    std::uint64_t num(std::size_t i)
+    {
+        if(i >= toks_.size()) fail("missing field");
+        std::uint64_t v = 0;
+        auto [end, ec] = std::from_chars(toks_[i].data(), toks_[i].data() + toks_[i].size(), v);
+        if(ec != std::errc() || end != toks_[i].data() + toks_[i].size()) fail("expected a number, got '" + std::string(toks_[i]) + "'");
+        return v;
+    }
+
+    template<class T>
+    T at(const std::vector<T>& table, std::size_t i)
+    {
+        std::uint64_t k = num(i);
+        if(k >= table.size()) fail("undefined index " + std::to_string(k));
+        return table[k];
+    }
+
+    Name name_at(std::size_t i) { return at(names_, i); }
+    Level level_at(std::size_t i) { return at(levels_, i); }
+    Expr expr_at(std::size_t i) { return at(exprs_, i); }
+
+    template<class T>
+    void define(std::vector<T>& table, T v, T hole)
+    {
+        std::uint64_t k = num(0);
+        if(k < table.size() && table[k] != hole) fail("index " + std::to_string(k) + " defined twice");
+        if(k >= table.size()) table.resize(k + 1, hole);
+        table[k] = v;
+    }
+
+    void name(std::string_view s)
+    {
+        Name parent = name_at(2);
+        std::string_view part;
+        if(toks_[1] == "#NS")
+        {
+            // the component is the rest of the line, spaces included
+            std::size_t at = std::size_t(toks_[2].data() - s.data()) + toks_[2].size() + 1;
+            if(at > s.size()) fail("missing name component");
+            part = s.substr(at);
+        }
+        else if(toks_.size() > 3) part = toks_[3];
+        else fail("missing name component");
+        define(names_, p_.names.append(parent, part), Name(no_slot));
+    }
+
+    void level(std::string_view kind)
+    {
+        Level l;
+        if(kind == "#US") l = p_.levels.succ(level_at(2));
+        else if(kind == "#UM") l = p_.levels.max(level_at(2), level_at(3));
+        else if(kind == "#UIM") l = p_.levels.imax(level_at(2), level_at(3));
+        else if(kind == "#UP") l = p_.levels.param(name_at(2));
+        else fail("unknown level " + std::string(kind));
+        define(levels_, l, Level(no_slot));
+    }
+
+    // sentinels win over terms, unsupported over dependent
+    static Expr worst(Expr a, Expr b)
+    {
+        if(a == unsupported_expr || b == unsupported_expr) return unsupported_expr;
+        if(a == dependent_expr || b == dependent_expr) return dependent_expr;
+        return 0;
+    }
+
+    static bool bad(Expr e) { return e == dependent_expr || e == unsupported_expr; }
+
+    BinderInfo binder_info(std::size_t i)
+    {
+        if(i >= toks_.size()) fail("missing binder info");
+        if(toks_[i] == "#BD") return BinderInfo::Default;
+        if(toks_[i] == "#BI") return BinderInfo::Implicit;
+        if(toks_[i] == "#BS") return BinderInfo::StrictImplicit;
+        if(toks_[i] == "#BC") return BinderInfo::InstImplicit;
+        fail("unknown binder info " + std::string(toks_[i]));
+    }
+
+    void expr(std::string_view kind)
+    {
+        Expr e;
+        if(kind == "#EV") e = p_.bvar(std::uint32_t(num(2)));
+        else if(kind == "#ES") e = p_.sort(level_at(2));
+        else if(kind == "#EC")
+        {
+            Name n = name_at(2);
+            std::vector<Level> ls;
+            for(std::size_t i = 3; i < toks_.size(); ++i) ls.push_back(level_at(i));
+            e = skipped_.contains(n) ? dependent_expr : p_.cnst(n, ls);
+        }
+        else if(kind == "#EA")
+        {
+            Expr f = expr_at(2), a = expr_at(3);
+            e = bad(f) || bad(a) ? worst(f, a) : p_.app(f, a);
+        }
+        else if(kind == "#EL" || kind == "#EP")
+        {
+            BinderInfo bi = binder_info(2);
+            Name n = name_at(3);
+            Expr dom = expr_at(4), body = expr_at(5);
+            if(bad(dom) || bad(body)) e = worst(dom, body);
+            else e = kind == "#EL" ? p_.lam(n, dom, body, bi) : p_.pi(n, dom, body, bi);
+        }
+        else if(kind == "#EZ")
+        {
+            Name n = name_at(2);
+            Expr type = expr_at(3), value = expr_at(4), body = expr_at(5);
+            e = bad(type) || bad(value) || bad(body) ? worst(worst(type, value), body) : p_.let(n, type, value, body);
+        }
+        else if(kind == "#ELN")
+        {
+            std::uint64_t v = 0;
+            std::string_view t = toks_.size() > 2 ? toks_[2] : "";
+            auto [end, ec] = std::from_chars(t.data(), t.data() + t.size(), v);
+            if(ec == std::errc() && end == t.data() + t.size() && v <= opts_.max_nat_literal)
+            {
+                e = p_.cnst("Nat.zero");
+                for(Expr succ = p_.cnst("Nat.succ"); v-- > 0;) e = p_.app(succ, e);
+            }
+            else e = unsupported_expr;
+        }
+        else if(kind == "#EJ" || kind == "#ELS") e = unsupported_expr;
+        else fail("unknown term " + std::string(kind));
+        define(exprs_, e, no_expr);
+    }
+
+    std::vector<Name> lparams_from(std::size_t i)
+    {
+        std::vector<Name> ls;
+        for(; i < toks_.size(); ++i) ls.push_back(name_at(i));
+        return ls;
+    }
+
+    void record(Outcome o, Name n, const std::string& msg)
+    {
+        switch(o)
+        {
+            case Outcome::Ok: ++stats_.checked; return;
+            case Outcome::Dependent: ++stats_.dependents; break;
+            case Outcome::Unsupported: ++stats_.unsupported; break;
+            case Outcome::Failed:
+                ++stats_.failed;
+                if(stats_.errors.size() < opts_.max_errors) stats_.errors.push_back(p_.names.str(n) + ": " + msg);
+                break;
+        }
+        skipped_.insert(n);
+    }
+
+    static Outcome outcome(Expr sentinel) { return sentinel == unsupported_expr ? Outcome::Unsupported : Outcome::Dependent; }
+
+    void decl()
+    {
+        std::string_view kind = toks_[0];
+        ++stats_.decls;
+        Name n = name_at(1);
+        if(kind == "#QUOT")
+        {
+            // one line per primitive; the first declares all of them, and each must state the
+            // kernel's type for it (up to binder names)
+            Expr type = expr_at(2);
+            std::vector<Name> lparams = lparams_from(3);
+            if(bad(type)) { record(outcome(type), n, ""); return; }
+            try
+            {
+                add_quot(env_);
+                const Declaration* old = env_.find(n);
+                if(!old) record(Outcome::Failed, n, "not a quotient primitive");
+                else if(old->lparams != lparams || !TypeChecker(env_, old->lparams).is_def_eq(old->type, type))
+                    record(Outcome::Failed, n, "type differs from the kernel's quotient primitive");
+                else record(Outcome::Ok, n, "");
+            }
+            catch(const kernel_exception& ex) { record(Outcome::Failed, n, ex.what()); }
+            return;
+        }
+        Declaration d;
+        d.name = n;
+        d.type = expr_at(2);
+        if(kind == "#AX")
+        {
+            d.kind = DeclKind::Axiom;
+            d.lparams = lparams_from(3);
+        }
+        else if(kind == "#DEF")
+        {
+            d.kind = DeclKind::Definition;
+            d.value = expr_at(3);
+            if(toks_.size() < 5) fail("missing reducibility hint");
+            d.lparams = lparams_from(toks_[4] == "R" ? 6 : 5); // heights are recomputed by the checker
+        }
+        else if(kind == "#THM" || kind == "#OPAQ")
+        {
+            d.kind = kind == "#THM" ? DeclKind::Theorem : DeclKind::Opaque;
+            d.value = expr_at(3);
+            d.lparams = lparams_from(4);
+        }
+        else if(kind == "#IND") { inductive(n, d.type); return; }
+        else if(kind == "#CTOR") { constructor(n, d.type); return; }
+        else if(kind == "#REC") { recursor(n); return; }
+        else fail("unknown declaration " + std::string(kind));
+
+        if(bad(d.type) || (d.value != no_expr && bad(d.value)))
+        {
+            record(outcome(worst(d.type, d.value == no_expr ? 0 : d.value)), n, "");
+            return;
+        }
+        // already there with the same statement (Quot.sound after #QUOT, or a shared prelude)
+        if(const Declaration* old = env_.find(n); old && old->type == d.type && old->lparams == d.lparams)
+        {
+            record(Outcome::Ok, n, "");
+            return;
+        }
+        try
+        {
+            if(opts_.store) opts_.store->add(std::move(d));
+            else add_decl(env_, std::move(d));
+            record(Outcome::Ok, n, "");
+        }
+        catch(const kernel_exception& ex)
+        {
+            record(Outcome::Failed, n, ex.what());
+        }
+    }
+
+    // #IND <n> <type> <isRec> <isNested> <nparams> <nindices> <k> <types>* <c> <ctors>* <lp>*
+    void inductive(Name n, Expr type)
+    {
+        std::uint32_t nparams = std::uint32_t(num(5));
+        std::size_t k = num(7), i = 8;
+        std::vector<Name> all;
+        for(std::size_t j = 0; j < k; ++j) all.push_back(name_at(i++));
+        std::size_t c = num(i++);
+        std::vector<Name> ctors;
+        for(std::size_t j = 0; j < c; ++j) ctors.push_back(name_at(i++));
+        std::vector<Name> lparams = lparams_from(i);
+
+        auto pos = std::find(all.begin(), all.end(), n);
+        if(pos == all.end()) fail("inductive type missing from its own block");
+        std::size_t bi;
+        if(auto it = block_of_.find(all.front()); it != block_of_.end()) bi = it->second;
+        else
+        {
+            bi = blocks_.size();
+            Block b;
+            b.lparams = lparams;
+            b.all = all;
+            b.nparams = nparams;
+            b.types.resize(all.size());
+            b.missing = all.size();
+            blocks_.push_back(std::move(b));
+            for(Name t : all) block_of_.emplace(t, bi);
+        }
+        Block& b = blocks_[bi];
+        if(b.done) fail("inductive type after its block was complete");
+        InductiveType& it = b.types[std::size_t(pos - all.begin())];
+        it.name = n;
+        it.type = type;
+        b.bad = worst(b.bad, type);
+        for(Name ctor : ctors)
+        {
+            it.ctors.push_back({ctor, no_expr});
+            block_of_.emplace(ctor, bi);
+        }
+        b.missing += ctors.size();
+        --b.missing;
+        if(b.missing == 0) complete(b);
+    }
+
+    // #CTOR <n> <type> <induct> <cidx> <nparams> <nfields> <lp>*
+    void constructor(Name n, Expr type)
+    {
+        auto it = block_of_.find(n);
+        if(it == block_of_.end()) fail("constructor before its inductive type");
+        Block& b = blocks_[it->second];
+        if(b.done) fail("constructor after its block was complete");
+        Name induct = name_at(3);
+        std::size_t cidx = num(4);
+        auto pos = std::find(b.all.begin(), b.all.end(), induct);
+        if(pos == b.all.end()) fail("constructor of another block");
+        InductiveType& t = b.types[std::size_t(pos - b.all.begin())];
+        if(cidx >= t.ctors.size() || t.ctors[cidx].name != n) fail("constructor index does not match its type");
+        t.ctors[cidx].type = type;
+        b.bad = worst(b.bad, type);
+        if(--b.missing == 0) complete(b);
+    }
+
+    // #REC <n> <type> ...: the kernel made its own when the block was added
+    void recursor(Name n)
+    {
+        if(env_.find(n)) { ++stats_.checked; return; }
+        if(skipped_.contains(n))
+        {
+            skipped_.erase(n);
+            record(rec_outcome_.at(n), n, "");
+            return;
+        }
+        record(Outcome::Failed, n, "no matching recursor was generated");
+    }
+
+    void complete(Block& b)
+    {
+        if(bad(b.bad)) { finish_block(b, outcome(b.bad), ""); return; }
+        try
+        {
+            add_inductive(env_, {b.lparams, b.nparams, b.types});
+            finish_block(b, Outcome::Ok, "");
+        }
+        catch(const kernel_exception& ex)
+        {
+            finish_block(b, Outcome::Failed, ex.what());
+        }
+    }
+
+    // counts the block's types and constructors; its recursors are counted when their lines come
+    void finish_block(Block& b, Outcome o, const std::string& msg)
+    {
+        b.done = true;
+        for(const InductiveType& t : b.types)
+        {
+            record(o, t.name, msg);
+            for(const ConstructorDecl& c : t.ctors) record(o == Outcome::Failed ? Outcome::Dependent : o, c.name, "");
+            if(o != Outcome::Ok)
+            {
+                Name rec = p_.names.append(t.name, "rec");
+                skipped_.insert(rec);
+                rec_outcome_[rec] = o == Outcome::Failed ? Outcome::Dependent : o;
+            }
+        }
+        b.types.clear();
+    }
+
+    Environment& env_;
+    Pool& p_;
+    ImportOptions opts_;
+    ImportStats stats_;
+    std::vector<std::string_view> toks_;
+    std::vector<Name> names_;
+    std::vector<Level> levels_;
+    std::vector<Expr> exprs_;
+    std::unordered_set<Name> skipped_;               // not in env, mentions of them are dependent
+    std::unordered_map<Name, Outcome> rec_outcome_;  // recursors of skipped blocks
+    std::vector<Block> blocks_;
+    std::unordered_map<Name, std::size_t> block_of_; // types and constructors to their block
+};
+
+namespace detail {
+
+// batches of lines from the reader thread; push blocks while `capacity` batches wait
+class LineQueue
+{
+public:
+    explicit LineQueue(std::size_t capacity) : capacity_(capacity) {}
+
+    bool push(std::vector<std::string> batch)
+    {
+        std::unique_lock lock(m_);
+        space_.wait(lock, [&] { return q_.size() < capacity_ || closed_; });
+        if(closed_) return false;
+        q_.push_back(std::move(batch));
+        ready_.notify_one();
+        return true;
+    }
+
+    bool pop(std::vector<std::string>& batch)
+    {
+        std::unique_lock lock(m_);
+        ready_.wait(lock, [&] { return !q_.empty() || done_; });
+        if(q_.empty()) return false;
+        batch = std::move(q_.front());
+        q_.pop_front();
+        space_.notify_one();
+        return true;
+    }
+
+    // the reader is done
+    void finish()
+    {
+        std::lock_guard lock(m_);
+        done_ = true;
+        ready_.notify_all();
+    }
+
+    // the consumer gave up, pushes fail from now on
+    void close()
+    {
+        std::lock_guard lock(m_);
+        closed_ = true;
+        space_.notify_all();
+    }
+
+private:
+    std::size_t capacity_;
+    std::mutex m_;
+    std::condition_variable ready_, space_;
+    std::deque<std::vector<std::string>> q_;
+    bool done_ = false, closed_ = false;
+};
+
+} // namespace detail
+
+// malformed input throws storage_exception; declarations the kernel rejects only show up in the stats
+inline ImportStats import_export(Environment& env, std::istream& in, ImportOptions opts = {})
+{
+    ExportImporter imp(env, opts);
+    std::string line;
+    if(!opts.threaded)
+    {
+        while(std::getline(in, line)) imp.line(line);
+        imp.finish();
+        return imp.stats();
+    }
+
+    constexpr std::size_t batch_lines = 4096;
+    detail::LineQueue q(8);
+    std::thread reader([&] {
+        std::vector<std::string> batch;
+        std::string l;
+        while(std::getline(in, l))
+        {
+            batch.push_back(std::move(l));
+            if(batch.size() == batch_lines && !q.push(std::exchange(batch, {}))) break;
+        }
+        if(!batch.empty()) q.push(std::move(batch));
+        q.finish();
+    });
+    try
+    {
+        std::vector<std::string> batch;
+        while(q.pop(batch))
+            for(const std::string& l : batch) imp.line(l);
+        imp.finish();
+    }
+    catch(...)
+    {
+        q.close();
+        reader.join();
+        throw;
+    }
+    reader.join();
+    return imp.stats();
+}
+
+} // namespace vl
+
+#endif // IMPORT_HPP
@@ -0,0 +1,479 @@
+// layout.hpp - force-directed layout for the workspace graph, shared by the native and wasm frontends
+// spring-electrical model (Fruchterman & Reingold 1991): every pair of nodes repels with k²/d and
+// every edge pulls its ends together with d²/k, k being the natural edge length. the repulsion is
+// summed over a quadtree (Barnes & Hut 1986): a cell seen under a small enough angle (side / distance
+// < theta) acts as one body at its centre of mass, so an iteration costs O(n log n) rather than n².
+// each node moves one step along its force; the step shrinks while the energy stops dropping and
+// grows back after it has dropped for a while (Hu 2005's adaptive cooling). pinned nodes (the one
+// being dragged) stay where they were put but still push and pull the others.
+// there is one level only (no coarsening), so a large regular graph such as a grid can settle
+// folded; cooling slower than Hu's 0.9 folds less often.
+// positions and forces are float columns (x apart from y). the tree is walked once per leaf of up to
+// 32 nodes rather than once per node (Barnes 1990): the walk opens cells against the leaf's box and
+// lists what it meets, cells as their centre of mass, near leaves node by node, and each node of the
+// leaf then sums over that flat list, 8 (AVX) or 4 (SSE2, wasm SIMD128) sources at a time.
+// two plain C++ kernels stand beside it: a lane kernel that keeps the same lanes and fuses the same
+// products, so it lays out bit for bit alike (the check that the vector code is right), and a
+// sequential one that adds the sources one after another with the vectorizer off (the baseline
+// the vector kernel's speedup is measured against; its rounding differs, so its layout does too)
+// (c) 2025 Zachary R. James
+
+#ifndef LAYOUT_HPP
+#define LAYOUT_HPP
+
+#include "graph.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define VL_LAYOUT_SIMD 8
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VL_LAYOUT_SIMD 4
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define VL_LAYOUT_SIMD 4
+#else
+#define VL_LAYOUT_SIMD 1
+#endif
+
+namespace vl {
+
+struct Vec2
+{
+    float x = 0, y = 0;
+
+    Vec2& operator+=(Vec2 b) { x += b.x; y += b.y; return *this; }
+    Vec2& operator-=(Vec2 b) { x -= b.x; y -= b.y; return *this; }
+    friend Vec2 operator+(Vec2 a, Vec2 b) { return {a.x + b.x, a.y + b.y}; }
+    friend Vec2 operator-(Vec2 a, Vec2 b) { return {a.x - b.x, a.y - b.y}; }
+    friend Vec2 operator*(Vec2 a, float s) { return {a.x * s, a.y * s}; }
+    float norm2() const { return x * x + y * y; }
+};
+
+// which repulsion kernel step() runs, see detail::repel*
+enum class LayoutKernel : std::uint8_t { Vector, Lanes, Sequential };
+
+struct LayoutOptions
+{
+    float length = 1;      // k, the natural edge length
+    float theta = 1;       // Barnes-Hut opening angle, 0 sums every pair exactly
+    float step = 0;        // first step length, 0 for k * sqrt(n) / 10
+    float cooling = 0.98f; // step factor after an iteration that did not lower the energy
+    LayoutKernel kernel = LayoutKernel::Vector; // the others are there to compare against
+};
+
+namespace detail {
+
+// interaction lists are padded to this many sources with massless ones far away
+inline constexpr std::size_t layout_width = 8;
+
+// a * b + c, fused exactly where the vector kernel fuses (with FMA), so neither leaves the compiler
+// a product and a sum it could contract on its own
+inline float madd(float a, float b, float c)
+{
+#if defined(__FMA__)
+    return std::fma(a, b, c);
+#else
+    return a * b + c;
+#endif
+}
+
+// sum over the sources j of m_j (p - s_j) / max(|p - s_j|², eps); n is a multiple of layout_width.
+// one source at a time into one sum. without -ffast-math the compiler may not reorder that sum, and
+// the vectorizer is turned off too, so this is the scalar code the vector kernel is timed against
+#if defined(__clang__)
+inline Vec2 repel_sequential(float px, float py, const float* sx, const float* sy, const float* sm, std::size_t n, float eps)
+#elif defined(__GNUC__)
+__attribute__((optimize("no-tree-vectorize"))) inline Vec2 repel_sequential(float px, float py, const float* sx, const float* sy,
+                                                                           const float* sm, std::size_t n, float eps)
+#else
+inline Vec2 repel_sequential(float px, float py, const float* sx, const float* sy, const float* sm, std::size_t n, float eps)
+#endif
+{
+    float fx = 0, fy = 0;
+#if defined(__clang__)
+#pragma clang loop vectorize(disable) interleave(disable)
+#endif
+    for(std::size_t j = 0; j < n; ++j)
+    {
+        float dx = px - sx[j], dy = py - sy[j];
+        float w = sm[j] / std::max(dx * dx + dy * dy, eps);
+        fx += dx * w;
+        fy += dy * w;
+    }
+    return {fx, fy};
+}
+
+// the same sum, source j into partial sum j mod VL_LAYOUT_SIMD and the partial sums added pairwise,
+// the order the vector kernels add in, so both give the same bits and the two layouts stay the same
+// (the compiler is free to vectorize this one, it is not a baseline for timing)
+inline Vec2 repel_lanes(float px, float py, const float* sx, const float* sy, const float* sm, std::size_t n, float eps)
+{
+    constexpr std::size_t lanes = VL_LAYOUT_SIMD;
+    float fx[lanes] = {}, fy[lanes] = {};
+    for(std::size_t j = 0; j < n; j += lanes)
+        for(std::size_t l = 0; l < lanes; ++l)
+        {
+            float dx = px - sx[j + l], dy = py - sy[j + l];
+            float w = sm[j + l] / std::max(madd(dx, dx, dy * dy), eps);
+            fx[l] = madd(dx, w, fx[l]);
+            fy[l] = madd(dy, w, fy[l]);
+        }
+    for(std::size_t h = 1; h < lanes; h *= 2)
+        for(std::size_t l = 0; l + h < lanes; l += 2 * h)
+        {
+            fx[l] += fx[l + h];
+            fy[l] += fy[l + h];
+        }
+    return {fx[0], fy[0]};
+}
+
+inline Vec2 repel(float px, float py, const float* sx, const float* sy, const float* sm, std::size_t n, float eps)
+{
+#if VL_LAYOUT_SIMD == 8
+    auto madd8 = [](__m256 a, __m256 b, __m256 c) {
+#if defined(__FMA__)
+        return _mm256_fmadd_ps(a, b, c);
+#else
+        return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+    };
+    __m256 x = _mm256_set1_ps(px), y = _mm256_set1_ps(py), e = _mm256_set1_ps(eps);
+    __m256 fx = _mm256_setzero_ps(), fy = _mm256_setzero_ps();
+    for(std::size_t j = 0; j < n; j += 8)
+    {
+        __m256 dx = _mm256_sub_ps(x, _mm256_loadu_ps(sx + j)), dy = _mm256_sub_ps(y, _mm256_loadu_ps(sy + j));
+        __m256 d2 = _mm256_max_ps(madd8(dx, dx, _mm256_mul_ps(dy, dy)), e);
+        __m256 w = _mm256_div_ps(_mm256_loadu_ps(sm + j), d2);
+        fx = madd8(dx, w, fx);
+        fy = madd8(dy, w, fy);
+    }
+    alignas(32) float ax[8], ay[8];
+    _mm256_store_ps(ax, fx);
+    _mm256_store_ps(ay, fy);
+    return {((ax[0] + ax[1]) + (ax[2] + ax[3])) + ((ax[4] + ax[5]) + (ax[6] + ax[7])),
+            ((ay[0] + ay[1]) + (ay[2] + ay[3])) + ((ay[4] + ay[5]) + (ay[6] + ay[7]))};
+#elif VL_LAYOUT_SIMD == 4 && defined(__wasm_simd128__)
+    v128_t x = wasm_f32x4_splat(px), y = wasm_f32x4_splat(py), e = wasm_f32x4_splat(eps);
+    v128_t fx = wasm_f32x4_splat(0), fy = wasm_f32x4_splat(0);
+    for(std::size_t j = 0; j < n; j += 4)
+    {
+        v128_t dx = wasm_f32x4_sub(x, wasm_v128_load(sx + j)), dy = wasm_f32x4_sub(y, wasm_v128_load(sy + j));
+        v128_t d2 = wasm_f32x4_max(wasm_f32x4_add(wasm_f32x4_mul(dx, dx), wasm_f32x4_mul(dy, dy)), e);
+        v128_t w = wasm_f32x4_div(wasm_v128_load(sm + j), d2);
+        fx = wasm_f32x4_add(fx, wasm_f32x4_mul(dx, w));
+        fy = wasm_f32x4_add(fy, wasm_f32x4_mul(dy, w));
+    }
+    return {(wasm_f32x4_extract_lane(fx, 0) + wasm_f32x4_extract_lane(fx, 1)) + (wasm_f32x4_extract_lane(fx, 2) + wasm_f32x4_extract_lane(fx, 3)),
+            (wasm_f32x4_extract_lane(fy, 0) + wasm_f32x4_extract_lane(fy, 1)) + (wasm_f32x4_extract_lane(fy, 2) + wasm_f32x4_extract_lane(fy, 3))};
+#elif VL_LAYOUT_SIMD == 4
+    __m128 x = _mm_set1_ps(px), y = _mm_set1_ps(py), e = _mm_set1_ps(eps);
+    __m128 fx = _mm_setzero_ps(), fy = _mm_setzero_ps();
+    for(std::size_t j = 0; j < n; j += 4)
+    {
+        __m128 dx = _mm_sub_ps(x, _mm_loadu_ps(sx + j)), dy = _mm_sub_ps(y, _mm_loadu_ps(sy + j));
+        __m128 d2 = _mm_max_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), e);
+        __m128 w = _mm_div_ps(_mm_loadu_ps(sm + j), d2);
+        fx = _mm_add_ps(fx, _mm_mul_ps(dx, w));
+        fy = _mm_add_ps(fy, _mm_mul_ps(dy, w));
+    }
+    alignas(16) float ax[4], ay[4];
+    _mm_store_ps(ax, fx);
+    _mm_store_ps(ay, fy);
+    return {(ax[0] + ax[1]) + (ax[2] + ax[3]), (ay[0] + ay[1]) + (ay[2] + ay[3])};
+#else
+    return repel_lanes(px, py, sx, sy, sm, n, eps);
+#endif
+}
+
+// a quadtree over the positions, rebuilt every iteration: cells split until they hold at most
+// `bucket` nodes, children of a cell are four consecutive cells. the nodes are kept sorted by leaf
+// (order()), their coordinates copied in that order so a leaf's are contiguous
+class QuadTree
+{
+public:
+    static constexpr int max_depth = 24;
+    static constexpr std::uint32_t bucket = 32;
+
+    struct Cell
+    {
+        float x = 0, y = 0, side = 0;     // lower corner and side
+        float cx = 0, cy = 0;             // centre of mass
+        std::uint32_t mass = 0;
+        std::uint32_t first = 0;          // first child, 0 for a leaf (cell 0 is the root)
+        std::uint32_t begin = 0, end = 0; // its nodes in order()
+    };
+
+    void build(std::span<const float> xs, std::span<const float> ys)
+    {
+        cells_.clear();
+        std::size_t n = xs.size();
+        order_.resize(n);
+        for(Node v = 0; v < n; ++v) order_[v] = v;
+        if(n == 0) return;
+        auto [x0, x1] = std::minmax_element(xs.begin(), xs.end());
+        auto [y0, y1] = std::minmax_element(ys.begin(), ys.end());
+        cells_.push_back({.x = *x0, .y = *y0, .side = std::max({*x1 - *x0, *y1 - *y0, 1e-3f}) * 1.0001f, .end = std::uint32_t(n)});
+        split(xs, ys, 0, 0);
+        bx_.resize(n);
+        by_.resize(n);
+        for(std::size_t i = 0; i < n; ++i)
+        {
+            bx_[i] = xs[order_[i]];
+            by_[i] = ys[order_[i]];
+        }
+    }
+
+    std::span<const Cell> cells() const { return cells_; }
+    std::span<const Node> order() const { return order_; }
+
+    // what acts on the nodes of leaf l: cells far enough from every point of its box by their centre
+    // of mass, the other nodes one by one (l's own included: a node adds nothing to itself, p - p
+    // being 0). padded to layout_width
+    void interactions(std::uint32_t l, float theta, std::vector<float>& sx, std::vector<float>& sy, std::vector<float>& sm)
+    {
+        sx.clear();
+        sy.clear();
+        sm.clear();
+        const Cell& leaf = cells_[l];
+        stack_.assign(1, 0);
+        while(!stack_.empty())
+        {
+            const Cell& c = cells_[stack_.back()];
+            stack_.pop_back();
+            if(c.mass == 0) continue;
+            float dx = std::max({leaf.x - c.cx, c.cx - (leaf.x + leaf.side), 0.f});
+            float dy = std::max({leaf.y - c.cy, c.cy - (leaf.y + leaf.side), 0.f});
+            if(c.side * c.side < theta * theta * (dx * dx + dy * dy))
+            {
+                sx.push_back(c.cx);
+                sy.push_back(c.cy);
+                sm.push_back(float(c.mass));
+            }
+            else if(c.first != 0)
+                for(std::uint32_t i = 0; i < 4; ++i) stack_.push_back(c.first + i);
+            else
+            {
+                sx.insert(sx.end(), bx_.begin() + c.begin, bx_.begin() + c.end);
+                sy.insert(sy.end(), by_.begin() + c.begin, by_.begin() + c.end);
+                sm.resize(sm.size() + (c.end - c.begin), 1.f);
+            }
+        }
+        while(sx.size() % layout_width != 0)
+        {
+            sx.push_back(1e18f);
+            sy.push_back(1e18f);
+            sm.push_back(0);
+        }
+    }
+
+private:
+    void split(std::span<const float> xs, std::span<const float> ys, std::uint32_t c, int depth)
+    {
+        std::uint32_t begin = cells_[c].begin, end = cells_[c].end;
+        cells_[c].mass = end - begin;
+        double sx = 0, sy = 0;
+        for(std::uint32_t i = begin; i < end; ++i)
+        {
+            sx += xs[order_[i]];
+            sy += ys[order_[i]];
+        }
+        if(end > begin)
+        {
+            cells_[c].cx = float(sx / (end - begin));
+            cells_[c].cy = float(sy / (end - begin));
+        }
+        if(end - begin <= bucket || depth == max_depth) return;
+
+        float h = cells_[c].side / 2, x = cells_[c].x, y = cells_[c].y;
+        auto lower = [&](Node v) { return ys[v] < y + h; };
+        auto left = [&](Node v) { return xs[v] < x + h; };
+        Node* o = order_.data();
+        std::uint32_t mid = std::uint32_t(std::partition(o + begin, o + end, lower) - o);
+        std::uint32_t q1 = std::uint32_t(std::partition(o + begin, o + mid, left) - o);
+        std::uint32_t q3 = std::uint32_t(std::partition(o + mid, o + end, left) - o);
+        std::uint32_t first = std::uint32_t(cells_.size());
+        cells_[c].first = first;
+        cells_.push_back({.x = x, .y = y, .side = h, .begin = begin, .end = q1});
+        cells_.push_back({.x = x + h, .y = y, .side = h, .begin = q1, .end = mid});
+        cells_.push_back({.x = x, .y = y + h, .side = h, .begin = mid, .end = q3});
+        cells_.push_back({.x = x + h, .y = y + h, .side = h, .begin = q3, .end = end});
+        for(std::uint32_t i = 0; i < 4; ++i) split(xs, ys, first + i, depth + 1);
+    }
+
+    std::vector<Cell> cells_;
+    std::vector<Node> order_;
+    std::vector<float> bx_, by_;
+    std::vector<std::uint32_t> stack_;
+};
+
+} // namespace detail
+
+// FORCE LAYOUT //
+
+class ForceLayout
+{
+public:
+    explicit ForceLayout(std::size_t n = 0, const LayoutOptions& opts = {}) : opts_(opts)
+    {
+        for(std::size_t i = 0; i < n; ++i) add_node();
+    }
+
+    // the dependency graph, one undirected edge per dependency
+    explicit ForceLayout(const DepGraph& g, const LayoutOptions& opts = {}) : ForceLayout(g.size(), opts)
+    {
+        for(Node v = 0; v < g.size(); ++v)
+            for(Node d : g.deps(v)) add_edge(v, d);
+    }
+
+    // new nodes start on a sunflower spiral (even density, nothing coincides), the i-th at radius
+    // k sqrt(i + 0.5)
+    Node add_node()
+    {
+        Node v = Node(x_.size());
+        float r = opts_.length * std::sqrt(float(v) + 0.5f), a = float(v) * 2.39996323f;
+        return add_node({r * std::cos(a), r * std::sin(a)});
+    }
+
+    // nodes put exactly on top of each other only come apart through their edges
+    Node add_node(Vec2 at)
+    {
+        x_.push_back(at.x);
+        y_.push_back(at.y);
+        fx_.push_back(0);
+        fy_.push_back(0);
+        pinned_.push_back(0);
+        return Node(x_.size() - 1);
+    }
+
+    void add_edge(Node a, Node b)
+    {
+        if(a != b) edges_.push_back({a, b});
+    }
+
+    void remove_edge(Node a, Node b)
+    {
+        std::erase_if(edges_, [&](std::pair<Node, Node> e) { return e == std::pair{a, b} || e == std::pair{b, a}; });
+    }
+
+    // fixes v at `at` until unpinned; a drag pins the node under the cursor every frame
+    void pin(Node v, Vec2 at)
+    {
+        x_[v] = at.x;
+        y_[v] = at.y;
+        pinned_[v] = 1;
+    }
+    void unpin(Node v) { pinned_[v] = 0; }
+
+    // one iteration, returns the energy (sum of squared forces on the free nodes)
+    float step()
+    {
+        std::size_t n = x_.size();
+        if(step_ == 0) step_ = opts_.step > 0 ? opts_.step : opts_.length * std::sqrt(float(std::max<std::size_t>(n, 1))) / 10;
+        float k = opts_.length, k2 = k * k, eps = 1e-4f * k2;
+
+        tree_.build(x_, y_);
+        std::span<const detail::QuadTree::Cell> cells = tree_.cells();
+        std::span<const Node> order = tree_.order();
+        auto kernel = opts_.kernel == LayoutKernel::Vector  ? detail::repel
+                      : opts_.kernel == LayoutKernel::Lanes ? detail::repel_lanes
+                                                            : detail::repel_sequential;
+        for(std::uint32_t l = 0; l < cells.size(); ++l)
+        {
+            if(cells[l].first != 0 || cells[l].mass == 0) continue;
+            tree_.interactions(l, opts_.theta, sx_, sy_, sm_);
+            for(std::uint32_t i = cells[l].begin; i < cells[l].end; ++i)
+            {
+                Node v = order[i];
+                Vec2 f = kernel(x_[v], y_[v], sx_.data(), sy_.data(), sm_.data(), sx_.size(), eps);
+                fx_[v] = f.x * k2;
+                fy_[v] = f.y * k2;
+            }
+        }
+        for(auto [a, b] : edges_)
+        {
+            float dx = x_[b] - x_[a], dy = y_[b] - y_[a];
+            float s = std::sqrt(dx * dx + dy * dy) / k;
+            fx_[a] += dx * s;
+            fy_[a] += dy * s;
+            fx_[b] -= dx * s;
+            fy_[b] -= dy * s;
+        }
+
+        float energy = 0;
+        for(std::size_t v = 0; v < n; ++v)
+        {
+            float f2 = fx_[v] * fx_[v] + fy_[v] * fy_[v];
+            float s = pinned_[v] || f2 == 0 ? 0 : step_ / std::sqrt(f2);
+            energy += pinned_[v] ? 0 : f2;
+            x_[v] += fx_[v] * s;
+            y_[v] += fy_[v] * s;
+        }
+        cool(energy);
+        ++iterations_;
+        return energy;
+    }
+
+    // iterates until the step falls under tolerance * k or after max_iterations, returns how many ran
+    unsigned run(unsigned max_iterations, float tolerance = 0.01f)
+    {
+        unsigned i = 0;
+        while(i < max_iterations && (step_ == 0 || step_ > tolerance * opts_.length))
+        {
+            step();
+            ++i;
+        }
+        return i;
+    }
+
+    // restarts the cooling (after an edit, so the graph can move again)
+    void reheat() { step_ = 0, energy_ = -1, progress_ = 0; }
+
+    std::size_t size() const { return x_.size(); }
+    std::span<const std::pair<Node, Node>> edges() const { return edges_; }
+    std::span<const float> xs() const { return x_; }
+    std::span<const float> ys() const { return y_; }
+    Vec2 position(Node v) const { return {x_[v], y_[v]}; }
+    float step_length() const { return step_; }
+    unsigned iterations() const { return iterations_; }
+
+private:
+    // Hu's schedule: shrink on a rise in energy, grow after five drops in a row
+    void cool(float energy)
+    {
+        if(energy_ >= 0 && energy < energy_)
+        {
+            if(++progress_ >= 5)
+            {
+                progress_ = 0;
+                step_ /= opts_.cooling;
+            }
+        }
+        else
+        {
+            progress_ = 0;
+            step_ *= opts_.cooling;
+        }
+        energy_ = energy;
+    }
+
+    LayoutOptions opts_;
+    std::vector<float> x_, y_, fx_, fy_;
+    std::vector<std::uint8_t> pinned_;
+    std::vector<std::pair<Node, Node>> edges_;
+    detail::QuadTree tree_;
+    std::vector<float> sx_, sy_, sm_; // the current leaf's interaction list
+    float step_ = 0, energy_ = -1;
+    unsigned progress_ = 0, iterations_ = 0;
+};
+
+} // namespace vl
+
+#endif // LAYOUT_HPP
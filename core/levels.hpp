@@ -0,0 +1,306 @@
+// levels.hpp - universe levels: zero | succ l | max l l | imax l l | param
+// hash-consed, index based (a Level is a slot in a LevelTable)
+// (c) 2025 Zachary R. James
+
+#ifndef LEVELS_HPP
+#define LEVELS_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace vl {
+
+using Name  = std::uint32_t; // interned name id (see NameTable in types.hpp)
+using Level = std::uint32_t; // slot in a LevelTable
+
+constexpr std::uint32_t no_slot = UINT32_MAX; // empty entry of an open addressing index
+
+// append-only array: an optional read-only prefix (a mapped library image, see storage.hpp)
+// followed by an owned tail; ids stay the same whether an element came from the image or not
+template<class T>
+class Segment
+{
+public:
+    const T& operator[](std::size_t i) const { return i < base_.size() ? base_[i] : tail_[i - base_.size()]; }
+    std::size_t size() const { return base_.size() + tail_.size(); }
+    std::size_t base_size() const { return base_.size(); }
+
+    void push_back(const T& v) { tail_.push_back(v); }
+    void append(std::span<const T> vs) { tail_.insert(tail_.end(), vs.begin(), vs.end()); }
+
+    // runs appended together never straddle base and tail
+    const T* ptr(std::size_t i) const { return i < base_.size() ? base_.data() + i : tail_.data() + (i - base_.size()); }
+
+    std::span<const T> base() const { return base_; }
+    std::span<const T> tail() const { return tail_; }
+
+    void set_base(std::span<const T> b)
+    {
+        base_ = b;
+        tail_.clear();
+    }
+
+private:
+    std::span<const T> base_;
+    std::vector<T> tail_;
+};
+
+enum class LevelKind : std::uint8_t { Zero, Succ, Max, IMax, Param };
+
+struct LevelNode
+{
+    LevelKind kind;
+    std::uint32_t a, b; // Succ: a | Max/IMax: a, b | Param: a = Name
+};
+
+class LevelTable
+{
+public:
+    LevelTable() { zero_ = intern({LevelKind::Zero, 0, 0}); }
+
+    const LevelNode& operator[](Level l) const { return nodes_[l]; }
+    std::size_t size() const { return nodes_.size(); }
+
+    // library images (storage.hpp): the node array and its index are used in place
+    const Segment<LevelNode>& nodes() const { return nodes_; }
+    static std::uint64_t hash(const LevelNode& n) { return Key{}(n); }
+
+    // exact node, no simplification (stored levels are rebuilt as they were written)
+    Level make(const LevelNode& n) { return intern(n); }
+
+    void attach(std::span<const LevelNode> nodes, std::span<const Level> slots)
+    {
+        nodes_.set_base(nodes);
+        base_slots_ = slots;
+        index_.clear();
+        zero_ = 0;
+    }
+
+    Level zero() const { return zero_; }
+    Level succ(Level l) { return intern({LevelKind::Succ, l, 0}); }
+    Level param(Name n) { return intern({LevelKind::Param, n, 0}); }
+    Level one() { return succ(zero_); }
+
+    // max/imax apply the cheap simplifications up front so common levels stay small
+    Level max(Level l1, Level l2)
+    {
+        if(l1 == l2 || is_zero(l2)) return l1;
+        if(is_zero(l1)) return l2;
+        if(is_explicit(l1) && is_explicit(l2)) return depth(l1) >= depth(l2) ? l1 : l2;
+        if(kind(l2) == LevelKind::Max && (nodes_[l2].a == l1 || nodes_[l2].b == l1)) return l2;
+        auto [b1, k1] = to_offset(l1);
+        auto [b2, k2] = to_offset(l2);
+        if(b1 == b2) return k1 >= k2 ? l1 : l2;
+        return intern({LevelKind::Max, l1, l2});
+    }
+
+    Level imax(Level l1, Level l2)
+    {
+        if(is_not_zero(l2)) return max(l1, l2);
+        if(is_zero(l2)) return l2;
+        if(is_zero(l1) || l1 == one()) return l2;
+        if(l1 == l2) return l1;
+        return intern({LevelKind::IMax, l1, l2});
+    }
+
+    Level succ_n(Level l, unsigned k) { while(k--) l = succ(l); return l; }
+
+    LevelKind kind(Level l) const { return nodes_[l].kind; }
+    bool is_zero(Level l) const { return l == zero_; }
+    bool is_explicit(Level l) const { return is_zero(to_offset(l).first); }
+    unsigned depth(Level l) const { return to_offset(l).second; }
+
+    // l is never zero under any assignment of params
+    bool is_not_zero(Level l) const
+    {
+        switch(kind(l))
+        {
+            case LevelKind::Zero: case LevelKind::Param: return false;
+            case LevelKind::Succ: return true;
+            case LevelKind::Max: return is_not_zero(nodes_[l].a) || is_not_zero(nodes_[l].b);
+            case LevelKind::IMax: return is_not_zero(nodes_[l].b);
+        }
+        return false;
+    }
+
+    // succ^k(base)
+    std::pair<Level, unsigned> to_offset(Level l) const
+    {
+        unsigned k = 0;
+        while(kind(l) == LevelKind::Succ) { l = nodes_[l].a; ++k; }
+        return {l, k};
+    }
+
+    bool has_param(Level l) const
+    {
+        switch(kind(l))
+        {
+            case LevelKind::Zero: return false;
+            case LevelKind::Param: return true;
+            case LevelKind::Succ: return has_param(nodes_[l].a);
+            default: return has_param(nodes_[l].a) || has_param(nodes_[l].b);
+        }
+    }
+
+    // replace params[i] by values[i]
+    Level instantiate(Level l, std::span<const Name> params, std::span<const Level> values)
+    {
+        if(!has_param(l)) return l;
+        const LevelNode n = nodes_[l];
+        switch(n.kind)
+        {
+            case LevelKind::Param:
+            {
+                for(std::size_t i = 0; i < params.size(); ++i)
+                    if(params[i] == n.a) return values[i];
+                return l;
+            }
+            case LevelKind::Succ: return succ(instantiate(n.a, params, values));
+            case LevelKind::Max: return max(instantiate(n.a, params, values), instantiate(n.b, params, values));
+            case LevelKind::IMax: return imax(instantiate(n.a, params, values), instantiate(n.b, params, values));
+            default: return l;
+        }
+    }
+
+    // canonical form: succ^k over a sorted max of non-redundant args (Lean 4 kernel normal form)
+    Level normalize(Level l)
+    {
+        auto [r, k] = to_offset(l);
+        switch(kind(r))
+        {
+            case LevelKind::Zero: case LevelKind::Param: return l;
+            case LevelKind::IMax:
+            {
+                const LevelNode n = nodes_[r];
+                Level l1 = normalize(n.a), l2 = normalize(n.b);
+                return succ_n(imax(l1, l2), k);
+            }
+            default: break;
+        }
+
+        std::vector<Level> todo, args;
+        push_max_args(r, todo);
+        for(Level a : todo) push_max_args(normalize(a), args);
+        std::sort(args.begin(), args.end(), [this](Level x, Level y) { return norm_lt(x, y); });
+
+        std::vector<Level> rargs;
+        std::size_t i = 0;
+        if(is_explicit(args[i]))
+        {
+            // keep the largest explicit level unless some succ^k'(l) with k' >= k subsumes it
+            while(i + 1 < args.size() && is_explicit(args[i + 1])) ++i;
+            unsigned ek = depth(args[i]);
+            std::size_t j = i + 1;
+            for(; j < args.size(); ++j) if(depth(args[j]) >= ek) break;
+            if(j < args.size()) ++i;
+        }
+        rargs.push_back(args[i]);
+        auto prev = to_offset(args[i]);
+        for(++i; i < args.size(); ++i)
+        {
+            auto curr = to_offset(args[i]);
+            if(prev.first == curr.first)
+            {
+                if(prev.second < curr.second) { prev = curr; rargs.back() = args[i]; }
+            }
+            else { prev = curr; rargs.push_back(args[i]); }
+        }
+
+        Level out = succ_n(rargs.back(), k);
+        for(std::size_t m = rargs.size() - 1; m-- > 0;) out = intern({LevelKind::Max, succ_n(rargs[m], k), out});
+        return out;
+    }
+
+    bool is_equiv(Level l1, Level l2) { return l1 == l2 || normalize(l1) == normalize(l2); }
+
+    // l1 >= l2 for every assignment (sound, incomplete; same algorithm as the Lean 4 kernel)
+    bool is_geq(Level l1, Level l2) { return is_geq_core(normalize(l1), normalize(l2)); }
+
+    std::string to_string(Level l, const std::function<std::string(Name)>& name) const
+    {
+        auto [r, k] = to_offset(l);
+        if(is_zero(r)) return std::to_string(k);
+        std::string s;
+        const LevelNode& n = nodes_[r];
+        switch(n.kind)
+        {
+            case LevelKind::Param: s = name(n.a); break;
+            case LevelKind::Max: s = "(max " + to_string(n.a, name) + " " + to_string(n.b, name) + ")"; break;
+            case LevelKind::IMax: s = "(imax " + to_string(n.a, name) + " " + to_string(n.b, name) + ")"; break;
+            default: break;
+        }
+        return k == 0 ? s : s + "+" + std::to_string(k);
+    }
+
+private:
+    struct Key
+    {
+        std::size_t operator()(const LevelNode& n) const
+        { return (std::size_t(n.kind) * 0x9E3779B97F4A7C15ull) ^ (std::size_t(n.a) << 21) ^ n.b; }
+    };
+    struct Eq
+    {
+        bool operator()(const LevelNode& x, const LevelNode& y) const
+        { return x.kind == y.kind && x.a == y.a && x.b == y.b; }
+    };
+
+    Level intern(LevelNode n)
+    {
+        if(!base_slots_.empty())
+        {
+            std::size_t mask = base_slots_.size() - 1;
+            for(std::size_t i = Key{}(n) & mask; base_slots_[i] != no_slot; i = (i + 1) & mask)
+                if(Eq{}(nodes_[base_slots_[i]], n)) return base_slots_[i];
+        }
+        auto [it, fresh] = index_.try_emplace(n, Level(nodes_.size()));
+        if(fresh) nodes_.push_back(n);
+        return it->second;
+    }
+
+    void push_max_args(Level l, std::vector<Level>& out) const
+    {
+        if(kind(l) == LevelKind::Max) { push_max_args(nodes_[l].a, out); push_max_args(nodes_[l].b, out); }
+        else out.push_back(l);
+    }
+
+    // total order on normalized args: explicit levels first, then by base, then by offset
+    bool norm_lt(Level x, Level y) const
+    {
+        auto [bx, kx] = to_offset(x);
+        auto [by, ky] = to_offset(y);
+        bool ex = is_zero(bx), ey = is_zero(by);
+        if(ex != ey) return ex;
+        if(bx != by) return bx < by;
+        return kx < ky;
+    }
+
+    bool is_geq_core(Level l1, Level l2)
+    {
+        if(l1 == l2 || is_zero(l2)) return true;
+        const LevelNode n1 = nodes_[l1], n2 = nodes_[l2];
+        if(n2.kind == LevelKind::Max) return is_geq(l1, n2.a) && is_geq(l1, n2.b);
+        if(n1.kind == LevelKind::Max && (is_geq(n1.a, l2) || is_geq(n1.b, l2))) return true;
+        if(n2.kind == LevelKind::IMax) return is_geq(l1, n2.a) && is_geq(l1, n2.b);
+        if(n1.kind == LevelKind::IMax) return is_geq(n1.b, l2);
+        auto [b1, k1] = to_offset(l1);
+        auto [b2, k2] = to_offset(l2);
+        if(b1 == b2 || is_zero(b1)) return k1 >= k2;
+        if(k1 == k2 && k1 > 0) return is_geq(b1, b2);
+        return false;
+    }
+
+    Segment<LevelNode> nodes_;
+    std::unordered_map<LevelNode, Level, Key, Eq> index_;  // tail only
+    std::span<const Level> base_slots_;                    // image index, no_slot = empty
+    Level zero_ = 0;
+};
+
+} // namespace vl
+
+#endif // LEVELS_HPP
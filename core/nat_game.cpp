@@ -0,0 +1,512 @@
+// nat_game.cpp - the natural number game on the kernel: prove the addition lemmas one level at a
+// time with rw, rfl, exact and induction. proofs are built as terms, a finished level is checked by
+// the kernel as a theorem and becomes a lemma for the next ones. hint lists the lemmas that close the
+// goal or rewrite one of its subterms, looked up in a LemmaIndex over every theorem so far instead of
+// trying each one (the prelude's part of the index is kept beside its snapshot)
+// (c) 2025 Zachary R. James
+
+#include "discr_tree.hpp"
+#include "eval.hpp"
+#include "prelude.hpp"
+#include "storage.hpp"
+
+#include <array>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using namespace vl;
+
+struct Goal
+{
+    Expr target;                                    // a Prop over the level's locals
+    std::vector<std::pair<std::string, Expr>> hyps; // name, local
+    std::function<void(Expr)> close;                // takes a proof of target
+};
+
+// one level: its theorem name, variable names (all Nat) and statement over them
+struct Stage
+{
+    const char* name;
+    std::vector<const char*> vars;
+    std::function<Expr(Pool&, std::span<const Expr>)> statement;
+};
+
+// a lemma or hypothesis ∀ xs, lhs = rhs, instantiated by matching
+struct Rewrite
+{
+    Expr from, to, proof; // proof : from = to
+};
+
+class Game
+{
+public:
+    Game(Environment& env, LemmaIndex& index) : env_(env), p_(env.pool), index_(index), tc_(env), ev_(env) {}
+
+    // plays one level from stdin; false once input ends or the player quits
+    bool play(const Stage& stage)
+    {
+        names_.clear();
+        std::vector<Expr> vars;
+        for(const char* v : stage.vars) vars.push_back(local(v, nat()));
+        Expr target = stage.statement(p_, vars);
+        std::cout << "\n== " << stage.name << " : " << show(target) << "\n";
+
+        Expr proof = no_expr;
+        goals_.clear();
+        goals_.push_back({target, {}, [&](Expr pf) { proof = pf; }});
+        std::string line;
+        while(!goals_.empty())
+        {
+            print_goal();
+            if(!(std::cout << "> " << std::flush, std::getline(std::cin, line)) || line == "quit") return false;
+            try
+            {
+                command(line);
+            }
+            catch(const kernel_exception& ex)
+            {
+                std::cout << "error: " << ex.what() << "\n";
+            }
+        }
+        add_theorem(env_, p_.names.intern(stage.name), {}, tc_.mk_pi(vars, target), tc_.mk_lambda(vars, proof));
+        index_.update();
+        std::cout << stage.name << " proved, the kernel accepted it\n";
+        return true;
+    }
+
+private:
+    Expr nat() { return p_.cnst("Nat"); }
+
+    Expr local(const std::string& name, Expr type)
+    {
+        Expr x = tc_.mk_local(name, type);
+        names_[p_[x].a] = name;
+        return x;
+    }
+
+    // a + b, succ a, 0 and a = b, everything else as the kernel prints it
+    std::string show(Expr e, bool arg = false) const
+    {
+        std::vector<Expr> args;
+        Expr f = p_.app_args(e, args);
+        auto paren = [&](std::string s) { return arg ? "(" + s + ")" : s; };
+        if(p_.kind(f) == ExprKind::FVar) return names_.at(p_[f].a);
+        if(p_.kind(f) == ExprKind::Const)
+        {
+            std::string_view n = p_.names.view(p_[f].a);
+            if(n == "Nat.zero" && args.empty()) return "0";
+            if(n == "Nat.succ" && args.size() == 1) return paren("succ " + show(args[0], true));
+            if(n == "Nat.add" && args.size() == 2) return paren(show(args[0], true) + " + " + show(args[1], true));
+            if(n == "Eq" && args.size() == 3) return paren(show(args[1]) + " = " + show(args[2]));
+        }
+        return paren(p_.to_string(e, [this](std::uint32_t id) { return names_.at(id); }));
+    }
+
+    void print_goal() const
+    {
+        const Goal& g = goals_.back();
+        std::cout << goals_.size() << (goals_.size() == 1 ? " goal" : " goals") << "\n";
+        for(const auto& [n, h] : g.hyps) std::cout << "  " << n << " : " << show(tc_.local(h).type) << "\n";
+        std::cout << "  ⊢ " << show(g.target) << "\n";
+    }
+
+    void command(const std::string& line)
+    {
+        std::size_t sp = line.find(' ');
+        std::string cmd = line.substr(0, sp), arg = sp == std::string::npos ? "" : line.substr(sp + 1);
+        if(cmd == "rw")
+        {
+            bool reverse = arg.starts_with("<- ");
+            rewrite(reverse ? arg.substr(3) : arg, reverse);
+        }
+        else if(cmd == "rfl") rfl();
+        else if(cmd == "exact") exact(arg);
+        else if(cmd == "induction") induction(arg);
+        else if(cmd == "hint") hint();
+        else if(cmd == "help" || cmd.empty())
+            std::cout << "rw [<-] h      rewrite with a lemma or hypothesis (left to right, or back)\n"
+                         "rfl            close a = b when both sides are definitionally equal\n"
+                         "exact h        close the goal with a lemma or hypothesis\n"
+                         "induction n    split on n = 0 and n = succ k, with ih for k\n"
+                         "hint           lemmas that apply here\n"
+                         "quit\n";
+        else std::cout << "unknown command '" << cmd << "', try help\n";
+    }
+
+    // ∀ xs, conclusion: the conclusion with xs as loose bvars, their count, and the proof head
+    struct Statement
+    {
+        Expr conclusion, head;
+        std::uint32_t nvars;
+    };
+
+    Statement statement(const std::string& name)
+    {
+        for(const auto& [n, h] : goals_.back().hyps)
+            if(n == name) return {tc_.local(h).type, h, 0};
+        const Declaration& d = env_.get(p_.names.intern(name));
+        if(d.kind != DeclKind::Theorem && d.kind != DeclKind::Axiom) throw kernel_exception("'" + name + "' is not a lemma");
+        if(!d.lparams.empty()) throw kernel_exception("'" + name + "' is universe polymorphic");
+        Statement s{d.type, p_.cnst(d.name), 0};
+        while(p_.kind(s.conclusion) == ExprKind::Pi) s.conclusion = p_[s.conclusion].c, ++s.nvars;
+        return s;
+    }
+
+    // first order matching, pattern bvar i is assign[i]
+    bool match(Expr pat, Expr t, std::vector<Expr>& assign) const
+    {
+        if(pat == t && !p_.has_loose_bvars(pat)) return true;
+        const ExprNode& n = p_[pat];
+        if(n.kind == ExprKind::BVar)
+        {
+            if(assign[n.a] == no_expr) assign[n.a] = t;
+            return assign[n.a] == t;
+        }
+        if(n.kind != ExprKind::App || p_.kind(t) != ExprKind::App) return false;
+        return match(n.a, p_[t].a, assign) && match(n.b, p_[t].b, assign);
+    }
+
+    // s applied to the matched variables (binder order), or nothing if some were not determined
+    std::optional<Expr> apply(const Statement& s, const std::vector<Expr>& assign)
+    {
+        Expr pf = s.head;
+        for(std::uint32_t j = 0; j < s.nvars; ++j)
+        {
+            if(assign[s.nvars - 1 - j] == no_expr) return std::nullopt;
+            pf = p_.app(pf, assign[s.nvars - 1 - j]);
+        }
+        return pf;
+    }
+
+    static bool is_eq(const Pool& p, Expr e, std::array<Expr, 3>& out)
+    {
+        std::vector<Expr> args;
+        Expr f = p.app_args(e, args);
+        if(p.kind(f) != ExprKind::Const || p.names.view(p[f].a) != "Eq" || args.size() != 3) return false;
+        out = {args[0], args[1], args[2]};
+        return true;
+    }
+
+    // the subterms of e outside binders, each once, outermost first
+    void subterms(Expr e, std::vector<Expr>& out, std::unordered_set<Expr>& seen) const
+    {
+        if(!seen.insert(e).second) return;
+        out.push_back(e);
+        if(p_.kind(e) == ExprKind::App)
+        {
+            subterms(p_[e].a, out, seen);
+            subterms(p_[e].b, out, seen);
+        }
+    }
+
+    // the first subterm of target the lemma rewrites, outermost first
+    std::optional<Rewrite> find_rewrite(const std::string& name, bool reverse, Expr target)
+    {
+        Statement s = statement(name);
+        std::array<Expr, 3> eq;
+        if(!is_eq(p_, s.conclusion, eq)) throw kernel_exception("'" + name + "' is not an equation");
+        std::vector<Expr> ts;
+        std::unordered_set<Expr> seen;
+        subterms(target, ts, seen);
+        for(Expr t : ts)
+        {
+            std::vector<Expr> assign(s.nvars, no_expr);
+            if(!match(reverse ? eq[2] : eq[1], t, assign)) continue;
+            std::optional<Expr> pf = apply(s, assign);
+            if(!pf) continue;
+            Expr from = p_.instantiate(eq[1], assign), to = p_.instantiate(eq[2], assign);
+            if(!reverse) return Rewrite{from, to, *pf};
+            return Rewrite{to, from, symm(eq[0], from, to, *pf)};
+        }
+        return std::nullopt;
+    }
+
+    // h : a = b  ->  b = a, by Eq.rec with motive fun x _ => x = a
+    Expr symm(Expr type, Expr a, Expr b, Expr h)
+    {
+        Expr x = local("x", type), hx = local("h", eq(type, a, x));
+        Expr motive = tc_.mk_lambda(std::array{x, hx}, eq(type, x, a));
+        return rec_eq(type, a, motive, refl(type, a), b, h);
+    }
+
+    Expr eq(Expr type, Expr a, Expr b)
+    {
+        std::array<Level, 1> one{p_.levels.one()};
+        return p_.app(p_.app(p_.app(p_.cnst("Eq", one), type), a), b);
+    }
+
+    Expr refl(Expr type, Expr a)
+    {
+        std::array<Level, 1> one{p_.levels.one()};
+        return p_.app(p_.app(p_.cnst("Eq.refl", one), type), a);
+    }
+
+    // Eq.rec into Prop over a Type
+    Expr rec_eq(Expr type, Expr a, Expr motive, Expr minor, Expr b, Expr h)
+    {
+        std::array<Level, 2> ls{p_.levels.zero(), p_.levels.one()};
+        std::array<Expr, 6> args{type, a, motive, minor, b, h};
+        return p_.app(p_.cnst("Eq.rec", ls), args);
+    }
+
+    // every occurrence of from in e becomes to
+    Expr replace(Expr e, Expr from, Expr to)
+    {
+        if(e == from) return to;
+        const ExprNode& n = p_[e];
+        if(n.kind != ExprKind::App) return e;
+        return p_.app(replace(n.a, from, to), replace(n.b, from, to));
+    }
+
+    // goal G[from] becomes G[to]: a proof p of G[to] gives Eq.rec (fun b _ => G[b] → G[from]) id to h p
+    void rewrite(const std::string& name, bool reverse)
+    {
+        Goal g = goals_.back();
+        std::optional<Rewrite> rw = find_rewrite(name, reverse, g.target);
+        if(!rw) throw kernel_exception("rw: nothing in the goal matches '" + name + "'");
+        Expr type = tc_.infer(rw->from);
+        Expr b = local("b", type), hb = local("h", eq(type, rw->from, b)), y = local("y", g.target);
+        Expr motive = tc_.mk_lambda(std::array{b, hb}, p_.arrow(replace(g.target, rw->from, b), g.target));
+        Expr back = rec_eq(type, rw->from, motive, tc_.mk_lambda(std::array{y}, y), rw->to, rw->proof);
+
+        goals_.pop_back();
+        Goal next{replace(g.target, rw->from, rw->to), g.hyps, [close = g.close, back, this](Expr pf) { close(p_.app(back, pf)); }};
+        std::array<Expr, 3> e;
+        if(is_eq(p_, next.target, e) && e[1] == e[2]) next.close(refl(e[0], e[1])); // rw ends with rfl
+        else goals_.push_back(std::move(next));
+    }
+
+    void rfl()
+    {
+        std::array<Expr, 3> e;
+        if(!is_eq(p_, goals_.back().target, e)) throw kernel_exception("rfl: the goal is not an equation");
+        if(!tc_.is_def_eq(e[1], e[2])) throw kernel_exception("rfl: the two sides are not definitionally equal");
+        Goal g = goals_.back();
+        goals_.pop_back();
+        g.close(refl(e[0], e[1]));
+    }
+
+    void exact(const std::string& name)
+    {
+        Statement s = statement(name);
+        std::vector<Expr> assign(s.nvars, no_expr);
+        std::optional<Expr> pf;
+        if(match(s.conclusion, goals_.back().target, assign)) pf = apply(s, assign);
+        if(!pf) throw kernel_exception("exact: '" + name + "' does not prove the goal");
+        Goal g = goals_.back();
+        goals_.pop_back();
+        g.close(*pf);
+    }
+
+    // Nat.rec (fun n => G[n]) base (fun k ih => step) n
+    void induction(const std::string& var)
+    {
+        Goal g = goals_.back();
+        Expr n = no_expr;
+        for(const auto& [id, name] : names_)
+            if(name == var && occurs(g.target, p_.fvar(id))) n = p_.fvar(id);
+        if(n == no_expr) throw kernel_exception("induction: no variable '" + var + "' in the goal");
+        for(const auto& [hn, h] : g.hyps)
+            if(occurs(tc_.local(h).type, n)) throw kernel_exception("induction: hypothesis '" + hn + "' mentions " + var);
+
+        Expr motive = tc_.mk_lambda(std::array{n}, g.target);
+        Expr k = local(fresh("k"), nat());
+        Expr ih = local(fresh("ih"), p_.instantiate(p_[motive].c, k));
+        struct Cases
+        {
+            Expr base = no_expr, step = no_expr;
+        };
+        auto cases = std::make_shared<Cases>();
+        auto done = [=, this, close = g.close] {
+            if(cases->base == no_expr || cases->step == no_expr) return;
+            std::array<Level, 1> zero{p_.levels.zero()};
+            std::array<Expr, 4> args{motive, cases->base, tc_.mk_lambda(std::array{k, ih}, cases->step), n};
+            close(p_.app(p_.cnst("Nat.rec", zero), args));
+        };
+
+        goals_.pop_back();
+        auto hyps = g.hyps;
+        hyps.push_back({names_.at(p_[ih].a), ih});
+        goals_.push_back({p_.instantiate(p_[motive].c, p_.app(p_.cnst("Nat.succ"), k)), hyps, [=](Expr pf) {
+                              cases->step = pf;
+                              done();
+                          }});
+        goals_.push_back({p_.instantiate(p_[motive].c, p_.cnst("Nat.zero")), g.hyps, [=](Expr pf) {
+                              cases->base = pf;
+                              done();
+                          }});
+    }
+
+    bool occurs(Expr e, Expr x) const
+    {
+        if(e == x) return true;
+        const ExprNode& n = p_[e];
+        switch(n.kind)
+        {
+            case ExprKind::App: return occurs(n.a, x) || occurs(n.b, x);
+            case ExprKind::Lam: case ExprKind::Pi: return occurs(n.b, x) || occurs(n.c, x);
+            default: return false;
+        }
+    }
+
+    std::string fresh(const std::string& base) const
+    {
+        std::string s = base;
+        auto taken = [&](const std::string& c) {
+            for(const auto& [id, n] : names_)
+                if(n == c) return true;
+            return false;
+        };
+        for(int i = 1; taken(s); ++i) s = base + std::to_string(i);
+        return s;
+    }
+
+    // closed sides of an equation are erased and run rather than unfolded by the kernel; the answer
+    // stands when both come out as numerals or constructors over them, none when a side has locals,
+    // does not evaluate (Nat overflow) or has an erased field (a type field is not proof irrelevant)
+    std::optional<bool> same_value(Expr a, Expr b)
+    {
+        if(p_.has_fvar(a) || p_.has_fvar(b)) return std::nullopt;
+        auto equal = [&](auto& self, ValuePtr x, ValuePtr y) -> std::optional<bool> {
+            x = ev_.force(x);
+            y = ev_.force(y);
+            if(x->kind == Value::Kind::Nat && y->kind == Value::Kind::Nat) return x->nat == y->nat;
+            if(x->kind != Value::Kind::Ctor || y->kind != Value::Kind::Ctor) return std::nullopt;
+            if(x->head != y->head) return false;
+            for(std::size_t i = 0; i < x->items.size() && i < y->items.size(); ++i)
+                if(std::optional<bool> r = self(self, x->items[i], y->items[i]); !r || !*r) return r;
+            return true;
+        };
+        try
+        {
+            return equal(equal, ev_.eval(a), ev_.eval(b));
+        }
+        catch(const eval_exception&)
+        {
+            return std::nullopt;
+        }
+        catch(const kernel_exception&)
+        {
+            return std::nullopt;
+        }
+    }
+
+    // candidates from the index, confirmed by trying them; hypotheses are few and just tried
+    void hint()
+    {
+        const Goal& g = goals_.back();
+        std::vector<std::string> out;
+        std::array<Expr, 3> e;
+        if(is_eq(p_, g.target, e))
+        {
+            std::optional<bool> same = same_value(e[1], e[2]);
+            if(same ? *same : tc_.is_def_eq(e[1], e[2])) out.push_back("rfl");
+        }
+
+        std::vector<std::pair<std::string, bool>> tries;
+        std::vector<Expr> ts;
+        std::unordered_set<Expr> seen;
+        subterms(g.target, ts, seen);
+        for(Expr t : ts)
+            for(const LemmaMatch& m : index_.match(t))
+            {
+                if(m.use == LemmaUse::Exact && t == g.target)
+                {
+                    Statement s = statement(p_.names.str(m.name));
+                    std::vector<Expr> assign(s.nvars, no_expr);
+                    if(match(s.conclusion, t, assign) && apply(s, assign)) out.push_back("exact " + p_.names.str(m.name));
+                }
+                else if(m.use != LemmaUse::Exact) tries.push_back({p_.names.str(m.name), m.use == LemmaUse::RewriteReverse});
+            }
+        for(const auto& [n, h] : g.hyps) tries.push_back({n, false}), tries.push_back({n, true});
+
+        std::unordered_set<std::string> shown;
+        for(const auto& [name, reverse] : tries)
+        {
+            std::optional<Rewrite> rw;
+            try
+            {
+                rw = find_rewrite(name, reverse, g.target);
+            }
+            catch(const kernel_exception&)
+            {
+            }
+            std::string cmd = std::string("rw ") + (reverse ? "<- " : "") + name;
+            // unfolding a closed term backwards (0 into 0 - 0) never helps
+            if(rw && reverse && !p_.has_fvar(rw->from)) continue;
+            if(rw && shown.insert(cmd).second) out.push_back(cmd + "    " + show(rw->from) + "  ~>  " + show(rw->to));
+        }
+        if(out.empty()) std::cout << "no lemma applies, maybe induction?\n";
+        for(const std::string& s : out) std::cout << "  " << s << "\n";
+    }
+
+    Environment& env_;
+    Pool& p_;
+    LemmaIndex& index_;
+    TypeChecker tc_;
+    Evaluator ev_;
+    std::vector<Goal> goals_;
+    std::unordered_map<std::uint32_t, std::string> names_; // fvar id -> display name
+};
+
+std::vector<Stage> stages()
+{
+    auto add = [](Pool& p, Expr a, Expr b) { return p.app(p.app(p.cnst("Nat.add"), a), b); };
+    auto succ = [](Pool& p, Expr a) { return p.app(p.cnst("Nat.succ"), a); };
+    auto eq = [](Pool& p, Expr a, Expr b) {
+        std::array<Level, 1> one{p.levels.one()};
+        return p.app(p.app(p.app(p.cnst("Eq", one), p.cnst("Nat")), a), b);
+    };
+    return {
+        {"add_zero", {"a"}, [=](Pool& p, std::span<const Expr> x) { return eq(p, add(p, x[0], p.cnst("Nat.zero")), x[0]); }},
+        {"add_succ", {"a", "b"}, [=](Pool& p, std::span<const Expr> x) { return eq(p, add(p, x[0], succ(p, x[1])), succ(p, add(p, x[0], x[1]))); }},
+        {"zero_add", {"n"}, [=](Pool& p, std::span<const Expr> x) { return eq(p, add(p, p.cnst("Nat.zero"), x[0]), x[0]); }},
+        {"succ_add", {"a", "b"}, [=](Pool& p, std::span<const Expr> x) { return eq(p, add(p, succ(p, x[0]), x[1]), succ(p, add(p, x[0], x[1]))); }},
+        {"add_comm", {"a", "b"}, [=](Pool& p, std::span<const Expr> x) { return eq(p, add(p, x[0], x[1]), add(p, x[1], x[0])); }},
+        {"add_assoc", {"a", "b", "c"}, [=](Pool& p, std::span<const Expr> x) {
+             return eq(p, add(p, add(p, x[0], x[1]), x[2]), add(p, x[0], add(p, x[1], x[2])));
+         }},
+    };
+}
+
+} // namespace
+
+int main()
+{
+    Environment env;
+    open_snapshot(env, snapshot_path("prelude.img"), prelude_key, load_prelude);
+
+    LemmaIndex index(env);
+    std::string index_path = snapshot_path("prelude.lemmas");
+    try
+    {
+        if(index_path.empty()) throw storage_exception("no cache");
+        load_lemma_index(index, env, index_path, prelude_key);
+    }
+    catch(const storage_exception&)
+    {
+        index.restore({}, 0);
+        index.update();
+        if(!index_path.empty())
+        {
+            try { save_lemma_index(index, env, index_path, prelude_key); }
+            catch(const std::exception&) {}
+        }
+    }
+    index.update();
+
+    std::cout << "natural number game: " << index.size() << " lemma patterns indexed, type help for commands\n";
+    Game game(env, index);
+    for(const Stage& s : stages())
+        if(!game.play(s)) return 0;
+    std::cout << "\nall levels done\n";
+}
@@ -0,0 +1,97 @@
+// prelude.hpp - the base environment every frontend starts from
+// Nat, Eq (the identity type, hott::Id), Sigma, List and quotients, all as kernel inductives,
+// and Nat arithmetic written as equations
+// (c) 2025 Zachary R. James
+
+#ifndef PRELUDE_HPP
+#define PRELUDE_HPP
+
+#include "equations.hpp"
+
+#include <array>
+
+namespace vl {
+
+// bump with any change to load_prelude: startup snapshots saved under another version are rebuilt
+constexpr std::uint64_t prelude_version = 1;
+
+// the snapshot key of a prelude environment: a snapshot is only as good as the kernel that checked
+// it, so a new kernel_version rebuilds it too
+constexpr std::uint64_t prelude_key = prelude_version << 32 | kernel_version;
+
+inline void load_prelude(Environment& env)
+{
+    Pool& p = env.pool;
+    TypeChecker tc(env);
+    auto nm = [&](const char* s) { return p.names.intern(s); };
+    Name u = nm("u"), v = nm("v");
+    Level lu = p.levels.param(u), lv = p.levels.param(v);
+    std::array<Level, 1> us{lu};
+    std::array<Level, 2> uvs{lu, lv};
+    Expr prop = p.sort(p.levels.zero());
+    Expr type_u = p.sort(p.levels.succ(lu)), type_v = p.sort(p.levels.succ(lv));
+
+    // inductive Nat : Type | zero : Nat | succ : Nat → Nat
+    Expr nat = p.cnst("Nat");
+    add_inductive(env, {{}, 0, {{nm("Nat"), p.sort(p.levels.one()), {
+        {nm("Nat.zero"), nat},
+        {nm("Nat.succ"), p.arrow(nat, nat)}}}}});
+
+    // inductive Eq.{u} {α : Sort u} (a : α) : α → Prop | refl : Eq a a
+    {
+        Expr alpha = tc.mk_local("α", p.sort(lu), BinderInfo::Implicit);
+        Expr a = tc.mk_local("a", alpha);
+        Expr eq_a = p.app(p.app(p.cnst("Eq", us), alpha), a);
+        add_inductive(env, {{u}, 2, {{nm("Eq"), tc.mk_pi(std::array{alpha, a}, p.arrow(alpha, prop)), {
+            {nm("Eq.refl"), tc.mk_pi(std::array{alpha, a}, p.app(eq_a, a))}}}}});
+    }
+
+    // inductive Sigma.{u, v} {α : Type u} (β : α → Type v) : Type (max u v)
+    // | mk : (fst : α) → β fst → Sigma β
+    {
+        Expr alpha = tc.mk_local("α", type_u, BinderInfo::Implicit);
+        Expr beta = tc.mk_local("β", p.arrow(alpha, type_v));
+        Expr fst = tc.mk_local("fst", alpha), snd = tc.mk_local("snd", p.app(beta, fst));
+        Expr sigma = p.app(p.app(p.cnst("Sigma", uvs), alpha), beta);
+        Expr sort = p.sort(p.levels.max(p.levels.succ(lu), p.levels.succ(lv)));
+        add_inductive(env, {{u, v}, 2, {{nm("Sigma"), tc.mk_pi(std::array{alpha, beta}, sort), {
+            {nm("Sigma.mk"), tc.mk_pi(std::array{alpha, beta, fst, snd}, sigma)}}}}});
+    }
+
+    // inductive List.{u} (α : Type u) : Type u | nil : List α | cons : α → List α → List α
+    {
+        Expr alpha = tc.mk_local("α", type_u);
+        Expr list = p.app(p.cnst("List", us), alpha);
+        Expr head = tc.mk_local("head", alpha), tail = tc.mk_local("tail", list);
+        add_inductive(env, {{u}, 1, {{nm("List"), tc.mk_pi(std::array{alpha}, type_u), {
+            {nm("List.nil"), tc.mk_pi(std::array{alpha}, list)},
+            {nm("List.cons"), tc.mk_pi(std::array{alpha, head, tail}, list)}}}}});
+    }
+
+    add_quot(env);
+
+    // Nat.add n zero = n,  Nat.add n (succ m) = succ (Nat.add n m)
+    // Nat.mul n zero = zero,  Nat.mul n (succ m) = Nat.add (Nat.mul n m) n
+    // Nat.sub n zero = n,  Nat.sub zero (succ m) = zero,  Nat.sub (succ n) (succ m) = Nat.sub n m
+    {
+        Expr zero = p.cnst("Nat.zero"), succ = p.cnst("Nat.succ");
+        Expr add = p.cnst("Nat.add"), mul = p.cnst("Nat.mul"), sub = p.cnst("Nat.sub");
+        Expr n = tc.mk_local("n", nat), m = tc.mk_local("m", nat);
+        Expr binop = p.arrow(nat, p.arrow(nat, nat));
+        auto call = [&](Expr f, Expr a, Expr b) { return p.app(p.app(f, a), b); };
+        add_equations(env, {nm("Nat.add"), {}, binop, {
+            {{n, zero}, n},
+            {{n, p.app(succ, m)}, p.app(succ, call(add, n, m))}}});
+        add_equations(env, {nm("Nat.mul"), {}, binop, {
+            {{n, zero}, zero},
+            {{n, p.app(succ, m)}, call(add, call(mul, n, m), n)}}});
+        add_equations(env, {nm("Nat.sub"), {}, binop, {
+            {{n, zero}, n},
+            {{zero, p.app(succ, m)}, zero},
+            {{p.app(succ, n), p.app(succ, m)}, call(sub, n, m)}}});
+    }
+}
+
+} // namespace vl
+
+#endif // PRELUDE_HPP
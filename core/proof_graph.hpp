@@ -0,0 +1,487 @@
+// proof_graph.hpp - proof trees for the proof view: goals, the tactic steps applied to them and the
+// goals each step leaves, drawn top down in layers (Sugiyama, Tagawa & Toda 1981). a step that
+// closes several goals at once (a shared subproof) has several parents, so the tree is a DAG.
+// relayout() runs the whole pipeline: layers by longest path from the roots, an order within each
+// layer starting from a depth first walk and improved by barycenter sweeps down and up (kept only
+// while the crossings go down), then x coordinates by alternately pulling each layer towards its
+// parents and its children, every pull the least squares placement that keeps the boxes apart.
+// layout() is the incremental pass the view calls after each tactic: nodes placed before keep their
+// layer, order and x; new ones are slotted in by the barycenter of their parents between the fixed
+// ones and pulled under them the same way. when a new run of boxes does not fit before the next
+// fixed box, that box and everything right of it from that layer down move right together, the only
+// way old nodes move. erasing a subtree (undo) leaves its room empty until the next relayout()
+// (c) 2025 Zachary R. James
+
+#ifndef PROOF_GRAPH_HPP
+#define PROOF_GRAPH_HPP
+
+#include "graph.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace vl {
+
+enum class ProofKind : std::uint8_t { Goal, Step };
+
+struct ProofLayoutOptions
+{
+    float gap = 16;           // between boxes in a layer
+    float layer_height = 48;  // between layers
+    unsigned sweeps = 4;      // barycenter rounds (down and up) in relayout()
+    unsigned passes = 4;      // coordinate rounds (parents and children) in relayout()
+};
+
+namespace detail {
+
+// the x minimizing the sum of (x[i] - want[i])² with x[i + 1] - x[i] >= sep[i]: with y[i] = x[i] minus
+// the separations before i the constraint is y nondecreasing, an isotonic regression (pool adjacent
+// violators: merge blocks while one sits left of the block before it, a block sits at its mean)
+inline void pack(std::span<const float> want, std::span<const float> sep, std::span<float> x)
+{
+    std::size_t n = want.size();
+    struct Block
+    {
+        double sum;
+        std::size_t count;
+        double mean() const { return sum / double(count); }
+    };
+    std::vector<Block> blocks;
+    double offset = 0;
+    for(std::size_t i = 0; i < n; ++i)
+    {
+        if(i > 0) offset += sep[i - 1];
+        blocks.push_back({want[i] - offset, 1});
+        while(blocks.size() > 1 && blocks[blocks.size() - 2].mean() >= blocks.back().mean())
+        {
+            Block b = blocks.back();
+            blocks.pop_back();
+            blocks.back().sum += b.sum;
+            blocks.back().count += b.count;
+        }
+    }
+    offset = 0;
+    std::size_t i = 0;
+    for(const Block& b : blocks)
+        for(std::size_t k = 0; k < b.count; ++k, ++i)
+        {
+            if(i > 0) offset += sep[i - 1];
+            x[i] = float(b.mean() + offset);
+        }
+}
+
+} // namespace detail
+
+// PROOF GRAPH //
+
+class ProofGraph
+{
+public:
+    explicit ProofGraph(const ProofLayoutOptions& opts = {}) : opts_(opts) {}
+
+    // a goal or step `width` wide under parent (no_node for the theorem's goal); placed by the next
+    // layout()
+    Node add(ProofKind kind, std::string label, float width, Node parent = no_node)
+    {
+        Node v = Node(nodes_.size());
+        nodes_.push_back({.kind = kind, .label = std::move(label), .width = width, .parents = {}, .kids = {}, .layer = 0,
+                          .pos = 0, .stamp = 0, .x = 0, .alive = true, .placed = false});
+        if(parent != no_node) connect(parent, v);
+        dirty_.push_back(v);
+        return v;
+    }
+
+    // another parent for v; if that pushes v to a deeper layer, v and what hangs below it are placed
+    // again
+    void link(Node parent, Node v)
+    {
+        connect(parent, v);
+        if(nodes_[v].placed && (!nodes_[parent].placed || nodes_[parent].layer + 1 > nodes_[v].layer)) unplace(v);
+    }
+
+    // v and everything below it that no other live parent holds
+    void erase(Node v)
+    {
+        std::vector<Node> todo{v};
+        std::vector<std::uint32_t> touched;
+        while(!todo.empty())
+        {
+            Node x = todo.back();
+            todo.pop_back();
+            ProofNode& n = nodes_[x];
+            if(!n.alive) continue;
+            n.alive = false;
+            if(n.placed)
+            {
+                std::erase(layers_[n.layer], x);
+                touched.push_back(n.layer);
+            }
+            n.placed = false;
+            for(Node p : n.parents) std::erase(nodes_[p].kids, x);
+            n.parents.clear();
+            for(Node k : n.kids)
+            {
+                std::erase(nodes_[k].parents, x);
+                if(nodes_[k].parents.empty()) todo.push_back(k);
+            }
+            n.kids.clear();
+        }
+        std::erase_if(dirty_, [&](Node x) { return !nodes_[x].alive; });
+        std::sort(touched.begin(), touched.end());
+        touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+        for(std::uint32_t l : touched) renumber(l);
+    }
+
+    // places what changed since the last call, the rest stays put
+    void layout()
+    {
+        if(dirty_.empty()) return;
+        std::vector<Node> fresh;
+        std::swap(fresh, dirty_);
+        assign_layers(fresh);
+        std::sort(fresh.begin(), fresh.end(), [&](Node a, Node b) { return nodes_[a].layer < nodes_[b].layer; });
+
+        for(std::size_t i = 0; i < fresh.size();)
+        {
+            std::uint32_t l = nodes_[fresh[i]].layer;
+            std::size_t j = i;
+            while(j < fresh.size() && nodes_[fresh[j]].layer == l) ++j;
+            place_layer(l, std::span<Node>(fresh).subspan(i, j - i));
+            i = j;
+        }
+    }
+
+    // forgets every position and lays the whole graph out again
+    void relayout()
+    {
+        layers_.clear();
+        dirty_.clear();
+        for(ProofNode& n : nodes_) n.placed = false;
+        std::vector<Node> all, roots;
+        for(Node v = 0; v < nodes_.size(); ++v)
+            if(nodes_[v].alive)
+            {
+                all.push_back(v);
+                if(nodes_[v].parents.empty()) roots.push_back(v);
+            }
+        assign_layers(all);
+
+        // a depth first walk lays subtrees side by side: a tree comes out without crossings. every
+        // live node hangs below a root (erase takes what loses its last parent)
+        std::vector<bool> seen(nodes_.size());
+        std::vector<Node> stack(roots.rbegin(), roots.rend());
+        while(!stack.empty())
+        {
+            Node v = stack.back();
+            stack.pop_back();
+            if(seen[v]) continue;
+            seen[v] = true;
+            push(v);
+            for(auto it = nodes_[v].kids.rbegin(); it != nodes_[v].kids.rend(); ++it) stack.push_back(*it);
+        }
+
+        minimize_crossings();
+        coordinates();
+    }
+
+    std::size_t size() const { return nodes_.size(); }
+    bool alive(Node v) const { return nodes_[v].alive; }
+    ProofKind kind(Node v) const { return nodes_[v].kind; }
+    const std::string& label(Node v) const { return nodes_[v].label; }
+    float width(Node v) const { return nodes_[v].width; }
+    std::span<const Node> parents(Node v) const { return nodes_[v].parents; }
+    std::span<const Node> kids(Node v) const { return nodes_[v].kids; }
+
+    // where v is drawn (its centre), valid once placed
+    std::uint32_t layer(Node v) const { return nodes_[v].layer; }
+    float x(Node v) const { return nodes_[v].x; }
+    float y(Node v) const { return float(nodes_[v].layer) * opts_.layer_height; }
+
+    std::size_t layers() const { return layers_.size(); }
+    std::span<const Node> layer_nodes(std::uint32_t l) const { return layers_[l]; }
+
+    // edges between consecutive layers that cross, what the ordering tries to keep low
+    std::size_t crossings() const
+    {
+        std::size_t total = 0;
+        for(std::uint32_t l = 1; l < layers_.size(); ++l) total += crossings(l);
+        return total;
+    }
+
+private:
+    struct ProofNode
+    {
+        ProofKind kind = ProofKind::Goal;
+        std::string label;
+        float width = 0;
+        std::vector<Node> parents, kids;
+        std::uint32_t layer = 0, pos = 0; // pos: index in its layer
+        std::uint32_t stamp = 0;          // assign_layers() has seen it
+        float x = 0;
+        bool alive = true, placed = false;
+    };
+
+    void connect(Node parent, Node v)
+    {
+        nodes_[parent].kids.push_back(v);
+        nodes_[v].parents.push_back(parent);
+    }
+
+    // longest path from a root for the unplaced nodes vs (a placed node keeps its layer), each once:
+    // a walk up through unplaced parents that finishes a node after all of them
+    void assign_layers(std::span<const Node> vs)
+    {
+        ++stamp_;
+        std::vector<std::pair<Node, std::size_t>> stack; // node, next parent to look at
+        for(Node root : vs)
+        {
+            if(nodes_[root].placed || nodes_[root].stamp == stamp_) continue;
+            nodes_[root].stamp = stamp_;
+            stack.push_back({root, 0});
+            while(!stack.empty())
+            {
+                auto& [v, i] = stack.back();
+                const std::vector<Node>& ps = nodes_[v].parents;
+                if(i < ps.size())
+                {
+                    Node p = ps[i++];
+                    if(!nodes_[p].placed && nodes_[p].stamp != stamp_)
+                    {
+                        nodes_[p].stamp = stamp_;
+                        stack.push_back({p, 0});
+                    }
+                    continue;
+                }
+                std::uint32_t l = 0;
+                for(Node p : ps) l = std::max(l, nodes_[p].layer + 1);
+                nodes_[v].layer = l;
+                stack.pop_back();
+            }
+        }
+    }
+
+    // v and its placed descendants leave their layers to be placed again
+    void unplace(Node v)
+    {
+        std::vector<Node> todo{v};
+        while(!todo.empty())
+        {
+            Node x = todo.back();
+            todo.pop_back();
+            if(!nodes_[x].placed) continue;
+            std::vector<Node>& row = layers_[nodes_[x].layer];
+            row.erase(row.begin() + nodes_[x].pos);
+            renumber(nodes_[x].layer);
+            nodes_[x].placed = false;
+            dirty_.push_back(x);
+            for(Node k : nodes_[x].kids) todo.push_back(k);
+        }
+    }
+
+    void push(Node v)
+    {
+        ProofNode& n = nodes_[v];
+        if(layers_.size() <= n.layer) layers_.resize(n.layer + 1);
+        n.pos = std::uint32_t(layers_[n.layer].size());
+        n.placed = true;
+        layers_[n.layer].push_back(v);
+    }
+
+    void renumber(std::uint32_t l)
+    {
+        for(std::uint32_t i = 0; i < layers_[l].size(); ++i) nodes_[layers_[l][i]].pos = i;
+    }
+
+    float sep(Node a, Node b) const { return (nodes_[a].width + nodes_[b].width) / 2 + opts_.gap; }
+
+    // mean x of v's placed parents (up) or children (down), nothing if it has none
+    bool barycenter(Node v, bool up, float& out) const
+    {
+        double sum = 0;
+        std::size_t n = 0;
+        for(Node u : up ? nodes_[v].parents : nodes_[v].kids)
+            if(nodes_[u].placed) sum += nodes_[u].x, ++n;
+        if(n) out = float(sum / double(n));
+        return n > 0;
+    }
+
+    // INCREMENTAL //
+
+    // new nodes of one layer: ordered by their parents' x (then by their place among the parent's
+    // children), slotted between the fixed nodes, then each run between two fixed nodes is packed
+    // under its parents and, if it does not fit, makes room on its right
+    void place_layer(std::uint32_t l, std::span<Node> fresh)
+    {
+        if(layers_.size() <= l) layers_.resize(l + 1);
+        std::vector<Node>& row = layers_[l];
+        float right = row.empty() ? 0 : nodes_[row.back()].x + nodes_[row.back()].width / 2;
+        std::vector<std::pair<std::pair<float, std::uint32_t>, Node>> keyed;
+        for(Node v : fresh)
+        {
+            float b = right;
+            barycenter(v, true, b);
+            std::uint32_t rank = 0;
+            if(!nodes_[v].parents.empty())
+            {
+                const std::vector<Node>& sibs = nodes_[nodes_[v].parents[0]].kids;
+                rank = std::uint32_t(std::find(sibs.begin(), sibs.end(), v) - sibs.begin());
+            }
+            nodes_[v].x = b;
+            keyed.push_back({{b, rank}, v});
+        }
+        std::sort(keyed.begin(), keyed.end());
+        for(std::size_t i = 0; i < keyed.size(); ++i) fresh[i] = keyed[i].second;
+
+        std::vector<Node> merged;
+        merged.reserve(row.size() + fresh.size());
+        std::merge(row.begin(), row.end(), fresh.begin(), fresh.end(), std::back_inserter(merged),
+                   [&](Node a, Node b) { return nodes_[a].x < nodes_[b].x; });
+        row = std::move(merged);
+        renumber(l);
+
+        // the fresh nodes are the unplaced ones until the end
+        std::vector<float> want, seps, xs;
+        for(std::size_t i = 0; i < row.size();)
+        {
+            if(nodes_[row[i]].placed) { ++i; continue; }
+            std::size_t j = i;
+            while(j < row.size() && !nodes_[row[j]].placed) ++j;
+            want.clear();
+            seps.clear();
+            for(std::size_t k = i; k < j; ++k)
+            {
+                want.push_back(nodes_[row[k]].x);
+                if(k + 1 < j) seps.push_back(sep(row[k], row[k + 1]));
+            }
+            xs.resize(want.size());
+            detail::pack(want, seps, xs);
+            if(i > 0) // clear of the fixed node on the left
+            {
+                float d = nodes_[row[i - 1]].x + sep(row[i - 1], row[i]) - xs[0];
+                if(d > 0)
+                    for(float& x : xs) x += d;
+            }
+            for(std::size_t k = i; k < j; ++k) nodes_[row[k]].x = xs[k - i];
+            if(j < row.size()) // room from the fixed node on the right
+            {
+                float need = nodes_[row[j - 1]].x + sep(row[j - 1], row[j]) - nodes_[row[j]].x;
+                if(need > 0) shift_right(l, j, need);
+            }
+            i = j;
+        }
+        for(Node v : fresh) nodes_[v].placed = true;
+    }
+
+    // the nodes of layer l from index i on, and every placed node below at least as far right as the
+    // first of them, move right by d
+    void shift_right(std::uint32_t l, std::size_t i, float d)
+    {
+        float from = nodes_[layers_[l][i]].x;
+        for(std::size_t k = i; k < layers_[l].size(); ++k) nodes_[layers_[l][k]].x += d;
+        for(std::uint32_t k = l + 1; k < layers_.size(); ++k)
+            for(Node v : layers_[k])
+                if(nodes_[v].placed && nodes_[v].x >= from) nodes_[v].x += d;
+    }
+
+    // FULL LAYOUT //
+
+    std::size_t crossings(std::uint32_t l) const
+    {
+        // edges from layer l - 1 into l by (upper pos, lower pos); inversions of the lower ends
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> es;
+        for(Node v : layers_[l])
+            for(Node p : nodes_[v].parents)
+                if(nodes_[p].layer + 1 == l) es.push_back({nodes_[p].pos, nodes_[v].pos});
+        std::sort(es.begin(), es.end());
+        std::vector<std::uint32_t> tree(layers_[l].size() + 1); // Fenwick tree over lower positions
+        std::size_t count = 0;
+        for(std::size_t i = 0; i < es.size(); ++i)
+        {
+            std::size_t le = 0;
+            for(std::uint32_t k = es[i].second + 1; k > 0; k -= k & -k) le += tree[k];
+            count += i - le;
+            for(std::uint32_t k = es[i].second + 1; k < tree.size(); k += k & -k) ++tree[k];
+        }
+        return count;
+    }
+
+    // barycenter heuristic on positions scaled to [0, 1) so that parents further up count too
+    void minimize_crossings()
+    {
+        std::vector<std::vector<Node>> best = layers_;
+        std::size_t best_count = crossings();
+        std::vector<float> key(nodes_.size());
+        for(unsigned s = 0; s < opts_.sweeps && best_count > 0; ++s)
+        {
+            for(int dir = 0; dir < 2; ++dir)
+            {
+                bool up = dir == 0; // down sweep orders each layer by its parents
+                for(std::size_t i = 0; i < layers_.size(); ++i)
+                {
+                    std::uint32_t l = std::uint32_t(up ? i : layers_.size() - 1 - i);
+                    std::vector<Node>& row = layers_[l];
+                    for(Node v : row)
+                    {
+                        double sum = 0;
+                        std::size_t n = 0;
+                        for(Node u : up ? nodes_[v].parents : nodes_[v].kids)
+                            sum += (nodes_[u].pos + 0.5) / double(layers_[nodes_[u].layer].size()), ++n;
+                        key[v] = n ? float(sum / double(n)) : (nodes_[v].pos + 0.5f) / float(row.size());
+                    }
+                    std::stable_sort(row.begin(), row.end(), [&](Node a, Node b) { return key[a] < key[b]; });
+                    renumber(l);
+                }
+                std::size_t c = crossings();
+                if(c < best_count) best = layers_, best_count = c;
+            }
+        }
+        layers_ = std::move(best);
+        for(std::uint32_t l = 0; l < layers_.size(); ++l) renumber(l);
+    }
+
+    void coordinates()
+    {
+        std::vector<float> want, seps, xs;
+        auto pull = [&](std::uint32_t l, int mode) { // 0: pack only, 1: to parents, 2: to children
+            std::vector<Node>& row = layers_[l];
+            want.clear();
+            seps.clear();
+            for(std::size_t i = 0; i < row.size(); ++i)
+            {
+                float w = nodes_[row[i]].x;
+                if(mode) barycenter(row[i], mode == 1, w);
+                want.push_back(w);
+                if(i + 1 < row.size()) seps.push_back(sep(row[i], row[i + 1]));
+            }
+            xs.resize(want.size());
+            detail::pack(want, seps, xs);
+            for(std::size_t i = 0; i < row.size(); ++i) nodes_[row[i]].x = xs[i];
+        };
+        for(std::uint32_t l = 0; l < layers_.size(); ++l)
+        {
+            for(Node v : layers_[l]) nodes_[v].x = 0;
+            pull(l, 0);
+        }
+        for(unsigned p = 0; p < opts_.passes; ++p)
+        {
+            for(std::uint32_t l = 1; l < layers_.size(); ++l) pull(l, 1);
+            for(std::uint32_t l = std::uint32_t(layers_.size()); l-- > 0;) pull(l, 2);
+        }
+        for(std::uint32_t l = 1; l < layers_.size(); ++l) pull(l, 1);
+    }
+
+    ProofLayoutOptions opts_;
+    std::vector<ProofNode> nodes_;
+    std::vector<std::vector<Node>> layers_; // placed nodes left to right
+    std::vector<Node> dirty_;               // added or moved since the last layout()
+    std::uint32_t stamp_ = 0;
+};
+
+} // namespace vl
+
+#endif // PROOF_GRAPH_HPP
@@ -0,0 +1,4064 @@
+// storage.hpp - library images: a checked environment as one immutable, position-independent file
+// the term, name and level arrays and their hash-cons indexes are written in the pool's own layout
+// (slot ids, no pointers), so loading maps the file read only and points the tables at it.
+// nothing is decoded except the declaration records; new terms go to the pool's owned tail.
+// terms are ordered signatures first, so values and proofs only page in when something uses them.
+// processes mapping the same image share its pages through the page cache.
+// images are trusted like object files: the kernel checked every declaration before it was saved.
+// open_snapshot keeps a frontend's starting environment as an image so later starts only map it.
+// ContentStore keeps declarations by the hash of their contents instead, with the hashes the kernel
+// has verified, so re-importing checked declarations skips the kernel (inductive blocks always go
+// through it: their recursors are regenerated, not read), and packs them into pages
+// compressed against a trained dictionary; Catalog names them, its edits
+// made durable through a write-ahead log with group commit; MetaStore keeps attributes and
+// cross-references in an on-disk B+tree; compact_library drops what no name reaches any more and
+// reorders the rest by dependency; SearchIndex finds names by substring,
+// save_lemma_index keeps a LemmaIndex across sessions, SimilarityIndex finds near-duplicate
+// declarations by MinHash signatures of their term shapes
+// (c) 2025 Zachary R. James
+
+#ifndef STORAGE_HPP
+#define STORAGE_HPP
+
+#include "checker.hpp"
+#include "discr_tree.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define VL_HAVE_MMAP 1
+#endif
+
+namespace vl {
+
+struct storage_exception : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+// FORMAT //
+// ImageHeader, then one 64-byte aligned section per Section, all little endian
+
+constexpr char image_magic[8] = {'V', 'L', 'I', 'M', 'A', 'G', 'E', 0};
+constexpr std::uint32_t image_version = 3;
+constexpr std::uint32_t image_endian = 0x01020304;
+constexpr std::size_t image_align = 64;
+
+enum class Section : std::uint32_t
+{
+    NameChars,   // char[], every name back to back
+    NameOffsets, // u32[names + 1]
+    NameSlots,   // u32[2^k], FNV-1a open addressing index over names
+    Levels,      // LevelNode[]
+    LevelSlots,  // u32[2^k]
+    Exprs,       // ExprNode[]
+    ExprSlots,   // u32[2^k], keyed by ExprNode::hash
+    Lists,       // u32[], level lists: count, then levels
+    ListSlots,   // u32[2^k]
+    Decls,       // DeclRecord[]
+    DeclData,    // u32[], the variable length parts of declarations
+    Count
+};
+
+struct SectionEntry
+{
+    std::uint64_t offset, size; // bytes
+};
+
+struct ImageHeader
+{
+    char magic[8];
+    std::uint32_t version, endian;
+    std::uint64_t file_size;
+    std::uint32_t next_fvar;
+    std::uint32_t quot_initialized;
+    Name quot_mk, quot_lift, quot_ind;
+    std::uint32_t signature_nodes; // Exprs[0, signature_nodes) is everything declaration types reach
+    std::uint64_t key;             // caller's fingerprint of what built the environment, see open_snapshot
+    SectionEntry sections[std::size_t(Section::Count)];
+};
+
+// fixed size part of a Declaration; lists are runs in DeclData (rules: ctor, nfields, rhs)
+struct DeclRecord
+{
+    DeclKind kind;
+    QuotKind quot;
+    std::uint8_t is_rec, k;
+    Name name;
+    Expr type, value;
+    std::uint32_t height;
+    std::uint32_t nparams, nindices, nmotives, nminors, cidx, nfields;
+    Name induct;
+    std::uint32_t lparams, nlparams, all, nall, ctors, nctors, rules, nrules;
+};
+
+static_assert(std::is_trivially_copyable_v<ExprNode> && std::is_trivially_copyable_v<LevelNode> &&
+              std::is_trivially_copyable_v<DeclRecord>);
+
+// MAPPING //
+
+// read only view of a whole file: mmap where available, otherwise one read into memory
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& path)
+    {
+#ifdef VL_HAVE_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0) throw storage_exception("cannot open '" + path + "'");
+        struct stat st{};
+        if(::fstat(fd, &st) != 0) { ::close(fd); throw storage_exception("cannot stat '" + path + "'"); }
+        size_ = std::size_t(st.st_size);
+        if(size_ > 0)
+        {
+            void* p = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+            if(p == MAP_FAILED) { ::close(fd); throw storage_exception("cannot map '" + path + "'"); }
+            data_ = static_cast<const std::byte*>(p);
+        }
+        ::close(fd);
+#else
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if(!in) throw storage_exception("cannot open '" + path + "'");
+        size_ = std::size_t(in.tellg());
+        copy_.resize((size_ + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t));
+        in.seekg(0);
+        in.read(reinterpret_cast<char*>(copy_.data()), std::streamsize(size_));
+        data_ = reinterpret_cast<const std::byte*>(copy_.data());
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+#ifdef VL_HAVE_MMAP
+        if(data_) ::munmap(const_cast<std::byte*>(data_), size_);
+#endif
+    }
+
+    std::span<const std::byte> bytes() const { return {data_, size_}; }
+
+    enum class Advice { WillNeed, Random };
+
+    // paging hint for a byte range (no-op without mmap)
+    void advise(std::size_t offset, std::size_t size, Advice a) const
+    {
+#ifdef VL_HAVE_MMAP
+        std::size_t page = std::size_t(::sysconf(_SC_PAGESIZE));
+        std::size_t begin = offset / page * page, end = std::min(offset + size, size_);
+        if(!data_ || begin >= end) return;
+        ::posix_madvise(const_cast<std::byte*>(data_) + begin, end - begin,
+                        a == Advice::WillNeed ? POSIX_MADV_WILLNEED : POSIX_MADV_RANDOM);
+#else
+        (void)offset; (void)size; (void)a;
+#endif
+    }
+
+private:
+    const std::byte* data_ = nullptr;
+    std::size_t size_ = 0;
+#ifndef VL_HAVE_MMAP
+    std::vector<std::max_align_t> copy_;
+#endif
+};
+
+// WRITING //
+
+namespace detail {
+
+// open addressing table over ids 0..n-1 (skipping those with !keep), same probing as the readers
+template<class Hash, class Keep>
+std::vector<std::uint32_t> slot_table(std::size_t n, Hash hash, Keep keep)
+{
+    std::size_t cap = 16;
+    while(cap < 2 * n) cap *= 2;
+    std::vector<std::uint32_t> slots(cap, no_slot);
+    for(std::uint32_t id = 0; id < n; ++id)
+    {
+        if(!keep(id)) continue;
+        std::size_t i = hash(id) & (cap - 1);
+        while(slots[i] != no_slot) i = (i + 1) & (cap - 1);
+        slots[i] = id;
+    }
+    return slots;
+}
+
+class ImageWriter
+{
+public:
+    explicit ImageWriter(const std::string& path) : out_(path, std::ios::binary | std::ios::trunc)
+    {
+        if(!out_) throw storage_exception("cannot write '" + path + "'");
+        pos_ = sizeof(ImageHeader);
+        out_.seekp(std::streamoff(pos_));
+    }
+
+    // a section made of consecutive runs (base and tail of a Segment, or one vector)
+    template<class T>
+    void section(Section s, std::initializer_list<std::span<const T>> runs)
+    {
+        pad();
+        SectionEntry& e = header_.sections[std::size_t(s)];
+        e.offset = pos_;
+        for(std::span<const T> r : runs)
+        {
+            out_.write(reinterpret_cast<const char*>(r.data()), std::streamsize(r.size_bytes()));
+            pos_ += r.size_bytes();
+        }
+        e.size = pos_ - e.offset;
+    }
+
+    ImageHeader& header() { return header_; }
+
+    void finish()
+    {
+        pad();
+        std::memcpy(header_.magic, image_magic, sizeof(image_magic));
+        header_.version = image_version;
+        header_.endian = image_endian;
+        header_.file_size = pos_;
+        out_.seekp(0);
+        out_.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+        out_.flush();
+        if(!out_) throw storage_exception("write failed");
+    }
+
+private:
+    void pad()
+    {
+        static const char zeros[image_align] = {};
+        std::size_t n = (image_align - pos_ % image_align) % image_align;
+        out_.write(zeros, std::streamsize(n));
+        pos_ += n;
+    }
+
+    std::ofstream out_;
+    std::uint64_t pos_ = 0;
+    ImageHeader header_{};
+};
+
+template<class T>
+std::span<const T> as_span(std::span<const std::byte> bytes, const SectionEntry& e)
+{
+    if(e.offset % image_align || e.size % sizeof(T) || e.offset + e.size > bytes.size())
+        throw storage_exception("corrupt image: bad section bounds");
+    return {reinterpret_cast<const T*>(bytes.data() + e.offset), std::size_t(e.size / sizeof(T))};
+}
+
+} // namespace detail
+
+inline void save_image(const Environment& env, const std::string& path, std::uint64_t key = 0)
+{
+    const Pool& p = env.pool;
+    detail::ImageWriter w(path);
+
+    // names
+    std::vector<char> chars;
+    std::vector<std::uint32_t> offsets{0};
+    for(Name n = 0; n < p.names.size(); ++n)
+    {
+        std::string_view s = p.names.view(n);
+        chars.insert(chars.end(), s.begin(), s.end());
+        offsets.push_back(std::uint32_t(chars.size()));
+    }
+    auto name_slots = detail::slot_table(p.names.size(), [&](Name n) { return NameTable::hash(p.names.view(n)); },
+                                         [](Name) { return true; });
+    w.section<char>(Section::NameChars, {chars});
+    w.section<std::uint32_t>(Section::NameOffsets, {offsets});
+    w.section<std::uint32_t>(Section::NameSlots, {name_slots});
+
+    // levels
+    const Segment<LevelNode>& lv = p.levels.nodes();
+    auto level_slots = detail::slot_table(lv.size(), [&](Level l) { return LevelTable::hash(lv[l]); },
+                                          [](Level) { return true; });
+    w.section<LevelNode>(Section::Levels, {lv.base(), lv.tail()});
+    w.section<std::uint32_t>(Section::LevelSlots, {level_slots});
+
+    // terms, renumbered: what declaration types reach first, then what only values and recursor
+    // rules reach, so opening an image pages in signatures and leaves proofs on disk until used.
+    // terms no declaration mentions (the checker's intermediate results) are dropped
+    const Segment<ExprNode>& ns = p.nodes();
+    enum : std::uint8_t { unused, signature, body };
+    std::vector<std::uint8_t> region(ns.size(), unused);
+    auto reach = [&](Expr root, std::uint8_t r) {
+        std::vector<Expr> todo{root};
+        while(!todo.empty())
+        {
+            Expr x = todo.back(); todo.pop_back();
+            if(region[x] != unused) continue;
+            region[x] = r;
+            const ExprNode& n = ns[x];
+            switch(n.kind)
+            {
+                case ExprKind::App: todo.push_back(n.a); todo.push_back(n.b); break;
+                case ExprKind::Lam: case ExprKind::Pi: todo.push_back(n.b); todo.push_back(n.c); break;
+                case ExprKind::Let: todo.push_back(n.b); todo.push_back(n.c); todo.push_back(n.d); break;
+                default: break;
+            }
+        }
+    };
+    for(const Declaration& d : env.decls()) reach(d.type, signature);
+    for(const Declaration& d : env.decls())
+    {
+        if(d.value != no_expr) reach(d.value, body);
+        for(const RecRule& rr : d.rules) reach(rr.rhs, body);
+    }
+    // children keep smaller ids than their parents within and across the two runs
+    std::vector<Expr> remap(ns.size(), no_expr);
+    std::vector<ExprNode> exprs;
+    for(std::uint8_t r : {signature, body})
+        for(Expr e = 0; e < ns.size(); ++e)
+        {
+            if(region[e] != r) continue;
+            ExprNode n = ns[e];
+            switch(n.kind)
+            {
+                case ExprKind::App: n.a = remap[n.a]; n.b = remap[n.b]; break;
+                case ExprKind::Lam: case ExprKind::Pi: n.b = remap[n.b]; n.c = remap[n.c]; break;
+                case ExprKind::Let: n.b = remap[n.b]; n.c = remap[n.c]; n.d = remap[n.d]; break;
+                default: break;
+            }
+            n.hash = Pool::hash(n);
+            remap[e] = Expr(exprs.size());
+            exprs.push_back(n);
+        }
+    auto signature_nodes = std::uint32_t(std::count(region.begin(), region.end(), signature));
+    auto expr_slots = detail::slot_table(exprs.size(), [&](Expr e) { return exprs[e].hash; }, [](Expr) { return true; });
+    w.section<ExprNode>(Section::Exprs, {exprs});
+    w.section<std::uint32_t>(Section::ExprSlots, {expr_slots});
+
+    // level lists, indexed by their start offset
+    const Segment<std::uint32_t>& ls = p.level_lists();
+    std::vector<bool> starts(ls.size());
+    for(std::size_t off = 0; off < ls.size(); off += ls[off] + 1) starts[off] = true;
+    auto list_slots = detail::slot_table(
+        ls.size(), [&](std::uint32_t off) { return Pool::list_hash({ls.ptr(off) + 1, ls[off]}); },
+        [&](std::uint32_t off) { return off > 0 && starts[off]; });
+    w.section<std::uint32_t>(Section::Lists, {ls.base(), ls.tail()});
+    w.section<std::uint32_t>(Section::ListSlots, {list_slots});
+
+    // declarations
+    std::vector<DeclRecord> recs;
+    std::vector<std::uint32_t> data;
+    auto run = [&](std::span<const Name> xs) {
+        auto off = std::uint32_t(data.size());
+        data.insert(data.end(), xs.begin(), xs.end());
+        return off;
+    };
+    for(const Declaration& d : env.decls())
+    {
+        DeclRecord r{};
+        r.kind = d.kind;
+        r.quot = d.quot;
+        r.is_rec = d.is_rec;
+        r.k = d.k;
+        r.name = d.name;
+        r.type = remap[d.type];
+        r.value = d.value == no_expr ? no_expr : remap[d.value];
+        r.height = d.height;
+        r.nparams = d.nparams;
+        r.nindices = d.nindices;
+        r.nmotives = d.nmotives;
+        r.nminors = d.nminors;
+        r.cidx = d.cidx;
+        r.nfields = d.nfields;
+        r.induct = d.induct;
+        r.lparams = run(d.lparams);
+        r.nlparams = std::uint32_t(d.lparams.size());
+        r.all = run(d.all);
+        r.nall = std::uint32_t(d.all.size());
+        r.ctors = run(d.ctors);
+        r.nctors = std::uint32_t(d.ctors.size());
+        r.rules = std::uint32_t(data.size());
+        r.nrules = std::uint32_t(d.rules.size());
+        for(const RecRule& rr : d.rules) data.insert(data.end(), {rr.ctor, rr.nfields, remap[rr.rhs]});
+        recs.push_back(r);
+    }
+    w.section<DeclRecord>(Section::Decls, {recs});
+    w.section<std::uint32_t>(Section::DeclData, {data});
+
+    ImageHeader& h = w.header();
+    h.next_fvar = p.next_fvar();
+    h.quot_initialized = env.quot_initialized;
+    h.quot_mk = env.quot_mk;
+    h.quot_lift = env.quot_lift;
+    h.quot_ind = env.quot_ind;
+    h.signature_nodes = signature_nodes;
+    h.key = key;
+    w.finish();
+}
+
+// LOADING //
+
+// env must be empty (fresh Environment); it keeps the mapping alive. key must match save_image's
+inline void load_image(Environment& env, const std::string& path, std::uint64_t key = 0)
+{
+    if(!env.decls().empty()) throw storage_exception("load_image needs an empty environment");
+    auto file = std::make_shared<const MappedFile>(path);
+    std::span<const std::byte> bytes = file->bytes();
+
+    ImageHeader h;
+    if(bytes.size() < sizeof(h)) throw storage_exception("'" + path + "' is not a library image");
+    std::memcpy(&h, bytes.data(), sizeof(h));
+    if(std::memcmp(h.magic, image_magic, sizeof(image_magic)) != 0)
+        throw storage_exception("'" + path + "' is not a library image");
+    if(h.version != image_version || h.endian != image_endian)
+        throw storage_exception("'" + path + "' was written by an incompatible version");
+    if(h.file_size != bytes.size()) throw storage_exception("'" + path + "' is truncated");
+    if(h.key != key) throw storage_exception("'" + path + "' was built from something else");
+
+    auto at = [&](Section s) -> const SectionEntry& { return h.sections[std::size_t(s)]; };
+    auto is_table = [](std::span<const std::uint32_t> t) { return t.size() >= 16 && (t.size() & (t.size() - 1)) == 0; };
+
+    auto chars = detail::as_span<char>(bytes, at(Section::NameChars));
+    auto offsets = detail::as_span<std::uint32_t>(bytes, at(Section::NameOffsets));
+    auto name_slots = detail::as_span<std::uint32_t>(bytes, at(Section::NameSlots));
+    auto levels = detail::as_span<LevelNode>(bytes, at(Section::Levels));
+    auto level_slots = detail::as_span<std::uint32_t>(bytes, at(Section::LevelSlots));
+    auto exprs = detail::as_span<ExprNode>(bytes, at(Section::Exprs));
+    auto expr_slots = detail::as_span<std::uint32_t>(bytes, at(Section::ExprSlots));
+    auto lists = detail::as_span<std::uint32_t>(bytes, at(Section::Lists));
+    auto list_slots = detail::as_span<std::uint32_t>(bytes, at(Section::ListSlots));
+    auto recs = detail::as_span<DeclRecord>(bytes, at(Section::Decls));
+    auto data = detail::as_span<std::uint32_t>(bytes, at(Section::DeclData));
+
+    if(offsets.empty() || offsets.back() != chars.size() || levels.empty() || lists.empty() ||
+       !is_table(name_slots) || !is_table(level_slots) || !is_table(expr_slots) || !is_table(list_slots) ||
+       h.signature_nodes > exprs.size())
+        throw storage_exception("corrupt image '" + path + "'");
+
+    // everything up to the end of the signatures is needed right away, bodies fault in when used
+    std::size_t bodies = at(Section::Exprs).offset + std::size_t(h.signature_nodes) * sizeof(ExprNode);
+    file->advise(0, bodies, MappedFile::Advice::WillNeed);
+    file->advise(bodies, exprs.size_bytes() - std::size_t(h.signature_nodes) * sizeof(ExprNode), MappedFile::Advice::Random);
+
+    Pool& p = env.pool;
+    p.names.attach(chars, offsets, name_slots);
+    p.levels.attach(levels, level_slots);
+    p.attach(exprs, expr_slots, lists, list_slots, h.next_fvar, file);
+
+    auto names = [&](std::uint32_t off, std::uint32_t n) {
+        if(std::size_t(off) + n > data.size()) throw storage_exception("corrupt image '" + path + "'");
+        return std::vector<Name>(data.begin() + off, data.begin() + off + n);
+    };
+    for(const DeclRecord& r : recs)
+    {
+        Declaration d;
+        d.kind = r.kind;
+        d.quot = r.quot;
+        d.is_rec = r.is_rec;
+        d.k = r.k;
+        d.name = r.name;
+        d.type = r.type;
+        d.value = r.value;
+        d.height = r.height;
+        d.nparams = r.nparams;
+        d.nindices = r.nindices;
+        d.nmotives = r.nmotives;
+        d.nminors = r.nminors;
+        d.cidx = r.cidx;
+        d.nfields = r.nfields;
+        d.induct = r.induct;
+        d.lparams = names(r.lparams, r.nlparams);
+        d.all = names(r.all, r.nall);
+        d.ctors = names(r.ctors, r.nctors);
+        std::vector<Name> rules = names(r.rules, 3 * r.nrules);
+        for(std::size_t i = 0; i < rules.size(); i += 3) d.rules.push_back({rules[i], rules[i + 1], rules[i + 2]});
+        env.add(std::move(d));
+    }
+    env.quot_initialized = h.quot_initialized;
+    env.quot_mk = h.quot_mk;
+    env.quot_lift = h.quot_lift;
+    env.quot_ind = h.quot_ind;
+}
+
+// SNAPSHOTS //
+// startup without re-elaborating: the environment a frontend starts from is built once and saved as
+// an image, later starts map it (no fix-up pass, the image has no pointers). key identifies what
+// built it (e.g. prelude_key), an image with another key or an older format is rebuilt.
+// type checker and evaluator caches are per instance and not kept
+
+// per user cache file: $XDG_CACHE_HOME/visual_lean/<file>, else ~/.cache/visual_lean/<file>,
+// empty when neither is set
+inline std::string snapshot_path(const std::string& file)
+{
+    std::filesystem::path dir;
+    if(const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) dir = xdg;
+    else if(const char* home = std::getenv("HOME"); home && *home) dir = std::filesystem::path(home) / ".cache";
+    else return {};
+    return (dir / "visual_lean" / file).string();
+}
+
+// maps path if it was saved with key, otherwise runs build(env) and saves it for the next start
+// (through a temporary file renamed over path, so concurrent starts see a whole image or none).
+// env must be empty; returns whether the image was used. an unwritable cache only costs speed
+template<class Build>
+bool open_snapshot(Environment& env, const std::string& path, std::uint64_t key, Build&& build)
+{
+    std::error_code ec;
+    if(!path.empty() && std::filesystem::exists(path, ec))
+    {
+        try
+        {
+            load_image(env, path, key);
+            return true;
+        }
+        catch(const storage_exception&)
+        {
+            env = Environment();
+        }
+    }
+    build(env);
+    if(path.empty()) return false;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+    std::string tmp = path + ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    try
+    {
+        save_image(env, tmp, key);
+        std::filesystem::rename(tmp, path, ec);
+    }
+    catch(const storage_exception&)
+    {
+        ec = std::make_error_code(std::errc::io_error);
+    }
+    if(ec) std::filesystem::remove(tmp, ec);
+    return false;
+}
+
+// CONTENT ADDRESSING //
+// a declaration is identified by a SHA-256 Merkle hash of its term DAG: binder names are left out,
+// universe params hash by position and constants by their declaration's hash (inductive families by
+// their whole block), so the same lemma in two libraries hashes the same. a definition or theorem
+// leaves its own name out too, since it is determined by its body; a constant with no body to unfold
+// (axiom, opaque, quotient primitive, inductive block) is nothing but its name, so that goes in:
+// axioms a b : Nat must not hash the same, or a proof of a = a would pass for one of a = b.
+// the hash covers everything the kernel looks at, so a hash verified once stays verified
+
+using Digest = std::array<std::uint8_t, 32>;
+
+struct DigestHash
+{
+    std::size_t operator()(const Digest& d) const
+    {
+        std::size_t h;
+        std::memcpy(&h, d.data(), sizeof(h));
+        return h;
+    }
+};
+
+inline std::string to_hex(const Digest& d)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    for(std::uint8_t b : d) { out += digits[b >> 4]; out += digits[b & 15]; }
+    return out;
+}
+
+// FIPS 180-4; integers are fed little endian so digests do not depend on the host
+class Sha256
+{
+public:
+    Sha256& bytes(const void* data, std::size_t n)
+    {
+        auto src = static_cast<const std::uint8_t*>(data);
+        total_ += n;
+        while(n > 0)
+        {
+            std::size_t k = std::min(n, sizeof(buf_) - len_);
+            std::memcpy(buf_ + len_, src, k);
+            len_ += k; src += k; n -= k;
+            if(len_ == sizeof(buf_)) { block(buf_); len_ = 0; }
+        }
+        return *this;
+    }
+
+    Sha256& u8(std::uint8_t v) { return bytes(&v, 1); }
+    Sha256& u32(std::uint32_t v)
+    {
+        std::uint8_t b[4] = {std::uint8_t(v), std::uint8_t(v >> 8), std::uint8_t(v >> 16), std::uint8_t(v >> 24)};
+        return bytes(b, 4);
+    }
+    Sha256& digest(const Digest& d) { return bytes(d.data(), d.size()); }
+
+    Digest finish()
+    {
+        static const std::uint8_t zeros[64] = {};
+        std::uint64_t bits = total_ * 8;
+        u8(0x80);
+        bytes(zeros, (120 - len_) % 64);
+        for(int i = 7; i >= 0; --i) u8(std::uint8_t(bits >> (8 * i)));
+        Digest out;
+        for(std::size_t i = 0; i < 32; ++i) out[i] = std::uint8_t(h_[i / 4] >> (24 - 8 * (i % 4)));
+        return out;
+    }
+
+private:
+    void block(const std::uint8_t* b)
+    {
+        static constexpr std::uint32_t k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+        std::uint32_t w[64];
+        for(int i = 0; i < 16; ++i)
+            w[i] = std::uint32_t(b[4 * i]) << 24 | std::uint32_t(b[4 * i + 1]) << 16 | std::uint32_t(b[4 * i + 2]) << 8 | b[4 * i + 3];
+        for(int i = 16; i < 64; ++i)
+        {
+            std::uint32_t s0 = std::rotr(w[i - 15], 7) ^ std::rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            std::uint32_t s1 = std::rotr(w[i - 2], 17) ^ std::rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        std::uint32_t v[8];
+        std::copy(h_, h_ + 8, v);
+        for(int i = 0; i < 64; ++i)
+        {
+            std::uint32_t s1 = std::rotr(v[4], 6) ^ std::rotr(v[4], 11) ^ std::rotr(v[4], 25);
+            std::uint32_t ch = (v[4] & v[5]) ^ (~v[4] & v[6]);
+            std::uint32_t t1 = v[7] + s1 + ch + k[i] + w[i];
+            std::uint32_t s0 = std::rotr(v[0], 2) ^ std::rotr(v[0], 13) ^ std::rotr(v[0], 22);
+            std::uint32_t maj = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+            std::copy_backward(v, v + 7, v + 8);
+            v[4] += t1;
+            v[0] = t1 + s0 + maj;
+        }
+        for(int i = 0; i < 8; ++i) h_[i] += v[i];
+    }
+
+    std::uint32_t h_[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    std::uint8_t buf_[64];
+    std::size_t len_ = 0;
+    std::uint64_t total_ = 0;
+};
+
+// declaration hashes of one Environment, memoized by name (and terms without universe params by slot)
+class DeclHasher
+{
+public:
+    explicit DeclHasher(const Environment& env) : env_(env), p_(env.pool) {}
+
+    static bool family(DeclKind k) { return k == DeclKind::Inductive || k == DeclKind::Constructor || k == DeclKind::Recursor; }
+
+    const Digest& operator()(Name n)
+    {
+        if(auto it = decls_.find(n); it != decls_.end()) return it->second;
+        const Declaration& d = env_.get(n);
+        Digest h = family(d.kind) ? member(d) : hash(d);
+        return decls_.emplace(n, h).first->second;
+    }
+
+    // d need not be in env yet; inductive families only hash as part of their block
+    Digest hash(const Declaration& d)
+    {
+        if(family(d.kind)) throw storage_exception("inductive families are hashed by block");
+        Ctx c{d.lparams, {}, {}};
+        Sha256 s;
+        s.u8(tag_decl).u8(std::uint8_t(d.kind)).u8(std::uint8_t(d.quot)).u32(std::uint32_t(d.lparams.size()));
+        if(d.kind != DeclKind::Definition && d.kind != DeclKind::Theorem) name(s, d.name);
+        s.digest(expr(d.type, c));
+        if(d.value != no_expr) s.digest(expr(d.value, c));
+        return s.finish();
+    }
+
+    // drops the memoized hashes of declarations taken back out of env (a block the store refused)
+    void forget(std::span<const Name> ns)
+    {
+        for(Name n : ns)
+        {
+            decls_.erase(n);
+            blocks_.erase(n);
+        }
+    }
+
+private:
+    // distinct from every ExprKind / LevelKind tag
+    enum : std::uint8_t { tag_decl = 0x40, tag_block, tag_member };
+
+    struct Ctx
+    {
+        std::span<const Name> lparams;
+        std::span<const Name> block;            // types of the block being hashed, referenced by position
+        std::unordered_map<Expr, Digest> local; // terms that depend on lparams or block
+    };
+
+    // types, constructors and recursors are positions in their block
+    Digest member(const Declaration& d)
+    {
+        const Declaration& ind = d.kind == DeclKind::Constructor ? env_.get(d.induct) : d;
+        Name self = d.kind == DeclKind::Inductive ? d.name : d.induct;
+        auto j = std::uint32_t(std::find(ind.all.begin(), ind.all.end(), self) - ind.all.begin());
+        Sha256 s;
+        s.u8(tag_member).u8(std::uint8_t(d.kind)).digest(block(ind.all)).u32(j);
+        if(d.kind == DeclKind::Constructor) s.u32(d.cidx);
+        return s.finish();
+    }
+
+    // the recursors are derived from the types and constructors, so those are all a block hashes
+    const Digest& block(std::span<const Name> all)
+    {
+        if(auto it = blocks_.find(all.front()); it != blocks_.end()) return it->second;
+        const Declaration& first = env_.get(all.front());
+        Ctx c{first.lparams, all, {}};
+        Sha256 s;
+        s.u8(tag_block).u32(std::uint32_t(first.lparams.size())).u32(first.nparams).u32(std::uint32_t(all.size()));
+        for(Name t : all)
+        {
+            const Declaration& ind = env_.get(t);
+            name(s, t);
+            s.u32(ind.nindices).u32(std::uint32_t(ind.ctors.size())).digest(expr(ind.type, c));
+            for(Name k : ind.ctors)
+            {
+                name(s, k);
+                s.digest(expr(env_.get(k).type, c));
+            }
+        }
+        return blocks_.emplace(all.front(), s.finish()).first->second;
+    }
+
+    Digest expr(Expr e, Ctx& c)
+    {
+        auto& memo = c.block.empty() && !p_.has_param(e) ? memo_ : c.local;
+        if(auto it = memo.find(e); it != memo.end()) return it->second;
+        const ExprNode& n = p_[e];
+        Sha256 s;
+        s.u8(std::uint8_t(n.kind));
+        switch(n.kind)
+        {
+            case ExprKind::BVar: s.u32(n.a); break;
+            case ExprKind::FVar: throw storage_exception("free variable in a declaration");
+            case ExprKind::Sort: level(s, n.a, c); break;
+            case ExprKind::Const:
+            {
+                auto it = std::find(c.block.begin(), c.block.end(), n.a);
+                if(it != c.block.end()) s.u8(1).u32(std::uint32_t(it - c.block.begin()));
+                else s.u8(0).digest((*this)(n.a));
+                std::span<const Level> ls = p_.const_levels(e);
+                s.u32(std::uint32_t(ls.size()));
+                for(Level l : ls) level(s, l, c);
+                break;
+            }
+            case ExprKind::App: s.digest(expr(n.a, c)).digest(expr(n.b, c)); break;
+            case ExprKind::Lam: case ExprKind::Pi:
+                s.u8(std::uint8_t(n.binfo)).digest(expr(n.b, c)).digest(expr(n.c, c));
+                break;
+            case ExprKind::Let: s.digest(expr(n.b, c)).digest(expr(n.c, c)).digest(expr(n.d, c)); break;
+        }
+        return memo.emplace(e, s.finish()).first->second;
+    }
+
+    // the identity of a constant with no body, length first
+    void name(Sha256& s, Name n)
+    {
+        std::string_view v = p_.names.view(n);
+        s.u32(std::uint32_t(v.size())).bytes(v.data(), v.size());
+    }
+
+    // levels are small trees, written prefix order into the enclosing node
+    void level(Sha256& s, Level l, const Ctx& c)
+    {
+        LevelNode n = p_.levels.nodes()[l];
+        s.u8(std::uint8_t(n.kind));
+        switch(n.kind)
+        {
+            case LevelKind::Zero: break;
+            case LevelKind::Succ: level(s, n.a, c); break;
+            case LevelKind::Max: case LevelKind::IMax: level(s, n.a, c); level(s, n.b, c); break;
+            case LevelKind::Param:
+            {
+                auto it = std::find(c.lparams.begin(), c.lparams.end(), n.a);
+                if(it == c.lparams.end()) throw storage_exception("undeclared universe parameter '" + p_.names.str(n.a) + "'");
+                s.u32(std::uint32_t(it - c.lparams.begin()));
+                break;
+            }
+        }
+    }
+
+    const Environment& env_;
+    const Pool& p_;
+    std::unordered_map<Name, Digest> decls_;
+    std::unordered_map<Name, Digest> blocks_; // by first type
+    std::unordered_map<Expr, Digest> memo_;
+};
+
+// VERIFIED HASHES //
+// every hash the kernel has accepted: VerifiedHeader, then the digests sorted
+
+constexpr char verified_magic[8] = {'V', 'L', 'V', 'E', 'R', 'I', 'F', 0};
+constexpr std::uint32_t verified_version = 2;
+
+struct VerifiedHeader
+{
+    char magic[8];
+    std::uint32_t version, endian;
+    std::uint64_t count;
+};
+
+class VerifiedIndex
+{
+public:
+    // a missing file is an empty index
+    void load(const std::filesystem::path& path)
+    {
+        sorted_.clear();
+        added_.clear();
+        std::ifstream in(path, std::ios::binary);
+        if(!in) return;
+        VerifiedHeader h{};
+        if(!in.read(reinterpret_cast<char*>(&h), sizeof(h)) || std::memcmp(h.magic, verified_magic, sizeof(verified_magic)) != 0)
+            throw storage_exception("'" + path.string() + "' is not a verified-hash index");
+        if(h.version != verified_version || h.endian != image_endian)
+            throw storage_exception("'" + path.string() + "' was written by an incompatible version");
+        sorted_.resize(h.count);
+        if(!in.read(reinterpret_cast<char*>(sorted_.data()), std::streamsize(h.count * sizeof(Digest))) ||
+           !std::is_sorted(sorted_.begin(), sorted_.end()))
+            throw storage_exception("corrupt verified-hash index '" + path.string() + "'");
+    }
+
+    bool contains(const Digest& d) const
+    {
+        return std::binary_search(sorted_.begin(), sorted_.end(), d) || added_.contains(d);
+    }
+
+    void insert(const Digest& d)
+    {
+        if(!contains(d)) added_.insert(d);
+    }
+
+    std::size_t size() const { return sorted_.size() + added_.size(); }
+
+    // written beside the old index and renamed over it, so a crash keeps one of the two
+    void save(const std::filesystem::path& path)
+    {
+        if(!added_.empty())
+        {
+            std::size_t mid = sorted_.size();
+            sorted_.insert(sorted_.end(), added_.begin(), added_.end());
+            std::sort(sorted_.begin() + std::ptrdiff_t(mid), sorted_.end());
+            std::inplace_merge(sorted_.begin(), sorted_.begin() + std::ptrdiff_t(mid), sorted_.end());
+            added_.clear();
+        }
+        VerifiedHeader h{};
+        std::memcpy(h.magic, verified_magic, sizeof(verified_magic));
+        h.version = verified_version;
+        h.endian = image_endian;
+        h.count = sorted_.size();
+        std::filesystem::path tmp = path;
+        tmp += ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+            out.write(reinterpret_cast<const char*>(sorted_.data()), std::streamsize(sorted_.size() * sizeof(Digest)));
+            if(!out) throw storage_exception("cannot write '" + tmp.string() + "'");
+        }
+        std::filesystem::rename(tmp, path);
+    }
+
+private:
+    std::vector<Digest> sorted_;
+    std::unordered_set<Digest, DigestHash> added_;
+};
+
+// PAGES //
+// a library directory of many small objects costs a seek and a read each on a cold cache, and the
+// objects repeat themselves (the same constants, digests and term shapes in every one). a pack
+// puts them back to back and cuts the stream into fixed size pages, each compressed on its own
+// against a dictionary trained on the objects, so reading one object decodes one or two pages.
+// codec: LZ77 sequences in the LZ4 layout (token with literal count << 4 | match length - 4, 255
+// runs for nibbles at 15, literals, u16 offset back into dictionary + page); the last sequence
+// has literals only
+// file: PackHeader, dictionary, pages, PackPage[pages], PackEntry[objects] sorted by digest
+
+// slicing by 8: t[k][b] is the crc of byte b followed by k zero bytes, so 8 bytes take 8 lookups
+// with no dependency between them (pages are checked on every read)
+inline std::uint32_t crc32(std::string_view bytes, std::uint32_t crc = 0)
+{
+    static const auto t = [] {
+        std::array<std::array<std::uint32_t, 256>, 8> t{};
+        for(std::uint32_t i = 0; i < 256; ++i)
+        {
+            std::uint32_t c = i;
+            for(int k = 0; k < 8; ++k) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[0][i] = c;
+        }
+        for(std::uint32_t i = 0; i < 256; ++i)
+            for(std::size_t k = 1; k < 8; ++k) t[k][i] = t[0][t[k - 1][i] & 0xFF] ^ (t[k - 1][i] >> 8);
+        return t;
+    }();
+    crc = ~crc;
+    const char* p = bytes.data();
+    std::size_t n = bytes.size();
+    for(; n >= 8; p += 8, n -= 8)
+    {
+        std::uint32_t lo = crc ^ (std::uint32_t(std::uint8_t(p[0])) | std::uint32_t(std::uint8_t(p[1])) << 8 |
+                                  std::uint32_t(std::uint8_t(p[2])) << 16 | std::uint32_t(std::uint8_t(p[3])) << 24);
+        crc = t[7][lo & 0xFF] ^ t[6][lo >> 8 & 0xFF] ^ t[5][lo >> 16 & 0xFF] ^ t[4][lo >> 24] ^ t[3][std::uint8_t(p[4])] ^
+              t[2][std::uint8_t(p[5])] ^ t[1][std::uint8_t(p[6])] ^ t[0][std::uint8_t(p[7])];
+    }
+    for(; n > 0; ++p, --n) crc = t[0][(crc ^ std::uint8_t(*p)) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+constexpr char pack_magic[8] = {'V', 'L', 'P', 'A', 'C', 'K', 0, 0};
+constexpr std::uint32_t pack_version = 1;
+
+struct PackHeader
+{
+    char magic[8];
+    std::uint32_t version, endian;
+    std::uint32_t page_size, pages;
+    std::uint64_t objects, raw_size; // raw_size: length of the object stream
+    std::uint64_t dict_offset, dict_size, pages_offset, index_offset;
+};
+
+struct PackPage
+{
+    std::uint64_t offset;     // in the file
+    std::uint32_t size, crc;  // stored as is when size is the page's raw length; crc of the raw page
+};
+
+struct PackEntry
+{
+    Digest digest;
+    std::uint64_t offset, size; // in the object stream
+};
+
+struct PackOptions
+{
+    std::uint32_t page_size = 16 << 10;
+    std::size_t dict_size = 32 << 10; // 0: no dictionary
+    bool compress = true;             // false stores pages as they are
+};
+
+struct PackStats
+{
+    std::size_t objects = 0, pages = 0, dict_bytes = 0;
+    std::uint64_t raw_bytes = 0, file_bytes = 0;
+};
+
+namespace detail {
+
+constexpr std::size_t lz_min_match = 4;
+constexpr std::size_t lz_window = 65535;
+
+inline std::uint32_t read32(const char* p)
+{
+    std::uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+inline void put_run(std::string& out, std::size_t n)
+{
+    for(; n >= 255; n -= 255) out += char(255);
+    out += char(n);
+}
+
+// compresses pages against a fixed dictionary (its last lz_window bytes, the rest is out of reach)
+class PageEncoder
+{
+public:
+    explicit PageEncoder(std::string_view dict) : dict_(dict.substr(dict.size() > lz_window ? dict.size() - lz_window : 0)) {}
+
+    std::string encode(std::string_view page) const
+    {
+        std::string buf(dict_);
+        buf += page;
+        const char* b = buf.data();
+        std::size_t n = buf.size();
+        std::vector<std::int32_t> head(std::size_t(1) << hash_bits, -1), chain(n, -1);
+        auto insert = [&](std::size_t i) {
+            std::uint32_t h = hash(b + i);
+            chain[i] = head[h];
+            head[h] = std::int32_t(i);
+        };
+        for(std::size_t i = 0; i + lz_min_match <= dict_.size(); ++i) insert(i);
+
+        std::string out;
+        out.reserve(page.size() / 2 + 16);
+        std::size_t lit = dict_.size(), i = dict_.size();
+        while(i + lz_min_match <= n)
+        {
+            std::size_t best = 0, from = 0;
+            int depth = max_depth;
+            for(std::int32_t c = head[hash(b + i)]; c >= 0 && depth-- > 0 && i - std::size_t(c) <= lz_window; c = chain[std::size_t(c)])
+            {
+                if(read32(b + c) != read32(b + i)) continue;
+                std::size_t len = lz_min_match;
+                while(i + len < n && b[std::size_t(c) + len] == b[i + len]) ++len;
+                if(len > best) best = len, from = std::size_t(c);
+            }
+            if(best < lz_min_match)
+            {
+                insert(i++);
+                continue;
+            }
+            sequence(out, {b + lit, i - lit}, best, i - from);
+            for(std::size_t end = i + best; i < end; ++i)
+                if(i + lz_min_match <= n) insert(i);
+            lit = i;
+        }
+        // literals only
+        std::size_t nlit = n - lit;
+        out += char(std::min<std::size_t>(nlit, 15) << 4);
+        if(nlit >= 15) put_run(out, nlit - 15);
+        out.append(b + lit, nlit);
+        return out;
+    }
+
+private:
+    static constexpr int hash_bits = 15, max_depth = 24;
+
+    static std::uint32_t hash(const char* p) { return read32(p) * 2654435761u >> (32 - hash_bits); }
+
+    static void sequence(std::string& out, std::string_view lit, std::size_t len, std::size_t offset)
+    {
+        std::size_t m = len - lz_min_match;
+        out += char(std::min<std::size_t>(lit.size(), 15) << 4 | std::min<std::size_t>(m, 15));
+        if(lit.size() >= 15) put_run(out, lit.size() - 15);
+        out += lit;
+        out += {char(offset), char(offset >> 8)};
+        if(m >= 15) put_run(out, m - 15);
+    }
+
+    std::string dict_;
+};
+
+// decodes a page of raw_size bytes; throws on anything that does not decode to exactly that
+inline std::string decode_page(std::string_view dict, std::string_view in, std::size_t raw_size)
+{
+    if(dict.size() > lz_window) dict.remove_prefix(dict.size() - lz_window);
+    std::string out(raw_size, '\0');
+    char* o = out.data();
+    std::size_t ip = 0, op = 0;
+    auto fail = [] [[noreturn]] { throw storage_exception("corrupt pack page"); };
+    auto run = [&](std::size_t n) {
+        if(n < 15) return n;
+        for(std::uint8_t c = 255; c == 255; n += c)
+        {
+            if(ip >= in.size()) fail();
+            c = std::uint8_t(in[ip++]);
+        }
+        return n;
+    };
+    for(;;)
+    {
+        if(ip >= in.size()) fail();
+        auto token = std::uint8_t(in[ip++]);
+        std::size_t lit = run(token >> 4);
+        if(lit > in.size() - ip || lit > raw_size - op) fail();
+        if(lit <= 16 && in.size() - ip >= 16 && raw_size - op >= 16) std::memcpy(o + op, in.data() + ip, 16); // one fixed copy
+        else std::memcpy(o + op, in.data() + ip, lit);
+        ip += lit;
+        op += lit;
+        if(ip == in.size()) break;
+
+        if(in.size() - ip < 2) fail();
+        std::size_t offset = std::uint8_t(in[ip]) | std::size_t(std::uint8_t(in[ip + 1])) << 8;
+        ip += 2;
+        std::size_t len = run(token & 15) + lz_min_match;
+        if(offset == 0 || offset > op + dict.size() || len > raw_size - op) fail();
+        if(offset > op) // starts in the dictionary
+        {
+            std::size_t from = dict.size() - (offset - op), n = std::min(len, dict.size() - from);
+            std::memcpy(o + op, dict.data() + from, n);
+            op += n;
+            len -= n;
+            offset = op; // the rest continues at the start of the page
+        }
+        std::size_t end = op + len;
+        if(offset >= 8 && raw_size - end >= 8) // 8 bytes at a time, the overshoot is overwritten later
+            for(std::size_t i = op; i < end; i += 8) std::memcpy(o + i, o + i - offset, 8);
+        else for(std::size_t i = op; i < end; ++i) o[i] = o[i - offset]; // overlapping, repeats a pattern
+        op = end;
+    }
+    if(op != raw_size) fail();
+    return out;
+}
+
+} // namespace detail
+
+// a dictionary of up to size bytes from sample objects: the 64-byte segments whose 8-byte
+// substrings occur in the most samples, one segment per stretch of the samples, best ones last
+// (closest to the page, cheapest offsets). with fewer sample bytes than size, the samples themselves
+inline std::string train_dictionary(std::span<const std::string_view> samples, std::size_t size)
+{
+    constexpr std::size_t k = 8, segment = 64, table_bits = 20;
+    std::string all;
+    for(std::string_view s : samples) all += s;
+    if(all.size() <= size) return all;
+
+    auto kmer = [&](std::size_t i) { return std::uint32_t(std::hash<std::string_view>{}({all.data() + i, k}) & ((1u << table_bits) - 1)); };
+    std::vector<std::uint32_t> freq(std::size_t(1) << table_bits), seen(freq.size(), ~0u);
+    std::size_t at = 0;
+    for(std::uint32_t id = 0; id < samples.size(); at += samples[id++].size())
+        for(std::size_t i = at; i + k <= at + samples[id].size(); ++i)
+            if(std::uint32_t h = kmer(i); seen[h] != id) seen[h] = id, ++freq[h];
+
+    std::vector<std::pair<std::uint64_t, std::size_t>> picked; // score, start
+    std::size_t epochs = std::max<std::size_t>(1, size / segment), span = all.size() / epochs;
+    for(std::size_t e = 0; e < epochs && span >= segment; ++e)
+    {
+        std::size_t begin = e * span, end = begin + span;
+        std::uint64_t score = 0, best = 0;
+        std::size_t best_at = begin;
+        for(std::size_t i = begin; i + k <= begin + segment; ++i) score += freq[kmer(i)];
+        for(std::size_t w = begin;; ++w)
+        {
+            if(score > best) best = score, best_at = w;
+            if(w + segment + 1 > end) break;
+            score += freq[kmer(w + segment - k + 1)];
+            score -= freq[kmer(w)];
+        }
+        if(best == 0) continue;
+        picked.push_back({best, best_at});
+        for(std::size_t i = best_at; i + k <= best_at + segment; ++i) freq[kmer(i)] = 0; // covered now
+    }
+    std::sort(picked.begin(), picked.end());
+    std::string dict;
+    for(const auto& [score, start] : picked) dict.append(all, start, segment);
+    return dict;
+}
+
+// builds a pack from objects added in order (the order decides what shares a page)
+class PackWriter
+{
+public:
+    PackWriter(const std::filesystem::path& path, const PackOptions& opts, std::string dict = {})
+        : path_(path.string()), out_(path, std::ios::binary | std::ios::trunc), page_size_(opts.page_size), compress_(opts.compress),
+          dict_(opts.compress ? std::move(dict) : std::string()), encoder_(dict_)
+    {
+        if(!out_) throw storage_exception("cannot write '" + path_ + "'");
+        if(page_size_ == 0) throw storage_exception("pack page size must be positive");
+        header_.dict_offset = sizeof(PackHeader);
+        header_.dict_size = dict_.size();
+        out_.seekp(std::streamoff(sizeof(PackHeader)));
+        out_.write(dict_.data(), std::streamsize(dict_.size()));
+        pos_ = header_.pages_offset = sizeof(PackHeader) + dict_.size();
+    }
+
+    void add(const Digest& h, std::string_view bytes)
+    {
+        entries_.push_back({h, raw_, bytes.size()});
+        raw_ += bytes.size();
+        while(!bytes.empty())
+        {
+            std::size_t n = std::min(bytes.size(), page_size_ - page_.size());
+            page_ += bytes.substr(0, n);
+            bytes.remove_prefix(n);
+            if(page_.size() == page_size_) flush();
+        }
+    }
+
+    PackStats finish()
+    {
+        if(!page_.empty()) flush();
+        std::sort(entries_.begin(), entries_.end(), [](const PackEntry& a, const PackEntry& b) { return a.digest < b.digest; });
+        for(std::size_t i = 1; i < entries_.size(); ++i)
+            if(entries_[i].digest == entries_[i - 1].digest) throw storage_exception("object " + to_hex(entries_[i].digest) + " added to a pack twice");
+        header_.index_offset = pos_ + table_.size() * sizeof(PackPage);
+        out_.write(reinterpret_cast<const char*>(table_.data()), std::streamsize(table_.size() * sizeof(PackPage)));
+        out_.write(reinterpret_cast<const char*>(entries_.data()), std::streamsize(entries_.size() * sizeof(PackEntry)));
+        std::memcpy(header_.magic, pack_magic, sizeof(pack_magic));
+        header_.version = pack_version;
+        header_.endian = image_endian;
+        header_.page_size = page_size_;
+        header_.pages = std::uint32_t(table_.size());
+        header_.objects = entries_.size();
+        header_.raw_size = raw_;
+        out_.seekp(0);
+        out_.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+        out_.flush();
+        if(!out_) throw storage_exception("cannot write '" + path_ + "'");
+        return {entries_.size(), table_.size(), dict_.size(), raw_, header_.index_offset + entries_.size() * sizeof(PackEntry)};
+    }
+
+private:
+    void flush()
+    {
+        std::string packed = compress_ ? encoder_.encode(page_) : std::string();
+        std::string_view body = compress_ && packed.size() < page_.size() ? std::string_view(packed) : std::string_view(page_);
+        table_.push_back({pos_, std::uint32_t(body.size()), crc32(page_)});
+        out_.write(body.data(), std::streamsize(body.size()));
+        pos_ += body.size();
+        page_.clear();
+    }
+
+    std::string path_;
+    std::ofstream out_;
+    std::uint32_t page_size_;
+    bool compress_;
+    std::string dict_;
+    detail::PageEncoder encoder_;
+    PackHeader header_{};
+    std::uint64_t pos_ = 0, raw_ = 0;
+    std::string page_;
+    std::vector<PackPage> table_;
+    std::vector<PackEntry> entries_;
+};
+
+// read only view of a pack, objects by digest; the last few decoded pages are kept
+class PackFile
+{
+public:
+    explicit PackFile(const std::filesystem::path& path) : path_(path.string()), file_(path_)
+    {
+        std::span<const std::byte> bytes = file_.bytes();
+        if(bytes.size() < sizeof(h_)) fail();
+        std::memcpy(&h_, bytes.data(), sizeof(h_));
+        if(std::memcmp(h_.magic, pack_magic, sizeof(pack_magic)) != 0) throw storage_exception("'" + path_ + "' is not a pack");
+        if(h_.version != pack_version || h_.endian != image_endian)
+            throw storage_exception("'" + path_ + "' was written by an incompatible version");
+        std::uint64_t table_bytes = std::uint64_t(h_.pages) * sizeof(PackPage), index_bytes = h_.objects * sizeof(PackEntry);
+        if(h_.page_size == 0 || h_.dict_offset + h_.dict_size > h_.pages_offset || h_.index_offset < table_bytes ||
+           h_.index_offset - table_bytes < h_.pages_offset || h_.index_offset + index_bytes != bytes.size() ||
+           (h_.raw_size + h_.page_size - 1) / h_.page_size != h_.pages)
+            fail();
+        auto at = [&](std::uint64_t off) { return reinterpret_cast<const char*>(bytes.data()) + off; };
+        dict_ = {at(h_.dict_offset), std::size_t(h_.dict_size)};
+        table_.resize(h_.pages);
+        std::memcpy(table_.data(), at(h_.index_offset - table_bytes), table_bytes);
+        index_.resize(h_.objects);
+        std::memcpy(index_.data(), at(h_.index_offset), index_bytes);
+        for(const PackPage& pg : table_)
+            if(pg.offset < h_.pages_offset || pg.offset + pg.size > h_.index_offset - table_bytes) fail();
+        for(const PackEntry& e : index_)
+            if(e.offset > h_.raw_size || e.size > h_.raw_size - e.offset) fail();
+        file_.advise(h_.pages_offset, h_.index_offset - table_bytes - h_.pages_offset, MappedFile::Advice::Random);
+    }
+
+    const PackHeader& header() const { return h_; }
+    std::span<const PackEntry> entries() const { return index_; } // by digest
+
+    const PackEntry* find(const Digest& h) const
+    {
+        auto it = std::lower_bound(index_.begin(), index_.end(), h, [](const PackEntry& e, const Digest& d) { return e.digest < d; });
+        return it != index_.end() && it->digest == h ? &*it : nullptr;
+    }
+
+    std::optional<std::string> read(const Digest& h) const
+    {
+        const PackEntry* e = find(h);
+        if(!e) return std::nullopt;
+        std::string out;
+        for(std::uint64_t at = e->offset, end = e->offset + e->size; at < end;)
+        {
+            std::uint64_t first = at / h_.page_size * h_.page_size;
+            const std::string& pg = page(std::uint32_t(at / h_.page_size));
+            std::size_t n = std::size_t(std::min(end, first + pg.size()) - at);
+            out.append(pg, std::size_t(at - first), n);
+            at += n;
+        }
+        return out;
+    }
+
+    // page i decoded and checked
+    const std::string& page(std::uint32_t i) const
+    {
+        if(i >= h_.pages) fail();
+        for(std::size_t j = 0; j < cache_.size(); ++j)
+            if(cache_[j].first == i)
+            {
+                std::rotate(cache_.begin(), cache_.begin() + std::ptrdiff_t(j), cache_.begin() + std::ptrdiff_t(j) + 1);
+                return cache_.front().second;
+            }
+        const PackPage& pg = table_[i];
+        std::size_t raw = std::size_t(std::min<std::uint64_t>(h_.page_size, h_.raw_size - std::uint64_t(i) * h_.page_size));
+        std::string_view body(reinterpret_cast<const char*>(file_.bytes().data()) + pg.offset, pg.size);
+        std::string data = pg.size == raw ? std::string(body) : detail::decode_page(dict_, body, raw);
+        if(crc32(data) != pg.crc) fail();
+        if(cache_.size() == cached_pages) cache_.pop_back();
+        cache_.insert(cache_.begin(), {i, std::move(data)});
+        return cache_.front().second;
+    }
+
+private:
+    static constexpr std::size_t cached_pages = 8;
+
+    [[noreturn]] void fail() const { throw storage_exception("corrupt pack '" + path_ + "'"); }
+
+    std::string path_;
+    MappedFile file_;
+    PackHeader h_{};
+    std::string_view dict_;
+    std::vector<PackPage> table_;
+    std::vector<PackEntry> index_;
+    mutable std::vector<std::pair<std::uint32_t, std::string>> cache_;
+};
+
+// CONTENT STORE //
+// a local library database keyed by declaration hash:
+//   root/objects/ab/cdef...   one declaration, written once (the same lemma from any library is one file)
+//   root/pack                 the objects pack() has moved out of objects/, see PAGES
+//   root/verified             VerifiedIndex
+// an object keeps the names it was stored with as hints; a constant is resolved by its hint when
+// that has the recorded hash here, otherwise by the hash alone
+
+constexpr char object_magic[8] = {'V', 'L', 'O', 'B', 'J', 0, 0, 0};
+constexpr std::uint32_t object_version = 2;
+
+namespace detail {
+
+// object layout, integers little endian u32:
+//   magic, version, kind quot is_rec k (bytes), nparams nindices nmotives nminors cidx nfields
+//   strings (len, chars), constants (string, digest), levels (kind byte, a, b), terms (kind byte,
+//   fields by kind, children by position), lparams, induct, all, ctors, type, value, rules
+class ObjectWriter
+{
+public:
+    ObjectWriter(const Pool& p, DeclHasher& hasher) : p_(p), hasher_(hasher) {}
+
+    std::string write(const Declaration& d)
+    {
+        std::vector<std::uint32_t> lps, all, ctors, rules;
+        std::uint32_t induct = str(d.induct);
+        for(Name n : d.lparams) lps.push_back(str(n));
+        for(Name n : d.all) all.push_back(str(n));
+        for(Name n : d.ctors) ctors.push_back(str(n));
+        std::uint32_t type = expr(d.type), value = d.value == no_expr ? no_expr : expr(d.value);
+        for(const RecRule& r : d.rules) rules.insert(rules.end(), {str(r.ctor), r.nfields, expr(r.rhs)});
+
+        std::string out(object_magic, sizeof(object_magic));
+        put(out, object_version);
+        out += {char(d.kind), char(d.quot), char(d.is_rec), char(d.k)};
+        for(std::uint32_t v : {d.nparams, d.nindices, d.nmotives, d.nminors, d.cidx, d.nfields}) put(out, v);
+        put(out, std::uint32_t(strs_.size()));
+        for(Name n : strs_)
+        {
+            std::string_view s = p_.names.view(n);
+            put(out, std::uint32_t(s.size()));
+            out += s;
+        }
+        put(out, std::uint32_t(consts_.size()));
+        for(Name n : consts_)
+        {
+            put(out, str_index_.at(n));
+            const Digest& h = hasher_(n);
+            out.append(reinterpret_cast<const char*>(h.data()), h.size());
+        }
+        put(out, std::uint32_t(levels_.size()));
+        out += level_data_;
+        put(out, std::uint32_t(exprs_.size()));
+        out += expr_data_;
+        auto list = [&](const std::vector<std::uint32_t>& xs) { put(out, std::uint32_t(xs.size())); for(auto x : xs) put(out, x); };
+        list(lps);
+        put(out, induct);
+        list(all);
+        list(ctors);
+        put(out, type);
+        put(out, value);
+        put(out, std::uint32_t(d.rules.size()));
+        for(auto x : rules) put(out, x);
+        return out;
+    }
+
+private:
+    static void put(std::string& out, std::uint32_t v)
+    {
+        out += {char(v), char(v >> 8), char(v >> 16), char(v >> 24)};
+    }
+
+    std::uint32_t str(Name n)
+    {
+        auto [it, fresh] = str_index_.try_emplace(n, std::uint32_t(strs_.size()));
+        if(fresh) strs_.push_back(n);
+        return it->second;
+    }
+
+    std::uint32_t cnst(Name n)
+    {
+        str(n);
+        auto [it, fresh] = const_index_.try_emplace(n, std::uint32_t(consts_.size()));
+        if(fresh) consts_.push_back(n);
+        return it->second;
+    }
+
+    std::uint32_t level(Level l)
+    {
+        if(auto it = levels_.find(l); it != levels_.end()) return it->second;
+        LevelNode n = p_.levels.nodes()[l];
+        std::uint32_t a = 0, b = 0;
+        switch(n.kind)
+        {
+            case LevelKind::Zero: break;
+            case LevelKind::Succ: a = level(n.a); break;
+            case LevelKind::Max: case LevelKind::IMax: a = level(n.a); b = level(n.b); break;
+            case LevelKind::Param: a = str(n.a); break;
+        }
+        level_data_ += char(n.kind);
+        put(level_data_, a);
+        put(level_data_, b);
+        return levels_.emplace(l, std::uint32_t(levels_.size())).first->second;
+    }
+
+    std::uint32_t expr(Expr e)
+    {
+        if(auto it = exprs_.find(e); it != exprs_.end()) return it->second;
+        const ExprNode& n = p_[e];
+        std::vector<std::uint32_t> fields;
+        switch(n.kind)
+        {
+            case ExprKind::BVar: fields = {n.a}; break;
+            case ExprKind::FVar: throw storage_exception("free variable in a declaration");
+            case ExprKind::Sort: fields = {level(n.a)}; break;
+            case ExprKind::Const:
+                fields = {cnst(n.a), std::uint32_t(p_.const_levels(e).size())};
+                for(Level l : p_.const_levels(e)) fields.push_back(level(l));
+                break;
+            case ExprKind::App: fields = {expr(n.a), expr(n.b)}; break;
+            case ExprKind::Lam: case ExprKind::Pi: fields = {std::uint32_t(n.binfo), str(n.a), expr(n.b), expr(n.c)}; break;
+            case ExprKind::Let: fields = {str(n.a), expr(n.b), expr(n.c), expr(n.d)}; break;
+        }
+        expr_data_ += char(n.kind);
+        for(std::uint32_t f : fields) put(expr_data_, f);
+        return exprs_.emplace(e, std::uint32_t(exprs_.size())).first->second;
+    }
+
+    const Pool& p_;
+    DeclHasher& hasher_;
+    std::vector<Name> strs_, consts_;
+    std::unordered_map<Name, std::uint32_t> str_index_, const_index_;
+    std::unordered_map<Level, std::uint32_t> levels_;
+    std::unordered_map<Expr, std::uint32_t> exprs_;
+    std::string level_data_, expr_data_;
+};
+
+// bounds checked cursor over an object
+class ObjectReader
+{
+public:
+    ObjectReader(std::string_view bytes, std::string what) : s_(bytes), what_(std::move(what)) {}
+
+    [[noreturn]] void fail() const { throw storage_exception("corrupt object " + what_); }
+
+    std::string_view take(std::size_t n)
+    {
+        if(s_.size() - i_ < n) fail();
+        std::string_view out = s_.substr(i_, n);
+        i_ += n;
+        return out;
+    }
+
+    std::uint8_t u8() { return std::uint8_t(take(1)[0]); }
+
+    std::uint32_t u32()
+    {
+        std::string_view b = take(4);
+        std::uint32_t v = 0;
+        for(int i = 3; i >= 0; --i) v = v << 8 | std::uint8_t(b[std::size_t(i)]);
+        return v;
+    }
+
+    // an index into a table of n entries
+    std::uint32_t index(std::size_t n)
+    {
+        std::uint32_t v = u32();
+        if(v >= n) fail();
+        return v;
+    }
+
+    bool done() const { return i_ == s_.size(); }
+
+private:
+    std::string_view s_;
+    std::size_t i_ = 0;
+    std::string what_;
+};
+
+} // namespace detail
+
+class ContentStore
+{
+public:
+    ContentStore(Environment& env, std::filesystem::path root) : env_(env), root_(std::move(root)), hasher_(env)
+    {
+        std::filesystem::create_directories(root_ / "objects");
+        verified_.load(root_ / "verified");
+        if(std::filesystem::exists(root_ / "pack")) pack_.emplace(root_ / "pack");
+    }
+
+    const Digest& hash(Name n) { return hasher_(n); }
+    bool contains(const Digest& h) const { return (pack_ && pack_->find(h)) || std::filesystem::exists(object_path(h)); }
+    bool verified(const Digest& h) const { return verified_.contains(h); }
+    const VerifiedIndex& index() const { return verified_; }
+
+    std::size_t checked() const { return checked_; } // declarations the kernel checked
+    std::size_t trusted() const { return trusted_; } // declarations admitted on a verified hash
+
+    // stores a declaration of env (which the kernel checked when it was added), returns its hash
+    Digest put(Name n)
+    {
+        Digest h = hasher_(n);
+        verified_.insert(h);
+        std::filesystem::path path = object_path(h);
+        if(contains(h)) return h;
+        std::string bytes = detail::ObjectWriter(env_.pool, hasher_).write(env_.get(n));
+        std::filesystem::create_directories(path.parent_path());
+        std::filesystem::path tmp = path;
+        tmp += ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            out.write(bytes.data(), std::streamsize(bytes.size()));
+            if(!out) throw storage_exception("cannot write '" + tmp.string() + "'");
+        }
+        std::filesystem::rename(tmp, path);
+        return h;
+    }
+
+    // add_decl, except that a declaration whose hash was verified before skips the kernel
+    void add(Declaration d)
+    {
+        if(DeclHasher::family(d.kind) || d.kind == DeclKind::Quot)
+            throw storage_exception("inductive families and quotients go through add_inductive / add_quot");
+        Digest h = hasher_.hash(d);
+        admit(std::move(d), h);
+    }
+
+    // loads object h into env under the name `as`
+    // (inductive families keep the names of their block as stored: the types first, then their
+    // constructors, and the kernel declares the block once the last of those is in; see family())
+    Name get(const Digest& h, Name as)
+    {
+        Declaration d = read(object(h), h, as);
+        if(DeclHasher::family(d.kind))
+        {
+            family(std::move(d), h);
+            return as;
+        }
+        if(hasher_.hash(d) != h) throw storage_exception("object " + to_hex(h) + " does not match its hash");
+        admit(std::move(d), h);
+        return as;
+    }
+
+    void save() { verified_.save(root_ / "verified"); }
+
+    // every object here: the pack's in pack order, then the loose ones not in it
+    std::vector<Digest> objects() const
+    {
+        std::vector<Digest> all;
+        if(pack_)
+        {
+            std::vector<PackEntry> es(pack_->entries().begin(), pack_->entries().end());
+            std::sort(es.begin(), es.end(), [](const PackEntry& a, const PackEntry& b) { return a.offset < b.offset; });
+            for(const PackEntry& e : es) all.push_back(e.digest);
+        }
+        for(const auto& [h, path] : loose())
+            if(!pack_ || !pack_->find(h)) all.push_back(h);
+        return all;
+    }
+
+    // the hashes of the declarations object h mentions, h itself left out
+    std::vector<Digest> dependencies(const Digest& h) const
+    {
+        std::string bytes = object(h);
+        detail::ObjectReader r(bytes, to_hex(h));
+        if(r.take(sizeof(object_magic)) != std::string_view(object_magic, sizeof(object_magic)) || r.u32() != object_version)
+            r.fail();
+        r.take(4 + 6 * 4);
+        for(std::uint32_t n = r.u32(); n > 0; --n) r.take(r.u32());
+        std::vector<Digest> out;
+        for(std::uint32_t n = r.u32(); n > 0; --n)
+        {
+            r.u32();
+            Digest d;
+            std::memcpy(d.data(), r.take(d.size()).data(), d.size());
+            if(d != h) out.push_back(d);
+        }
+        return out;
+    }
+
+    // moves every object into one pack (the old pack's objects first, in their order), then removes
+    // the loose files. the dictionary is trained on up to 4 MiB of objects spread over the store,
+    // none for a store under 8 dictionaries
+    PackStats pack(const PackOptions& opts = {}) { return repack(objects(), opts); }
+
+    // keeps only the objects the roots reach through their dependencies and packs them dependencies
+    // first: a depth first walk from each root in turn, so roots given in name order share pages with
+    // their namespace and what it needs. dependencies not stored here are skipped (they resolve by
+    // name on loading); no roots keeps no object (objects() as the roots keeps them all, reordered)
+    PackStats compact(std::span<const Digest> roots, const PackOptions& opts = {})
+    {
+        std::vector<Digest> order;
+        std::unordered_set<Digest, DigestHash> seen;
+        std::vector<std::pair<Digest, std::vector<Digest>>> stack; // object, dependencies left
+        for(const Digest& root : roots)
+        {
+            if(!contains(root) || !seen.insert(root).second) continue;
+            stack.push_back({root, dependencies(root)});
+            while(!stack.empty())
+            {
+                std::vector<Digest>& deps = stack.back().second;
+                if(deps.empty())
+                {
+                    order.push_back(stack.back().first);
+                    stack.pop_back();
+                    continue;
+                }
+                Digest d = deps.back();
+                deps.pop_back();
+                if(contains(d) && seen.insert(d).second) stack.push_back({d, dependencies(d)});
+            }
+        }
+        return repack(order, opts);
+    }
+
+    const PackFile* packed() const { return pack_ ? &*pack_ : nullptr; }
+
+    // the stored bytes of object h; a loose object wins over the pack (it is the newer copy of the
+    // same bytes)
+    std::string object(const Digest& h) const
+    {
+        if(std::ifstream in(object_path(h), std::ios::binary); in)
+            return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if(pack_)
+            if(std::optional<std::string> bytes = pack_->read(h)) return std::move(*bytes);
+        throw storage_exception("no object " + to_hex(h));
+    }
+
+private:
+    std::filesystem::path object_path(const Digest& h) const
+    {
+        std::string hex = to_hex(h);
+        return root_ / "objects" / hex.substr(0, 2) / hex.substr(2);
+    }
+
+    std::vector<std::pair<Digest, std::filesystem::path>> loose() const
+    {
+        std::vector<std::pair<Digest, std::filesystem::path>> out;
+        for(const auto& f : std::filesystem::recursive_directory_iterator(root_ / "objects"))
+        {
+            std::string hex = f.path().parent_path().filename().string() + f.path().filename().string();
+            if(!f.is_regular_file() || hex.size() != 64 || hex.find_first_not_of("0123456789abcdef") != std::string::npos) continue;
+            Digest h;
+            for(std::size_t i = 0; i < h.size(); ++i) h[i] = std::uint8_t(std::stoul(hex.substr(2 * i, 2), nullptr, 16));
+            out.push_back({h, f.path()});
+        }
+        return out;
+    }
+
+    // a new pack of exactly the objects in order; every loose file goes (it is packed or dropped)
+    PackStats repack(const std::vector<Digest>& order, const PackOptions& opts)
+    {
+        std::string dict;
+        if(opts.compress && opts.dict_size > 0)
+        {
+            constexpr std::size_t sample_bytes = 4 << 20;
+            std::vector<std::string> samples;
+            std::size_t stride = 1, total = 0;
+            for(std::size_t i = 0; i < order.size() && total < sample_bytes; i += stride)
+            {
+                total += samples.emplace_back(object(order[i])).size();
+                if(i == 64) stride = std::max<std::size_t>(1, order.size() * (total / 65) / sample_bytes); // by the average size so far
+            }
+            std::vector<std::string_view> views(samples.begin(), samples.end());
+            if(total >= 8 * opts.dict_size) dict = train_dictionary(views, opts.dict_size); // else it costs more than it saves
+        }
+
+        std::vector<std::pair<Digest, std::filesystem::path>> files = loose();
+        std::filesystem::path tmp = root_ / "pack.tmp";
+        PackStats stats;
+        {
+            PackWriter w(tmp, opts, std::move(dict));
+            for(const Digest& h : order) w.add(h, object(h));
+            stats = w.finish();
+        }
+        pack_.reset();
+        std::filesystem::rename(tmp, root_ / "pack");
+        pack_.emplace(root_ / "pack");
+        for(const auto& [h, path] : files) std::filesystem::remove(path);
+        for(const auto& dir : std::filesystem::directory_iterator(root_ / "objects"))
+            if(dir.is_directory() && std::filesystem::is_empty(dir.path())) std::filesystem::remove(dir.path());
+        return stats;
+    }
+
+    void admit(Declaration d, const Digest& h)
+    {
+        if(verified_.contains(h))
+        {
+            if(d.kind == DeclKind::Definition) d.height = definition_height(env_, d.value);
+            Name n = d.name;
+            QuotKind q = d.quot;
+            env_.add(std::move(d));
+            if(q == QuotKind::Mk) env_.quot_mk = n;
+            if(q == QuotKind::Lift) env_.quot_lift = n;
+            if(q == QuotKind::Ind) env_.quot_ind = n;
+            if(q != QuotKind::None) env_.quot_initialized = env_.quot_mk && env_.quot_lift && env_.quot_ind;
+            ++trusted_;
+            return;
+        }
+        if(d.kind == DeclKind::Quot)
+            throw storage_exception("'" + env_.pool.names.str(d.name) + "' is not verified here; declare it with add_quot");
+        add_decl(env_, std::move(d));
+        verified_.insert(h);
+        ++checked_;
+    }
+
+    // inductive families. a block's hash covers only the terms of its types and constructors, so
+    // nothing else in a stored member can be taken on trust, the recursors least of all (a wrong
+    // rule or K flag is an unsound kernel). types and constructors wait here until the block is
+    // complete; the kernel then declares it from those terms alone, generating the recursors, and
+    // every member must equal what it declared field for field and hash to the digest it came
+    // under. a stored recursor is only compared with the generated one
+    void family(Declaration d, const Digest& h)
+    {
+        const std::string name = env_.pool.names.str(d.name);
+        if(d.kind == DeclKind::Recursor)
+        {
+            const Declaration* made = env_.find(d.name);
+            if(!made || made->kind != DeclKind::Recursor)
+                throw storage_exception("recursor '" + name + "' comes before the types and constructors of its block");
+            verify(d, *made, h);
+            verified_.insert(h);
+            return;
+        }
+
+        Name key;
+        if(d.kind == DeclKind::Inductive)
+        {
+            if(std::find(d.all.begin(), d.all.end(), d.name) == d.all.end()) throw storage_exception("'" + name + "' is not in its own block");
+            key = d.all.front();
+        }
+        else
+        {
+            auto it = pending_.find(d.induct);
+            if(it == pending_.end()) throw storage_exception("constructor '" + name + "' comes before its type");
+            key = it->second;
+        }
+        if(!pending_.emplace(d.name, key).second) throw storage_exception("'" + name + "' is loaded twice");
+        std::vector<std::pair<Declaration, Digest>>& members = blocks_[key];
+        members.push_back({std::move(d), h});
+
+        // complete once every type of the block and every constructor they list is here
+        auto member = [&](Name n) -> const Declaration* {
+            for(const auto& [m, mh] : members)
+                if(m.name == n) return &m;
+            return nullptr;
+        };
+        const Declaration* first = member(key);
+        if(!first) return;
+        InductiveDecl decl{first->lparams, first->nparams, {}};
+        for(Name t : first->all)
+        {
+            const Declaration* ty = member(t);
+            if(!ty) return;
+            InductiveType it{t, ty->type, {}};
+            for(Name c : ty->ctors)
+            {
+                const Declaration* k = member(c);
+                if(!k) return;
+                it.ctors.push_back({c, k->type});
+            }
+            decl.types.push_back(std::move(it));
+        }
+
+        std::vector<std::pair<Declaration, Digest>> done = std::move(members);
+        blocks_.erase(key);
+        std::vector<Name> names;
+        for(const auto& [m, mh] : done) names.push_back(m.name);
+        for(Name n : names) pending_.erase(n);
+        std::size_t mark = env_.decls().size();
+        add_inductive(env_, decl);
+        try
+        {
+            for(const auto& [m, mh] : done)
+            {
+                const Declaration* made = env_.find(m.name); // none for a constructor its type does not list
+                if(!made) throw storage_exception("'" + env_.pool.names.str(m.name) + "' is not a member of its block");
+                verify(m, *made, mh);
+            }
+        }
+        catch(...)
+        {
+            for(std::size_t i = mark; i < env_.decls().size(); ++i) names.push_back(env_.decls()[i].name);
+            env_.truncate(mark);
+            hasher_.forget(names);
+            throw;
+        }
+        for(const auto& [m, mh] : done) verified_.insert(mh);
+        checked_ += env_.decls().size() - mark;
+    }
+
+    // what the kernel declares for a family member, every field but the definitional height
+    static bool same(const Declaration& a, const Declaration& b)
+    {
+        auto rule = [](const RecRule& x, const RecRule& y) { return x.ctor == y.ctor && x.nfields == y.nfields && x.rhs == y.rhs; };
+        return a.kind == b.kind && a.name == b.name && a.lparams == b.lparams && a.type == b.type && a.value == b.value &&
+               a.quot == b.quot && a.nparams == b.nparams && a.nindices == b.nindices && a.nmotives == b.nmotives &&
+               a.nminors == b.nminors && a.cidx == b.cidx && a.nfields == b.nfields && a.induct == b.induct && a.all == b.all &&
+               a.ctors == b.ctors && a.is_rec == b.is_rec && a.k == b.k &&
+               std::equal(a.rules.begin(), a.rules.end(), b.rules.begin(), b.rules.end(), rule);
+    }
+
+    void verify(const Declaration& stored, const Declaration& made, const Digest& h)
+    {
+        if(!same(stored, made) || hasher_(made.name) != h)
+            throw storage_exception("object " + to_hex(h) + " ('" + env_.pool.names.str(made.name) +
+                                    "') is not what the kernel derives from its block");
+    }
+
+    Name resolve(Name hint, const Digest& h)
+    {
+        if(pending_.contains(hint)) return hint; // checked with its block
+        if(env_.find(hint))
+        {
+            try
+            {
+                if(hasher_(hint) == h) return hint;
+            }
+            catch(const kernel_exception&)
+            {
+                return hint; // a member of the inductive block being loaded, not hashable until it is complete
+            }
+        }
+        std::span<const Declaration> ds = env_.decls();
+        if(indexed_ > ds.size()) { by_hash_.clear(); indexed_ = 0; }
+        for(; indexed_ < ds.size(); ++indexed_)
+        {
+            try { by_hash_.emplace(hasher_(ds[indexed_].name), ds[indexed_].name); }
+            catch(const kernel_exception&) { break; }
+        }
+        auto [lo, hi] = by_hash_.equal_range(h);
+        if(lo == hi) throw storage_exception("missing dependency '" + env_.pool.names.str(hint) + "' (" + to_hex(h) + ")");
+        if(std::next(lo) != hi) throw storage_exception("ambiguous dependency '" + env_.pool.names.str(hint) + "' (" + to_hex(h) + ")");
+        return lo->second;
+    }
+
+    Declaration read(std::string_view bytes, const Digest& self, Name as)
+    {
+        Pool& p = env_.pool;
+        detail::ObjectReader r(bytes, to_hex(self));
+        if(r.take(sizeof(object_magic)) != std::string_view(object_magic, sizeof(object_magic)) || r.u32() != object_version)
+            r.fail();
+
+        Declaration d;
+        d.name = as;
+        d.kind = DeclKind(r.u8());
+        d.quot = QuotKind(r.u8());
+        d.is_rec = r.u8();
+        d.k = r.u8();
+        if(d.kind > DeclKind::Recursor || d.quot > QuotKind::Ind) r.fail();
+        for(std::uint32_t* f : {&d.nparams, &d.nindices, &d.nmotives, &d.nminors, &d.cidx, &d.nfields}) *f = r.u32();
+
+        std::vector<Name> strs(r.u32());
+        for(Name& n : strs) n = p.names.intern(r.take(r.u32()));
+        auto str = [&] { return strs[r.index(strs.size())]; };
+        auto names = [&] { std::vector<Name> xs(r.u32()); for(Name& x : xs) x = str(); return xs; };
+
+        std::vector<Name> consts(r.u32());
+        for(Name& n : consts)
+        {
+            Name hint = str();
+            Digest h;
+            std::string_view b = r.take(h.size());
+            std::memcpy(h.data(), b.data(), h.size());
+            n = h == self ? as : resolve(hint, h); // recursor rules mention the recursor
+        }
+
+        std::vector<Level> lv(r.u32());
+        for(std::size_t i = 0; i < lv.size(); ++i)
+        {
+            auto kind = LevelKind(r.u8());
+            std::uint32_t a = r.u32(), b = r.u32();
+            switch(kind)
+            {
+                case LevelKind::Zero: break;
+                case LevelKind::Succ: if(a >= i) r.fail(); a = lv[a]; break;
+                case LevelKind::Max: case LevelKind::IMax: if(a >= i || b >= i) r.fail(); a = lv[a]; b = lv[b]; break;
+                case LevelKind::Param: if(a >= strs.size()) r.fail(); a = strs[a]; break;
+                default: r.fail();
+            }
+            lv[i] = p.levels.make({kind, a, b});
+        }
+
+        std::vector<Expr> ex(r.u32());
+        for(std::size_t i = 0; i < ex.size(); ++i)
+        {
+            auto child = [&] { return ex[r.index(i)]; };
+            auto kind = ExprKind(r.u8());
+            switch(kind)
+            {
+                case ExprKind::BVar: ex[i] = p.bvar(r.u32()); break;
+                case ExprKind::Sort: ex[i] = p.sort(lv[r.index(lv.size())]); break;
+                case ExprKind::Const:
+                {
+                    Name c = consts[r.index(consts.size())];
+                    std::vector<Level> ls(r.u32());
+                    for(Level& l : ls) l = lv[r.index(lv.size())];
+                    ex[i] = p.cnst(c, ls);
+                    break;
+                }
+                case ExprKind::App: { Expr f = child(); ex[i] = p.app(f, child()); break; }
+                case ExprKind::Lam: case ExprKind::Pi:
+                {
+                    auto bi = BinderInfo(r.u32());
+                    if(bi > BinderInfo::InstImplicit) r.fail();
+                    Name n = str();
+                    Expr dom = child();
+                    Expr body = child();
+                    ex[i] = kind == ExprKind::Lam ? p.lam(n, dom, body, bi) : p.pi(n, dom, body, bi);
+                    break;
+                }
+                case ExprKind::Let:
+                {
+                    Name n = str();
+                    Expr type = child();
+                    Expr value = child();
+                    ex[i] = p.let(n, type, value, child());
+                    break;
+                }
+                default: r.fail();
+            }
+        }
+        auto term = [&] { return ex[r.index(ex.size())]; };
+
+        d.lparams = names();
+        d.induct = str();
+        d.all = names();
+        d.ctors = names();
+        d.type = term();
+        if(std::uint32_t v = r.u32(); v != no_expr)
+        {
+            if(v >= ex.size()) r.fail();
+            d.value = ex[v];
+        }
+        d.rules.resize(r.u32());
+        for(RecRule& rr : d.rules)
+        {
+            rr.ctor = str();
+            rr.nfields = r.u32();
+            rr.rhs = term();
+        }
+        if(!r.done()) r.fail();
+        return d;
+    }
+
+    Environment& env_;
+    std::filesystem::path root_;
+    DeclHasher hasher_;
+    VerifiedIndex verified_;
+    std::optional<PackFile> pack_;
+    std::size_t checked_ = 0, trusted_ = 0;
+    std::unordered_multimap<Digest, Name, DigestHash> by_hash_; // env's declarations, for resolve
+    std::size_t indexed_ = 0;
+    std::unordered_map<Name, std::vector<std::pair<Declaration, Digest>>> blocks_; // incomplete, by first type
+    std::unordered_map<Name, Name> pending_;                                       // their members -> first type
+};
+
+// WRITE-AHEAD LOG //
+// appends are buffered in memory and made durable in groups: the first commit to find nothing in
+// flight writes and syncs everything pending, commits arriving meanwhile wait for that sync or share
+// the next one. with a group window a background thread syncs on a timer instead, so a single writer
+// never waits for the disk and a crash loses at most the last window of edits.
+// file: WalHeader, then records (u32 size, u32 crc32 of lsn + payload, u64 lsn, payload);
+// recovery keeps the longest intact prefix with consecutive lsns and cuts off the rest
+
+constexpr char wal_magic[8] = {'V', 'L', 'W', 'A', 'L', 0, 0, 0};
+constexpr std::uint32_t wal_version = 1;
+
+struct WalHeader
+{
+    char magic[8];
+    std::uint32_t version, endian;
+};
+
+namespace detail {
+
+// append-only file with an explicit sync; without POSIX, sync only flushes the C library buffers
+class LogFile
+{
+public:
+    explicit LogFile(const std::filesystem::path& path) : path_(path.string())
+    {
+#ifdef VL_HAVE_MMAP
+        fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+        if(fd_ < 0) throw storage_exception("cannot open '" + path_ + "'");
+#else
+        f_ = std::fopen(path_.c_str(), "ab+");
+        if(!f_) throw storage_exception("cannot open '" + path_ + "'");
+#endif
+    }
+
+    LogFile(const LogFile&) = delete;
+    LogFile& operator=(const LogFile&) = delete;
+
+    ~LogFile()
+    {
+#ifdef VL_HAVE_MMAP
+        ::close(fd_);
+#else
+        std::fclose(f_);
+#endif
+    }
+
+    std::string read_all() const
+    {
+        std::ifstream in(path_, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    }
+
+    void append(std::string_view bytes)
+    {
+#ifdef VL_HAVE_MMAP
+        while(!bytes.empty())
+        {
+            ssize_t n = ::write(fd_, bytes.data(), bytes.size());
+            if(n < 0) throw storage_exception("cannot write '" + path_ + "'");
+            bytes.remove_prefix(std::size_t(n));
+        }
+#else
+        if(std::fwrite(bytes.data(), 1, bytes.size(), f_) != bytes.size()) throw storage_exception("cannot write '" + path_ + "'");
+#endif
+    }
+
+    void sync()
+    {
+#if defined(VL_HAVE_MMAP) && defined(__linux__)
+        if(::fdatasync(fd_) != 0) throw storage_exception("cannot sync '" + path_ + "'");
+#elif defined(VL_HAVE_MMAP)
+        if(::fsync(fd_) != 0) throw storage_exception("cannot sync '" + path_ + "'");
+#else
+        if(std::fflush(f_) != 0) throw storage_exception("cannot sync '" + path_ + "'");
+#endif
+    }
+
+    void truncate(std::size_t size)
+    {
+#ifdef VL_HAVE_MMAP
+        if(::ftruncate(fd_, off_t(size)) != 0) throw storage_exception("cannot truncate '" + path_ + "'");
+#else
+        std::fflush(f_);
+        std::filesystem::resize_file(path_, size);
+#endif
+        sync();
+    }
+
+private:
+    std::string path_;
+#ifdef VL_HAVE_MMAP
+    int fd_ = -1;
+#else
+    std::FILE* f_ = nullptr;
+#endif
+};
+
+inline void put_u32(std::string& out, std::uint32_t v) { out += {char(v), char(v >> 8), char(v >> 16), char(v >> 24)}; }
+
+inline void put_u64(std::string& out, std::uint64_t v)
+{
+    put_u32(out, std::uint32_t(v));
+    put_u32(out, std::uint32_t(v >> 32));
+}
+
+inline std::uint32_t get_u32(std::string_view b)
+{
+    std::uint32_t v = 0;
+    for(std::size_t i = 4; i-- > 0;) v = v << 8 | std::uint8_t(b[i]);
+    return v;
+}
+
+inline std::uint64_t get_u64(std::string_view b)
+{
+    std::uint64_t v = 0;
+    for(std::size_t i = 8; i-- > 0;) v = v << 8 | std::uint8_t(b[i]);
+    return v;
+}
+
+} // namespace detail
+
+class WriteAheadLog
+{
+public:
+    explicit WriteAheadLog(const std::filesystem::path& path, std::chrono::microseconds group_window = {})
+        : file_(path), path_(path.string()), window_(group_window) {}
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    ~WriteAheadLog()
+    {
+        {
+            std::lock_guard lock(m_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        if(flusher_.joinable()) flusher_.join();
+        try { flush(); } catch(const storage_exception&) {}
+    }
+
+    // calls apply(lsn, payload) for every intact record in order and drops a torn tail;
+    // once, before the first append. base is the lsn the log was last reset() at (what a checkpoint
+    // covers): new records count on from past it even when the log is empty. returns the last lsn
+    template<class F>
+    std::uint64_t recover(F&& apply, std::uint64_t base = 0)
+    {
+        std::string data = file_.read_all();
+        std::size_t pos = sizeof(WalHeader);
+        if(data.empty())
+        {
+            WalHeader h{};
+            std::memcpy(h.magic, wal_magic, sizeof(wal_magic));
+            h.version = wal_version;
+            h.endian = image_endian;
+            file_.append({reinterpret_cast<const char*>(&h), sizeof(h)});
+            file_.sync();
+            data.assign(reinterpret_cast<const char*>(&h), sizeof(h));
+        }
+        WalHeader h{};
+        if(data.size() < sizeof(h)) throw storage_exception("'" + path_ + "' is not a write-ahead log");
+        std::memcpy(&h, data.data(), sizeof(h));
+        if(std::memcmp(h.magic, wal_magic, sizeof(wal_magic)) != 0 || h.version != wal_version || h.endian != image_endian)
+            throw storage_exception("'" + path_ + "' is not a write-ahead log of this version");
+
+        std::string_view s = data;
+        std::uint64_t last = 0;
+        while(s.size() - pos >= record_header)
+        {
+            std::uint32_t size = detail::get_u32(s.substr(pos, 4)), crc = detail::get_u32(s.substr(pos + 4, 4));
+            if(s.size() - pos - record_header < size) break;
+            std::string_view lsn_bytes = s.substr(pos + 8, 8), payload = s.substr(pos + record_header, size);
+            std::uint64_t lsn = detail::get_u64(lsn_bytes);
+            if(crc32(payload, crc32(lsn_bytes)) != crc || (last != 0 && lsn != last + 1)) break;
+            apply(lsn, payload);
+            last = lsn;
+            pos += record_header + size;
+        }
+        if(pos != data.size()) file_.truncate(pos);
+
+        std::lock_guard lock(m_);
+        next_ = durable_ = std::max(last, base);
+        recovered_ = true;
+        if(window_.count() > 0) flusher_ = std::thread([this] { flush_loop(); });
+        return next_;
+    }
+
+    // buffered; durable once commit(lsn) returns
+    std::uint64_t append(std::string_view payload)
+    {
+        std::lock_guard lock(m_);
+        if(!recovered_) throw storage_exception("recover '" + path_ + "' before appending");
+        std::uint64_t lsn = ++next_;
+        std::string lsn_bytes;
+        detail::put_u64(lsn_bytes, lsn);
+        detail::put_u32(pending_, std::uint32_t(payload.size()));
+        detail::put_u32(pending_, crc32(payload, crc32(lsn_bytes)));
+        pending_ += lsn_bytes;
+        pending_ += payload;
+        return lsn;
+    }
+
+    void commit(std::uint64_t lsn)
+    {
+        std::unique_lock lock(m_);
+        while(durable_ < lsn)
+        {
+            if(failed_) throw storage_exception("'" + path_ + "' failed to sync");
+            if(syncing_ || window_.count() > 0) synced_.wait(lock);
+            else sync(lock);
+        }
+    }
+
+    // everything appended so far
+    void flush()
+    {
+        std::unique_lock lock(m_);
+        while(durable_ < next_)
+        {
+            if(failed_) throw storage_exception("'" + path_ + "' failed to sync");
+            if(syncing_) synced_.wait(lock);
+            else sync(lock);
+        }
+    }
+
+    // drop every record (their effects are saved elsewhere); lsns keep counting up
+    void reset()
+    {
+        flush();
+        std::lock_guard lock(m_);
+        file_.truncate(sizeof(WalHeader));
+    }
+
+    std::uint64_t last_lsn() const { std::lock_guard lock(m_); return next_; }
+    std::uint64_t durable_lsn() const { std::lock_guard lock(m_); return durable_; }
+    std::uint64_t syncs() const { std::lock_guard lock(m_); return syncs_; }
+
+private:
+    static constexpr std::size_t record_header = 16;
+
+    // called with the lock held, releases it around the write and the sync
+    void sync(std::unique_lock<std::mutex>& lock)
+    {
+        syncing_ = true;
+        std::string batch;
+        batch.swap(pending_);
+        std::uint64_t upto = next_;
+        lock.unlock();
+        bool ok = true;
+        try
+        {
+            file_.append(batch);
+            file_.sync();
+        }
+        catch(const storage_exception&)
+        {
+            ok = false;
+        }
+        lock.lock();
+        syncing_ = false;
+        if(ok) { durable_ = upto; ++syncs_; }
+        else failed_ = true;
+        synced_.notify_all();
+        if(!ok) throw storage_exception("'" + path_ + "' failed to sync");
+    }
+
+    void flush_loop()
+    {
+        std::unique_lock lock(m_);
+        while(!stop_)
+        {
+            wake_.wait_for(lock, window_);
+            if(!syncing_ && !failed_ && durable_ < next_)
+            {
+                try { sync(lock); } catch(const storage_exception&) {}
+            }
+        }
+    }
+
+    detail::LogFile file_;
+    std::string path_;
+    std::chrono::microseconds window_;
+    mutable std::mutex m_;
+    std::condition_variable synced_, wake_;
+    std::string pending_;
+    std::uint64_t next_ = 0, durable_ = 0, syncs_ = 0;
+    bool recovered_ = false, syncing_ = false, failed_ = false, stop_ = false;
+    std::thread flusher_;
+};
+
+// CATALOG //
+// the mutable part of the library database: which name points at which content hash, plus free form
+// metadata per name. edits go through the write-ahead log root/catalog.wal; checkpoint() writes the
+// whole catalog to root/catalog (with the last lsn it covers) and empties the log.
+// versions are immutable treaps sharing unchanged subtrees: the single writer path-copies and
+// publishes the new root, readers work on a CatalogSnapshot that no edit or checkpoint can block
+// (taking one only copies a pointer under a lock held for exactly that), and a version is freed with
+// its last snapshot
+
+constexpr char catalog_magic[8] = {'V', 'L', 'C', 'A', 'T', 'L', 'G', 0};
+constexpr std::uint32_t catalog_version = 1;
+
+struct CatalogEntry
+{
+    Digest hash{};
+    std::string meta;
+};
+
+namespace detail {
+
+struct CatalogNode;
+using CatalogTree = std::shared_ptr<const CatalogNode>;
+
+// priorities come from the name, so a set of names has one shape whatever the edit order
+struct CatalogNode
+{
+    std::string name;
+    CatalogEntry entry;
+    std::uint64_t prio;
+    CatalogTree left, right;
+};
+
+struct CatalogVersion
+{
+    CatalogTree root;
+    std::size_t size = 0;
+    std::uint64_t lsn = 0; // last edit it contains
+};
+
+inline CatalogTree tree(CatalogNode n) { return std::make_shared<const CatalogNode>(std::move(n)); }
+
+// t with change applied to name's entry (created empty if missing)
+template<class F>
+CatalogTree tree_update(const CatalogTree& t, std::string_view name, std::uint64_t prio, const F& change, bool& added)
+{
+    if(!t)
+    {
+        added = true;
+        CatalogNode n{std::string(name), {}, prio, nullptr, nullptr};
+        change(n.entry);
+        return tree(std::move(n));
+    }
+    CatalogNode n = *t;
+    if(name == t->name) { change(n.entry); return tree(std::move(n)); }
+    if(name < t->name)
+    {
+        n.left = tree_update(t->left, name, prio, change, added);
+        if(n.left->prio > n.prio)
+        {
+            CatalogNode l = *n.left;
+            n.left = l.right;
+            l.right = tree(std::move(n));
+            return tree(std::move(l));
+        }
+    }
+    else
+    {
+        n.right = tree_update(t->right, name, prio, change, added);
+        if(n.right->prio > n.prio)
+        {
+            CatalogNode r = *n.right;
+            n.right = r.left;
+            r.left = tree(std::move(n));
+            return tree(std::move(r));
+        }
+    }
+    return tree(std::move(n));
+}
+
+// every name of a before every name of b
+inline CatalogTree tree_join(const CatalogTree& a, const CatalogTree& b)
+{
+    if(!a) return b;
+    if(!b) return a;
+    if(a->prio > b->prio)
+    {
+        CatalogNode n = *a;
+        n.right = tree_join(a->right, b);
+        return tree(std::move(n));
+    }
+    CatalogNode n = *b;
+    n.left = tree_join(a, b->left);
+    return tree(std::move(n));
+}
+
+inline CatalogTree tree_erase(const CatalogTree& t, std::string_view name, bool& removed)
+{
+    if(!t) return t;
+    if(name == t->name) { removed = true; return tree_join(t->left, t->right); }
+    CatalogTree child = tree_erase(name < t->name ? t->left : t->right, name, removed);
+    if(!removed) return t;
+    CatalogNode n = *t;
+    (name < t->name ? n.left : n.right) = std::move(child);
+    return tree(std::move(n));
+}
+
+} // namespace detail
+
+// a consistent, read only view of the catalog as of one edit; cheap to take and to copy
+class CatalogSnapshot
+{
+public:
+    const CatalogEntry* find(std::string_view name) const
+    {
+        const detail::CatalogNode* n = v_->root.get();
+        while(n && n->name != name) n = (name < n->name ? n->left : n->right).get();
+        return n ? &n->entry : nullptr;
+    }
+
+    std::size_t size() const { return v_->size; }
+    std::uint64_t lsn() const { return v_->lsn; }
+
+    // f(name, entry) for every name starting with prefix, in name order
+    template<class F>
+    void for_each(F&& f, std::string_view prefix = {}) const { walk(v_->root.get(), prefix, f); }
+
+private:
+    friend class Catalog;
+    explicit CatalogSnapshot(std::shared_ptr<const detail::CatalogVersion> v) : v_(std::move(v)) {}
+
+    template<class F>
+    static void walk(const detail::CatalogNode* n, std::string_view prefix, F& f)
+    {
+        while(n)
+        {
+            std::string_view key = n->name;
+            bool below = key.substr(0, prefix.size()) < prefix;   // the whole left subtree is before prefix
+            bool above = key.substr(0, prefix.size()) > prefix;   // the whole right subtree is past it
+            if(!below) walk(n->left.get(), prefix, f);
+            if(!below && !above) f(key, n->entry);
+            if(above) return;
+            n = n->right.get();
+        }
+    }
+
+    std::shared_ptr<const detail::CatalogVersion> v_;
+};
+
+class Catalog
+{
+public:
+    explicit Catalog(std::filesystem::path root, std::chrono::microseconds group_window = {})
+        : root_(directory(std::move(root))), wal_(root_ / "catalog.wal", group_window)
+    {
+        std::uint64_t base = load();
+        wal_.recover([&](std::uint64_t lsn, std::string_view rec) {
+            if(lsn > base) apply(rec, lsn);
+        }, base);
+    }
+
+    // the latest published version
+    CatalogSnapshot snapshot() const
+    {
+        std::lock_guard lock(head_m_);
+        return CatalogSnapshot(head_);
+    }
+
+    std::optional<CatalogEntry> find(std::string_view name) const
+    {
+        CatalogSnapshot s = snapshot();
+        if(const CatalogEntry* e = s.find(name)) return *e;
+        return std::nullopt;
+    }
+
+    std::size_t size() const { return snapshot().size(); }
+
+    // each edit returns its lsn; it is durable once commit(lsn) returns (or after the group window).
+    // snapshots taken after the edit returns see it
+    std::uint64_t bind(std::string_view name, const Digest& h)
+    {
+        std::string rec = record(Op::Bind, name);
+        rec.append(reinterpret_cast<const char*>(h.data()), h.size());
+        return edit(rec);
+    }
+
+    std::uint64_t annotate(std::string_view name, std::string_view meta)
+    {
+        std::string rec = record(Op::Annotate, name);
+        detail::put_u32(rec, std::uint32_t(meta.size()));
+        rec += meta;
+        return edit(rec);
+    }
+
+    std::uint64_t erase(std::string_view name) { return edit(record(Op::Erase, name)); }
+
+    void commit(std::uint64_t lsn) { wal_.commit(lsn); }
+    void flush() { wal_.flush(); }
+
+    // holds back other writers while it saves, readers carry on with their snapshots
+    void checkpoint()
+    {
+        std::lock_guard lock(write_);
+        wal_.flush();
+        CatalogSnapshot s = snapshot();
+        std::string out(catalog_magic, sizeof(catalog_magic));
+        detail::put_u32(out, catalog_version);
+        detail::put_u32(out, image_endian);
+        detail::put_u64(out, s.lsn());
+        detail::put_u64(out, s.size());
+        s.for_each([&](std::string_view name, const CatalogEntry& e) {
+            detail::put_u32(out, std::uint32_t(name.size()));
+            out += name;
+            out.append(reinterpret_cast<const char*>(e.hash.data()), e.hash.size());
+            detail::put_u32(out, std::uint32_t(e.meta.size()));
+            out += e.meta;
+        });
+        std::filesystem::path tmp = root_ / "catalog.tmp";
+        std::filesystem::remove(tmp);
+        {
+            detail::LogFile f(tmp);
+            f.append(out);
+            f.sync();
+        }
+        std::filesystem::rename(tmp, root_ / "catalog");
+        wal_.reset();
+    }
+
+    WriteAheadLog& log() { return wal_; }
+
+private:
+    enum class Op : std::uint8_t { Bind, Annotate, Erase };
+
+    static std::filesystem::path directory(std::filesystem::path p)
+    {
+        std::filesystem::create_directories(p);
+        return p;
+    }
+
+    static std::string record(Op op, std::string_view name)
+    {
+        std::string rec(1, char(op));
+        detail::put_u32(rec, std::uint32_t(name.size()));
+        rec += name;
+        return rec;
+    }
+
+    // logged and published under the writer lock, so the log replays in the order edits were made
+    std::uint64_t edit(const std::string& rec)
+    {
+        std::lock_guard lock(write_);
+        std::uint64_t lsn = wal_.append(rec);
+        apply(rec, lsn);
+        return lsn;
+    }
+
+    // writer side: build the next version from the current one and publish it
+    void apply(std::string_view rec, std::uint64_t lsn)
+    {
+        detail::ObjectReader r(rec, "catalog record");
+        auto op = Op(r.u8());
+        std::string_view name = r.take(r.u32());
+        auto cur = snapshot().v_;
+        auto next = std::make_shared<detail::CatalogVersion>(*cur);
+        next->lsn = lsn;
+        std::uint64_t prio = mix(NameTable::hash(name), 0);
+        bool changed = false;
+        switch(op)
+        {
+            case Op::Bind:
+            {
+                std::string_view b = r.take(sizeof(Digest));
+                next->root = detail::tree_update(cur->root, name, prio,
+                    [&](CatalogEntry& e) { std::memcpy(e.hash.data(), b.data(), sizeof(Digest)); }, changed);
+                break;
+            }
+            case Op::Annotate:
+            {
+                std::string_view meta = r.take(r.u32());
+                next->root = detail::tree_update(cur->root, name, prio, [&](CatalogEntry& e) { e.meta = meta; }, changed);
+                break;
+            }
+            case Op::Erase:
+                next->root = detail::tree_erase(cur->root, name, changed);
+                if(changed) --next->size;
+                changed = false;
+                break;
+            default: r.fail();
+        }
+        if(!r.done()) r.fail();
+        if(changed) ++next->size;
+        publish(std::move(next));
+    }
+
+    void publish(std::shared_ptr<const detail::CatalogVersion> v)
+    {
+        std::lock_guard lock(head_m_);
+        head_.swap(v); // the old version is released outside the lock
+    }
+
+    // the checkpoint, returns the last lsn it covers
+    std::uint64_t load()
+    {
+        std::ifstream in(root_ / "catalog", std::ios::binary);
+        if(!in) return 0;
+        std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        detail::ObjectReader r(data, "catalog");
+        if(r.take(sizeof(catalog_magic)) != std::string_view(catalog_magic, sizeof(catalog_magic)) ||
+           r.u32() != catalog_version || r.u32() != image_endian)
+            r.fail();
+        auto v = std::make_shared<detail::CatalogVersion>();
+        v->lsn = detail::get_u64(r.take(8));
+        std::uint64_t n = detail::get_u64(r.take(8));
+        for(std::uint64_t i = 0; i < n; ++i)
+        {
+            std::string_view name = r.take(r.u32());
+            Digest h;
+            std::memcpy(h.data(), r.take(sizeof(Digest)).data(), sizeof(Digest));
+            std::string_view meta = r.take(r.u32());
+            bool added = false;
+            v->root = detail::tree_update(v->root, name, mix(NameTable::hash(name), 0),
+                [&](CatalogEntry& e) { e.hash = h; e.meta = meta; }, added);
+            v->size += added;
+        }
+        if(!r.done()) r.fail();
+        std::uint64_t lsn = v->lsn;
+        publish(std::move(v));
+        return lsn;
+    }
+
+    std::filesystem::path root_;
+    std::mutex write_;
+    mutable std::mutex head_m_;
+    std::shared_ptr<const detail::CatalogVersion> head_ = std::make_shared<const detail::CatalogVersion>();
+    WriteAheadLog wal_;
+};
+
+// METADATA //
+// keyed metadata beside the declarations (attributes, tags, author, verification status, used-by
+// references) in an on-disk B+tree, so a range of names is found without reading the library.
+// keys and values are byte strings in byte order. the tree is copy on write: an edit copies the
+// path from the root to its leaf into pages past the end of the file, commit() writes them, syncs,
+// then points the next of two header slots at the new root and syncs again, so a crash keeps the
+// last commit. a page the commit replaced is free from the next edit on (no header reaches it any
+// more); free pages are only known to the BTree that freed them, after reopening they are left
+// for compaction.
+// file: page 0 holds two header slots at 0 and 256 (BTreeHeader + crc32, the valid one with the
+// higher txn wins), then node pages: u32 crc32 of the rest of the page, u8 leaf, u8 0, u16 count, then
+//   leaf:     count x (u16 key size, u16 value size, key, value)
+//   internal: u64 first child, count x (u16 key size, key, u64 child); child i + 1 holds keys >= key i
+// one BTree is used by one thread; decoded nodes are cached and the clean ones dropped past a limit
+
+constexpr char btree_magic[8] = {'V', 'L', 'B', 'T', 'R', 'E', 'E', 0};
+constexpr std::uint32_t btree_version = 1;
+
+struct BTreeHeader
+{
+    char magic[8];
+    std::uint32_t version, endian;
+    std::uint32_t page_size, pad;
+    std::uint64_t txn, root, pages, entries; // root 0: empty
+};
+
+namespace detail {
+
+// a file read and written in place by offset; sync as in LogFile
+class PageFile
+{
+public:
+    explicit PageFile(const std::filesystem::path& path) : path_(path.string())
+    {
+#ifdef VL_HAVE_MMAP
+        fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT, 0644);
+        if(fd_ < 0) throw storage_exception("cannot open '" + path_ + "'");
+#else
+        if(!std::filesystem::exists(path)) std::ofstream(path, std::ios::binary);
+        f_ = std::fopen(path_.c_str(), "r+b");
+        if(!f_) throw storage_exception("cannot open '" + path_ + "'");
+#endif
+    }
+
+    PageFile(const PageFile&) = delete;
+    PageFile& operator=(const PageFile&) = delete;
+
+    ~PageFile()
+    {
+#ifdef VL_HAVE_MMAP
+        ::close(fd_);
+#else
+        std::fclose(f_);
+#endif
+    }
+
+    std::uint64_t size() const { return std::filesystem::file_size(path_); }
+
+    // false when the file ends first
+    bool read(std::uint64_t offset, char* out, std::size_t n) const
+    {
+#ifdef VL_HAVE_MMAP
+        while(n > 0)
+        {
+            ssize_t got = ::pread(fd_, out, n, off_t(offset));
+            if(got < 0) throw storage_exception("cannot read '" + path_ + "'");
+            if(got == 0) return false;
+            out += got, offset += std::uint64_t(got), n -= std::size_t(got);
+        }
+        return true;
+#else
+        return std::fseek(f_, long(offset), SEEK_SET) == 0 && std::fread(out, 1, n, f_) == n;
+#endif
+    }
+
+    void write(std::uint64_t offset, std::string_view bytes)
+    {
+#ifdef VL_HAVE_MMAP
+        while(!bytes.empty())
+        {
+            ssize_t n = ::pwrite(fd_, bytes.data(), bytes.size(), off_t(offset));
+            if(n < 0) throw storage_exception("cannot write '" + path_ + "'");
+            bytes.remove_prefix(std::size_t(n));
+            offset += std::uint64_t(n);
+        }
+#else
+        if(std::fseek(f_, long(offset), SEEK_SET) != 0 || std::fwrite(bytes.data(), 1, bytes.size(), f_) != bytes.size())
+            throw storage_exception("cannot write '" + path_ + "'");
+#endif
+    }
+
+    void sync()
+    {
+#if defined(VL_HAVE_MMAP) && defined(__linux__)
+        if(::fdatasync(fd_) != 0) throw storage_exception("cannot sync '" + path_ + "'");
+#elif defined(VL_HAVE_MMAP)
+        if(::fsync(fd_) != 0) throw storage_exception("cannot sync '" + path_ + "'");
+#else
+        if(std::fflush(f_) != 0) throw storage_exception("cannot sync '" + path_ + "'");
+#endif
+    }
+
+private:
+    std::string path_;
+#ifdef VL_HAVE_MMAP
+    int fd_ = -1;
+#else
+    std::FILE* f_ = nullptr;
+#endif
+};
+
+inline void put_u16(std::string& out, std::size_t v) { out += {char(v), char(v >> 8)}; }
+
+struct BTreeNode
+{
+    bool leaf = true, dirty = false;
+    std::vector<std::string> keys, values; // values: leaves
+    std::vector<std::uint64_t> kids;       // internal nodes, keys.size() + 1
+
+    std::size_t bytes() const
+    {
+        std::size_t n = 8 + (leaf ? 0 : 8);
+        for(std::size_t i = 0; i < keys.size(); ++i) n += keys[i].size() + (leaf ? 4 + values[i].size() : 10);
+        return n;
+    }
+};
+
+} // namespace detail
+
+class BTree
+{
+public:
+    // creates the file with page_size pages when it is missing or empty, otherwise keeps its own
+    explicit BTree(const std::filesystem::path& path, std::uint32_t page_size = 4096, std::size_t cached_pages = 4096)
+        : path_(path.string()), file_(path), cache_limit_(cached_pages)
+    {
+        if(file_.size() == 0)
+        {
+            if(page_size < 512 || page_size > 65536) throw storage_exception("B+tree page size must be in [512, 65536]");
+            h_ = {};
+            std::memcpy(h_.magic, btree_magic, sizeof(btree_magic));
+            h_.version = btree_version;
+            h_.endian = image_endian;
+            h_.page_size = page_size;
+            h_.pages = 1;
+            write_header(h_, 0);
+            h_.txn = 1;
+            write_header(h_, 1);
+            file_.sync();
+        }
+        else open();
+        committed_ = h_;
+    }
+
+    std::uint32_t page_size() const { return h_.page_size; }
+    std::size_t size() const { return std::size_t(h_.entries); }
+    std::uint64_t pages() const { return h_.pages; } // in the file after the next commit, headers included
+    bool changed() const { return changed_; }
+
+    // the largest key size + value size put accepts, so any node splits into two that fit a page
+    std::size_t max_entry() const { return (h_.page_size - 8) / 4 - 10; }
+
+    std::optional<std::string> get(std::string_view key)
+    {
+        trim();
+        for(std::uint64_t id = h_.root; id != 0;)
+        {
+            detail::BTreeNode& n = load(id);
+            if(n.leaf)
+            {
+                auto it = std::lower_bound(n.keys.begin(), n.keys.end(), key);
+                if(it == n.keys.end() || *it != key) return std::nullopt;
+                return n.values[std::size_t(it - n.keys.begin())];
+            }
+            id = n.kids[child(n, key)];
+        }
+        return std::nullopt;
+    }
+
+    bool contains(std::string_view key) { return get(key).has_value(); }
+
+    void put(std::string_view key, std::string_view value)
+    {
+        if(key.size() + value.size() > max_entry())
+            throw storage_exception("B+tree entry of " + std::to_string(key.size() + value.size()) + " bytes in '" + path_ + "'");
+        trim();
+        if(h_.root == 0)
+        {
+            detail::BTreeNode& n = fresh(h_.root);
+            n.keys.emplace_back(key);
+            n.values.emplace_back(value);
+            ++h_.entries;
+            return;
+        }
+        if(auto split = insert(h_.root, key, value, true))
+        {
+            std::uint64_t left = h_.root;
+            detail::BTreeNode& n = fresh(h_.root);
+            n.leaf = false;
+            n.keys.push_back(std::move(split->first));
+            n.kids = {left, split->second};
+        }
+    }
+
+    bool erase(std::string_view key)
+    {
+        if(!contains(key)) return false; // nothing copied for a miss
+        remove(h_.root, key);
+        while(h_.root != 0 && load(h_.root).keys.empty())
+        {
+            detail::BTreeNode& root = load(h_.root);
+            std::uint64_t next = root.leaf ? 0 : root.kids[0];
+            drop(h_.root);
+            h_.root = next;
+        }
+        --h_.entries;
+        return true;
+    }
+
+    // f(key, value) for every key starting with prefix and not before from, in key order; f may
+    // return false to stop. the tree must not change during the walk
+    template<class F>
+    void for_each(F&& f, std::string_view prefix = {}, std::string_view from = {})
+    {
+        trim();
+        if(h_.root != 0) walk(h_.root, prefix, std::max(prefix, from), f);
+    }
+
+    // makes every edit so far durable
+    void commit()
+    {
+        if(!changed()) return;
+        std::vector<std::pair<std::uint64_t, detail::BTreeNode*>> dirty;
+        for(auto& [id, n] : cache_)
+            if(n->dirty) dirty.push_back({id, n.get()});
+        std::sort(dirty.begin(), dirty.end());
+        for(const auto& [id, n] : dirty) file_.write(id * h_.page_size, encode(*n));
+        file_.sync();
+        ++h_.txn;
+        write_header(h_, h_.txn % 2);
+        file_.sync();
+        for(const auto& [id, n] : dirty) n->dirty = false;
+        committed_ = h_;
+        free_.insert(free_.end(), retired_.begin(), retired_.end());
+        retired_.clear();
+        committed_free_ = free_;
+        changed_ = false;
+    }
+
+    // drops every edit since the last commit
+    void rollback()
+    {
+        std::erase_if(cache_, [](const auto& kv) { return kv.second->dirty; });
+        h_ = committed_;
+        free_ = committed_free_;
+        retired_.clear();
+        changed_ = false;
+    }
+
+private:
+    using Split = std::optional<std::pair<std::string, std::uint64_t>>; // separator, new right sibling
+
+    static std::size_t child(const detail::BTreeNode& n, std::string_view key)
+    {
+        return std::size_t(std::upper_bound(n.keys.begin(), n.keys.end(), key) - n.keys.begin());
+    }
+
+    [[noreturn]] void fail() const { throw storage_exception("corrupt B+tree '" + path_ + "'"); }
+
+    void open()
+    {
+        std::optional<BTreeHeader> best;
+        for(std::uint64_t slot = 0; slot < 2; ++slot)
+        {
+            std::string page(sizeof(BTreeHeader) + 4, '\0');
+            if(!file_.read(slot * 256, page.data(), page.size())) continue;
+            BTreeHeader h;
+            std::memcpy(&h, page.data(), sizeof(h));
+            if(std::memcmp(h.magic, btree_magic, sizeof(btree_magic)) != 0)
+                throw storage_exception("'" + path_ + "' is not a B+tree");
+            if(h.version != btree_version || h.endian != image_endian)
+                throw storage_exception("'" + path_ + "' was written by an incompatible version");
+            if(crc32({page.data(), sizeof(h)}) != detail::get_u32(std::string_view(page).substr(sizeof(h))) || h.txn % 2 != slot)
+                continue; // torn header write
+            if(!best || h.txn > best->txn) best = h;
+        }
+        if(!best || best->page_size < 512 || best->page_size > 65536 || best->root >= best->pages) fail();
+        h_ = *best;
+        if(file_.size() < h_.pages * h_.page_size) fail();
+    }
+
+    // extends the file to h.pages, pages allocated and dropped again were never written
+    void write_header(const BTreeHeader& h, std::uint64_t slot)
+    {
+        std::string page(reinterpret_cast<const char*>(&h), sizeof(h));
+        detail::put_u32(page, crc32(page));
+        file_.write(slot * 256, page);
+        if(h.pages * h.page_size > file_.size()) file_.write(h.pages * h.page_size - 1, std::string(1, '\0'));
+    }
+
+    std::string encode(const detail::BTreeNode& n) const
+    {
+        std::string body;
+        body += char(n.leaf);
+        body += char(0);
+        detail::put_u16(body, n.keys.size());
+        if(!n.leaf) detail::put_u64(body, n.kids[0]);
+        for(std::size_t i = 0; i < n.keys.size(); ++i)
+        {
+            detail::put_u16(body, n.keys[i].size());
+            if(n.leaf) detail::put_u16(body, n.values[i].size());
+            body += n.keys[i];
+            if(n.leaf) body += n.values[i];
+            else detail::put_u64(body, n.kids[i + 1]);
+        }
+        body.resize(h_.page_size - 4, '\0');
+        std::string page;
+        detail::put_u32(page, crc32(body));
+        return page + body;
+    }
+
+    detail::BTreeNode& load(std::uint64_t id)
+    {
+        if(auto it = cache_.find(id); it != cache_.end()) return *it->second;
+        if(id < 1 || id >= h_.pages) fail();
+        std::string page(h_.page_size, '\0');
+        if(!file_.read(id * h_.page_size, page.data(), page.size())) fail();
+        std::string_view s(page);
+        if(crc32(s.substr(4)) != detail::get_u32(s)) fail();
+        detail::ObjectReader r(s.substr(4), "B+tree page in '" + path_ + "'");
+        auto n = std::make_unique<detail::BTreeNode>();
+        n->leaf = r.u8() != 0;
+        r.u8();
+        auto u16 = [&] { return std::size_t(r.u8()) | std::size_t(r.u8()) << 8; };
+        std::size_t count = u16();
+        if(!n->leaf) n->kids.push_back(detail::get_u64(r.take(8)));
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            std::size_t k = u16(), v = n->leaf ? u16() : 0;
+            n->keys.emplace_back(r.take(k));
+            if(n->leaf) n->values.emplace_back(r.take(v));
+            else n->kids.push_back(detail::get_u64(r.take(8)));
+        }
+        if(!std::is_sorted(n->keys.begin(), n->keys.end())) fail();
+        return *cache_.emplace(id, std::move(n)).first->second;
+    }
+
+    // a page for a node of this transaction, a free one first
+    std::uint64_t allocate()
+    {
+        changed_ = true;
+        if(free_.empty()) return h_.pages++;
+        std::uint64_t id = free_.back();
+        free_.pop_back();
+        return id;
+    }
+
+    // a node leaves the tree: a page of this transaction is free at once, a committed one after commit
+    void drop(std::uint64_t id)
+    {
+        (load(id).dirty ? free_ : retired_).push_back(id);
+        cache_.erase(id);
+    }
+
+    // a new node, id set to its page
+    detail::BTreeNode& fresh(std::uint64_t& id)
+    {
+        id = allocate();
+        auto& n = cache_[id] = std::make_unique<detail::BTreeNode>();
+        n->dirty = true;
+        return *n;
+    }
+
+    // node id, copied to a new page first unless this transaction already did; id follows the copy
+    detail::BTreeNode& writable(std::uint64_t& id)
+    {
+        detail::BTreeNode& n = load(id);
+        if(n.dirty) return n;
+        auto node = std::move(cache_.find(id)->second);
+        cache_.erase(id);
+        retired_.push_back(id);
+        id = allocate();
+        node->dirty = true;
+        return *(cache_[id] = std::move(node));
+    }
+
+    // rightmost: id is on the path to the last key
+    Split insert(std::uint64_t& id, std::string_view key, std::string_view value, bool rightmost)
+    {
+        detail::BTreeNode* n = &writable(id);
+        bool appended = false; // the new key or separator went to the end of n
+        if(n->leaf)
+        {
+            auto it = std::lower_bound(n->keys.begin(), n->keys.end(), key);
+            std::size_t i = std::size_t(it - n->keys.begin());
+            if(it != n->keys.end() && *it == key) n->values[i] = value;
+            else
+            {
+                appended = it == n->keys.end();
+                n->keys.emplace(it, key);
+                n->values.emplace(n->values.begin() + std::ptrdiff_t(i), value);
+                ++h_.entries;
+            }
+        }
+        else
+        {
+            std::size_t i = child(*n, key);
+            if(Split s = insert(n->kids[i], key, value, rightmost && i + 1 == n->kids.size()))
+            {
+                appended = i == n->keys.size();
+                n->keys.insert(n->keys.begin() + std::ptrdiff_t(i), std::move(s->first));
+                n->kids.insert(n->kids.begin() + std::ptrdiff_t(i) + 1, s->second);
+            }
+        }
+        if(n->bytes() <= h_.page_size) return std::nullopt;
+
+        // at the first key that puts half the bytes on the left; keys arriving in order (a bulk
+        // load, a compaction) leave the left node full instead, it will not get any more
+        std::size_t half = n->bytes() / 2, at = 0;
+        for(std::size_t b = 8; at + 1 < n->keys.size() && b < half; ++at) b += n->keys[at].size() + (n->leaf ? 4 + n->values[at].size() : 10);
+        if(rightmost && appended) at = n->keys.size() - (n->leaf ? 1 : 2);
+        at = std::max<std::size_t>(at, 1);
+        std::uint64_t right_id;
+        detail::BTreeNode& right = fresh(right_id);
+        right.leaf = n->leaf;
+        auto from = n->keys.begin() + std::ptrdiff_t(at);
+        std::string sep = *from;
+        if(n->leaf)
+        {
+            right.keys.assign(from, n->keys.end());
+            right.values.assign(n->values.begin() + std::ptrdiff_t(at), n->values.end());
+            n->values.resize(at);
+        }
+        else // the separator moves up
+        {
+            right.keys.assign(from + 1, n->keys.end());
+            right.kids.assign(n->kids.begin() + std::ptrdiff_t(at) + 1, n->kids.end());
+            n->kids.resize(at + 1);
+        }
+        n->keys.resize(at);
+        return std::pair{std::move(sep), right_id};
+    }
+
+    // key is present; a child left under a quarter page merges with a neighbour when both fit one
+    void remove(std::uint64_t& id, std::string_view key)
+    {
+        detail::BTreeNode& n = writable(id);
+        if(n.leaf)
+        {
+            std::size_t i = std::size_t(std::lower_bound(n.keys.begin(), n.keys.end(), key) - n.keys.begin());
+            n.keys.erase(n.keys.begin() + std::ptrdiff_t(i));
+            n.values.erase(n.values.begin() + std::ptrdiff_t(i));
+            return;
+        }
+        std::size_t i = child(n, key);
+        remove(n.kids[i], key);
+        if(load(n.kids[i]).bytes() >= h_.page_size / 4) return;
+        std::size_t l = i > 0 ? i - 1 : i, r = l + 1;
+        if(r >= n.kids.size()) return;
+        detail::BTreeNode &a = writable(n.kids[l]), &b = writable(n.kids[r]);
+        std::size_t merged = a.bytes() + b.bytes() - 8; // one node header
+        if(!a.leaf) merged += n.keys[l].size() + 10 - 8; // the separator comes down, b's first child is a plain child
+        if(merged > h_.page_size) return;
+        if(a.leaf) a.values.insert(a.values.end(), b.values.begin(), b.values.end());
+        else
+        {
+            a.keys.push_back(n.keys[l]);
+            a.kids.insert(a.kids.end(), b.kids.begin(), b.kids.end());
+        }
+        a.keys.insert(a.keys.end(), b.keys.begin(), b.keys.end());
+        drop(n.kids[r]);
+        n.keys.erase(n.keys.begin() + std::ptrdiff_t(l));
+        n.kids.erase(n.kids.begin() + std::ptrdiff_t(r));
+    }
+
+    // false once the walk is past the prefix or f stopped it
+    template<class F>
+    bool walk(std::uint64_t id, std::string_view prefix, std::string_view from, F& f)
+    {
+        detail::BTreeNode& n = load(id);
+        if(!n.leaf)
+        {
+            for(std::size_t i = child(n, from); i < n.kids.size(); ++i)
+            {
+                if(i > 0 && !n.keys[i - 1].starts_with(prefix) && n.keys[i - 1] > prefix) return false;
+                std::uint64_t kid = n.kids[i];
+                if(!walk(kid, prefix, from, f)) return false;
+            }
+            return true;
+        }
+        for(std::size_t i = std::size_t(std::lower_bound(n.keys.begin(), n.keys.end(), from) - n.keys.begin()); i < n.keys.size(); ++i)
+        {
+            const std::string& k = n.keys[i];
+            if(!k.starts_with(prefix)) return false;
+            if constexpr(std::is_same_v<decltype(f(std::string_view(k), std::string_view(k))), bool>)
+            {
+                if(!f(std::string_view(k), std::string_view(n.values[i]))) return false;
+            }
+            else f(std::string_view(k), std::string_view(n.values[i]));
+        }
+        return true;
+    }
+
+    // called before each operation, never during one, so no node in use is dropped
+    void trim()
+    {
+        if(cache_.size() > cache_limit_) std::erase_if(cache_, [](const auto& kv) { return !kv.second->dirty; });
+    }
+
+    std::string path_;
+    detail::PageFile file_;
+    std::size_t cache_limit_;
+    BTreeHeader h_{}, committed_{};
+    bool changed_ = false;
+    std::vector<std::uint64_t> free_, committed_free_, retired_; // retired_: committed pages this transaction replaced
+    std::unordered_map<std::uint64_t, std::unique_ptr<detail::BTreeNode>> cache_;
+};
+
+// declaration metadata in a BTree, keyed by table byte, name, 0 byte, field:
+//   'a' name attribute -> value        attributes ("kind", "author", "status", tags ...)
+//   'd' name target    -> ""           name uses target
+//   'u' target name    -> ""           the same reference backwards, for used-by queries
+// 0 sorts before any other byte, so each table is in name order ("Rat" before "Rat.add")
+class MetaStore
+{
+public:
+    explicit MetaStore(const std::filesystem::path& path) : tree_(path) {}
+
+    std::optional<std::string> get(std::string_view name, std::string_view attr) { return tree_.get(key('a', name, attr)); }
+    void set(std::string_view name, std::string_view attr, std::string_view value) { tree_.put(key('a', name, attr), value); }
+    bool unset(std::string_view name, std::string_view attr) { return tree_.erase(key('a', name, attr)); }
+
+    // f(attr, value) for every attribute of name, by attribute
+    template<class F>
+    void attributes(std::string_view name, F&& f)
+    {
+        std::string prefix = key('a', name, {});
+        tree_.for_each([&](std::string_view k, std::string_view v) { return call(f, k.substr(prefix.size()), v); }, prefix);
+    }
+
+    // f(name, attr, value) for every attribute of every name starting with prefix, in name order
+    // then by attribute, from name `from` on; f may return false to stop
+    template<class F>
+    void for_each(F&& f, std::string_view prefix = {}, std::string_view from = {})
+    {
+        std::string p = "a" + std::string(prefix), start = from.empty() ? std::string() : key('a', from, {});
+        tree_.for_each([&](std::string_view k, std::string_view v) {
+            std::size_t end = k.find('\0', 1);
+            return call(f, k.substr(1, end - 1), k.substr(end + 1), v);
+        }, p, start);
+    }
+
+    // replaces what name uses, both directions
+    void set_uses(std::string_view name, std::span<const std::string_view> targets)
+    {
+        std::vector<std::string> old;
+        uses(name, [&](std::string_view t) { old.emplace_back(t); });
+        for(const std::string& t : old)
+        {
+            tree_.erase(key('d', name, t));
+            tree_.erase(key('u', t, name));
+        }
+        for(std::string_view t : targets)
+        {
+            tree_.put(key('d', name, t), {});
+            tree_.put(key('u', t, name), {});
+        }
+    }
+
+    // f(target) for everything name uses, f(user) for everything that uses name; in name order
+    template<class F>
+    void uses(std::string_view name, F&& f) { column('d', name, f); }
+    template<class F>
+    void used_by(std::string_view name, F&& f) { column('u', name, f); }
+
+    // name's attributes and uses (what uses name is the users' own record)
+    void erase(std::string_view name)
+    {
+        std::vector<std::string> attrs;
+        attributes(name, [&](std::string_view a, std::string_view) { attrs.emplace_back(a); });
+        for(const std::string& a : attrs) unset(name, a);
+        set_uses(name, {});
+    }
+
+    void commit() { tree_.commit(); }
+    void rollback() { tree_.rollback(); }
+    BTree& tree() { return tree_; }
+
+private:
+    static std::string key(char table, std::string_view name, std::string_view field)
+    {
+        if(name.find('\0') != std::string_view::npos) throw storage_exception("metadata name with a 0 byte");
+        std::string k(1, table);
+        k += name;
+        k += '\0';
+        k += field;
+        return k;
+    }
+
+    template<class F, class... A>
+    static bool call(F& f, A... a)
+    {
+        if constexpr(std::is_same_v<decltype(f(a...)), bool>) return f(a...);
+        else { f(a...); return true; }
+    }
+
+    template<class F>
+    void column(char table, std::string_view name, F& f)
+    {
+        std::string prefix = key(table, name, {});
+        tree_.for_each([&](std::string_view k, std::string_view) { return call(f, k.substr(prefix.size())); }, prefix);
+    }
+
+    BTree tree_;
+};
+
+// "kind" and uses of env's declarations from first on (a recursor uses what its rules mention)
+inline void record_declarations(MetaStore& m, const Environment& env, std::size_t first = 0)
+{
+    static constexpr const char* kinds[] = {"axiom", "definition", "theorem", "opaque", "quot", "inductive", "constructor", "recursor"};
+    const Pool& p = env.pool;
+    std::unordered_set<Expr> seen;
+    std::vector<Name> used;
+    std::vector<std::string_view> targets;
+    for(const Declaration& d : env.decls().subspan(std::min(first, env.decls().size())))
+    {
+        seen.clear();
+        used.clear();
+        p.consts(d.type, seen, used);
+        if(d.value != no_expr) p.consts(d.value, seen, used);
+        for(const RecRule& r : d.rules) p.consts(r.rhs, seen, used);
+        std::sort(used.begin(), used.end());
+        used.erase(std::unique(used.begin(), used.end()), used.end());
+        targets.clear();
+        for(Name n : used)
+            if(n != d.name) targets.push_back(p.names.view(n));
+        std::string_view name = p.names.view(d.name);
+        m.set(name, "kind", kinds[std::size_t(d.kind)]);
+        m.set_uses(name, targets);
+    }
+}
+
+// COMPACTION //
+// rewrites a library database directory in place: Catalog's log is folded into its checkpoint, the
+// ContentStore keeps only the versions some name is bound to and what they depend on, packed in
+// dependency order with each namespace together (loading a module reads a run of pages), and the
+// MetaStore root/meta, if there is one, is copied without the pages edits left behind. a store
+// without a catalog says nothing about what is live, so it keeps every object; a catalog with every
+// name erased keeps none
+
+struct CompactStats
+{
+    std::uint64_t bytes_before = 0, bytes_after = 0;
+    std::size_t objects_before = 0, objects_after = 0;
+};
+
+inline std::uint64_t directory_bytes(const std::filesystem::path& root)
+{
+    std::uint64_t n = 0;
+    for(const auto& f : std::filesystem::recursive_directory_iterator(root))
+        if(f.is_regular_file()) n += f.file_size();
+    return n;
+}
+
+// the hashes bound in root's catalog in name order (empty once every name is erased), nullopt
+// without a catalog
+inline std::optional<std::vector<Digest>> catalog_roots(const std::filesystem::path& root)
+{
+    if(!std::filesystem::exists(root / "catalog") && !std::filesystem::exists(root / "catalog.wal")) return std::nullopt;
+    std::vector<Digest> out;
+    Catalog cat(root);
+    cat.snapshot().for_each([&](std::string_view, const CatalogEntry& e) { out.push_back(e.hash); });
+    return out;
+}
+
+// the entries of a BTree in order into a fresh file renamed over it
+inline void compact_btree(const std::filesystem::path& path)
+{
+    std::filesystem::path tmp = path;
+    tmp += ".tmp";
+    std::filesystem::remove(tmp);
+    {
+        BTree from(path);
+        BTree to(tmp, from.page_size());
+        std::size_t n = 0;
+        from.for_each([&](std::string_view k, std::string_view v) {
+            to.put(k, v);
+            if(++n % 65536 == 0) to.commit(); // bounds the dirty pages held in memory
+        });
+        to.commit();
+    }
+    std::filesystem::rename(tmp, path);
+}
+
+inline CompactStats compact_library(const std::filesystem::path& root, const PackOptions& opts = {})
+{
+    CompactStats s;
+    s.bytes_before = directory_bytes(root);
+    if(std::filesystem::exists(root / "catalog") || std::filesystem::exists(root / "catalog.wal")) Catalog(root).checkpoint();
+    std::optional<std::vector<Digest>> roots = catalog_roots(root);
+    Environment env;
+    ContentStore store(env, root);
+    std::vector<Digest> all = store.objects();
+    s.objects_before = all.size();
+    s.objects_after = store.compact(roots ? *roots : all, opts).objects;
+    if(std::filesystem::exists(root / "meta")) compact_btree(root / "meta");
+    s.bytes_after = directory_bytes(root);
+    return s;
+}
+
+// SEARCH //
+// inverted index for library search over names and a text per name (docstring, notation, printed
+// type). postings are kept per byte trigram of the ASCII-lowercased strings, UTF-8 included as is
+// (a substring of the text is a substring of its bytes), separately for names and for text so name
+// hits rank first. names also have lists per byte and byte pair for one and two letter queries, text
+// one per non-ASCII code point for symbols too short for a trigram (α, ⟨).
+// substring queries intersect the lists of their grams and confirm each candidate; fuzzy queries
+// keep the names sharing enough trigrams with the query (k edits destroy at most 3k of them, or 2k
+// pairs or k bytes for queries too short to keep a trigram) and rank those by edit distance to
+// their closest substring (bit-parallel, Myers 1999).
+// documents are append only, erase() leaves a tombstone
+
+class SearchIndex
+{
+public:
+    using Doc = std::uint32_t;
+
+    struct Match
+    {
+        Doc doc;
+        std::uint32_t distance; // in bytes, so a non-ASCII symbol counts as up to 4 edits
+    };
+
+    Doc add(std::string_view name, std::string_view text = {})
+    {
+        Doc d = Doc(docs_.size());
+        docs_.push_back({chars_.size(), std::uint32_t(name.size()), std::uint32_t(text.size())});
+        chars_.append(name);
+        chars_.append(text);
+        erased_.push_back(false);
+        for(std::uint32_t g : grams(name, 1)) name_grams_[g].push_back(d);
+        for(std::uint32_t g : grams(text, 3)) text_grams_[g].push_back(d);
+        for(std::uint32_t k : symbols(text)) symbols_[k].push_back(d);
+        return d;
+    }
+
+    void erase(Doc d) { erased_.at(d) = true; }
+
+    std::size_t size() const { return docs_.size(); }
+    std::string_view name(Doc d) const { return std::string_view(chars_).substr(docs_[d].offset, docs_[d].name); }
+    std::string_view text(Doc d) const { return std::string_view(chars_).substr(docs_[d].offset + docs_[d].name, docs_[d].text); }
+
+    // documents containing q (ignoring ASCII case): names that contain it first, matches at the start
+    // of a name component and shorter names ahead, then those where only the text does
+    std::vector<Doc> find(std::string_view q, std::size_t limit = 50) const
+    {
+        std::string f = fold(q);
+        std::vector<Doc> out;
+        if(f.empty()) return out;
+
+        // ranked by (mid-component match, name length, doc); once `limit` are found, names that would
+        // rank past them even as component matches are not searched
+        std::vector<std::pair<std::uint64_t, Doc>> ranked;
+        std::uint64_t cutoff = UINT64_MAX;
+        for(Doc d : intersect(name_grams_, f))
+        {
+            std::uint64_t key = std::uint64_t(name(d).size()) << 32 | d;
+            if(erased_[d] || key > cutoff) continue;
+            std::size_t at = search(name(d), f);
+            if(at == std::string_view::npos) continue;
+            bool component = at == 0 || name(d)[at - 1] == '.' || name(d)[at - 1] == '_';
+            key |= std::uint64_t(!component) << 63;
+            if(key > cutoff) continue;
+            ranked.push_back({key, d});
+            if(limit > 0 && ranked.size() == 2 * limit)
+            {
+                std::nth_element(ranked.begin(), ranked.begin() + std::ptrdiff_t(limit - 1), ranked.end());
+                ranked.resize(limit);
+                cutoff = ranked[limit - 1].first;
+            }
+        }
+        std::size_t n = std::min(limit, ranked.size());
+        std::partial_sort(ranked.begin(), ranked.begin() + std::ptrdiff_t(n), ranked.end());
+        for(std::size_t i = 0; i < n; ++i) out.push_back(ranked[i].second);
+        if(out.size() == limit) return out;
+
+        std::vector<Doc> named(out.begin(), out.end()), in_text;
+        std::sort(named.begin(), named.end());
+        if(f.size() >= 3) in_text = intersect(text_grams_, f);
+        else if(auto it = symbols_.find(symbol(f)); it != symbols_.end()) in_text = it->second;
+        else if(std::uint8_t(f[0]) < 0x80) // one or two ASCII characters: every text is a candidate
+            for(Doc d = 0; d < docs_.size(); ++d) in_text.push_back(d);
+        for(Doc d : in_text)
+        {
+            if(out.size() == limit) break;
+            if(erased_[d] || std::binary_search(named.begin(), named.end(), d)) continue;
+            if(search(name(d), f) == std::string_view::npos && search(text(d), f) != std::string_view::npos) out.push_back(d);
+        }
+        return out;
+    }
+
+    // names within max_edits of a substring matching q, closest first
+    std::vector<Match> fuzzy(std::string_view q, std::uint32_t max_edits = 1, std::size_t limit = 50) const
+    {
+        std::string f = fold(q);
+        std::vector<Match> out;
+        if(f.empty()) return out;
+
+        // the longest grams of which the query keeps one through k edits; a query of k bytes or
+        // fewer is within k of every name, so then every name is a candidate
+        std::uint32_t k = max_edits, len = 3;
+        std::vector<std::uint32_t> qgrams = grams(f, len, len);
+        for(; len > 0 && qgrams.size() <= len * k; --len)
+            qgrams = len > 1 ? grams(f, len - 1, len - 1) : std::vector<std::uint32_t>{};
+        std::size_t need = qgrams.empty() ? 0 : qgrams.size() - len * k;
+
+        std::vector<std::uint16_t> shared(docs_.size());
+        std::vector<Doc> candidates;
+        if(need == 0)
+            for(Doc d = 0; d < docs_.size(); ++d) candidates.push_back(d);
+        for(std::uint32_t g : qgrams)
+        {
+            auto it = name_grams_.find(g);
+            if(it == name_grams_.end()) continue;
+            for(Doc d : it->second)
+                if(++shared[d] == need) candidates.push_back(d);
+        }
+
+        // ranked by (distance, name length, doc). names containing the query are found as find() finds
+        // them, at distance 0; the rest go most shared grams first: a name sharing c of them is at least
+        // (size - c) / len edits away, and one, so a name whose key with that bound already ranks past
+        // the `limit` best so far is skipped without computing its distance
+        std::vector<std::vector<Doc>> by_shared(qgrams.size() + 1);
+        for(Doc d : candidates)
+            if(!erased_[d]) by_shared[shared[d]].push_back(d);
+        Pattern pat(f);
+        std::vector<std::pair<std::uint64_t, Match>> ranked;
+        std::uint64_t cutoff = UINT64_MAX;
+        auto key = [&](std::uint32_t dist, Doc d) { return std::uint64_t(dist) << 48 | std::uint64_t(name(d).size()) << 32 | d; };
+        auto trim = [&] {
+            std::nth_element(ranked.begin(), ranked.begin() + std::ptrdiff_t(limit - 1), ranked.end(),
+                             [](const auto& a, const auto& b) { return a.first < b.first; });
+            ranked.resize(limit);
+            cutoff = ranked[limit - 1].first;
+        };
+        std::vector<bool> exact(docs_.size());
+        if(limit > 0)
+            for(Doc d : intersect(name_grams_, f))
+            {
+                if(erased_[d] || search(name(d), f) == std::string_view::npos) continue;
+                exact[d] = true;
+                if(key(0, d) > cutoff) continue;
+                ranked.push_back({key(0, d), {d, 0}});
+                if(ranked.size() == 2 * limit) trim();
+            }
+        if(ranked.size() >= limit && limit > 0) trim();
+        for(std::size_t c = qgrams.size() + 1; c-- > need && limit > 0;)
+        {
+            std::uint32_t bound = std::max(1u, len == 0 ? 0 : std::uint32_t(qgrams.size() - c + len - 1) / len);
+            if(cutoff < std::uint64_t(bound) << 48) break;
+            for(Doc d : by_shared[c])
+            {
+                if(exact[d] || key(bound, d) > cutoff) continue;
+                std::uint32_t dist = pat.distance(name(d));
+                if(dist > k || key(dist, d) > cutoff) continue;
+                ranked.push_back({key(dist, d), {d, dist}});
+                if(ranked.size() == 2 * limit) trim();
+            }
+            if(ranked.size() >= limit) trim();
+        }
+        std::size_t n = std::min(limit, ranked.size());
+        std::partial_sort(ranked.begin(), ranked.begin() + std::ptrdiff_t(n), ranked.end(),
+                          [](const auto& a, const auto& b) { return a.first < b.first; });
+        for(std::size_t i = 0; i < n; ++i) out.push_back(ranked[i].second);
+        return out;
+    }
+
+private:
+    using Postings = std::unordered_map<std::uint32_t, std::vector<Doc>>;
+
+    struct DocEntry
+    {
+        std::size_t offset;
+        std::uint32_t name, text;
+    };
+
+    static char lower(char c) { return c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c; }
+
+    static std::string fold(std::string_view s)
+    {
+        std::string r(s);
+        for(char& c : r) c = lower(c);
+        return r;
+    }
+
+    // the folded bytes s[i, i + n) with n in the top byte, so grams of different lengths share a table
+    static std::uint32_t gram(std::string_view s, std::size_t i, std::size_t n)
+    {
+        std::uint32_t g = 0;
+        for(std::size_t j = i; j < i + n; ++j) g = g << 8 | std::uint8_t(lower(s[j]));
+        return g | std::uint32_t(n) << 24;
+    }
+
+    // distinct grams of s from min_len to max_len bytes, sorted
+    static std::vector<std::uint32_t> grams(std::string_view s, std::size_t min_len, std::size_t max_len = 3)
+    {
+        std::vector<std::uint32_t> r;
+        for(std::size_t n = min_len; n <= max_len; ++n)
+            for(std::size_t i = 0; i + n <= s.size(); ++i) r.push_back(gram(s, i, n));
+        std::sort(r.begin(), r.end());
+        r.erase(std::unique(r.begin(), r.end()), r.end());
+        return r;
+    }
+
+    // the bytes of one code point, as a key
+    static std::uint32_t symbol(std::string_view s)
+    {
+        std::uint32_t k = 0;
+        for(char c : s) k = k << 8 | std::uint8_t(c);
+        return k;
+    }
+
+    // distinct non-ASCII code points of s
+    static std::vector<std::uint32_t> symbols(std::string_view s)
+    {
+        std::vector<std::uint32_t> keys;
+        for(std::size_t i = 0; i < s.size();)
+        {
+            std::uint8_t lead = std::uint8_t(s[i]);
+            std::size_t n = lead < 0x80 ? 1 : lead >= 0xf0 ? 4 : lead >= 0xe0 ? 3 : lead >= 0xc0 ? 2 : 1;
+            n = std::min(n, s.size() - i);
+            if(lead >= 0xc0) keys.push_back(symbol(s.substr(i, n)));
+            i += n;
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        return keys;
+    }
+
+    // docs in every list of q's longest grams, smallest list first
+    static std::vector<Doc> intersect(const Postings& index, std::string_view q)
+    {
+        std::vector<const std::vector<Doc>*> lists;
+        for(std::uint32_t g : grams(q, std::min<std::size_t>(q.size(), 3)))
+        {
+            auto it = index.find(g);
+            if(it == index.end()) return {};
+            lists.push_back(&it->second);
+        }
+        std::sort(lists.begin(), lists.end(), [](auto* a, auto* b) { return a->size() < b->size(); });
+        std::vector<Doc> r = *lists.front();
+        for(std::size_t i = 1; i < lists.size() && !r.empty(); ++i)
+        {
+            auto from = lists[i]->begin();
+            std::erase_if(r, [&](Doc d) {
+                from = std::lower_bound(from, lists[i]->end(), d);
+                return from == lists[i]->end() || *from != d;
+            });
+        }
+        return r;
+    }
+
+    // position of folded q in s, ignoring ASCII case
+    static std::size_t search(std::string_view s, std::string_view q)
+    {
+        auto it = std::search(s.begin(), s.end(), q.begin(), q.end(), [](char a, char b) { return lower(a) == b; });
+        return it == s.end() && !q.empty() ? std::string_view::npos : std::size_t(it - s.begin());
+    }
+
+    // smallest edit distance between a folded query and any substring of a name: one column of the
+    // dynamic programming table as bit vectors of +1 / -1 steps, a match may start anywhere.
+    // queries past 64 bytes fall back to the table itself
+    class Pattern
+    {
+    public:
+        explicit Pattern(std::string_view q) : q_(q)
+        {
+            if(q.size() > 64) return;
+            for(std::size_t i = 0; i < q.size(); ++i) peq_[std::uint8_t(q[i])] |= std::uint64_t(1) << i;
+        }
+
+        std::uint32_t distance(std::string_view s) const
+        {
+            std::size_t m = q_.size();
+            std::uint32_t score = std::uint32_t(m), best = score;
+            if(m > 64)
+            {
+                std::vector<std::uint32_t> row(m + 1);
+                for(std::size_t i = 0; i <= m; ++i) row[i] = std::uint32_t(i);
+                for(char c : s)
+                {
+                    std::uint32_t diag = 0;
+                    for(std::size_t i = 1; i <= m; ++i)
+                    {
+                        std::uint32_t up = row[i];
+                        row[i] = std::min({up + 1, row[i - 1] + 1, diag + (lower(c) == q_[i - 1] ? 0u : 1u)});
+                        diag = up;
+                    }
+                    best = std::min(best, row[m]);
+                }
+                return best;
+            }
+            std::uint64_t high = std::uint64_t(1) << (m - 1), pv = ~std::uint64_t(0), mv = 0;
+            for(char c : s)
+            {
+                std::uint64_t eq = peq_[std::uint8_t(lower(c))];
+                std::uint64_t xv = eq | mv, xh = (((eq & pv) + pv) ^ pv) | eq;
+                std::uint64_t ph = mv | ~(xh | pv), mh = pv & xh;
+                if(ph & high) ++score;
+                else if(mh & high) --score;
+                ph <<= 1; // the top row is all zeros: no carry in
+                mh <<= 1;
+                pv = mh | ~(xv | ph);
+                mv = ph & xv;
+                best = std::min(best, score);
+            }
+            return best;
+        }
+
+    private:
+        std::string_view q_;
+        std::array<std::uint64_t, 256> peq_{};
+    };
+
+    std::string chars_;
+    std::vector<DocEntry> docs_;
+    std::vector<bool> erased_;
+    Postings name_grams_, text_grams_, symbols_;
+};
+
+// every name of a catalog version, with its metadata as the text
+inline SearchIndex search_index(const CatalogSnapshot& s)
+{
+    SearchIndex ix;
+    s.for_each([&](std::string_view name, const CatalogEntry& e) { ix.add(name, e.meta); });
+    return ix;
+}
+
+// LEMMA INDEX //
+// a LemmaIndex on disk: magic, version, declarations covered, key (u64), crc32 of the covered
+// declarations' names, names (length, chars), then per node its edges (kind byte, arity, name or 0,
+// child) and values (name, use byte), other integers little endian u32, and a crc32 of all of it.
+// constants are stored by name, so the file does not depend on how a pool numbers them. key is the
+// caller's fingerprint of what built env, as for open_snapshot (the types behind the names); loading
+// refuses another key, or an environment whose first declarations have other names than those the
+// index covers
+
+constexpr char lemma_index_magic[8] = {'V', 'L', 'L', 'E', 'M', 'M', 'A', 0};
+constexpr std::uint32_t lemma_index_version = 2;
+
+namespace detail {
+
+// the names of env's first n declarations, each with its terminating 0
+inline std::uint32_t names_crc(const Environment& env, std::size_t n)
+{
+    std::uint32_t crc = 0;
+    for(std::size_t i = 0; i < n; ++i)
+    {
+        std::string_view s = env.pool.names.view(env.decls()[i].name);
+        crc = crc32(std::string_view(s.data(), s.size() + 1), crc);
+    }
+    return crc;
+}
+
+} // namespace detail
+
+inline void save_lemma_index(const LemmaIndex& ix, const Environment& env, const std::filesystem::path& path, std::uint64_t key)
+{
+    const Pool& p = env.pool;
+    std::vector<Name> names;
+    std::unordered_map<Name, std::uint32_t> slot;
+    auto name = [&](Name n) {
+        auto [it, fresh] = slot.emplace(n, std::uint32_t(names.size()));
+        if(fresh) names.push_back(n);
+        return it->second;
+    };
+    std::size_t covered = ix.indexed();
+
+    std::string body;
+    detail::put_u32(body, std::uint32_t(ix.nodes().size()));
+    for(const LemmaIndex::Node& n : ix.nodes())
+    {
+        detail::put_u32(body, std::uint32_t(n.edges.size()));
+        for(const LemmaIndex::Edge& e : n.edges)
+        {
+            if(e.key.kind() == KeyKind::Local) throw storage_exception("lemma index with a free variable");
+            body += char(e.key.kind());
+            detail::put_u32(body, e.key.arity());
+            detail::put_u32(body, e.key.kind() == KeyKind::Const ? name(e.key.id()) : 0);
+            detail::put_u32(body, e.child);
+        }
+        detail::put_u32(body, std::uint32_t(n.values.size()));
+        for(const LemmaMatch& v : n.values)
+        {
+            detail::put_u32(body, name(v.name));
+            body += char(v.use);
+        }
+    }
+
+    std::string out(lemma_index_magic, sizeof(lemma_index_magic));
+    detail::put_u32(out, lemma_index_version);
+    detail::put_u32(out, std::uint32_t(covered));
+    detail::put_u64(out, key);
+    detail::put_u32(out, detail::names_crc(env, covered));
+    detail::put_u32(out, std::uint32_t(names.size()));
+    for(Name n : names)
+    {
+        std::string_view s = p.names.view(n);
+        detail::put_u32(out, std::uint32_t(s.size()));
+        out += s;
+    }
+    out += body;
+    detail::put_u32(out, crc32(out));
+
+    std::filesystem::path tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        f.write(out.data(), std::streamsize(out.size()));
+        if(!f) throw storage_exception("cannot write '" + tmp.string() + "'");
+    }
+    std::filesystem::rename(tmp, path);
+}
+
+// ix must be over env; afterwards ix.update() enters only what env declared past the saved index
+inline void load_lemma_index(LemmaIndex& ix, Environment& env, const std::filesystem::path& path, std::uint64_t key)
+{
+    std::ifstream f(path, std::ios::binary);
+    if(!f) throw storage_exception("cannot open '" + path.string() + "'");
+    std::string bytes{std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()};
+    if(bytes.size() < sizeof(lemma_index_magic) + 4 || std::memcmp(bytes.data(), lemma_index_magic, sizeof(lemma_index_magic)) != 0)
+        throw storage_exception("'" + path.string() + "' is not a lemma index");
+    std::string_view all(bytes);
+    if(crc32(all.substr(0, all.size() - 4)) != detail::get_u32(all.substr(all.size() - 4)))
+        throw storage_exception("corrupt lemma index '" + path.string() + "'");
+
+    detail::ObjectReader r(all.substr(sizeof(lemma_index_magic), all.size() - sizeof(lemma_index_magic) - 4), "lemma index '" + path.string() + "'");
+    if(r.u32() != lemma_index_version) throw storage_exception("'" + path.string() + "' was written by an incompatible version");
+    std::size_t covered = r.u32();
+    std::uint64_t saved_key = detail::get_u64(r.take(8));
+    std::uint32_t crc = r.u32();
+    if(saved_key != key || covered > env.decls().size() || detail::names_crc(env, covered) != crc)
+        throw storage_exception("'" + path.string() + "' indexes another environment");
+    std::vector<Name> names(r.u32());
+    for(Name& n : names) n = env.pool.names.intern(r.take(r.u32()));
+
+    std::vector<LemmaIndex::Node> nodes(r.u32());
+    for(LemmaIndex::Node& n : nodes)
+    {
+        n.edges.resize(r.u32());
+        for(LemmaIndex::Edge& e : n.edges)
+        {
+            auto kind = KeyKind(r.u8());
+            if(kind > KeyKind::Const) r.fail();
+            std::uint32_t arity = r.u32();
+            e.key = DiscrKey(kind, arity, kind == KeyKind::Const ? names[r.index(names.size())] : r.index(1));
+            e.child = r.index(nodes.size());
+        }
+        n.values.resize(r.u32());
+        for(LemmaMatch& v : n.values)
+        {
+            v.name = names[r.index(names.size())];
+            v.use = LemmaUse(r.u8());
+            if(v.use > LemmaUse::RewriteReverse) r.fail();
+        }
+    }
+    if(!r.done()) r.fail();
+    ix.restore(std::move(nodes), covered);
+}
+
+// SIMILARITY //
+// near-duplicate declarations by the shape of their terms. the shingles of a term are the hashes of
+// its subterms cut off at depth 3, normalized so renaming changes nothing: bound variables by de
+// Bruijn index, constants by the string of their name, binder names and infos, universe levels and
+// free variables left out. a MinHash signature keeps the minimum of each of minhash_size hash
+// functions over the shingles, so the fraction of equal entries of two signatures estimates the
+// Jaccard similarity of their shingle sets. LSH: a signature is cut into lsh_bands bands of lsh_rows
+// entries and declarations sharing a band are candidates (likely from about (1 / bands)^(1 / rows)
+// = 0.5 similarity on), looked up by binary search in one table per band sorted by band hash.
+// file: magic, version, count, per declaration its name (u32 size, chars) and signature, crc32
+
+constexpr std::size_t minhash_size = 64, lsh_bands = 16, lsh_rows = minhash_size / lsh_bands;
+using MinHash = std::array<std::uint32_t, minhash_size>;
+
+constexpr char similar_magic[8] = {'V', 'L', 'S', 'I', 'M', 'I', 'L', 0};
+constexpr std::uint32_t similar_version = 1;
+
+namespace detail {
+
+class ShapeHasher
+{
+public:
+    explicit ShapeHasher(const Pool& p) : p_(p) {}
+
+    // the shingles of the subterms of e not in seen yet
+    void shingles(Expr e, std::unordered_set<Expr>& seen, std::vector<std::uint64_t>& out)
+    {
+        std::vector<Expr> todo{e};
+        while(!todo.empty())
+        {
+            Expr x = todo.back(); todo.pop_back();
+            if(!seen.insert(x).second) continue;
+            out.push_back(shape(x)[2]);
+            const ExprNode& n = p_[x];
+            switch(n.kind)
+            {
+                case ExprKind::App: todo.push_back(n.a); todo.push_back(n.b); break;
+                case ExprKind::Lam: case ExprKind::Pi: todo.push_back(n.b); todo.push_back(n.c); break;
+                case ExprKind::Let: todo.push_back(n.b); todo.push_back(n.c); todo.push_back(n.d); break;
+                default: break;
+            }
+        }
+    }
+
+private:
+    using Shape = std::array<std::uint64_t, 3>; // cut off at depth 1, 2, 3
+
+    const Shape& shape(Expr e)
+    {
+        if(auto it = memo_.find(e); it != memo_.end()) return it->second;
+        const ExprNode& n = p_[e];
+        std::uint64_t label = std::uint64_t(n.kind) + 1;
+        if(n.kind == ExprKind::BVar) label = mix(label, n.a);
+        if(n.kind == ExprKind::Const) label = mix(label, NameTable::hash(p_.names.view(n.a)));
+        Expr kids[3];
+        std::size_t nkids = 0;
+        switch(n.kind)
+        {
+            case ExprKind::App: kids[0] = n.a, kids[1] = n.b, nkids = 2; break;
+            case ExprKind::Lam: case ExprKind::Pi: kids[0] = n.b, kids[1] = n.c, nkids = 2; break;
+            case ExprKind::Let: kids[0] = n.b, kids[1] = n.c, kids[2] = n.d, nkids = 3; break;
+            default: break;
+        }
+        Shape s{label, label, label};
+        for(std::size_t i = 0; i < nkids; ++i)
+        {
+            const Shape& k = shape(kids[i]);
+            s[1] = mix(s[1], k[0]);
+            s[2] = mix(s[2], k[1]);
+        }
+        return memo_.emplace(e, s).first->second;
+    }
+
+    const Pool& p_;
+    std::unordered_map<Expr, Shape> memo_;
+};
+
+} // namespace detail
+
+// h_i(x) = high half of a_i x + b_i, one multiply per function and shingle
+inline MinHash minhash(std::span<const std::uint64_t> shingles)
+{
+    static const auto coef = [] {
+        std::array<std::pair<std::uint64_t, std::uint64_t>, minhash_size> c{};
+        for(std::size_t i = 0; i < minhash_size; ++i) c[i] = {mix(i, 0x5151) | 1, mix(i, 0xB0B0)};
+        return c;
+    }();
+    MinHash sig;
+    sig.fill(UINT32_MAX);
+    for(std::uint64_t x : shingles)
+        for(std::size_t i = 0; i < minhash_size; ++i)
+            sig[i] = std::min(sig[i], std::uint32_t((coef[i].first * x + coef[i].second) >> 32));
+    return sig;
+}
+
+class SimilarityIndex
+{
+public:
+    using Doc = std::uint32_t;
+
+    struct Match
+    {
+        Doc doc;
+        double similarity;
+    };
+
+    static double similarity(const MinHash& a, const MinHash& b)
+    {
+        std::size_t same = 0;
+        for(std::size_t i = 0; i < minhash_size; ++i) same += a[i] == b[i];
+        return double(same) / double(minhash_size);
+    }
+
+    Doc add(std::string_view name, const MinHash& sig)
+    {
+        Doc d = Doc(sigs_.size());
+        offsets_.push_back(chars_.size());
+        chars_ += name;
+        sigs_.push_back(sig);
+        for(std::size_t b = 0; b < lsh_bands; ++b) bands_[b].push_back({band(sig, b), d});
+        return d;
+    }
+
+    std::size_t size() const { return sigs_.size(); }
+    std::string_view name(Doc d) const
+    {
+        std::size_t end = d + 1 < offsets_.size() ? offsets_[d + 1] : chars_.size();
+        return std::string_view(chars_).substr(offsets_[d], end - offsets_[d]);
+    }
+    const MinHash& signature(Doc d) const { return sigs_[d]; }
+
+    // documents sharing a band with sig and estimated at least threshold similar, most similar first
+    std::vector<Match> similar(const MinHash& sig, double threshold = 0.5, std::size_t limit = 20) const
+    {
+        sort();
+        std::vector<Doc> cands;
+        for(std::size_t b = 0; b < lsh_bands; ++b)
+        {
+            auto [lo, hi] = std::equal_range(bands_[b].begin(), bands_[b].end(), std::pair{band(sig, b), Doc(0)},
+                                             [](const auto& x, const auto& y) { return x.first < y.first; });
+            for(auto it = lo; it != hi; ++it) cands.push_back(it->second);
+        }
+        std::sort(cands.begin(), cands.end());
+        cands.erase(std::unique(cands.begin(), cands.end()), cands.end());
+        std::vector<Match> out;
+        for(Doc d : cands)
+            if(double s = similarity(sig, sigs_[d]); s >= threshold) out.push_back({d, s});
+        std::sort(out.begin(), out.end(), [](const Match& a, const Match& b) { return a.similarity != b.similarity ? a.similarity > b.similarity : a.doc < b.doc; });
+        if(out.size() > limit) out.resize(limit);
+        return out;
+    }
+
+    // groups of at least two documents joined by estimated similarity >= threshold, for a batch
+    // pass over the whole index: each member of a bucket is compared with the bucket's first only,
+    // so the work is linear in the buckets. groups and their members in document order
+    std::vector<std::vector<Doc>> duplicates(double threshold = 0.9) const
+    {
+        sort();
+        std::vector<Doc> parent(sigs_.size());
+        for(Doc d = 0; d < parent.size(); ++d) parent[d] = d;
+        auto root = [&](Doc d) {
+            while(parent[d] != d) d = parent[d] = parent[parent[d]];
+            return d;
+        };
+        for(const auto& table : bands_)
+            for(std::size_t i = 0; i < table.size();)
+            {
+                std::size_t j = i + 1;
+                for(; j < table.size() && table[j].first == table[i].first; ++j)
+                {
+                    Doc a = root(table[i].second), b = root(table[j].second);
+                    if(a != b && similarity(sigs_[table[i].second], sigs_[table[j].second]) >= threshold) parent[std::max(a, b)] = std::min(a, b);
+                }
+                i = j;
+            }
+        std::vector<std::vector<Doc>> groups;
+        std::vector<std::uint32_t> group(sigs_.size(), no_slot);
+        for(Doc d = 0; d < parent.size(); ++d)
+        {
+            Doc r = root(d);
+            if(r == d) continue;
+            if(group[r] == no_slot)
+            {
+                group[r] = std::uint32_t(groups.size());
+                groups.push_back({r});
+            }
+            groups[group[r]].push_back(d);
+        }
+        return groups;
+    }
+
+private:
+    static std::uint32_t band(const MinHash& sig, std::size_t b)
+    {
+        std::uint64_t h = b;
+        for(std::size_t i = b * lsh_rows; i < (b + 1) * lsh_rows; ++i) h = mix(h, sig[i]);
+        return std::uint32_t(h);
+    }
+
+    // documents added since the last lookup are sorted and merged in
+    void sort() const
+    {
+        if(sorted_ == sigs_.size()) return;
+        for(auto& table : bands_)
+        {
+            auto mid = table.begin() + std::ptrdiff_t(sorted_);
+            std::sort(mid, table.end());
+            std::inplace_merge(table.begin(), mid, table.end());
+        }
+        sorted_ = sigs_.size();
+    }
+
+    std::string chars_;
+    std::vector<std::size_t> offsets_;
+    std::vector<MinHash> sigs_;
+    mutable std::array<std::vector<std::pair<std::uint32_t, Doc>>, lsh_bands> bands_; // band hash, doc
+    mutable std::size_t sorted_ = 0;
+};
+
+// adds the axioms, definitions and theorems of env from first on, by their statements (and the
+// values of definitions, whose type alone says little); the generated declarations of inductive
+// types are left out
+inline void add_signatures(SimilarityIndex& ix, const Environment& env, std::size_t first = 0)
+{
+    detail::ShapeHasher h(env.pool);
+    std::unordered_set<Expr> seen;
+    std::vector<std::uint64_t> shingles;
+    for(const Declaration& d : env.decls().subspan(std::min(first, env.decls().size())))
+    {
+        if(d.kind != DeclKind::Axiom && d.kind != DeclKind::Definition && d.kind != DeclKind::Theorem && d.kind != DeclKind::Opaque) continue;
+        seen.clear();
+        shingles.clear();
+        h.shingles(d.type, seen, shingles);
+        if(d.kind != DeclKind::Theorem && d.value != no_expr) h.shingles(d.value, seen, shingles);
+        ix.add(env.pool.names.view(d.name), minhash(shingles));
+    }
+}
+
+inline void save_similarity_index(const SimilarityIndex& ix, const std::filesystem::path& path)
+{
+    std::string out(similar_magic, sizeof(similar_magic));
+    detail::put_u32(out, similar_version);
+    detail::put_u32(out, std::uint32_t(ix.size()));
+    for(SimilarityIndex::Doc d = 0; d < ix.size(); ++d)
+    {
+        std::string_view name = ix.name(d);
+        detail::put_u32(out, std::uint32_t(name.size()));
+        out += name;
+        for(std::uint32_t v : ix.signature(d)) detail::put_u32(out, v);
+    }
+    detail::put_u32(out, crc32(out));
+
+    std::filesystem::path tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        f.write(out.data(), std::streamsize(out.size()));
+        if(!f) throw storage_exception("cannot write '" + tmp.string() + "'");
+    }
+    std::filesystem::rename(tmp, path);
+}
+
+inline SimilarityIndex load_similarity_index(const std::filesystem::path& path)
+{
+    std::ifstream f(path, std::ios::binary);
+    if(!f) throw storage_exception("cannot open '" + path.string() + "'");
+    std::string bytes{std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()};
+    if(bytes.size() < sizeof(similar_magic) + 4 || std::memcmp(bytes.data(), similar_magic, sizeof(similar_magic)) != 0)
+        throw storage_exception("'" + path.string() + "' is not a similarity index");
+    std::string_view all(bytes);
+    if(crc32(all.substr(0, all.size() - 4)) != detail::get_u32(all.substr(all.size() - 4)))
+        throw storage_exception("corrupt similarity index '" + path.string() + "'");
+
+    detail::ObjectReader r(all.substr(sizeof(similar_magic), all.size() - sizeof(similar_magic) - 4), "similarity index '" + path.string() + "'");
+    if(r.u32() != similar_version) throw storage_exception("'" + path.string() + "' was written by an incompatible version");
+    SimilarityIndex ix;
+    for(std::uint32_t n = r.u32(); n > 0; --n)
+    {
+        std::string_view name = r.take(r.u32());
+        MinHash sig;
+        for(std::uint32_t& v : sig) v = r.u32();
+        ix.add(name, sig);
+    }
+    if(!r.done()) r.fail();
+    return ix;
+}
+
+} // namespace vl
+
+#endif // STORAGE_HPP
@@ -0,0 +1,664 @@
+// type_checker.hpp - environment, infer / whnf / definitional equality, quotients
+// the trusted part: everything that decides whether a term has a type lives here
+// (c) 2025 Zachary R. James
+
+#ifndef TYPE_CHECKER_HPP
+#define TYPE_CHECKER_HPP
+
+#include "types.hpp"
+
+#include <algorithm>
+#include <array>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace vl {
+
+// bump with any change to what the kernel accepts or derives: type checking, reduction, the
+// inductive compiler and its recursors, the equation compiler. environments saved as trusted
+// (startup snapshots) under another version are rebuilt and checked again
+constexpr std::uint64_t kernel_version = 2;
+
+// DECLARATIONS //
+
+enum class DeclKind : std::uint8_t { Axiom, Definition, Theorem, Opaque, Quot, Inductive, Constructor, Recursor };
+enum class QuotKind : std::uint8_t { None, Type, Mk, Lift, Ind };
+
+// I.rec params motives minors (c params fields) ↦ rhs params motives minors fields
+struct RecRule
+{
+    Name ctor;
+    std::uint32_t nfields;
+    Expr rhs; // fun params motives minors fields => minor fields ihs
+};
+
+struct Declaration
+{
+    DeclKind kind = DeclKind::Axiom;
+    Name name = 0;
+    std::vector<Name> lparams;  // universe params
+    Expr type = no_expr;
+    Expr value = no_expr;       // Definition / Theorem / Opaque
+    std::uint32_t height = 0;   // definitional height, drives lazy delta in is_def_eq
+    QuotKind quot = QuotKind::None;
+
+    // inductive families (see add_inductive in checker.hpp)
+    std::uint32_t nparams = 0, nindices = 0; // Inductive, Constructor (nparams), Recursor
+    std::uint32_t nmotives = 0, nminors = 0; // Recursor
+    std::uint32_t cidx = 0, nfields = 0;     // Constructor: position in its type, number of fields
+    Name induct = 0;                         // Constructor / Recursor: the inductive type
+    std::vector<Name> all;                   // Inductive / Recursor: every type of the mutual block
+    std::vector<Name> ctors;                 // Inductive
+    std::vector<RecRule> rules;              // Recursor: one per constructor of induct, by cidx
+    bool is_rec = false;                     // Inductive
+    bool k = false;                          // Recursor: K-like (Prop, one ctor, no fields)
+
+    bool unfoldable() const { return kind == DeclKind::Definition || kind == DeclKind::Theorem; }
+    std::uint32_t major_idx() const { return nparams + nmotives + nminors + nindices; }
+};
+
+class Environment
+{
+public:
+    Pool pool;
+
+    const Declaration* find(Name n) const
+    {
+        auto it = index_.find(n);
+        return it == index_.end() ? nullptr : &decls_[it->second];
+    }
+
+    const Declaration& get(Name n) const
+    {
+        if(auto d = find(n)) return *d;
+        throw kernel_exception("unknown constant '" + pool.names.str(n) + "'");
+    }
+
+    // unchecked insert, see checker.hpp for the checked entry points
+    void add(Declaration d)
+    {
+        if(index_.contains(d.name)) throw kernel_exception("already declared '" + pool.names.str(d.name) + "'");
+        index_.emplace(d.name, std::uint32_t(decls_.size()));
+        decls_.push_back(std::move(d));
+    }
+
+    std::span<const Declaration> decls() const { return decls_; }
+
+    // drop every declaration added after the first n (undo of a failed block)
+    void truncate(std::size_t n)
+    {
+        while(decls_.size() > n) { index_.erase(decls_.back().name); decls_.pop_back(); }
+    }
+
+    // recursor rules specialized to concrete universe levels, keyed by (rhs, level list)
+    Expr rule_rhs(const RecRule& rule, const Declaration& rec, Expr rec_const)
+    {
+        std::uint64_t key = std::uint64_t(rule.rhs) << 32 | pool[rec_const].b;
+        if(auto it = rule_cache_.find(key); it != rule_cache_.end()) return it->second;
+        std::vector<Level> ls(pool.const_levels(rec_const).begin(), pool.const_levels(rec_const).end());
+        Expr r = pool.instantiate_lparams(rule.rhs, rec.lparams, ls);
+        rule_cache_.emplace(key, r);
+        return r;
+    }
+
+    // quotient support (see add_quot)
+    bool quot_initialized = false;
+    Name quot_mk = 0, quot_lift = 0, quot_ind = 0;
+
+private:
+    std::vector<Declaration> decls_;
+    std::unordered_map<Name, std::uint32_t> index_;
+    std::unordered_map<std::uint64_t, Expr> rule_cache_;
+};
+
+// TYPE CHECKER //
+
+struct LocalDecl
+{
+    Name name;
+    Expr type;
+    BinderInfo binfo;
+};
+
+class TypeChecker
+{
+public:
+    explicit TypeChecker(Environment& env, std::span<const Name> lparams = {})
+        : env_(env), p_(env.pool), lparams_(lparams) {}
+
+    Environment& env() { return env_; }
+
+    // locals //
+
+    Expr mk_local(Name n, Expr type, BinderInfo bi = BinderInfo::Default)
+    {
+        Expr x = p_.fresh_fvar();
+        lctx_.emplace(p_[x].a, LocalDecl{n, type, bi});
+        return x;
+    }
+    Expr mk_local(std::string_view n, Expr type, BinderInfo bi = BinderInfo::Default)
+    { return mk_local(p_.names.intern(n), type, bi); }
+
+    const LocalDecl& local(Expr x) const
+    {
+        auto it = lctx_.find(p_[x].a);
+        if(it == lctx_.end()) throw kernel_exception("unknown free variable");
+        return it->second;
+    }
+
+    // (x1 : A1) → ... → body, abstracting the given locals
+    Expr mk_pi(std::span<const Expr> xs, Expr body) { return close(ExprKind::Pi, xs, body); }
+    Expr mk_lambda(std::span<const Expr> xs, Expr body) { return close(ExprKind::Lam, xs, body); }
+
+    std::string to_string(Expr e) const
+    {
+        return p_.to_string(e, [this](std::uint32_t id) {
+            auto it = lctx_.find(id);
+            return it == lctx_.end() ? "_fv" + std::to_string(id) : p_.names.str(it->second.name);
+        });
+    }
+
+    // inference //
+
+    // infer the type of e, fully checking it
+    Expr check(Expr e) { return infer_core(e, false); }
+
+    // infer the type of e assuming e is well typed
+    Expr infer(Expr e) { return infer_core(e, true); }
+
+    Expr ensure_sort(Expr t)
+    {
+        if(p_.kind(t) == ExprKind::Sort) return t;
+        Expr w = whnf(t);
+        if(p_.kind(w) == ExprKind::Sort) return w;
+        throw kernel_exception("type expected, got " + to_string(t));
+    }
+
+    Expr ensure_pi(Expr t)
+    {
+        if(p_.kind(t) == ExprKind::Pi) return t;
+        Expr w = whnf(t);
+        if(p_.kind(w) == ExprKind::Pi) return w;
+        throw kernel_exception("function expected, got " + to_string(t));
+    }
+
+    bool is_prop(Expr type) { return whnf(infer(type)) == p_.sort(p_.levels.zero()); }
+
+    // reduction //
+
+    // weak head normal form without unfolding definitions
+    Expr whnf_core(Expr e)
+    {
+        switch(p_.kind(e))
+        {
+            case ExprKind::BVar: case ExprKind::FVar: case ExprKind::Sort: case ExprKind::Const:
+            case ExprKind::Lam: case ExprKind::Pi:
+                return e;
+            case ExprKind::Let:
+                return whnf_core(p_.instantiate(p_[e].d, p_[e].c));
+            case ExprKind::App: break;
+        }
+        if(auto it = whnf_core_cache_.find(e); it != whnf_core_cache_.end()) return it->second;
+
+        std::vector<Expr> args;
+        Expr f0 = p_.app_args(e, args);
+        Expr f = whnf_core(f0);
+        Expr r = e;
+        if(p_.kind(f) == ExprKind::Lam)
+        {
+            // beta: consume as many args as there are leading lambdas in one substitution
+            std::size_t m = 0;
+            while(p_.kind(f) == ExprKind::Lam && m < args.size()) { f = p_[f].c; ++m; }
+            Expr body = p_.instantiate_rev(f, std::span<const Expr>(args.data(), m));
+            r = whnf_core(p_.app(body, std::span<const Expr>(args.data() + m, args.size() - m)));
+        }
+        else if(f == f0)
+        {
+            if(Expr red = reduce_rec(f, args); red != no_expr) r = whnf_core(red);
+            else if(Expr red = reduce_quot(f, args); red != no_expr) r = whnf_core(red);
+        }
+        else r = whnf_core(p_.app(f, args));
+
+        whnf_core_cache_.emplace(e, r);
+        return r;
+    }
+
+    Expr whnf(Expr e)
+    {
+        switch(p_.kind(e))
+        {
+            case ExprKind::BVar: case ExprKind::FVar: case ExprKind::Sort: case ExprKind::Lam: case ExprKind::Pi:
+                return e;
+            default: break;
+        }
+        if(auto it = whnf_cache_.find(e); it != whnf_cache_.end()) return it->second;
+        Expr t = e;
+        for(;;)
+        {
+            t = whnf_core(t);
+            Expr u = unfold(t);
+            if(u == no_expr) break;
+            t = u;
+        }
+        whnf_cache_.emplace(e, t);
+        return t;
+    }
+
+    // δ-unfold the head constant of e, no_expr exactly when delta_decl(e) is null
+    Expr unfold(Expr e)
+    {
+        const Declaration* d = delta_decl(e);
+        if(!d) return no_expr;
+        std::vector<Expr> args;
+        Expr f = p_.app_args(e, args);
+        std::vector<Level> ls(p_.const_levels(f).begin(), p_.const_levels(f).end());
+        return p_.app(p_.instantiate_lparams(d->value, d->lparams, ls), args);
+    }
+
+    // definitional equality //
+
+    bool is_def_eq(Expr t, Expr s)
+    {
+        if(t == s) return true;
+        std::uint64_t key = t < s ? std::uint64_t(t) << 32 | s : std::uint64_t(s) << 32 | t;
+        if(eq_cache_.contains(key)) return true;
+        bool r = is_def_eq_core(t, s);
+        if(r) eq_cache_.insert(key);
+        return r;
+    }
+
+private:
+    Expr close(ExprKind k, std::span<const Expr> xs, Expr body)
+    {
+        Expr r = p_.abstract(body, xs);
+        for(std::size_t i = xs.size(); i-- > 0;)
+        {
+            const LocalDecl& d = local(xs[i]);
+            Expr dom = p_.abstract(d.type, xs.first(i));
+            r = k == ExprKind::Pi ? p_.pi(d.name, dom, r, d.binfo) : p_.lam(d.name, dom, r, d.binfo);
+        }
+        return r;
+    }
+
+    void check_level(Level l)
+    {
+        const LevelNode n = p_.levels[l];
+        switch(n.kind)
+        {
+            case LevelKind::Param:
+                if(std::find(lparams_.begin(), lparams_.end(), n.a) == lparams_.end())
+                    throw kernel_exception("undeclared universe '" + p_.names.str(n.a) + "'");
+                break;
+            case LevelKind::Succ: check_level(n.a); break;
+            case LevelKind::Max: case LevelKind::IMax: check_level(n.a); check_level(n.b); break;
+            default: break;
+        }
+    }
+
+    Expr infer_core(Expr e, bool infer_only)
+    {
+        auto& cache = infer_only ? infer_cache_ : check_cache_;
+        if(auto it = cache.find(e); it != cache.end()) return it->second;
+
+        const ExprNode n = p_[e];
+        Expr r = no_expr;
+        switch(n.kind)
+        {
+            case ExprKind::BVar: throw kernel_exception("unexpected bound variable");
+            case ExprKind::FVar: r = local(e).type; break;
+            case ExprKind::Sort:
+                if(!infer_only) check_level(n.a);
+                r = p_.sort(p_.levels.succ(n.a));
+                break;
+            case ExprKind::Const:
+            {
+                const Declaration& d = env_.get(n.a);
+                std::vector<Level> ls(p_.const_levels(e).begin(), p_.const_levels(e).end());
+                if(ls.size() != d.lparams.size())
+                    throw kernel_exception("wrong number of universe levels for '" + p_.names.str(n.a) + "'");
+                if(!infer_only) for(Level l : ls) check_level(l);
+                r = p_.instantiate_lparams(d.type, d.lparams, ls);
+                break;
+            }
+            case ExprKind::App: r = infer_app(e, infer_only); break;
+            case ExprKind::Lam: r = infer_lambda(e, infer_only); break;
+            case ExprKind::Pi: r = infer_pi(e, infer_only); break;
+            case ExprKind::Let:
+            {
+                if(!infer_only)
+                {
+                    ensure_sort(infer_core(n.b, false));
+                    Expr vt = infer_core(n.c, false);
+                    if(!is_def_eq(vt, n.b)) throw kernel_exception("let value type mismatch");
+                }
+                r = infer_core(p_.instantiate(n.d, n.c), infer_only);
+                break;
+            }
+        }
+        cache.emplace(e, r);
+        return r;
+    }
+
+    Expr infer_app(Expr e, bool infer_only)
+    {
+        std::vector<Expr> args;
+        Expr f = p_.app_args(e, args);
+        Expr ft = infer_core(f, infer_only);
+        // walk the pi telescope, instantiating lazily in batches (one substitution per whnf)
+        std::size_t j = 0;
+        for(std::size_t i = 0; i < args.size(); ++i)
+        {
+            if(p_.kind(ft) != ExprKind::Pi)
+            {
+                ft = ensure_pi(p_.instantiate_rev(ft, std::span<const Expr>(args.data() + j, i - j)));
+                j = i;
+            }
+            if(!infer_only)
+            {
+                Expr dom = p_.instantiate_rev(p_[ft].b, std::span<const Expr>(args.data() + j, i - j));
+                Expr at = infer_core(args[i], false);
+                if(!is_def_eq(at, dom))
+                    throw kernel_exception("application type mismatch: " + to_string(args[i]) + " : " + to_string(at) +
+                                           " but expected " + to_string(dom));
+            }
+            ft = p_[ft].c;
+        }
+        return p_.instantiate_rev(ft, std::span<const Expr>(args.data() + j, args.size() - j));
+    }
+
+    Expr infer_lambda(Expr e, bool infer_only)
+    {
+        std::vector<Expr> xs;
+        while(p_.kind(e) == ExprKind::Lam)
+        {
+            const ExprNode n = p_[e];
+            Expr dom = p_.instantiate_rev(n.b, xs);
+            if(!infer_only) ensure_sort(infer_core(dom, false));
+            xs.push_back(mk_local(n.a, dom, n.binfo));
+            e = n.c;
+        }
+        Expr body = p_.instantiate_rev(e, xs);
+        return mk_pi(xs, infer_core(body, infer_only));
+    }
+
+    Expr infer_pi(Expr e, bool infer_only)
+    {
+        std::vector<Expr> xs;
+        std::vector<Level> us;
+        while(p_.kind(e) == ExprKind::Pi)
+        {
+            const ExprNode n = p_[e];
+            Expr dom = p_.instantiate_rev(n.b, xs);
+            us.push_back(p_[ensure_sort(infer_core(dom, infer_only))].a);
+            xs.push_back(mk_local(n.a, dom, n.binfo));
+            e = n.c;
+        }
+        Expr body = p_.instantiate_rev(e, xs);
+        Level l = p_[ensure_sort(infer_core(body, infer_only))].a;
+        for(std::size_t i = us.size(); i-- > 0;) l = p_.levels.imax(us[i], l);
+        return p_.sort(l);
+    }
+
+    // ι: I.rec params motives minors indices (c params fields) extra ↦ rule.rhs params motives minors fields extra
+    Expr reduce_rec(Expr f, std::span<const Expr> args)
+    {
+        if(p_.kind(f) != ExprKind::Const) return no_expr;
+        const Declaration* rec = env_.find(p_[f].a);
+        if(!rec || rec->kind != DeclKind::Recursor) return no_expr;
+        std::uint32_t mi = rec->major_idx();
+        if(args.size() <= mi) return no_expr;
+
+        Expr major = whnf(args[mi]);
+        if(rec->k) major = to_ctor_when_k(*rec, major);
+        Expr c = p_.app_fn(major);
+        if(p_.kind(c) != ExprKind::Const) return no_expr;
+        const Declaration* ctor = env_.find(p_[c].a);
+        if(!ctor || ctor->kind != DeclKind::Constructor || ctor->induct != rec->induct) return no_expr;
+        const RecRule& rule = rec->rules[ctor->cidx];
+
+        std::vector<Expr> margs;
+        p_.app_args(major, margs);
+        if(margs.size() != rec->nparams + rule.nfields) return no_expr;
+
+        Expr r = p_.app(env_.rule_rhs(rule, *rec, f), args.first(rec->nparams + rec->nmotives + rec->nminors));
+        r = p_.app(r, std::span<const Expr>(margs).subspan(rec->nparams));
+        return p_.app(r, args.subspan(mi + 1));
+    }
+
+    // K-like recursors (Eq.rec) compute on any major premise whose type is a ctor's result
+    Expr to_ctor_when_k(const Declaration& rec, Expr major)
+    {
+        Expr mt = whnf(infer(major));
+        Expr I = p_.app_fn(mt);
+        if(!p_.is_const(I, rec.induct)) return major;
+        std::vector<Expr> targs;
+        p_.app_args(mt, targs);
+        if(targs.size() < rec.nparams) return major;
+        const Declaration& ind = env_.get(rec.induct);
+        std::vector<Level> ls(p_.const_levels(I).begin(), p_.const_levels(I).end());
+        Expr c = p_.app(p_.cnst(ind.ctors[0], ls), std::span<const Expr>(targs).first(rec.nparams));
+        return is_def_eq(mt, infer(c)) ? c : major;
+    }
+
+    // Quot.lift f h (Quot.mk r a) ↦ f a,  Quot.ind h (Quot.mk r a) ↦ h a
+    // constant-time dispatch on the cached names, one whnf of the quotient argument
+    Expr reduce_quot(Expr f, std::span<const Expr> args)
+    {
+        if(!env_.quot_initialized || p_.kind(f) != ExprKind::Const) return no_expr;
+        Name n = p_[f].a;
+        std::size_t mk_pos;
+        if(n == env_.quot_lift) mk_pos = 5;
+        else if(n == env_.quot_ind) mk_pos = 4;
+        else return no_expr;
+        if(args.size() <= mk_pos) return no_expr;
+
+        Expr mk = whnf(args[mk_pos]);
+        if(p_.app_num_args(mk) != 3 || !p_.is_const(p_.app_fn(mk), env_.quot_mk)) return no_expr;
+
+        Expr r = p_.app(args[3], p_[mk].b);
+        return p_.app(r, args.subspan(mk_pos + 1));
+    }
+
+    bool is_def_eq_binding(Expr t, Expr s)
+    {
+        ExprKind k = p_.kind(t);
+        std::vector<Expr> xs;
+        while(p_.kind(t) == k && p_.kind(s) == k)
+        {
+            const ExprNode nt = p_[t], ns = p_[s];
+            Expr dt = p_.instantiate_rev(nt.b, xs), ds = p_.instantiate_rev(ns.b, xs);
+            if(!is_def_eq(dt, ds)) return false;
+            xs.push_back(mk_local(nt.a, dt, nt.binfo));
+            t = nt.c;
+            s = ns.c;
+        }
+        return is_def_eq(p_.instantiate_rev(t, xs), p_.instantiate_rev(s, xs));
+    }
+
+    // 1 = equal, 0 = different, -1 = unknown
+    int quick_is_def_eq(Expr t, Expr s)
+    {
+        if(t == s) return 1;
+        ExprKind kt = p_.kind(t), ks = p_.kind(s);
+        if(kt == ks && (kt == ExprKind::Lam || kt == ExprKind::Pi)) return is_def_eq_binding(t, s);
+        if(kt == ExprKind::Sort && ks == ExprKind::Sort) return p_.levels.is_equiv(p_[t].a, p_[s].a);
+        return -1;
+    }
+
+    bool is_def_eq_args(Expr t, Expr s)
+    {
+        while(p_.kind(t) == ExprKind::App && p_.kind(s) == ExprKind::App)
+        {
+            if(!is_def_eq(p_[t].b, p_[s].b)) return false;
+            t = p_[t].a;
+            s = p_[s].a;
+        }
+        return p_.kind(t) != ExprKind::App && p_.kind(s) != ExprKind::App;
+    }
+
+    bool is_def_eq_app(Expr t, Expr s)
+    {
+        if(p_.app_num_args(t) != p_.app_num_args(s)) return false;
+        return is_def_eq(p_.app_fn(t), p_.app_fn(s)) && is_def_eq_args(t, s);
+    }
+
+    bool levels_equiv(Expr c1, Expr c2)
+    {
+        auto l1 = p_.const_levels(c1), l2 = p_.const_levels(c2);
+        if(l1.size() != l2.size()) return false;
+        for(std::size_t i = 0; i < l1.size(); ++i)
+            if(!p_.levels.is_equiv(l1[i], l2[i])) return false;
+        return true;
+    }
+
+    // the definition unfold(e) would use; the lazy δ loop unfolds whichever side has one
+    const Declaration* delta_decl(Expr e)
+    {
+        Expr f = p_.app_fn(e);
+        if(p_.kind(f) != ExprKind::Const) return nullptr;
+        const Declaration* d = env_.find(p_[f].a);
+        if(!d || !d->unfoldable() || d->value == no_expr) return nullptr; // add() takes one without a value unchecked
+        return p_.const_levels(f).size() == d->lparams.size() ? d : nullptr;
+    }
+
+    // η: (fun x => f x) =?= f
+    bool try_eta(Expr t, Expr s)
+    {
+        if(p_.kind(t) != ExprKind::Lam || p_.kind(s) == ExprKind::Lam) return false;
+        Expr st = whnf(infer(s));
+        if(p_.kind(st) != ExprKind::Pi) return false;
+        const ExprNode n = p_[st];
+        Expr x = mk_local(n.a, n.b, n.binfo);
+        return is_def_eq(p_.instantiate(p_[t].c, x), p_.app(s, x));
+    }
+
+    bool is_def_eq_core(Expr t, Expr s)
+    {
+        if(int q = quick_is_def_eq(t, s); q >= 0) return q;
+
+        // proof irrelevance
+        Expr tt = infer(t);
+        if(is_prop(tt)) return is_def_eq(tt, infer(s));
+
+        t = whnf_core(t);
+        s = whnf_core(s);
+        if(int q = quick_is_def_eq(t, s); q >= 0) return q;
+
+        // lazy δ: unfold the side with the larger height first, compare arguments when heads agree
+        for(;;)
+        {
+            const Declaration* dt = delta_decl(t);
+            const Declaration* ds = delta_decl(s);
+            if(!dt && !ds) break;
+            if(dt && ds && dt == ds && is_def_eq_args(t, s) && levels_equiv(p_.app_fn(t), p_.app_fn(s)))
+                return true;
+            if(dt && (!ds || dt->height >= ds->height)) t = whnf_core(unfold(t));
+            if(ds && (!dt || ds->height >= dt->height)) s = whnf_core(unfold(s));
+            if(int q = quick_is_def_eq(t, s); q >= 0) return q;
+        }
+
+        const ExprNode nt = p_[t], ns = p_[s];
+        if(nt.kind == ExprKind::Const && ns.kind == ExprKind::Const && nt.a == ns.a && levels_equiv(t, s)) return true;
+        if(nt.kind == ExprKind::FVar && ns.kind == ExprKind::FVar && nt.a == ns.a) return true;
+        if(nt.kind == ExprKind::App && ns.kind == ExprKind::App && is_def_eq_app(t, s)) return true;
+        if(try_eta(t, s) || try_eta(s, t)) return true;
+        return false;
+    }
+
+    Environment& env_;
+    Pool& p_;
+    std::span<const Name> lparams_;
+    std::unordered_map<std::uint32_t, LocalDecl> lctx_;
+    std::unordered_map<Expr, Expr> infer_cache_, check_cache_, whnf_core_cache_, whnf_cache_;
+    std::unordered_set<std::uint64_t> eq_cache_;
+};
+
+// QUOTIENTS //
+
+// Quot, Quot.mk, Quot.lift, Quot.ind as kernel primitives, Quot.sound as an axiom.
+// Needs Eq.{u} : {α : Sort u} → α → α → Prop already declared (as in Lean 4).
+inline void add_quot(Environment& env)
+{
+    if(env.quot_initialized) return;
+    Pool& p = env.pool;
+    Name u_name = p.names.intern("u"), v_name = p.names.intern("v");
+    Level u = p.levels.param(u_name), v = p.levels.param(v_name);
+    Expr sort_u = p.sort(u), sort_v = p.sort(v), prop = p.sort(p.levels.zero());
+
+    Name eq_name = p.names.intern("Eq");
+    const Declaration* eq = env.find(eq_name);
+    if(!eq || eq->lparams.size() != 1) throw kernel_exception("Eq.{u} must be declared before quotients");
+    {
+        TypeChecker tc(env, eq->lparams);
+        Level w = p.levels.param(eq->lparams[0]);
+        Expr alpha = tc.mk_local("α", p.sort(w), BinderInfo::Implicit);
+        Expr expected = tc.mk_pi(std::array{alpha}, p.arrow(alpha, p.arrow(alpha, prop)));
+        if(!tc.is_def_eq(eq->type, expected)) throw kernel_exception("Eq has an unexpected type");
+    }
+
+    auto add = [&](const char* name, std::vector<Name> ls, Expr type, QuotKind qk) {
+        Declaration d;
+        d.kind = qk == QuotKind::None ? DeclKind::Axiom : DeclKind::Quot;
+        d.name = p.names.intern(name);
+        d.lparams = std::move(ls);
+        d.type = type;
+        d.quot = qk;
+        env.add(std::move(d));
+    };
+
+    TypeChecker tc(env);
+    std::array<Level, 1> lu{u};
+    std::array<Level, 1> lv{v};
+    Expr alpha = tc.mk_local("α", sort_u, BinderInfo::Implicit);
+    Expr rel_t = p.arrow(alpha, p.arrow(alpha, prop));
+    Expr r = tc.mk_local("r", rel_t);
+    Expr r_imp = tc.mk_local("r", rel_t, BinderInfo::Implicit);
+
+    // Quot.{u} : {α : Sort u} → (α → α → Prop) → Sort u
+    add("Quot", {u_name}, tc.mk_pi(std::array{alpha, r}, sort_u), QuotKind::Type);
+    Expr quot_c = p.cnst("Quot", lu);
+    Expr quot_r = p.app(p.app(quot_c, alpha), r_imp);
+
+    // Quot.mk.{u} : {α : Sort u} → (r : α → α → Prop) → α → @Quot α r
+    Expr a = tc.mk_local("a", alpha);
+    add("Quot.mk", {u_name}, tc.mk_pi(std::array{alpha, r, a}, p.app(p.app(quot_c, alpha), r)), QuotKind::Mk);
+    Expr mk_c = p.cnst("Quot.mk", lu);
+    auto mk = [&](Expr x) { return p.app(p.app(p.app(mk_c, alpha), r_imp), x); };
+
+    // Quot.lift.{u, v} : {α : Sort u} → {r : α → α → Prop} → {β : Sort v} → (f : α → β) →
+    //                    (∀ a b : α, r a b → f a = f b) → @Quot α r → β
+    Expr beta = tc.mk_local("β", sort_v, BinderInfo::Implicit);
+    Expr f = tc.mk_local("f", p.arrow(alpha, beta));
+    Expr b = tc.mk_local("b", alpha);
+    Expr eq_v = p.cnst(eq_name, lv);
+    Expr resp = tc.mk_pi(std::array{a, b},
+        p.arrow(p.app(p.app(r_imp, a), b), p.app(p.app(p.app(eq_v, beta), p.app(f, a)), p.app(f, b))));
+    Expr h = tc.mk_local("h", resp);
+    add("Quot.lift", {u_name, v_name}, tc.mk_pi(std::array{alpha, r_imp, beta, f, h}, p.arrow(quot_r, beta)), QuotKind::Lift);
+
+    // Quot.ind.{u} : ∀ {α : Sort u} {r : α → α → Prop} {β : @Quot α r → Prop},
+    //                (∀ a : α, β (Quot.mk r a)) → ∀ q : @Quot α r, β q
+    Expr motive = tc.mk_local("β", p.arrow(quot_r, prop), BinderInfo::Implicit);
+    Expr hmk = tc.mk_local("mk", tc.mk_pi(std::array{a}, p.app(motive, mk(a))));
+    Expr q = tc.mk_local("q", quot_r);
+    add("Quot.ind", {u_name}, tc.mk_pi(std::array{alpha, r_imp, motive, hmk, q}, p.app(motive, q)), QuotKind::Ind);
+
+    // Quot.sound.{u} : ∀ {α : Sort u} {r : α → α → Prop} {a b : α}, r a b → Quot.mk r a = Quot.mk r b
+    Expr eq_u = p.cnst(eq_name, lu);
+    Expr ai = tc.mk_local("a", alpha, BinderInfo::Implicit), bi = tc.mk_local("b", alpha, BinderInfo::Implicit);
+    Expr sound = tc.mk_pi(std::array{alpha, r_imp, ai, bi},
+        p.arrow(p.app(p.app(r_imp, ai), bi), p.app(p.app(p.app(eq_u, quot_r), mk(ai)), mk(bi))));
+    add("Quot.sound", {u_name}, sound, QuotKind::None);
+
+    env.quot_mk = p.names.intern("Quot.mk");
+    env.quot_lift = p.names.intern("Quot.lift");
+    env.quot_ind = p.names.intern("Quot.ind");
+    env.quot_initialized = true;
+}
+
+} // namespace vl
+
+#endif // TYPE_CHECKER_HPP
@@ -0,0 +1,690 @@
+// types.hpp - kernel terms
+// de Bruijn indices for bound variables, free variables for locals (locally nameless),
+// every term hash-consed in a Pool so that equal terms share one slot (Expr = slot index)
+// (c) 2025 Zachary R. James
+
+#ifndef TYPES_HPP
+#define TYPES_HPP
+
+#include "levels.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace vl {
+
+using Expr = std::uint32_t;
+constexpr Expr no_expr = UINT32_MAX;
+
+// NAMES //
+
+// dotted names ("Nat.succ") interned as whole strings; 0 is the anonymous name
+class NameTable
+{
+public:
+    NameTable() { intern(""); }
+
+    Name intern(std::string_view s)
+    {
+        if(auto n = find(s)) return *n;
+        Name n = Name(size());
+        strs_.emplace_back(s);
+        index_.emplace(strs_.back(), n);
+        return n;
+    }
+
+    Name append(Name prefix, std::string_view s)
+    {
+        if(prefix == 0) return intern(s);
+        return intern(str(prefix) + "." + std::string(s));
+    }
+
+    std::optional<Name> find(std::string_view s) const
+    {
+        if(!base_slots_.empty())
+        {
+            std::size_t mask = base_slots_.size() - 1;
+            for(std::size_t i = hash(s) & mask; base_slots_[i] != no_slot; i = (i + 1) & mask)
+                if(view(base_slots_[i]) == s) return base_slots_[i];
+        }
+        auto it = index_.find(std::string(s));
+        if(it == index_.end()) return std::nullopt;
+        return it->second;
+    }
+
+    // names from a library image are copied out on first use, view() never copies
+    const std::string& str(Name n) const
+    {
+        if(n >= base_size()) return strs_[n - base_size()];
+        auto it = base_strs_.find(n);
+        if(it == base_strs_.end()) it = base_strs_.emplace(n, std::string(view(n))).first;
+        return it->second;
+    }
+
+    std::string_view view(Name n) const
+    {
+        if(n >= base_size()) return strs_[n - base_size()];
+        return {base_chars_.data() + base_offsets_[n], base_offsets_[n + 1] - base_offsets_[n]};
+    }
+
+    std::size_t size() const { return base_size() + strs_.size(); }
+
+    // library images (storage.hpp): chars of every name back to back, offsets[n] .. offsets[n + 1]
+    static std::uint64_t hash(std::string_view s)
+    {
+        std::uint64_t h = 0xcbf29ce484222325ull; // FNV-1a
+        for(char c : s) h = (h ^ std::uint8_t(c)) * 0x100000001b3ull;
+        return h;
+    }
+
+    void attach(std::span<const char> chars, std::span<const std::uint32_t> offsets, std::span<const Name> slots)
+    {
+        base_chars_ = chars;
+        base_offsets_ = offsets;
+        base_slots_ = slots;
+        strs_.clear();
+        index_.clear();
+        base_strs_.clear();
+    }
+
+private:
+    std::size_t base_size() const { return base_offsets_.empty() ? 0 : base_offsets_.size() - 1; }
+
+    std::deque<std::string> strs_;                   // tail, deque keeps str() references stable
+    std::unordered_map<std::string, Name> index_;    // tail only
+    std::span<const char> base_chars_;
+    std::span<const std::uint32_t> base_offsets_;
+    std::span<const Name> base_slots_;
+    mutable std::unordered_map<Name, std::string> base_strs_;
+};
+
+// TERMS //
+
+enum class ExprKind : std::uint8_t { BVar, FVar, Sort, Const, App, Lam, Pi, Let };
+enum class BinderInfo : std::uint8_t { Default, Implicit, StrictImplicit, InstImplicit };
+
+// flags
+constexpr std::uint8_t has_fvar_flag  = 1;
+constexpr std::uint8_t has_param_flag = 2;
+
+// 32 bytes, trivially copyable; children are slot indices so a node array can be saved as is
+//   BVar: a = index         FVar: a = fvar id          Sort: a = Level
+//   Const: a = Name, b = level list id                 App: a = fn, b = arg
+//   Lam/Pi: a = binder name, b = domain, c = body      Let: a = name, b = type, c = value, d = body
+struct ExprNode
+{
+    ExprKind kind;
+    BinderInfo binfo;
+    std::uint8_t flags;
+    std::uint8_t pad;
+    std::uint32_t range; // every loose bvar index is < range
+    std::uint32_t a, b, c, d;
+    std::uint64_t hash;
+};
+
+static_assert(sizeof(ExprNode) == 32);
+
+struct kernel_exception : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+inline std::uint64_t mix(std::uint64_t h, std::uint64_t v)
+{
+    h ^= v + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+    h ^= h >> 29; h *= 0xBF58476D1CE4E5B9ull; h ^= h >> 32;
+    return h;
+}
+
+class Pool
+{
+public:
+    NameTable names;
+    LevelTable levels;
+
+    Pool()
+    {
+        lists_.push_back(0);  // list 0 is the empty list
+        slots_.assign(1024, no_expr);
+    }
+
+    const ExprNode& operator[](Expr e) const { return nodes_[e]; }
+    ExprKind kind(Expr e) const { return nodes_[e].kind; }
+    std::size_t size() const { return nodes_.size(); }
+
+    // library images (storage.hpp): node and level-list arrays plus their indexes are used in place,
+    // `backing` keeps the mapping alive for as long as the pool
+    const Segment<ExprNode>& nodes() const { return nodes_; }
+    const Segment<std::uint32_t>& level_lists() const { return lists_; }
+    std::uint32_t next_fvar() const { return next_fvar_; }
+
+    static std::uint64_t hash(const ExprNode& n) { return hash_of(n); }
+
+    static std::uint64_t list_hash(std::span<const Level> ls)
+    {
+        std::uint64_t h = ls.size();
+        for(Level l : ls) h = mix(h, l);
+        return h;
+    }
+
+    void attach(std::span<const ExprNode> nodes, std::span<const Expr> slots, std::span<const std::uint32_t> lists,
+                std::span<const std::uint32_t> list_slots, std::uint32_t next_fvar, std::shared_ptr<const void> backing)
+    {
+        nodes_.set_base(nodes);
+        base_slots_ = slots;
+        slots_.assign(1024, no_expr);
+        lists_.set_base(lists);
+        base_list_slots_ = list_slots;
+        list_index_.clear();
+        next_fvar_ = next_fvar;
+        backing_ = std::move(backing);
+    }
+
+    bool has_loose_bvars(Expr e) const { return nodes_[e].range > 0; }
+    bool has_fvar(Expr e) const { return nodes_[e].flags & has_fvar_flag; }
+    bool has_param(Expr e) const { return nodes_[e].flags & has_param_flag; }
+
+    // constructors //
+
+    Expr bvar(std::uint32_t i) { return intern({ExprKind::BVar, {}, 0, 0, i + 1, i, 0, 0, 0, 0}); }
+    Expr fvar(std::uint32_t id) { return intern({ExprKind::FVar, {}, has_fvar_flag, 0, 0, id, 0, 0, 0, 0}); }
+    Expr fresh_fvar() { return fvar(next_fvar_++); }
+
+    Expr sort(Level l)
+    {
+        std::uint8_t f = levels.has_param(l) ? has_param_flag : 0;
+        return intern({ExprKind::Sort, {}, f, 0, 0, l, 0, 0, 0, 0});
+    }
+
+    Expr cnst(Name n, std::span<const Level> ls = {})
+    {
+        std::uint8_t f = 0;
+        for(Level l : ls) if(levels.has_param(l)) f = has_param_flag;
+        return intern({ExprKind::Const, {}, f, 0, 0, n, level_list(ls), 0, 0, 0});
+    }
+    Expr cnst(std::string_view n, std::span<const Level> ls = {}) { return cnst(names.intern(n), ls); }
+
+    Expr app(Expr f, Expr x)
+    {
+        const ExprNode &nf = nodes_[f], &nx = nodes_[x];
+        return intern({ExprKind::App, {}, std::uint8_t(nf.flags | nx.flags), 0,
+                       std::max(nf.range, nx.range), f, x, 0, 0, 0});
+    }
+
+    Expr app(Expr f, std::span<const Expr> args)
+    {
+        for(Expr x : args) f = app(f, x);
+        return f;
+    }
+
+    Expr lam(Name n, Expr dom, Expr body, BinderInfo bi = BinderInfo::Default)
+    { return binder(ExprKind::Lam, n, dom, body, bi); }
+
+    Expr pi(Name n, Expr dom, Expr body, BinderInfo bi = BinderInfo::Default)
+    { return binder(ExprKind::Pi, n, dom, body, bi); }
+
+    // non dependent arrow
+    Expr arrow(Expr dom, Expr cod) { return pi(0, dom, lift_loose_bvars(cod, 1), BinderInfo::Default); }
+
+    Expr let(Name n, Expr type, Expr value, Expr body)
+    {
+        const ExprNode &t = nodes_[type], &v = nodes_[value], &b = nodes_[body];
+        std::uint32_t r = std::max({t.range, v.range, b.range > 0 ? b.range - 1 : 0});
+        return intern({ExprKind::Let, {}, std::uint8_t(t.flags | v.flags | b.flags), 0, r, n, type, value, body, 0});
+    }
+
+    // view into the level list table, copy it before creating new constants
+    std::span<const Level> const_levels(Expr e) const
+    {
+        std::uint32_t off = nodes_[e].b;
+        return {lists_.ptr(off) + 1, lists_[off]};
+    }
+
+    // accessors //
+
+    Expr app_fn(Expr e) const
+    {
+        while(kind(e) == ExprKind::App) e = nodes_[e].a;
+        return e;
+    }
+
+    // f a1 .. an  ->  f, appends a1 .. an
+    Expr app_args(Expr e, std::vector<Expr>& args) const
+    {
+        std::size_t start = args.size();
+        while(kind(e) == ExprKind::App) { args.push_back(nodes_[e].b); e = nodes_[e].a; }
+        std::reverse(args.begin() + start, args.end());
+        return e;
+    }
+
+    std::size_t app_num_args(Expr e) const
+    {
+        std::size_t n = 0;
+        while(kind(e) == ExprKind::App) { e = nodes_[e].a; ++n; }
+        return n;
+    }
+
+    bool is_const(Expr e, Name n) const { return kind(e) == ExprKind::Const && nodes_[e].a == n; }
+
+    // substitution //
+
+    // loose bvar i (i < subst.size()) becomes subst[i], larger ones drop by subst.size()
+    Expr instantiate(Expr e, std::span<const Expr> subst)
+    {
+        if(subst.empty() || !has_loose_bvars(e)) return e;
+        std::unordered_map<std::uint64_t, Expr> cache;
+        return instantiate_core(e, 0, subst, false, cache);
+    }
+
+    Expr instantiate(Expr e, Expr x) { return instantiate(e, std::span<const Expr>(&x, 1)); }
+
+    // loose bvar i becomes subst[n - 1 - i] (binder order, as produced by abstract)
+    Expr instantiate_rev(Expr e, std::span<const Expr> subst)
+    {
+        if(subst.empty() || !has_loose_bvars(e)) return e;
+        std::unordered_map<std::uint64_t, Expr> cache;
+        return instantiate_core(e, 0, subst, true, cache);
+    }
+
+    // fvars[i] becomes bvar (n - 1 - i), inverse of instantiate_rev
+    Expr abstract(Expr e, std::span<const Expr> fvars)
+    {
+        if(fvars.empty() || !has_fvar(e)) return e;
+        std::unordered_map<std::uint64_t, Expr> cache;
+        return abstract_core(e, 0, fvars, cache);
+    }
+
+    Expr lift_loose_bvars(Expr e, std::uint32_t d) { return lift_core(e, 0, d); }
+
+    // replace universe params
+    Expr instantiate_lparams(Expr e, std::span<const Name> params, std::span<const Level> values)
+    {
+        if(params.empty() || !has_param(e)) return e;
+        std::unordered_map<Expr, Expr> cache;
+        return lparams_core(e, params, values, cache);
+    }
+
+    // does loose bvar i occur in e
+    bool has_loose_bvar(Expr e, std::uint32_t i) const
+    {
+        const ExprNode& n = nodes_[e];
+        if(n.range <= i) return false;
+        switch(n.kind)
+        {
+            case ExprKind::BVar: return n.a == i;
+            case ExprKind::App: return has_loose_bvar(n.a, i) || has_loose_bvar(n.b, i);
+            case ExprKind::Lam: case ExprKind::Pi: return has_loose_bvar(n.b, i) || has_loose_bvar(n.c, i + 1);
+            case ExprKind::Let: return has_loose_bvar(n.b, i) || has_loose_bvar(n.c, i) || has_loose_bvar(n.d, i + 1);
+            default: return false;
+        }
+    }
+
+    // does e mention constant n (stops early on the first hit)
+    bool occurs_const(Expr e, Name n) const
+    {
+        std::vector<Expr> todo{e};
+        std::vector<bool> seen(nodes_.size());
+        while(!todo.empty())
+        {
+            Expr x = todo.back(); todo.pop_back();
+            if(seen[x]) continue;
+            seen[x] = true;
+            const ExprNode& nx = nodes_[x];
+            switch(nx.kind)
+            {
+                case ExprKind::Const: if(nx.a == n) return true; break;
+                case ExprKind::App: todo.push_back(nx.a); todo.push_back(nx.b); break;
+                case ExprKind::Lam: case ExprKind::Pi: todo.push_back(nx.b); todo.push_back(nx.c); break;
+                case ExprKind::Let: todo.push_back(nx.b); todo.push_back(nx.c); todo.push_back(nx.d); break;
+                default: break;
+            }
+        }
+        return false;
+    }
+
+    // appends the constants of the subterms of e not in seen yet (seen carries over between calls,
+    // so one set covers every term of a declaration); a constant used at several universe levels
+    // comes out once per level list
+    void consts(Expr e, std::unordered_set<Expr>& seen, std::vector<Name>& out) const
+    {
+        std::vector<Expr> todo{e};
+        while(!todo.empty())
+        {
+            Expr x = todo.back(); todo.pop_back();
+            if(!seen.insert(x).second) continue;
+            const ExprNode& nx = nodes_[x];
+            switch(nx.kind)
+            {
+                case ExprKind::Const: out.push_back(nx.a); break;
+                case ExprKind::App: todo.push_back(nx.a); todo.push_back(nx.b); break;
+                case ExprKind::Lam: case ExprKind::Pi: todo.push_back(nx.b); todo.push_back(nx.c); break;
+                case ExprKind::Let: todo.push_back(nx.b); todo.push_back(nx.c); todo.push_back(nx.d); break;
+                default: break;
+            }
+        }
+    }
+
+    // printing //
+
+    std::string level_str(Level l) const
+    { return levels.to_string(l, [this](Name n) { return names.str(n); }); }
+
+    std::string to_string(Expr e, const std::function<std::string(std::uint32_t)>& fvar_name = {}) const
+    {
+        std::vector<std::string> ctx;
+        std::string out;
+        print(e, ctx, fvar_name, out, false);
+        return out;
+    }
+
+private:
+    Expr binder(ExprKind k, Name n, Expr dom, Expr body, BinderInfo bi)
+    {
+        const ExprNode &d = nodes_[dom], &b = nodes_[body];
+        std::uint32_t r = std::max(d.range, b.range > 0 ? b.range - 1 : 0);
+        return intern({k, bi, std::uint8_t(d.flags | b.flags), 0, r, n, dom, body, 0, 0});
+    }
+
+    std::uint32_t level_list(std::span<const Level> ls)
+    {
+        if(ls.empty()) return 0;
+        std::uint64_t h = list_hash(ls);
+        auto same_list = [&](std::uint32_t off) {
+            return lists_[off] == ls.size() && std::equal(ls.begin(), ls.end(), lists_.ptr(off) + 1);
+        };
+        if(!base_list_slots_.empty())
+        {
+            std::size_t mask = base_list_slots_.size() - 1;
+            for(std::size_t i = h & mask; base_list_slots_[i] != no_slot; i = (i + 1) & mask)
+                if(same_list(base_list_slots_[i])) return base_list_slots_[i];
+        }
+        auto [lo, hi] = list_index_.equal_range(h);
+        for(auto it = lo; it != hi; ++it)
+            if(same_list(it->second)) return it->second;
+        std::uint32_t off = std::uint32_t(lists_.size());
+        std::vector<std::uint32_t> run{std::uint32_t(ls.size())};
+        run.insert(run.end(), ls.begin(), ls.end());
+        lists_.append(run);
+        list_index_.emplace(h, off);
+        return off;
+    }
+
+    // binder names are cosmetic: alpha-equivalent terms get the same slot (first name wins)
+    static bool same(const ExprNode& x, const ExprNode& y)
+    {
+        bool binding = x.kind == ExprKind::Lam || x.kind == ExprKind::Pi;
+        return x.kind == y.kind && x.binfo == y.binfo && (binding || x.a == y.a) &&
+               x.b == y.b && x.c == y.c && x.d == y.d;
+    }
+
+    static std::uint64_t hash_of(const ExprNode& n)
+    {
+        bool binding = n.kind == ExprKind::Lam || n.kind == ExprKind::Pi;
+        std::uint64_t h = mix(std::uint64_t(n.kind) << 8 | std::uint64_t(n.binfo), binding ? 0 : n.a);
+        return mix(mix(mix(h, n.b), n.c), n.d);
+    }
+
+    Expr intern(ExprNode n)
+    {
+        n.hash = hash_of(n);
+        if(!base_slots_.empty())
+        {
+            std::size_t mask = base_slots_.size() - 1;
+            for(std::size_t i = n.hash & mask; base_slots_[i] != no_expr; i = (i + 1) & mask)
+                if(nodes_[base_slots_[i]].hash == n.hash && same(nodes_[base_slots_[i]], n)) return base_slots_[i];
+        }
+        std::size_t mask = slots_.size() - 1;
+        for(std::size_t i = n.hash & mask;; i = (i + 1) & mask)
+        {
+            Expr s = slots_[i];
+            if(s == no_expr)
+            {
+                Expr e = Expr(nodes_.size());
+                nodes_.push_back(n);
+                slots_[i] = e;
+                if(2 * nodes_.tail().size() > slots_.size()) rehash();
+                return e;
+            }
+            if(nodes_[s].hash == n.hash && same(nodes_[s], n)) return s;
+        }
+    }
+
+    void rehash()
+    {
+        slots_.assign(slots_.size() * 2, no_expr);
+        std::size_t mask = slots_.size() - 1;
+        for(Expr e = Expr(nodes_.base_size()); e < nodes_.size(); ++e)
+        {
+            std::size_t i = nodes_[e].hash & mask;
+            while(slots_[i] != no_expr) i = (i + 1) & mask;
+            slots_[i] = e;
+        }
+    }
+
+    Expr instantiate_core(Expr e, std::uint32_t off, std::span<const Expr> s, bool rev,
+                          std::unordered_map<std::uint64_t, Expr>& cache)
+    {
+        const ExprNode n = nodes_[e];
+        if(n.range <= off) return e;
+        std::uint64_t key = std::uint64_t(e) << 32 | off;
+        if(auto it = cache.find(key); it != cache.end()) return it->second;
+        Expr r = e;
+        switch(n.kind)
+        {
+            case ExprKind::BVar:
+            {
+                std::uint32_t i = n.a - off;
+                if(i < s.size()) r = lift_loose_bvars(rev ? s[s.size() - 1 - i] : s[i], off);
+                else r = bvar(n.a - std::uint32_t(s.size()));
+                break;
+            }
+            case ExprKind::App:
+                r = app(instantiate_core(n.a, off, s, rev, cache), instantiate_core(n.b, off, s, rev, cache));
+                break;
+            case ExprKind::Lam: case ExprKind::Pi:
+                r = binder(n.kind, n.a, instantiate_core(n.b, off, s, rev, cache),
+                           instantiate_core(n.c, off + 1, s, rev, cache), n.binfo);
+                break;
+            case ExprKind::Let:
+                r = let(n.a, instantiate_core(n.b, off, s, rev, cache), instantiate_core(n.c, off, s, rev, cache),
+                        instantiate_core(n.d, off + 1, s, rev, cache));
+                break;
+            default: break;
+        }
+        cache.emplace(key, r);
+        return r;
+    }
+
+    Expr abstract_core(Expr e, std::uint32_t off, std::span<const Expr> fv,
+                       std::unordered_map<std::uint64_t, Expr>& cache)
+    {
+        const ExprNode n = nodes_[e];
+        if(!(n.flags & has_fvar_flag)) return e;
+        std::uint64_t key = std::uint64_t(e) << 32 | off;
+        if(auto it = cache.find(key); it != cache.end()) return it->second;
+        Expr r = e;
+        switch(n.kind)
+        {
+            case ExprKind::FVar:
+                for(std::size_t i = fv.size(); i-- > 0;)
+                    if(fv[i] == e) { r = bvar(off + std::uint32_t(fv.size() - 1 - i)); break; }
+                break;
+            case ExprKind::App:
+                r = app(abstract_core(n.a, off, fv, cache), abstract_core(n.b, off, fv, cache));
+                break;
+            case ExprKind::Lam: case ExprKind::Pi:
+                r = binder(n.kind, n.a, abstract_core(n.b, off, fv, cache), abstract_core(n.c, off + 1, fv, cache), n.binfo);
+                break;
+            case ExprKind::Let:
+                r = let(n.a, abstract_core(n.b, off, fv, cache), abstract_core(n.c, off, fv, cache),
+                        abstract_core(n.d, off + 1, fv, cache));
+                break;
+            default: break;
+        }
+        cache.emplace(key, r);
+        return r;
+    }
+
+    // bvars >= off shift up by d
+    Expr lift_core(Expr e, std::uint32_t off, std::uint32_t d)
+    {
+        const ExprNode n = nodes_[e];
+        if(d == 0 || n.range <= off) return e;
+        switch(n.kind)
+        {
+            case ExprKind::BVar: return bvar(n.a + d);
+            case ExprKind::App: return app(lift_core(n.a, off, d), lift_core(n.b, off, d));
+            case ExprKind::Lam: case ExprKind::Pi:
+                return binder(n.kind, n.a, lift_core(n.b, off, d), lift_core(n.c, off + 1, d), n.binfo);
+            case ExprKind::Let:
+                return let(n.a, lift_core(n.b, off, d), lift_core(n.c, off, d), lift_core(n.d, off + 1, d));
+            default: return e;
+        }
+    }
+
+    Expr lparams_core(Expr e, std::span<const Name> ps, std::span<const Level> vs, std::unordered_map<Expr, Expr>& cache)
+    {
+        const ExprNode n = nodes_[e];
+        if(!(n.flags & has_param_flag)) return e;
+        if(auto it = cache.find(e); it != cache.end()) return it->second;
+        Expr r = e;
+        switch(n.kind)
+        {
+            case ExprKind::Sort: r = sort(levels.instantiate(n.a, ps, vs)); break;
+            case ExprKind::Const:
+            {
+                std::vector<Level> ls(const_levels(e).begin(), const_levels(e).end());
+                for(Level& l : ls) l = levels.instantiate(l, ps, vs);
+                r = cnst(n.a, ls);
+                break;
+            }
+            case ExprKind::App: r = app(lparams_core(n.a, ps, vs, cache), lparams_core(n.b, ps, vs, cache)); break;
+            case ExprKind::Lam: case ExprKind::Pi:
+                r = binder(n.kind, n.a, lparams_core(n.b, ps, vs, cache), lparams_core(n.c, ps, vs, cache), n.binfo);
+                break;
+            case ExprKind::Let:
+                r = let(n.a, lparams_core(n.b, ps, vs, cache), lparams_core(n.c, ps, vs, cache), lparams_core(n.d, ps, vs, cache));
+                break;
+            default: break;
+        }
+        cache.emplace(e, r);
+        return r;
+    }
+
+    // binder names as displayed, shadowed ones get a numeric suffix
+    static std::string display_name(const std::string& base, const std::vector<std::string>& ctx)
+    {
+        std::string s = base.empty() ? "x" : base;
+        for(unsigned i = 1; std::find(ctx.begin(), ctx.end(), s) != ctx.end(); ++i)
+            s = (base.empty() ? "x" : base) + "_" + std::to_string(i);
+        return s;
+    }
+
+    void print(Expr e, std::vector<std::string>& ctx, const std::function<std::string(std::uint32_t)>& fvar_name,
+               std::string& out, bool paren) const
+    {
+        const ExprNode& n = nodes_[e];
+        switch(n.kind)
+        {
+            case ExprKind::BVar:
+            {
+                if(n.a < ctx.size()) out += ctx[ctx.size() - 1 - n.a];
+                else out += "#" + std::to_string(n.a);
+                break;
+            }
+            case ExprKind::FVar: out += fvar_name ? fvar_name(n.a) : "_fv" + std::to_string(n.a); break;
+            case ExprKind::Sort:
+                if(levels.is_zero(n.a)) out += "Prop";
+                else out += "Sort " + level_str(n.a);
+                break;
+            case ExprKind::Const:
+            {
+                out += names.str(n.a);
+                auto ls = const_levels(e);
+                if(!ls.empty())
+                {
+                    out += ".{";
+                    for(std::size_t i = 0; i < ls.size(); ++i) out += (i ? ", " : "") + level_str(ls[i]);
+                    out += "}";
+                }
+                break;
+            }
+            case ExprKind::App:
+            {
+                if(paren) out += "(";
+                print(n.a, ctx, fvar_name, out, false);
+                out += " ";
+                print(n.b, ctx, fvar_name, out, true);
+                if(paren) out += ")";
+                break;
+            }
+            case ExprKind::Lam: case ExprKind::Pi:
+            {
+                if(paren) out += "(";
+                bool arrow = n.kind == ExprKind::Pi && !has_loose_bvar(n.c, 0);
+                std::string bname = display_name(names.str(n.a), ctx);
+                if(arrow)
+                {
+                    ExprKind dk = nodes_[n.b].kind;
+                    print(n.b, ctx, fvar_name, out, dk == ExprKind::Pi || dk == ExprKind::Lam);
+                    out += " → ";
+                }
+                else
+                {
+                    bool implicit = n.binfo == BinderInfo::Implicit || n.binfo == BinderInfo::StrictImplicit;
+                    bool inst = n.binfo == BinderInfo::InstImplicit;
+                    out += n.kind == ExprKind::Lam ? "fun " : "";
+                    out += implicit ? "{" : inst ? "[" : "(";
+                    out += bname + " : ";
+                    print(n.b, ctx, fvar_name, out, false);
+                    out += implicit ? "}" : inst ? "]" : ")";
+                    out += n.kind == ExprKind::Lam ? " => " : " → ";
+                }
+                ctx.push_back(bname);
+                print(n.c, ctx, fvar_name, out, false);
+                ctx.pop_back();
+                if(paren) out += ")";
+                break;
+            }
+            case ExprKind::Let:
+            {
+                if(paren) out += "(";
+                std::string bname = display_name(names.str(n.a), ctx);
+                out += "let " + bname + " : ";
+                print(n.b, ctx, fvar_name, out, false);
+                out += " := ";
+                print(n.c, ctx, fvar_name, out, false);
+                out += "; ";
+                ctx.push_back(bname);
+                print(n.d, ctx, fvar_name, out, false);
+                ctx.pop_back();
+                if(paren) out += ")";
+                break;
+            }
+        }
+    }
+
+    Segment<ExprNode> nodes_;
+    std::vector<Expr> slots_;              // open addressing hash-cons index (tail nodes)
+    std::span<const Expr> base_slots_;     // same for the image's nodes, read only
+    Segment<std::uint32_t> lists_;         // level lists: count, then levels
+    std::unordered_multimap<std::uint64_t, std::uint32_t> list_index_;
+    std::span<const std::uint32_t> base_list_slots_;
+    std::uint32_t next_fvar_ = 0;
+    std::shared_ptr<const void> backing_;
+};
+
+} // namespace vl
+
+#endif // TYPES_HPP
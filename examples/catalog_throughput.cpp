@@ -0,0 +1,156 @@
+// catalog_throughput.cpp - benchmark for the catalog's write-ahead log (Catalog, WriteAheadLog in storage.hpp)
+// usage: catalog_throughput [edits] [scratch dir] [readers]
+// binds generated names (default 20000 edits, the same ones every run) to hashes with durability on,
+// three ways: one writer committing each edit (a sync per edit), 16 writers committing each edit
+// (group commit shares syncs between them), and one writer that does not wait while a background
+// thread syncs every 2 ms. prints edits per second and syncs for each, then reopens the catalog and
+// checks that recovery finds every edit, or exits with 1.
+// then readers (default 2) look names up at random in a catalog of 10 x edits names, a snapshot per
+// batch of 1000 lookups, while one writer makes 3 x edits more edits with a checkpoint after each
+// third: prints lookups per second, the slowest batch, and the writer's edits per second
+// (c) 2025 Zachary R. James
+
+#include "storage.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace vl;
+
+namespace {
+
+Digest digest(std::size_t i)
+{
+    Digest h{};
+    for(std::size_t b = 0; b < 8; ++b) h[b] = std::uint8_t(i >> 8 * b);
+    return h;
+}
+
+std::string name(std::size_t i) { return "Mathlib.Edit.name_" + std::to_string(i); }
+
+// edits [0, n) split between writers, each committed unless wait is false; false if a reopen
+// misses any of them
+bool run(const char* what, const std::filesystem::path& root, std::size_t n, unsigned writers, std::chrono::microseconds window,
+         bool wait)
+{
+    std::filesystem::remove_all(root);
+    std::uint64_t syncs = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    double ms = 0;
+    {
+        Catalog c(root, window);
+        std::vector<std::thread> ts;
+        for(unsigned w = 0; w < writers; ++w)
+            ts.emplace_back([&, w] {
+                for(std::size_t i = w; i < n; i += writers)
+                {
+                    std::uint64_t lsn = c.bind(name(i), digest(i));
+                    if(wait) c.commit(lsn);
+                }
+            });
+        for(std::thread& t : ts) t.join();
+        c.flush();
+        ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        syncs = c.log().syncs();
+    }
+    Catalog c(root);
+    bool all = c.size() == n;
+    for(std::size_t i = 0; i < n && all; ++i)
+    {
+        std::optional<CatalogEntry> e = c.find(name(i));
+        all = e && e->hash == digest(i);
+    }
+    std::printf("%-28s %2u writers: %zu edits in %7.0f ms, %9.0f edits/s, %6llu syncs%s\n", what, writers, n, ms, double(n) * 1e3 / ms,
+                (unsigned long long)syncs, all ? "" : ", EDITS LOST");
+    return all;
+}
+
+// readers looking up names of a catalog of `names` while a writer makes `edits` edits and 3
+// checkpoints
+void readers(const std::filesystem::path& root, std::size_t names, std::size_t edits, unsigned threads)
+{
+    using ms = std::chrono::duration<double, std::milli>;
+    std::filesystem::remove_all(root);
+    Catalog c(root, std::chrono::milliseconds(2));
+    std::vector<std::string> keys; // made up front, so the readers time lookups alone
+    for(std::size_t i = 0; i < names; ++i)
+    {
+        keys.push_back(name(i));
+        c.bind(keys.back(), digest(i));
+    }
+    c.checkpoint();
+
+    // one reader on its own first, for comparison
+    std::mt19937 rng(42);
+    std::size_t hits = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    CatalogSnapshot s = c.snapshot();
+    for(std::size_t i = 0; i < names; ++i) hits += s.find(keys[rng() % names]) != nullptr;
+    double alone = ms(std::chrono::steady_clock::now() - t0).count();
+
+    std::atomic<bool> done = false;
+    std::vector<std::size_t> lookups(threads), found(threads);
+    std::vector<double> slowest(threads);
+    std::vector<std::thread> ts;
+    for(unsigned r = 0; r < threads; ++r)
+        ts.emplace_back([&, r] {
+            std::mt19937 rng(r);
+            while(!done)
+            {
+                auto t0 = std::chrono::steady_clock::now();
+                CatalogSnapshot s = c.snapshot();
+                for(int i = 0; i < 1000; ++i) found[r] += s.find(keys[rng() % names]) != nullptr;
+                lookups[r] += 1000;
+                slowest[r] = std::max(slowest[r], ms(std::chrono::steady_clock::now() - t0).count());
+            }
+        });
+    t0 = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < edits; ++i)
+    {
+        // rebinds an existing name, erases one or binds a new one
+        std::size_t k = i % 3 == 2 ? names + i : i * 7 % names;
+        if(i % 3 == 1) c.erase(name(k));
+        else c.bind(name(k), digest(i));
+        if((i + 1) % (edits / 3 + 1) == 0) c.checkpoint();
+    }
+    c.flush();
+    double writer = ms(std::chrono::steady_clock::now() - t0).count();
+    done = true;
+    for(std::thread& t : ts) t.join();
+
+    std::size_t total = 0;
+    double worst = 0;
+    for(unsigned r = 0; r < threads; ++r)
+    {
+        total += lookups[r];
+        worst = std::max(worst, slowest[r]);
+    }
+    std::printf("1 reader alone on %zu names: %.2fM lookups/s (%zu found)\n", names, double(names) / alone / 1e3, hits);
+    std::printf("%u readers beside a writer: %.2fM lookups/s, slowest batch of 1000 %.1f ms; writer %zu edits and 3 checkpoints "
+                "in %.0f ms, %.0f edits/s\n",
+                threads, double(total) / writer / 1e3, worst, edits, writer, double(edits) * 1e3 / writer);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    std::filesystem::path dir = argc > 2 ? argv[2] : std::filesystem::temp_directory_path() / "vl_catalog_throughput";
+
+    bool ok = run("sync per edit:", dir / "each", n, 1, {}, true);
+    ok = run("group commit:", dir / "group", n, 16, {}, true) && ok;
+    ok = run("2 ms window, no waiting:", dir / "window", n, 1, std::chrono::milliseconds(2), false) && ok;
+    readers(dir / "readers", 10 * n, 3 * n, argc > 3 ? unsigned(std::strtoul(argv[3], nullptr, 10)) : 2);
+    std::filesystem::remove_all(dir);
+    return ok ? 0 : 1;
+}
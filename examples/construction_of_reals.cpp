@@ -0,0 +1,140 @@
+// construction_of_reals.cpp - Nat → Int → Rat on top of the prelude, then extracted to C++
+// Int is Lean's ofNat / negSucc split, Rat a numerator with a shifted denominator
+// (mk a b means a / (b + 1), so no positivity proof is needed and nothing is normalized).
+// neither is a quotient (pairs of Nats up to a + d = b + c, fractions up to cross multiplication):
+// each operation through Quot.lift needs a proof that it respects the relation, which takes the
+// Int ring lemmas and there is no tactic layer here to build them, and quotients would not change
+// what runs, since evaluation and extraction take Quot.mk for the identity. Quot's own rules are
+// tested in regressions.cpp.
+// prints a few #eval results, then writes a standalone benchmark (argv[1], default
+// reals_bench.cpp) that runs the same terms compiled by the host compiler.
+// (c) 2025 Zachary R. James
+
+#include "extract.hpp"
+#include "prelude.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace vl;
+
+namespace {
+
+void load_reals(Environment& env)
+{
+    Pool& p = env.pool;
+    TypeChecker tc(env);
+    auto nm = [&](const char* s) { return p.names.intern(s); };
+    auto call = [&](const char* f, auto... xs) { Expr e = p.cnst(f); ((e = p.app(e, xs)), ...); return e; };
+
+    Expr nat = p.cnst("Nat"), zero = p.cnst("Nat.zero");
+    auto succ = [&](Expr n) { return p.app(p.cnst("Nat.succ"), n); };
+    Expr n = tc.mk_local("n", nat), m = tc.mk_local("m", nat), k = tc.mk_local("k", nat);
+
+    // inductive Int | ofNat : Nat → Int | negSucc : Nat → Int   (negSucc n = -(n + 1))
+    Expr int_ = p.cnst("Int");
+    add_inductive(env, {{}, 0, {{nm("Int"), p.sort(p.levels.one()), {
+        {nm("Int.ofNat"), p.arrow(nat, int_)},
+        {nm("Int.negSucc"), p.arrow(nat, int_)}}}}});
+    auto of = [&](Expr e) { return p.app(p.cnst("Int.ofNat"), e); };
+    auto neg_succ = [&](Expr e) { return p.app(p.cnst("Int.negSucc"), e); };
+    Expr a = tc.mk_local("a", int_), b = tc.mk_local("b", int_);
+    Expr int2 = p.arrow(int_, p.arrow(int_, int_));
+
+    add_equations(env, {nm("Int.negOfNat"), {}, p.arrow(nat, int_), {
+        {{zero}, of(zero)},
+        {{succ(m)}, neg_succ(m)}}});
+    add_equations(env, {nm("Int.neg"), {}, p.arrow(int_, int_), {
+        {{of(n)}, call("Int.negOfNat", n)},
+        {{neg_succ(n)}, of(succ(n))}}});
+
+    // m - n as an Int, split on whether n - m is zero
+    add_equations(env, {nm("Int.subNatNat.aux"), {}, p.arrow(nat, p.arrow(nat, p.arrow(nat, int_))), {
+        {{m, n, zero}, of(call("Nat.sub", m, n))},
+        {{m, n, succ(k)}, neg_succ(k)}}});
+    add_definition(env, nm("Int.subNatNat"), {}, p.arrow(nat, p.arrow(nat, int_)),
+                   tc.mk_lambda(std::array{m, n}, call("Int.subNatNat.aux", m, n, call("Nat.sub", n, m))));
+
+    add_equations(env, {nm("Int.add"), {}, int2, {
+        {{of(m), of(n)}, of(call("Nat.add", m, n))},
+        {{of(m), neg_succ(n)}, call("Int.subNatNat", m, succ(n))},
+        {{neg_succ(m), of(n)}, call("Int.subNatNat", n, succ(m))},
+        {{neg_succ(m), neg_succ(n)}, neg_succ(succ(call("Nat.add", m, n)))}}});
+    add_equations(env, {nm("Int.mul"), {}, int2, {
+        {{of(m), of(n)}, of(call("Nat.mul", m, n))},
+        {{of(m), neg_succ(n)}, call("Int.negOfNat", call("Nat.mul", m, succ(n)))},
+        {{neg_succ(m), of(n)}, call("Int.negOfNat", call("Nat.mul", succ(m), n))},
+        {{neg_succ(m), neg_succ(n)}, of(call("Nat.mul", succ(m), succ(n)))}}});
+    add_definition(env, nm("Int.sub"), {}, int2, tc.mk_lambda(std::array{a, b}, call("Int.add", a, call("Int.neg", b))));
+
+    // inductive Rat | mk : Int → Nat → Rat
+    Expr rat = p.cnst("Rat");
+    add_inductive(env, {{}, 0, {{nm("Rat"), p.sort(p.levels.one()), {
+        {nm("Rat.mk"), p.arrow(int_, p.arrow(nat, rat))}}}}});
+    auto mk = [&](Expr x, Expr y) { return call("Rat.mk", x, y); };
+    Expr c = tc.mk_local("c", int_);
+    Expr rat2 = p.arrow(rat, p.arrow(rat, rat));
+    // (b + 1)(m + 1) - 1 = b m + b + m
+    auto den = [&](Expr x, Expr y) { return call("Nat.add", call("Nat.add", call("Nat.mul", x, y), x), y); };
+    auto scale = [&](Expr x, Expr y) { return call("Int.mul", x, of(succ(y))); };
+
+    add_equations(env, {nm("Rat.add"), {}, rat2, {
+        {{mk(a, n), mk(c, m)}, mk(call("Int.add", scale(a, m), scale(c, n)), den(n, m))}}});
+    add_equations(env, {nm("Rat.mul"), {}, rat2, {
+        {{mk(a, n), mk(c, m)}, mk(call("Int.mul", a, c), den(n, m))}}});
+    add_equations(env, {nm("Rat.neg"), {}, p.arrow(rat, rat), {
+        {{mk(a, n)}, mk(call("Int.neg", a), n)}}});
+
+    // Σ_{i < n} (-1)^i i  and  Σ_{i < n} 1 / (i + 1)
+    add_equations(env, {nm("Int.altSum"), {}, p.arrow(nat, int_), {
+        {{zero}, of(zero)},
+        {{succ(n)}, call("Int.sub", of(n), call("Int.altSum", n))}}});
+    add_equations(env, {nm("Rat.harmonic"), {}, p.arrow(nat, rat), {
+        {{zero}, mk(of(zero), zero)},
+        {{succ(n)}, call("Rat.add", call("Rat.harmonic", n), mk(of(succ(zero)), n))}}});
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Environment env;
+    load_prelude(env);
+    load_reals(env);
+    Pool& p = env.pool;
+
+    auto num = [&](std::uint64_t v) { Expr e = p.cnst("Nat.zero"); while(v--) e = p.app(p.cnst("Nat.succ"), e); return e; };
+    auto call = [&](const char* f, auto... xs) { Expr e = p.cnst(f); ((e = p.app(e, xs)), ...); return e; };
+    auto int_ = [&](std::int64_t v) { return v >= 0 ? call("Int.ofNat", num(std::uint64_t(v))) : call("Int.negSucc", num(std::uint64_t(-v - 1))); };
+
+    std::vector<std::pair<std::string, Expr>> terms = {
+        {"Int.mul (1234 - 5678) 77", call("Int.mul", call("Int.sub", int_(1234), int_(5678)), int_(77))},
+        {"Int.altSum 2000", call("Int.altSum", num(2000))},
+        {"Rat.harmonic 15", call("Rat.harmonic", num(15))},
+        {"Rat.mul (-3/4) (5/6)", call("Rat.mul", call("Rat.mk", int_(-3), num(3)), call("Rat.mk", int_(5), num(5)))},
+    };
+
+    Evaluator ev(env);
+    TypeChecker tc(env);
+    for(const auto& [label, e] : terms)
+    {
+        tc.check(e);
+        Ir ir = ev.erase(e);
+        ValuePtr r = ev.run(ir);
+        auto t0 = std::chrono::steady_clock::now();
+        constexpr int iterations = 20;
+        for(int i = 0; i < iterations; ++i) r = ev.run(ir);
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / iterations;
+        std::printf("%-28s %12.3f us/run  = %s   (evaluator)\n", label.c_str(), us, ev.to_string(r).c_str());
+    }
+
+    Extractor ex(ev);
+    const char* out = argc > 1 ? argv[1] : "reals_bench.cpp";
+    std::ofstream(out) << ex.bench_main(terms, 200);
+    std::printf("wrote %s\n", out);
+}
@@ -0,0 +1,184 @@
+// graph_layout.cpp - benchmark for the workspace's force-directed layout (layout.hpp)
+// usage: graph_layout [nodes] [iterations]
+// lays out a random graph shaped like a library (each node uses one to three earlier ones, older
+// nodes more often), default 20000 nodes for 300 iterations, and prints iterations per second and
+// the mean edge length against k with each repulsion kernel: the vector one, the plain C++ one with
+// its lanes (they add in the same order, so any difference between the two layouts is a bug and
+// exits with 1) and the sequential one, the scalar baseline the speedup is against (its first step
+// must land within sequential_tolerance of the vector one, or it exits with 1). one all-pairs
+// iteration (theta 0) is timed for comparison.
+// then the settled layout goes into a spatial index (graph.hpp), nodes as boxes k/2 wide and edges
+// after them, and pointer hits, viewport queries and one frame of updates are timed against a scan
+// (c) 2025 Zachary R. James
+
+#include "layout.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace vl;
+
+namespace {
+
+ForceLayout library_graph(std::size_t n, const LayoutOptions& opts)
+{
+    ForceLayout g(n, opts);
+    std::mt19937 rng(42);
+    for(Node v = 1; v < n; ++v)
+    {
+        int uses = 1 + int(rng() % 3);
+        for(int i = 0; i < uses; ++i)
+        {
+            // the square of a uniform draw leans to the front: early nodes are the basic ones
+            double u = std::uniform_real_distribution<double>(0, 1)(rng);
+            g.add_edge(v, Node(u * u * v));
+        }
+    }
+    return g;
+}
+
+double mean_edge(const ForceLayout& g)
+{
+    double sum = 0;
+    for(auto [a, b] : g.edges()) sum += std::sqrt((g.position(a) - g.position(b)).norm2());
+    return g.edges().empty() ? 0 : sum / double(g.edges().size());
+}
+
+double run(ForceLayout& g, unsigned iterations, const char* what)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    for(unsigned i = 0; i < iterations; ++i) g.step();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    std::printf("%-12s %u iterations in %.0f ms, %.1f iterations/s, mean edge %.2f k, step %.3f k\n", what, iterations, ms,
+                iterations * 1e3 / ms, mean_edge(g), g.step_length());
+    return ms;
+}
+
+// how far apart one step of the vector and the sequential kernel may put the layouts, as a share of
+// the width
+constexpr double sequential_tolerance = 1e-6;
+
+// the largest distance between a node's places in a and b, over the diameter of a
+double deviation(const ForceLayout& a, const ForceLayout& b)
+{
+    double worst = 0, lo = 1e300, hi = -1e300;
+    for(Node v = 0; v < a.size(); ++v)
+    {
+        worst = std::max(worst, double(std::sqrt((a.position(v) - b.position(v)).norm2())));
+        lo = std::min({lo, double(a.xs()[v]), double(a.ys()[v])});
+        hi = std::max({hi, double(a.xs()[v]), double(a.ys()[v])});
+    }
+    return worst / std::max(hi - lo, 1e-9);
+}
+
+// every node as a box k/2 wide under its own id, every edge under n + its index
+void boxes(const ForceLayout& g, std::vector<Box>& out)
+{
+    out.clear();
+    for(Node v = 0; v < g.size(); ++v) out.push_back(Box::around(g.xs()[v], g.ys()[v], 0.5f, 0.5f));
+    for(auto [a, b] : g.edges()) out.push_back(Box::segment(g.xs()[a], g.ys()[a], g.xs()[b], g.ys()[b]));
+}
+
+void hit_test(ForceLayout& g)
+{
+    using ms = std::chrono::duration<double, std::milli>;
+    std::vector<Box> bs;
+    boxes(g, bs);
+    Box all = bs[0];
+    for(const Box& b : bs) all = merge(all, b);
+
+    auto t0 = std::chrono::steady_clock::now();
+    SpatialIndex ix(0.25f);
+    ix.build(bs);
+    auto t1 = std::chrono::steady_clock::now();
+    std::printf("index: %zu boxes in %.1f ms, height %d\n", ix.size(), ms(t1 - t0).count(), ix.height());
+
+    // the pointer at random places, and a viewport a tenth of the drawing across
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> ux(all.x0, all.x1), uy(all.y0, all.y1);
+    const int points = 100000, views = 1000;
+    float vw = (all.x1 - all.x0) / 10, vh = (all.y1 - all.y0) / 10;
+    std::vector<Box> ps(points), vs(views);
+    for(Box& p : ps)
+    {
+        float x = ux(rng), y = uy(rng);
+        p = {x, y, x, y};
+    }
+    for(Box& v : vs)
+    {
+        float x = ux(rng), y = uy(rng);
+        v = Box::around(x, y, vw, vh);
+    }
+    std::size_t hits = 0, seen = 0, scanned = 0;
+    t0 = std::chrono::steady_clock::now();
+    for(const Box& p : ps) hits += ix.at(p.x0, p.y0).size();
+    t1 = std::chrono::steady_clock::now();
+    for(const Box& v : vs) ix.query(v, [&](SpatialIndex::Id) { ++seen; });
+    auto t2 = std::chrono::steady_clock::now();
+    for(const Box& p : ps)
+        for(const Box& b : bs) scanned += b.overlaps(p);
+    auto t3 = std::chrono::steady_clock::now();
+    for(const Box& v : vs)
+        for(const Box& b : bs) scanned += b.overlaps(v);
+    auto t4 = std::chrono::steady_clock::now();
+    std::printf("pointer:  %.2f us per query (scan %.1f us), %.1f hits\n", ms(t1 - t0).count() * 1e3 / points,
+                ms(t3 - t2).count() * 1e3 / points, double(hits) / points);
+    std::printf("viewport: %.1f us per query (scan %.1f us), %.0f hits%s\n", ms(t2 - t1).count() * 1e3 / views,
+                ms(t4 - t3).count() * 1e3 / views, double(seen) / views, hits + seen == scanned ? "" : ", NOT THE SCAN'S HITS");
+
+    // one more iteration moves everything a little; only what left its grown box is put back
+    g.step();
+    boxes(g, bs);
+    std::size_t moved = 0;
+    t0 = std::chrono::steady_clock::now();
+    for(SpatialIndex::Id id = 0; id < bs.size(); ++id) moved += ix.set(id, bs[id]);
+    t1 = std::chrono::steady_clock::now();
+    std::printf("one frame: %zu of %zu boxes put back in %.1f ms\n", moved, bs.size(), ms(t1 - t0).count());
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    unsigned iterations = argc > 2 ? unsigned(std::strtoul(argv[2], nullptr, 10)) : 300;
+
+    ForceLayout g = library_graph(n, {}), lanes = library_graph(n, {.kernel = LayoutKernel::Lanes}),
+                sequential = library_graph(n, {.kernel = LayoutKernel::Sequential});
+    std::printf("%zu nodes, %zu edges, mean edge %.2f k at the start, %d-wide kernel\n", g.size(), g.edges().size(),
+                mean_edge(g), VL_LAYOUT_SIMD);
+    g.step();
+    lanes.step();
+    sequential.step();
+    double first = deviation(g, lanes), baseline = deviation(g, sequential);
+    double vector_ms = run(g, iterations - 1, "vector:");
+    double lanes_ms = run(lanes, iterations - 1, "lanes:");
+    double sequential_ms = run(sequential, iterations - 1, "sequential:");
+    double last = deviation(g, lanes);
+    std::printf("speedup %.2fx over sequential (%.2fx over lanes); vector and lanes layouts differ by %.1e of their width "
+                "after one iteration, %.1e after %u; vector and sequential by %.1e after one\n",
+                sequential_ms / vector_ms, lanes_ms / vector_ms, first, last, iterations, baseline);
+    if(first > 1e-6 || last > 1e-6)
+    {
+        std::printf("FAIL: the vector and lane kernels disagree\n");
+        return 1;
+    }
+    // the sequential sum rounds differently, by a few float ulps of each force; later steps amplify
+    // that (the adaptive step), so only the first is compared
+    if(baseline > sequential_tolerance)
+    {
+        std::printf("FAIL: the vector and sequential kernels disagree by more than %.0e\n", sequential_tolerance);
+        return 1;
+    }
+
+    ForceLayout exact = library_graph(n, {.theta = 0});
+    auto t0 = std::chrono::steady_clock::now();
+    exact.step();
+    std::printf("all pairs: 1 iteration in %.0f ms\n",
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+
+    hit_test(g);
+}
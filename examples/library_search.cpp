@@ -0,0 +1,152 @@
+// library_search.cpp - benchmark for library search (SearchIndex and search_index in storage.hpp)
+// usage: library_search [names] [scratch dir]
+// binds generated Mathlib-style names (default 200000, the same ones every run) in a catalog, with
+// a docstring in notation as each one's metadata, builds the index from a snapshot of it, and
+// prints the median and worst time of each query over 20 runs: substring queries of one letter to a
+// full name, symbols, and fuzzy ones with one and two edits. substring queries are also timed as a
+// scan of every name and docstring, and must find the same number of documents, or it exits with 1
+// (c) 2025 Zachary R. James
+
+#include "storage.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace vl;
+
+namespace {
+
+using ms = std::chrono::duration<double, std::milli>;
+
+const char* spaces[] = {"Nat", "Int", "List", "Finset", "Set", "Real", "Polynomial", "MeasureTheory", "Matrix", "Filter"};
+const char* words[] = {"add", "mul", "sub", "comm", "assoc", "zero", "one", "succ", "le", "lt", "map", "sum", "prod", "card",
+                       "mem", "union", "inter", "image", "continuous", "tendsto", "integral", "det", "pow", "neg", "inv"};
+const char* docs[] = {"∀ n : ℕ, n + 0 = n", "a * b = b * a", "s ⊆ t → f '' s ⊆ f '' t", "⟨x, hx⟩ ∈ s",
+                      "∑ i ∈ s, f i ≤ ∑ i ∈ s, g i", "Tendsto f atTop (𝓝 a)", "∫ x, f x ∂μ", "α → β → α", "⊤ ≤ a ↔ a = ⊤"};
+
+// Namespace.word_word_word names and a docstring of one or two formulas each
+void library(std::size_t n, std::vector<std::string>& names, std::vector<std::string>& texts)
+{
+    std::mt19937 rng(42);
+    auto pick = [&](std::size_t k) { return std::size_t(rng() % k); };
+    for(std::size_t i = 0; i < n; ++i)
+    {
+        std::string name = spaces[pick(std::size(spaces))];
+        name += '.';
+        for(std::size_t w = 1 + pick(4); w-- > 0;) name += std::string(words[pick(std::size(words))]) + (w ? "_" : "");
+        name += '_' + std::to_string(i); // distinct names
+        std::string text = docs[pick(std::size(docs))];
+        if(pick(2)) text += std::string(" and ") + docs[pick(std::size(docs))];
+        names.push_back(std::move(name));
+        texts.push_back(std::move(text));
+    }
+}
+
+std::string fold(std::string s)
+{
+    for(char& c : s) c = c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c;
+    return s;
+}
+
+// median and worst of 20 runs of f, in ms
+template<class F>
+std::pair<double, double> timed(F&& f)
+{
+    std::vector<double> t;
+    for(int i = 0; i < 20; ++i)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        f();
+        t.push_back(ms(std::chrono::steady_clock::now() - t0).count());
+    }
+    std::sort(t.begin(), t.end());
+    return {t[t.size() / 2], t.back()};
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    std::filesystem::path dir = argc > 2 ? argv[2] : std::filesystem::temp_directory_path() / "vl_library_search";
+    std::filesystem::remove_all(dir);
+
+    std::vector<std::string> names, texts;
+    library(n, names, texts);
+    auto t0 = std::chrono::steady_clock::now();
+    {
+        Catalog c(dir);
+        std::uint64_t lsn = 0;
+        for(std::size_t i = 0; i < n; ++i)
+        {
+            Digest h{};
+            for(std::size_t b = 0; b < 8; ++b) h[b] = std::uint8_t(i >> 8 * b);
+            c.bind(names[i], h);
+            lsn = c.annotate(names[i], texts[i]);
+        }
+        c.commit(lsn);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    Catalog c(dir);
+    SearchIndex ix = search_index(c.snapshot());
+    auto t2 = std::chrono::steady_clock::now();
+    std::printf("%zu names: catalog written in %.0f ms, index built from a snapshot in %.0f ms\n", ix.size(),
+                ms(t1 - t0).count(), ms(t2 - t1).count());
+
+    std::vector<std::string> folded_names, folded_texts;
+    for(SearchIndex::Doc d = 0; d < ix.size(); ++d)
+    {
+        folded_names.push_back(fold(std::string(ix.name(d))));
+        folded_texts.push_back(fold(std::string(ix.text(d))));
+    }
+
+    int failed = 0;
+    double worst = 0;
+    const char* substrings[] = {"a", "le", "comm", "add_comm", "Nat.succ", "mul_assoc", "continuous", "ℕ", "⟨", "∂μ",
+                                "Finset.sum_card", "nothing_here"};
+    for(const char* q : substrings)
+    {
+        std::size_t hits = 0, all = ix.find(q, ix.size()).size(), scanned = 0;
+        auto [med, max] = timed([&] { hits = ix.find(q).size(); });
+        double scan = timed([&] {
+            std::string f = fold(q);
+            scanned = 0;
+            for(std::size_t d = 0; d < folded_names.size(); ++d)
+                scanned += folded_names[d].find(f) != std::string::npos || folded_texts[d].find(f) != std::string::npos;
+        }).first;
+        std::printf("find %-16s %6zu docs, first %2zu in %7.3f ms median, %7.3f ms worst (scan %.1f ms)%s\n", q, all, hits, med,
+                    max, scan, all == scanned ? "" : ", NOT THE SCAN'S COUNT");
+        failed += all != scanned;
+        worst = std::max(worst, max);
+    }
+
+    struct Fuzzy
+    {
+        const char* q;
+        std::uint32_t edits;
+    };
+    Fuzzy fuzzies[] = {{"asoc", 1},     {"ad_comm", 1},      {"Finset.sm", 1},  {"sucx_le", 1}, {"contnuous", 1},
+                       {"mul_asoc", 2}, {"Lst.mp", 2}, {"integrl_tendso", 2}, {"xyzzy", 2}};
+    for(const Fuzzy& z : fuzzies)
+    {
+        std::size_t hits = 0;
+        std::uint32_t best = 0;
+        auto [med, max] = timed([&] {
+            std::vector<SearchIndex::Match> m = ix.fuzzy(z.q, z.edits);
+            hits = m.size();
+            best = m.empty() ? 0 : m.front().distance;
+        });
+        std::printf("fuzzy %-15s %u edits: %2zu matches (closest %u) in %7.3f ms median, %7.3f ms worst\n", z.q, z.edits, hits,
+                    best, med, max);
+        worst = std::max(worst, max);
+    }
+    std::printf("worst query %.3f ms\n", worst);
+    std::filesystem::remove_all(dir);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+// proof_layout.cpp - benchmark for the proof view's layered layout (proof_graph.hpp)
+// usage: proof_layout [tactics]
+// plays a random proof (each tactic takes an open goal and leaves none, one or two subgoals, now
+// and then one is undone), default 5000 tactics, calling layout() after each as the view does, and
+// prints the time per tactic against one relayout() of the final tree, how many of the nodes placed
+// before a tactic moved, and the crossings either way; boxes that overlap in a layer exit with 1
+// (c) 2025 Zachary R. James
+
+#include "proof_graph.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace vl;
+
+namespace {
+
+// boxes in every layer at least their half widths and the gap apart
+bool separated(const ProofGraph& g, float gap)
+{
+    for(std::uint32_t l = 0; l < g.layers(); ++l)
+    {
+        std::span<const Node> row = g.layer_nodes(l);
+        for(std::size_t i = 0; i + 1 < row.size(); ++i)
+            if(g.x(row[i + 1]) - g.x(row[i]) < (g.width(row[i]) + g.width(row[i + 1])) / 2 + gap - 1e-3f)
+                return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::size_t tactics = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5000;
+    std::mt19937 rng(42);
+    ProofGraph g;
+    std::vector<Node> open{g.add(ProofKind::Goal, "theorem", 120)};
+    g.layout();
+
+    double ms = 0;
+    std::size_t moved = 0, old = 0;
+    std::vector<float> before;
+    for(std::size_t t = 0; t < tactics && !open.empty(); ++t)
+    {
+        before.resize(g.size());
+        for(Node v = 0; v < g.size(); ++v) before[v] = g.x(v);
+        std::size_t k = rng() % open.size();
+        Node goal = open[k];
+        open.erase(open.begin() + std::ptrdiff_t(k));
+        Node step = g.add(ProofKind::Step, "tactic", float(40 + rng() % 80), goal);
+        unsigned subgoals = open.size() > 16 && rng() % 3 == 0 ? 0 : 1 + (rng() % 4 == 0);
+        for(unsigned i = 0; i < subgoals; ++i) open.push_back(g.add(ProofKind::Goal, "goal", float(60 + rng() % 120), step));
+        if(rng() % 64 == 0) // undo: the goal comes back open
+        {
+            g.erase(step);
+            std::erase_if(open, [&](Node v) { return !g.alive(v); });
+            open.push_back(goal);
+        }
+
+        auto t0 = std::chrono::steady_clock::now();
+        g.layout();
+        ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        for(Node v = 0; v < before.size(); ++v)
+            if(g.alive(v)) ++old, moved += g.x(v) != before[v];
+    }
+    std::size_t incremental = g.crossings();
+    bool ok = separated(g, ProofLayoutOptions{}.gap);
+
+    auto t0 = std::chrono::steady_clock::now();
+    g.relayout();
+    double full = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    std::printf("%zu nodes in %zu layers\n", g.size(), g.layers());
+    std::printf("layout():   %.2f us per tactic, %.2f%% of the placed nodes moved, %zu crossings%s\n",
+                ms * 1e3 / double(tactics), 100.0 * double(moved) / double(std::max<std::size_t>(old, 1)),
+                incremental, ok ? "" : ", OVERLAP");
+    bool full_ok = separated(g, ProofLayoutOptions{}.gap);
+    std::printf("relayout(): %.2f ms, %zu crossings%s\n", full, g.crossings(), full_ok ? "" : ", OVERLAP");
+    if(!ok || !full_ok)
+    {
+        std::printf("FAIL: boxes in a layer overlap\n");
+        return 1;
+    }
+}
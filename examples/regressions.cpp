@@ -0,0 +1,1094 @@
+// regressions.cpp - the smallest programs that showed bugs found in review, and one case per kernel
+// rule that must refuse or reduce (positivity, universes, rollback, quotients, equations), run by ctest
+// usage: regressions [scratch dir]
+// extraction checks build the generated C++ with VL_CXX (the compiler this was built with), and
+// import checks read their .export fixtures from VL_EXAMPLES
+// each check prints one line; the exit status is the number that failed
+// (c) 2025 Zachary R. James
+
+#include "equations.hpp"
+#include "extract.hpp"
+#include "graph.hpp"
+#include "import.hpp"
+#include "prelude.hpp"
+#include "storage.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+using namespace vl;
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const char* what)
+{
+    std::printf("%s  %s\n", ok ? "ok  " : "FAIL", what);
+    failures += !ok;
+}
+
+// STORE //
+
+// a stored recursor is never trusted: flipping its K flag must not get it into the kernel
+void tampered_recursor(const std::filesystem::path& dir)
+{
+    std::filesystem::path root = dir / "store";
+    std::filesystem::remove_all(root);
+    const char* block[] = {"Nat", "Nat.zero", "Nat.succ", "Nat.rec"};
+    std::vector<Digest> hs;
+    {
+        Environment env;
+        load_prelude(env);
+        ContentStore store(env, root);
+        for(const char* n : block) hs.push_back(store.put(env.pool.names.intern(n)));
+        store.save();
+    }
+    auto load = [&](Environment& env) {
+        ContentStore store(env, root);
+        for(std::size_t i = 0; i < hs.size(); ++i) store.get(hs[i], env.pool.names.intern(block[i]));
+    };
+
+    bool clean = false;
+    try
+    {
+        Environment env;
+        load(env);
+        clean = !env.get(env.pool.names.intern("Nat.rec")).k;
+    }
+    catch(const std::exception& e) { std::printf("  %s\n", e.what()); }
+    check(clean, "store: an inductive block loads back");
+
+    std::string hex = to_hex(hs[3]);
+    std::filesystem::path object = root / "objects" / hex.substr(0, 2) / hex.substr(2);
+    {
+        std::fstream f(object, std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(15); // magic, version, kind, quot, is_rec, then k
+        f.put(1);
+    }
+    bool refused = false;
+    try
+    {
+        Environment env;
+        load(env);
+    }
+    catch(const storage_exception&) { refused = true; }
+    check(refused, "store: a recursor with its K flag flipped is refused");
+}
+
+// axioms a b : Nat hash differently (the hash leaves definitions' names out, and used to leave
+// axioms' out too), so a proof of a = a verified through the store does not let one of a = b past
+// the kernel
+void named_axioms(const std::filesystem::path& dir)
+{
+    std::filesystem::path root = dir / "axioms";
+    std::filesystem::remove_all(root);
+    Environment env;
+    load_prelude(env);
+    Pool& p = env.pool;
+    ContentStore store(env, root);
+    std::array<Level, 1> one{p.levels.one()};
+    Expr nat = p.cnst("Nat"), a = p.cnst("a"), b = p.cnst("b");
+    auto decl = [&](DeclKind kind, const char* n, Expr type, Expr value) {
+        Declaration d;
+        d.kind = kind;
+        d.name = p.names.intern(n);
+        d.type = type;
+        d.value = value;
+        return d;
+    };
+    auto eq = [&](Expr x, Expr y) { return p.app(p.app(p.app(p.cnst("Eq", one), nat), x), y); };
+    Expr refl = p.app(p.app(p.cnst("Eq.refl", one), nat), a);
+    std::string out;
+    try
+    {
+        store.add(decl(DeclKind::Axiom, "a", nat, no_expr));
+        store.add(decl(DeclKind::Axiom, "b", nat, no_expr));
+        store.add(decl(DeclKind::Theorem, "t1", eq(a, a), refl));
+        store.add(decl(DeclKind::Theorem, "t2", eq(a, b), refl));
+        out = "accepted (checked " + std::to_string(store.checked()) + " trusted " + std::to_string(store.trusted()) + ")";
+    }
+    catch(const std::exception& e) { out = e.what(); }
+    std::printf("  t2 : a = b := Eq.refl a: %s\n", out.c_str());
+    check(!env.find(p.names.intern("t2")) && store.hash(p.names.intern("a")) != store.hash(p.names.intern("b")),
+          "store: two axioms of one type hash apart, so a false theorem is not trusted");
+}
+
+// an edit committed after a checkpoint and a reopen survives the next reopen (the log used to
+// count from lsn 1 again, below the checkpoint's lsn, and recovery skipped those records)
+void edit_after_checkpoint(const std::filesystem::path& dir)
+{
+    std::filesystem::path root = dir / "catalog";
+    std::filesystem::remove_all(root);
+    Digest a{}, b{};
+    a[0] = 1;
+    b[0] = 2;
+    {
+        Catalog c(root);
+        c.commit(c.bind("a", a));
+        c.checkpoint();
+    }
+    {
+        Catalog c(root);
+        c.commit(c.bind("b", b));
+    }
+    Catalog c(root);
+    std::optional<CatalogEntry> e = c.find("b");
+    check(c.find("a") && e && e->hash == b, "catalog: an edit after a checkpoint and a reopen is kept");
+}
+
+// a log whose last record was cut short, or whose middle record has a flipped byte, recovers the
+// records before the damage, is cut back to them, and goes on from there
+void wal_damaged_tail(const std::filesystem::path& dir)
+{
+    std::filesystem::path path = dir / "damaged.wal";
+    auto write = [&](int n) {
+        std::filesystem::remove(path);
+        WriteAheadLog log(path);
+        log.recover([](std::uint64_t, std::string_view) {});
+        for(int i = 1; i <= n; ++i) log.append("edit " + std::to_string(i));
+        log.flush();
+    };
+    auto recover = [&] {
+        std::vector<std::string> got;
+        WriteAheadLog log(path);
+        std::uint64_t last = log.recover([&](std::uint64_t lsn, std::string_view rec) {
+            if(rec == "edit " + std::to_string(lsn)) got.emplace_back(rec);
+        });
+        return std::pair{last, got.size()};
+    };
+
+    write(5);
+    std::uintmax_t intact = std::filesystem::file_size(path);
+    {
+        std::ofstream f(path, std::ios::binary | std::ios::app);
+        f.write("\x20\0\0\0torn", 8); // the start of a sixth record
+    }
+    auto [torn_last, torn_n] = recover();
+    bool torn = torn_last == 5 && torn_n == 5 && std::filesystem::file_size(path) == intact;
+    {
+        WriteAheadLog log(path);
+        log.recover([](std::uint64_t, std::string_view) {});
+        log.commit(log.append("edit 6"));
+    }
+    auto [more_last, more_n] = recover();
+    check(torn && more_last == 6 && more_n == 6, "wal: a torn last record is cut off on reopen and the log goes on");
+
+    write(5);
+    std::uintmax_t size = std::filesystem::file_size(path);
+    {
+        std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(std::streamoff(size - 8)); // inside the payload of the last record
+        f.put('X');
+    }
+    auto [bad_last, bad_n] = recover();
+    check(bad_last == 4 && bad_n == 4 && std::filesystem::file_size(path) < size, "wal: a record that fails its crc is cut off with the rest");
+}
+
+// writers on several threads committing into one group window all come back durable, sharing
+// syncs, and every edit is there after a reopen
+void group_commit_threads(const std::filesystem::path& dir)
+{
+    std::filesystem::path root = dir / "group";
+    std::filesystem::remove_all(root);
+    constexpr int threads = 8, edits = 50;
+    std::uint64_t syncs = 0;
+    {
+        Catalog c(root, std::chrono::milliseconds(5));
+        std::vector<std::thread> ts;
+        for(int t = 0; t < threads; ++t)
+            ts.emplace_back([&c, t] {
+                for(int i = 0; i < edits; ++i)
+                {
+                    Digest h{};
+                    h[0] = std::uint8_t(t);
+                    h[1] = std::uint8_t(i);
+                    c.commit(c.bind("t" + std::to_string(t) + "." + std::to_string(i), h));
+                }
+            });
+        for(std::thread& t : ts) t.join();
+        syncs = c.log().syncs();
+    }
+    Catalog c(root);
+    bool all = c.size() == threads * edits;
+    for(int t = 0; t < threads; ++t)
+        for(int i = 0; i < edits; ++i)
+        {
+            std::optional<CatalogEntry> e = c.find("t" + std::to_string(t) + "." + std::to_string(i));
+            all = all && e && e->hash[0] == t && e->hash[1] == i;
+        }
+    std::printf("  %d edits in %llu syncs\n", threads * edits, (unsigned long long)syncs);
+    check(all && syncs < std::uint64_t(threads * edits), "wal: commits from several threads share syncs and all survive a reopen");
+}
+
+// a checkpoint empties the log; reopening reads the checkpoint alone, then edits on top of it, an
+// erase included
+void reopen_after_checkpoint(const std::filesystem::path& dir)
+{
+    std::filesystem::path root = dir / "checkpointed";
+    std::filesystem::remove_all(root);
+    Digest a{}, b{};
+    a[0] = 1;
+    b[0] = 2;
+    std::uint64_t lsn = 0;
+    {
+        Catalog c(root);
+        c.bind("a", a);
+        c.annotate("a", "first");
+        c.commit(c.bind("b", b));
+        c.checkpoint();
+        lsn = c.snapshot().lsn();
+    }
+    bool empty_log = std::filesystem::file_size(root / "catalog.wal") == sizeof(WalHeader), same = false;
+    {
+        Catalog c(root);
+        std::optional<CatalogEntry> e = c.find("a");
+        same = c.size() == 2 && e && e->hash == a && e->meta == "first" && c.snapshot().lsn() == lsn;
+        c.commit(c.erase("a"));
+    }
+    Catalog c(root);
+    check(empty_log && same && !c.find("a") && c.find("b") && c.snapshot().lsn() == lsn + 1,
+          "catalog: a checkpoint reopens as it was saved, and edits after it replay on top");
+}
+
+// a snapshot keeps the contents it was taken with through binds, annotations, erases and a
+// checkpoint after it
+void snapshot_isolation(const std::filesystem::path& dir)
+{
+    std::filesystem::path root = dir / "snapshot";
+    std::filesystem::remove_all(root);
+    Catalog c(root);
+    Digest h{};
+    for(int i = 0; i < 100; ++i)
+    {
+        h[0] = std::uint8_t(i);
+        c.bind("n" + std::to_string(i), h);
+        c.annotate("n" + std::to_string(i), "meta " + std::to_string(i));
+    }
+    auto contents = [](const CatalogSnapshot& s) {
+        std::vector<std::pair<std::string, CatalogEntry>> all;
+        s.for_each([&](std::string_view name, const CatalogEntry& e) { all.emplace_back(name, e); });
+        return all;
+    };
+    auto same = [](const auto& a, const auto& b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const auto& x, const auto& y) {
+                   return x.first == y.first && x.second.hash == y.second.hash && x.second.meta == y.second.meta;
+               });
+    };
+    CatalogSnapshot s = c.snapshot();
+    auto frozen = contents(s);
+    std::uint64_t lsn = s.lsn();
+    h[0] = 0xff;
+    for(int i = 0; i < 100; i += 3) c.erase("n" + std::to_string(i));
+    for(int i = 1; i < 100; i += 3) c.bind("n" + std::to_string(i), h);
+    for(int i = 2; i < 100; i += 3) c.annotate("n" + std::to_string(i), "changed");
+    c.bind("new", h);
+    c.checkpoint();
+    const CatalogEntry* e = s.find("n1");
+    bool kept = same(contents(s), frozen) && s.size() == 100 && s.lsn() == lsn && !s.find("new") && e && e->hash[0] == 1;
+    check(kept && c.size() == 100 - 34 + 1 && !same(contents(c.snapshot()), frozen), "snapshot: edits and a checkpoint after a snapshot leave it as it was");
+}
+
+// readers taking snapshots while a writer binds, erases and checkpoints each see exactly the
+// catalog as of their snapshot's lsn: edit j binds k<j>, and every fifth erases the name bound
+// three edits before
+void snapshot_readers(const std::filesystem::path& dir)
+{
+    std::filesystem::path root = dir / "readers";
+    std::filesystem::remove_all(root);
+    constexpr std::uint64_t edits = 2000;
+    Catalog c(root);
+    auto numbered = [](std::uint64_t j) {
+        Digest h{};
+        for(std::size_t b = 0; b < 8; ++b) h[b] = std::uint8_t(j >> 8 * b);
+        return h;
+    };
+    auto expected = [](std::uint64_t lsn) {
+        std::vector<std::string> names;
+        for(std::uint64_t j = 1; j <= lsn; ++j)
+            if(j % 5 != 0 && !(j + 3 <= lsn && (j + 3) % 5 == 0)) names.push_back("k" + std::to_string(j));
+        std::sort(names.begin(), names.end());
+        return names;
+    };
+    std::atomic<bool> done = false;
+    std::atomic<int> wrong = 0, seen = 0;
+    std::vector<std::thread> readers;
+    for(int r = 0; r < 3; ++r)
+        readers.emplace_back([&] {
+            while(!done)
+            {
+                CatalogSnapshot s = c.snapshot();
+                std::vector<std::string> names;
+                bool hashes = true;
+                s.for_each([&](std::string_view name, const CatalogEntry& e) {
+                    names.emplace_back(name);
+                    hashes = hashes && e.hash == numbered(std::stoull(std::string(name.substr(1))));
+                });
+                if(!hashes || names != expected(s.lsn()) || s.size() != names.size()) ++wrong;
+                ++seen;
+            }
+        });
+    for(std::uint64_t j = 1; j <= edits; ++j)
+    {
+        if(j % 5 == 0) c.erase("k" + std::to_string(j - 3));
+        else c.bind("k" + std::to_string(j), numbered(j));
+        if(j % 500 == 0) c.checkpoint();
+    }
+    done = true;
+    for(std::thread& t : readers) t.join();
+    std::printf("  %d snapshots read during %llu edits\n", seen.load(), (unsigned long long)edits);
+    check(wrong == 0 && seen > 0 && c.snapshot().size() == expected(edits).size(),
+          "snapshot: readers on other threads see exactly the catalog as of their snapshot");
+}
+
+// a catalog whose names are all erased names nothing live: compaction drops every object rather
+// than taking the empty root list for "no catalog" and keeping them all
+void compact_erased_catalog(const std::filesystem::path& dir)
+{
+    std::filesystem::path root = dir / "library";
+    std::filesystem::remove_all(root);
+    Digest h;
+    {
+        Environment env;
+        load_prelude(env);
+        ContentStore store(env, root);
+        h = store.put(env.pool.names.intern("Nat.add"));
+        store.save();
+    }
+    {
+        Catalog c(root);
+        c.commit(c.bind("Nat.add", h));
+        c.commit(c.erase("Nat.add"));
+    }
+    CompactStats s = compact_library(root);
+    Environment env;
+    ContentStore store(env, root);
+    std::printf("  %zu objects, %zu kept\n", s.objects_before, s.objects_after);
+    check(s.objects_before > 0 && s.objects_after == 0 && store.objects().empty(), "compact: a catalog with every name erased keeps no object");
+}
+
+// the saved lemma index of one prelude must not load over another: a change that keeps the
+// declaration count and the last name used to pass the only check there was
+void stale_lemma_index(const std::filesystem::path& dir)
+{
+    std::filesystem::path path = dir / "prelude.lemmas";
+    {
+        Environment env;
+        load_prelude(env);
+        LemmaIndex ix(env);
+        ix.update();
+        save_lemma_index(ix, env, path, 1);
+    }
+    auto loads = [&](std::uint64_t key, bool rename) {
+        Environment env;
+        load_prelude(env);
+        if(rename) // Nat.add.eq_1 swapped for a theorem of another name, the last declaration kept
+        {
+            std::vector<Declaration> ds(env.decls().begin(), env.decls().end());
+            auto it = std::find_if(ds.begin(), ds.end(), [&](const Declaration& d) { return env.pool.names.view(d.name) == "Nat.add.eq_1"; });
+            if(it == ds.end()) return true;
+            it->name = env.pool.names.intern("Nat.add.zero");
+            std::size_t i = std::size_t(it - ds.begin());
+            env.truncate(i);
+            for(; i < ds.size(); ++i) env.add(ds[i]);
+        }
+        LemmaIndex ix(env);
+        try { load_lemma_index(ix, env, path, key); }
+        catch(const storage_exception&) { return false; }
+        return true;
+    };
+    check(loads(1, false) && !loads(2, false) && !loads(1, true), "lemma index: a saved index loads only over the environment it covers");
+}
+
+// a BTree with small pages under random puts and erases against std::map: splits and merges copy
+// on write, a commit survives reopening, rollback() returns to it, and a torn newest header falls
+// back to the commit before
+void btree_against_map(const std::filesystem::path& dir)
+{
+    std::filesystem::path path = dir / "tree";
+    std::filesystem::remove(path);
+    std::mt19937 rng(42);
+    auto pick = [&](std::size_t n) { return std::size_t(rng() % n); };
+    auto random_key = [&] { return "k" + std::to_string(pick(3000)); };
+    std::map<std::string, std::string> want, committed, before;
+    auto same = [&](BTree& t, const std::map<std::string, std::string>& m) {
+        std::vector<std::pair<std::string, std::string>> all;
+        t.for_each([&](std::string_view k, std::string_view v) { all.emplace_back(k, v); });
+        bool ok = t.size() == m.size() && all == std::vector<std::pair<std::string, std::string>>(m.begin(), m.end());
+        for(int i = 0; ok && i < 50; ++i)
+        {
+            std::string k = random_key();
+            auto it = m.find(k);
+            ok = t.get(k) == (it == m.end() ? std::nullopt : std::optional<std::string>(it->second));
+        }
+        return ok;
+    };
+
+    bool ops = true, reopened = true, rolled_back = true, prefixes = true;
+    auto t = std::make_unique<BTree>(path, 512);
+    for(int round = 0; round < 20; ++round)
+    {
+        for(int i = 0; i < 400; ++i)
+        {
+            std::string k = random_key();
+            if(pick(3) == 0)
+            {
+                bool had = want.erase(k) > 0;
+                ops = ops && t->erase(k) == had;
+            }
+            else
+            {
+                std::string v(pick(40), char('a' + pick(26)));
+                t->put(k, v);
+                want[k] = v;
+            }
+        }
+        ops = ops && same(*t, want);
+        if(round % 4 == 3) // dropped: back to the last commit
+        {
+            t->rollback();
+            want = committed;
+            rolled_back = rolled_back && same(*t, want);
+            continue;
+        }
+        t->commit();
+        before = std::exchange(committed, want);
+        t = std::make_unique<BTree>(path);
+        reopened = reopened && same(*t, want);
+
+        std::string prefix = "k" + std::to_string(pick(10)), from = prefix + std::to_string(pick(10));
+        std::vector<std::string> got, scan;
+        t->for_each([&](std::string_view k, std::string_view) { got.emplace_back(k); }, prefix, from);
+        for(auto it = want.lower_bound(from); it != want.end() && it->first.starts_with(prefix); ++it) scan.push_back(it->first);
+        prefixes = prefixes && got == scan;
+    }
+    check(ops, "btree: random puts and erases read back as std::map has them");
+    check(reopened, "btree: a commit reads back the same after reopening");
+    check(rolled_back, "btree: rollback() returns to the last commit");
+    check(prefixes, "btree: a prefix walk from a key visits the map's keys in order");
+
+    // the newer of the two header slots torn: the tree opens at the commit before
+    t.reset();
+    std::uint64_t txn[2] = {};
+    {
+        std::ifstream f(path, std::ios::binary);
+        for(std::uint64_t slot = 0; slot < 2; ++slot)
+        {
+            f.seekg(std::streamoff(slot * 256 + offsetof(BTreeHeader, txn)));
+            f.read(reinterpret_cast<char*>(&txn[slot]), sizeof(txn[slot]));
+        }
+    }
+    {
+        std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(std::streamoff((txn[1] > txn[0] ? 256 : 0) + offsetof(BTreeHeader, entries)));
+        f.put(char(0x5a));
+    }
+    bool recovered = false;
+    try
+    {
+        BTree old(path);
+        recovered = same(old, before);
+    }
+    catch(const std::exception& e) { std::printf("  %s\n", e.what()); }
+    check(recovered, "btree: a torn newest header falls back to the commit before it");
+}
+
+// MetaStore over the prelude: what Nat.add uses and what uses Nat, and a name range in order
+void meta_queries(const std::filesystem::path& dir)
+{
+    std::filesystem::path path = dir / "meta";
+    std::filesystem::remove(path);
+    Environment env;
+    load_prelude(env);
+    std::vector<std::string> range, scan;
+    {
+        MetaStore m(path);
+        record_declarations(m, env);
+        m.commit();
+    }
+    MetaStore m(path);
+    std::vector<std::string> uses, users;
+    m.uses("Nat.add", [&](std::string_view t) { uses.emplace_back(t); });
+    m.used_by("Nat", [&](std::string_view u) { users.emplace_back(u); });
+    m.for_each([&](std::string_view name, std::string_view attr, std::string_view) {
+        if(attr == "kind") range.emplace_back(name);
+    }, "Nat.");
+    for(const Declaration& d : env.decls())
+        if(env.pool.names.view(d.name).starts_with("Nat.")) scan.push_back(env.pool.names.str(d.name));
+    std::sort(scan.begin(), scan.end());
+    auto has = [](const std::vector<std::string>& v, const char* n) { return std::find(v.begin(), v.end(), n) != v.end(); };
+    std::printf("  Nat.add uses %zu, Nat used by %zu, %zu names under Nat.\n", uses.size(), users.size(), range.size());
+    check(has(uses, "Nat") && has(users, "Nat.add") && has(users, "Nat.succ") && std::is_sorted(users.begin(), users.end()),
+          "meta: uses and used-by are the two directions of one reference");
+    check(range == scan && m.get("Nat.add", "kind") == "definition", "meta: a prefix range lists every name under it, in order");
+}
+
+// SearchIndex over random names against a scan of every document: fuzzy queries shorter than 6
+// bytes used to allow fewer edits than asked, down to exact matching below 3
+void search_against_scan()
+{
+    std::mt19937 rng(42);
+    auto pick = [&](std::size_t n) { return std::size_t(rng() % n); };
+    const char* parts[] = {"Nat", "add", "mul", "comm", "assoc", "List", "map", "succ", "le", "lt", "zero", "Finset", "sum", "ne"};
+    const char* symbols[] = {"ℕ", "→", "⟨", "⟩", "α", "≤"};
+    auto word = [&] {
+        std::string w = parts[pick(std::size(parts))];
+        if(pick(3) == 0) w += char('a' + pick(26));
+        return w;
+    };
+    SearchIndex ix;
+    std::vector<std::string> names, texts;
+    for(int i = 0; i < 2000; ++i)
+    {
+        std::string n = word(), t;
+        for(std::size_t j = pick(3); j-- > 0;) n += (pick(2) ? "." : "_") + word();
+        for(std::size_t j = pick(4); j-- > 0;) t += std::string(pick(2) ? symbols[pick(std::size(symbols))] : parts[pick(std::size(parts))]) + " ";
+        ix.add(n, t);
+        names.push_back(n);
+        texts.push_back(t);
+    }
+    std::vector<bool> erased(names.size());
+    for(int i = 0; i < 100; ++i)
+    {
+        std::size_t d = pick(names.size());
+        ix.erase(SearchIndex::Doc(d));
+        erased[d] = true;
+    }
+
+    auto fold = [](std::string s) {
+        for(char& c : s) c = c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c;
+        return s;
+    };
+    // edit distance from q to the closest substring of s
+    auto distance = [&](const std::string& q, const std::string& s) {
+        std::vector<std::uint32_t> col(q.size() + 1);
+        for(std::size_t i = 0; i <= q.size(); ++i) col[i] = std::uint32_t(i);
+        std::uint32_t best = col.back();
+        for(char c : s)
+        {
+            std::uint32_t diag = 0; // a match may start at any column
+            for(std::size_t i = 1; i <= q.size(); ++i)
+            {
+                std::uint32_t up = col[i];
+                col[i] = std::min({up + 1, col[i - 1] + 1, diag + (c == q[i - 1] ? 0u : 1u)});
+                diag = up;
+            }
+            col[0] = 0;
+            best = std::min(best, col.back());
+        }
+        return best;
+    };
+
+    bool found = true, fuzzy = true, top = true;
+    for(int i = 0; i < 300; ++i)
+    {
+        // a piece of a name with up to two bytes changed, dropped or added
+        std::string q = names[pick(names.size())];
+        std::size_t len = 1 + pick(std::min<std::size_t>(q.size(), 9));
+        q = q.substr(pick(q.size() - len + 1), len);
+        for(std::size_t e = pick(3); e-- > 0 && !q.empty();)
+        {
+            std::size_t at = pick(q.size());
+            char c = char('a' + pick(26));
+            if(int op = int(pick(3)); op == 0) q[at] = c;
+            else if(op == 1) q.erase(at, 1);
+            else q.insert(at, 1, c);
+        }
+        if(q.empty()) continue;
+        std::string f = fold(q);
+
+        std::vector<SearchIndex::Doc> got = ix.find(q, names.size()), want;
+        for(std::size_t d = 0; d < names.size(); ++d)
+            if(!erased[d] && (fold(names[d]).find(f) != std::string::npos || fold(texts[d]).find(f) != std::string::npos))
+                want.push_back(SearchIndex::Doc(d));
+        std::sort(got.begin(), got.end());
+        found = found && got == want;
+
+        for(std::uint32_t k = 0; k <= 2; ++k)
+        {
+            std::vector<std::pair<SearchIndex::Doc, std::uint32_t>> all, scan;
+            for(const SearchIndex::Match& m : ix.fuzzy(q, k, names.size())) all.push_back({m.doc, m.distance});
+            std::vector<std::tuple<std::uint32_t, std::size_t, SearchIndex::Doc>> ranked;
+            for(std::size_t d = 0; d < names.size(); ++d)
+                if(std::uint32_t dist = distance(f, fold(names[d])); !erased[d] && dist <= k)
+                {
+                    scan.push_back({SearchIndex::Doc(d), dist});
+                    ranked.push_back({dist, names[d].size(), SearchIndex::Doc(d)});
+                }
+            std::sort(all.begin(), all.end());
+            fuzzy = fuzzy && all == scan;
+
+            std::sort(ranked.begin(), ranked.end());
+            std::vector<SearchIndex::Match> best = ix.fuzzy(q, k, 10);
+            top = top && best.size() == std::min<std::size_t>(10, ranked.size());
+            for(std::size_t j = 0; top && j < best.size(); ++j) top = best[j].doc == std::get<2>(ranked[j]);
+        }
+    }
+    check(found, "search: substring queries find what a scan of names and texts finds");
+    check(fuzzy, "search: fuzzy queries of any length find what a scan finds, with its distances");
+    check(top, "search: the first fuzzy matches are the scan's best, in its order");
+}
+
+// IMPORT //
+
+// examples/outcomes.export: axioms A : Type and a : A go in, b : Prop := a is rejected, s := "DE"
+// is unsupported and t := s depends on it
+void export_outcomes()
+{
+    Environment env;
+    std::ifstream in(std::filesystem::path(VL_EXAMPLES) / "outcomes.export");
+    ImportStats s;
+    try { s = import_export(env, in); }
+    catch(const std::exception& e) { std::printf("  %s\n", e.what()); }
+    std::printf("  %zu decls: %zu checked, %zu failed, %zu unsupported, %zu dependent\n", s.decls, s.checked, s.failed, s.unsupported,
+                s.dependents);
+    check(s.decls == 5 && s.checked == 2 && s.failed == 1 && s.unsupported == 1 && s.dependents == 1 &&
+              env.find(env.pool.names.intern("a")) && !env.find(env.pool.names.intern("t")),
+          "import: each outcome of the fixture is counted once");
+}
+
+// imports `text` over the prelude; the stats, or nothing if the importer threw
+std::optional<ImportStats> import_text(const char* text)
+{
+    Environment env;
+    load_prelude(env);
+    std::istringstream in(text);
+    try { return import_export(env, in, {.threaded = false}); }
+    catch(const storage_exception& e) { std::printf("  %s\n", e.what()); }
+    return std::nullopt;
+}
+
+// a #QUOT line is compared with the kernel's primitive like any declaration already there (it was
+// taken as Ok whatever type it stated), and a bare # is an error rather than a read past its end
+void export_quot()
+{
+    // Quot.{u} : {α : Sort u} → (α → α → Prop) → Sort u
+    const char* names = "1 #NS 0 Quot\n2 #NS 0 u\n3 #NS 0 α\n4 #NS 0 r\n5 #NS 0 a\n1 #UP 2\n0 #ES 1\n";
+    std::string quot = std::string(names) +
+                       "1 #EV 0\n2 #ES 0\n3 #EV 1\n4 #EP #BD 5 3 2\n5 #EP #BD 5 1 4\n6 #EP #BD 4 5 0\n7 #EP #BI 3 0 6\n#QUOT 1 7 2\n";
+    std::string wrong = std::string(names) + "#QUOT 1 0 2\n";
+    std::optional<ImportStats> ok = import_text(quot.c_str()), bad = import_text(wrong.c_str());
+    check(ok && ok->checked == 1 && bad && bad->failed == 1 && !bad->errors.empty(),
+          "import: a #QUOT line must state the kernel's type for the primitive");
+    check(!import_text("1 #NS 0 x\n5 #\n"), "import: a bare # is a malformed line");
+}
+
+// GRAPH //
+
+// TopoOrder under random edge inserts and removals: after each one every dependency is before its
+// user, an insert is refused exactly when the dependency already reaches the user (found by a
+// search), and a refused insert's cycle is made of edges that are there, from v back to u
+void topo_random_edits()
+{
+    constexpr std::size_t n = 300;
+    TopoOrder g(n);
+    std::mt19937 rng(42);
+    std::vector<std::pair<Node, Node>> edges;
+    // does v depend on u through edges already there
+    auto reaches = [&](Node v, Node u) {
+        std::vector<bool> seen(n);
+        std::vector<Node> todo{v};
+        while(!todo.empty())
+        {
+            Node x = todo.back();
+            todo.pop_back();
+            if(x == u) return true;
+            for(Node y : g.deps(x))
+                if(!seen[y])
+                {
+                    seen[y] = true;
+                    todo.push_back(y);
+                }
+        }
+        return false;
+    };
+
+    bool ordered = true, refused_right = true, cycles = true;
+    std::size_t refused = 0;
+    for(int i = 0; i < 6000; ++i)
+    {
+        if(!edges.empty() && rng() % 3 == 0)
+        {
+            std::size_t k = rng() % edges.size();
+            g.remove_edge(edges[k].first, edges[k].second);
+            edges[k] = edges.back();
+            edges.pop_back();
+        }
+        else
+        {
+            Node u = Node(rng() % n), v = Node(rng() % n);
+            bool had = g.has_edge(u, v), cyclic = u == v || reaches(v, u);
+            std::vector<Node> before(g.order().begin(), g.order().end());
+            std::vector<Node> cycle;
+            bool added = g.add_edge(u, v, &cycle);
+            refused_right = refused_right && added == !cyclic;
+            if(added && !had) edges.push_back({u, v});
+            if(!added)
+            {
+                ++refused;
+                bool ok = !cycle.empty() && cycle.front() == v && cycle.back() == u && !g.has_edge(u, v) &&
+                          std::equal(before.begin(), before.end(), g.order().begin());
+                for(std::size_t j = 0; ok && j + 1 < cycle.size(); ++j) ok = g.has_edge(cycle[j], cycle[j + 1]);
+                cycles = cycles && ok;
+            }
+        }
+        for(auto [u, v] : edges) ordered = ordered && g.position(v) < g.position(u);
+        for(Node x = 0; x < n; ++x) ordered = ordered && g.order()[g.position(x)] == x;
+    }
+    std::printf("  %zu edges left, %zu inserts refused\n", edges.size(), refused);
+    check(ordered, "topo: every dependency stays before its user through inserts and removals");
+    check(refused_right && refused > 0, "topo: an insert is refused exactly when it closes a cycle");
+    check(cycles, "topo: a refused insert changes nothing and hands back a cycle of real edges from v to u");
+}
+
+// KERNEL //
+
+// add_inductive(env, decl) throws with a message containing `error` and leaves env as it was
+bool refused(Environment& env, const InductiveDecl& decl, const char* error)
+{
+    std::size_t before = env.decls().size();
+    std::string out;
+    try { add_inductive(env, decl); }
+    catch(const kernel_exception& e) { out = e.what(); }
+    std::printf("  %s\n", out.c_str());
+    bool gone = true;
+    for(const InductiveType& t : decl.types) gone = gone && !env.find(t.name);
+    return out.find(error) != std::string::npos && env.decls().size() == before && gone;
+}
+
+// inductive Bad | mk : (Bad → Nat) → Bad
+void non_positive()
+{
+    Environment env;
+    load_prelude(env);
+    Pool& p = env.pool;
+    Expr bad = p.cnst("Bad");
+    check(refused(env, {{}, 0, {{p.names.intern("Bad"), p.sort(p.levels.one()), {{p.names.intern("Bad.mk"), p.arrow(p.arrow(bad, p.cnst("Nat")), bad)}}}}},
+                  "non positive occurrence"),
+          "inductive: a type to the left of an arrow in its own constructor is refused");
+}
+
+// inductive Big : Type | mk : Type → Big, a field in a universe above the type's
+void universe_too_big()
+{
+    Environment env;
+    load_prelude(env);
+    Pool& p = env.pool;
+    Expr type = p.sort(p.levels.one());
+    check(refused(env, {{}, 0, {{p.names.intern("Big"), type, {{p.names.intern("Big.mk"), p.arrow(type, p.cnst("Big"))}}}}}, "is too big"),
+          "inductive: a field in a larger universe than its type is refused");
+}
+
+// mutual A | mk : A, B | mk : (B → Nat) → B: A is declared before B's constructor fails, and taken
+// back out with it
+void mutual_rollback()
+{
+    Environment env;
+    load_prelude(env);
+    Pool& p = env.pool;
+    Expr type = p.sort(p.levels.one()), a = p.cnst("A"), b = p.cnst("B");
+    InductiveDecl decl{{}, 0, {{p.names.intern("A"), type, {{p.names.intern("A.mk"), a}}},
+                               {p.names.intern("B"), type, {{p.names.intern("B.mk"), p.arrow(p.arrow(b, p.cnst("Nat")), b)}}}}};
+    check(refused(env, decl, "non positive occurrence") && !env.find(p.names.intern("A.mk")) && !env.find(p.names.intern("A.rec")),
+          "inductive: a refused mutual block leaves none of its types behind");
+}
+
+// Quot.lift f h (Quot.mk r a) ≡ f a and Quot.ind β h (Quot.mk r a) ≡ h a, over r := Eq on Nat;
+// on a q that is not Quot.mk neither reduces
+void quot_reduction()
+{
+    Environment env;
+    load_prelude(env);
+    Pool& p = env.pool;
+    TypeChecker tc(env);
+    std::array<Level, 1> one{p.levels.one()};
+    std::array<Level, 2> one_one{p.levels.one(), p.levels.one()};
+    Expr nat = p.cnst("Nat");
+    auto eq = [&](Expr x, Expr y) { return p.app(p.app(p.app(p.cnst("Eq", one), nat), x), y); };
+    Expr x = tc.mk_local("x", nat), y = tc.mk_local("y", nat);
+    Expr r = tc.mk_lambda(std::array{x, y}, eq(x, y));
+    Expr f = p.cnst("Nat.succ");
+    Expr h = tc.mk_local("h", tc.mk_pi(std::array{x, y}, p.arrow(p.app(p.app(r, x), y), eq(p.app(f, x), p.app(f, y)))));
+    Expr a = tc.mk_local("a", nat);
+    Expr quot = p.app(p.app(p.cnst("Quot", one), nat), r);
+    Expr mk = p.app(p.app(p.app(p.cnst("Quot.mk", one), nat), r), a);
+    Expr q = tc.mk_local("q", quot);
+    auto lift = [&](Expr on) { return p.app(p.app(p.app(p.app(p.app(p.app(p.cnst("Quot.lift", one_one), nat), r), nat), f), h), on); };
+
+    Expr w = tc.mk_local("w", quot);
+    Expr motive = tc.mk_lambda(std::array{w}, eq(p.cnst("Nat.zero"), p.cnst("Nat.zero")));
+    Expr hmk = tc.mk_local("hmk", tc.mk_pi(std::array{a}, p.app(motive, p.app(p.app(p.app(p.cnst("Quot.mk", one), nat), r), a))));
+    auto ind = [&](Expr on) { return p.app(p.app(p.app(p.app(p.app(p.cnst("Quot.ind", one), nat), r), motive), hmk), on); };
+
+    bool ok = false;
+    try
+    {
+        ok = tc.is_def_eq(tc.infer(lift(mk)), nat) && tc.is_def_eq(lift(mk), p.app(f, a)) && !tc.is_def_eq(lift(mk), a) &&
+             tc.whnf(lift(q)) == lift(q) && tc.whnf(ind(mk)) == p.app(hmk, a) && tc.whnf(ind(q)) == ind(q);
+    }
+    catch(const kernel_exception& e) { std::printf("  %s\n", e.what()); }
+    check(ok, "quot: Quot.lift and Quot.ind reduce on Quot.mk and only there");
+}
+
+// a definition without a value (Environment::add does not check) is not δ-unfolded, by whnf or the
+// lazy δ loop of is_def_eq, rather than unfolding to no_expr
+void delta_without_value()
+{
+    Environment env;
+    load_prelude(env);
+    Pool& p = env.pool;
+    Declaration d;
+    d.kind = DeclKind::Definition;
+    d.name = p.names.intern("c");
+    d.type = p.cnst("Nat");
+    env.add(d);
+    TypeChecker tc(env);
+    Expr c = p.cnst("c"), zero = p.cnst("Nat.zero");
+    bool ok = tc.whnf(c) == c && !tc.is_def_eq(c, zero) && !tc.is_def_eq(p.app(p.cnst("Nat.succ"), c), p.app(p.cnst("Nat.succ"), zero));
+    check(ok, "kernel: a definition without a value stays folded");
+}
+
+// EVALUATION //
+
+// structure P where n : Nat, h : n = n, over the prelude
+void declare_proof_field(Environment& env)
+{
+    Pool& p = env.pool;
+    TypeChecker tc(env);
+    std::array<Level, 1> one{p.levels.one()};
+    Expr nat = p.cnst("Nat"), P = p.cnst("P");
+    Expr n = tc.mk_local("n", nat);
+    Expr h = tc.mk_local("h", p.app(p.app(p.app(p.cnst("Eq", one), nat), n), n));
+    add_inductive(env, {{}, 0, {{p.names.intern("P"), p.sort(p.levels.one()), {{p.names.intern("P.mk"), tc.mk_pi(std::array{n, h}, P)}}}}});
+}
+
+// P.rec (fun n h => n) (P.mk 3 (Eq.refl 3)): the minor takes the proof field too, though
+// constructor values used to keep only n
+Expr proof_field_term(Environment& env)
+{
+    declare_proof_field(env);
+    Pool& p = env.pool;
+    TypeChecker tc(env);
+    std::array<Level, 1> one{p.levels.one()};
+    Expr nat = p.cnst("Nat"), three = p.cnst("Nat.zero");
+    for(int i = 0; i < 3; ++i) three = p.app(p.cnst("Nat.succ"), three);
+    Expr n = tc.mk_local("n", nat);
+    Expr h = tc.mk_local("h", p.app(p.app(p.app(p.cnst("Eq", one), nat), n), n));
+    Expr motive = tc.mk_lambda(std::array{tc.mk_local("x", p.cnst("P"))}, nat);
+    Expr minor = tc.mk_lambda(std::array{n, h}, n);
+    Expr refl = p.app(p.app(p.cnst("Eq.refl", one), nat), three);
+    return p.app(p.app(p.app(p.cnst("P.rec", one), motive), minor), p.app(p.app(p.cnst("P.mk"), three), refl));
+}
+
+void proof_field_eval()
+{
+    Environment env;
+    load_prelude(env);
+    Expr e = proof_field_term(env);
+    TypeChecker tc(env);
+    std::string out;
+    try
+    {
+        tc.check(e);
+        Evaluator ev(env);
+        out = ev.to_string(ev.eval(e));
+    }
+    catch(const std::exception& ex) { out = ex.what(); }
+    std::printf("  P.rec (fun n h => n) (P.mk 3 rfl) = %s\n", out.c_str());
+    check(out == "3", "eval: a minor premise sees every field of a structure with a proof field");
+}
+
+// 256^7, 256^8 and 2^63 + 2^63 as prelude terms
+std::array<Expr, 3> overflow_terms(Environment& env)
+{
+    Pool& p = env.pool;
+    auto num = [&](int k) {
+        Expr e = p.cnst("Nat.zero");
+        while(k--) e = p.app(p.cnst("Nat.succ"), e);
+        return e;
+    };
+    auto op = [&](const char* f, Expr x, Expr y) { return p.app(p.app(p.cnst(f), x), y); };
+    Expr b = num(256), e = b;
+    for(int i = 0; i < 6; ++i) e = op("Nat.mul", e, b);
+    Expr half = op("Nat.mul", e, num(128)); // 2^63
+    return {e, op("Nat.mul", e, b), op("Nat.add", half, half)};
+}
+
+// 256^7 evaluates; 256^8 and 2^63 + 2^63 do not fit in the machine word and must not wrap to 0
+void nat_overflow()
+{
+    Environment env;
+    load_prelude(env);
+    auto [e, mul_e, add_e] = overflow_terms(env);
+    Evaluator ev(env);
+    auto run = [&](Expr x) {
+        try { return ev.to_string(ev.eval(x)); }
+        catch(const eval_exception& ex) { return std::string(ex.what()); }
+    };
+    std::string fits = run(e), mul = run(mul_e), add = run(add_e);
+    std::printf("  256^7 = %s, 256^8: %s, 2^63 + 2^63: %s\n", fits.c_str(), mul.c_str(), add.c_str());
+    check(fits == "72057594037927936" && mul == "Nat overflow" && add == "Nat overflow", "eval: Nat arithmetic past 2^64 is an error");
+}
+
+// EQUATIONS //
+
+// same n n = n used to compile with both columns bound to one variable, so same 2 3 was 3
+void nonlinear_pattern()
+{
+    Environment env;
+    load_prelude(env);
+    Pool& p = env.pool;
+    TypeChecker tc(env);
+    Expr nat = p.cnst("Nat"), n = tc.mk_local("n", nat);
+    std::string out;
+    try { add_equations(env, {p.names.intern("same"), {}, p.arrow(nat, p.arrow(nat, nat)), {{{n, n}, n}}}); }
+    catch(const kernel_exception& e) { out = e.what(); }
+    std::printf("  same n n = n: %s\n", out.c_str());
+    check(out.find("uses a pattern variable twice") != std::string::npos && !env.find(p.names.intern("same")),
+          "equations: a pattern variable used twice in one equation is refused");
+}
+
+// the compiler's own errors: a constructor no equation covers, an equation no argument can reach
+void missing_and_redundant()
+{
+    Environment env;
+    load_prelude(env);
+    Pool& p = env.pool;
+    TypeChecker tc(env);
+    Expr nat = p.cnst("Nat"), zero = p.cnst("Nat.zero"), n = tc.mk_local("n", nat);
+    auto run = [&](const char* name, std::vector<Equation> eqns) {
+        try { add_equations(env, {p.names.intern(name), {}, p.arrow(nat, nat), std::move(eqns)}); }
+        catch(const kernel_exception& e) { return std::string(e.what()); }
+        return std::string();
+    };
+    std::string missing = run("isZero", {{{zero}, zero}});
+    std::string redundant = run("always", {{{n}, zero}, {{zero}, p.app(p.cnst("Nat.succ"), zero)}});
+    std::printf("  %s; %s\n", missing.c_str(), redundant.c_str());
+    check(missing.starts_with("missing case 'isZero") && redundant == "equation 2 of 'always' is redundant" &&
+              !env.find(p.names.intern("isZero")) && !env.find(p.names.intern("always")),
+          "equations: a missing case and a redundant equation are refused");
+}
+
+// an equation lemma the kernel refuses (here its name is taken) takes the definition back out
+void lemma_rollback()
+{
+    Environment env;
+    load_prelude(env);
+    Pool& p = env.pool;
+    TypeChecker tc(env);
+    Expr nat = p.cnst("Nat"), n = tc.mk_local("n", nat);
+    add_definition(env, p.names.intern("pred.eq_2"), {}, nat, p.cnst("Nat.zero"));
+    std::size_t before = env.decls().size();
+    bool threw = false;
+    try
+    {
+        add_equations(env, {p.names.intern("pred"), {}, p.arrow(nat, nat), {
+            {{p.cnst("Nat.zero")}, p.cnst("Nat.zero")},
+            {{p.app(p.cnst("Nat.succ"), n)}, n}}});
+    }
+    catch(const kernel_exception&) { threw = true; }
+    check(threw && env.decls().size() == before && !env.find(p.names.intern("pred")),
+          "equations: a refused equation lemma leaves no definition behind");
+}
+
+// EXTRACTION //
+
+// bench_main for the terms, built with the compiler this was built with and run: its exit status
+// is 0 and out has its lines
+bool run_extracted(const std::filesystem::path& dir, const std::string& stem, Environment& env,
+                   const std::vector<std::pair<std::string, Expr>>& terms, std::vector<std::string>& out)
+{
+    Evaluator ev(env);
+    Extractor x(ev);
+    std::filesystem::path src = dir / (stem + ".cpp"), exe = dir / stem, log = dir / (stem + ".out");
+    std::ofstream(src) << x.bench_main(terms, 1);
+    std::string build = std::string(VL_CXX) + " -std=c++23 -O1 -fsanitize=address -o " + exe.string() + " " + src.string();
+    if(std::system(build.c_str()) != 0) return false;
+    bool ran = std::system((exe.string() + " > " + log.string()).c_str()) == 0;
+    std::ifstream in(log);
+    for(std::string line; std::getline(in, line);)
+    {
+        std::printf("  %s\n", line.c_str());
+        out.push_back(line);
+    }
+    return ran;
+}
+
+// the same term extracted to C++
+void proof_field_extract(const std::filesystem::path& dir)
+{
+    Environment env;
+    load_prelude(env);
+    Expr e = proof_field_term(env);
+    std::vector<std::string> out;
+    bool ran = run_extracted(dir, "proof_field", env, {{"proof_field", e}}, out);
+    check(ran && out.size() == 1 && out[0].ends_with("= 3"), "extract: a recursor over a structure with a proof field reads every field");
+}
+
+// extracted Nat arithmetic fails where the evaluator does, rather than printing a wrapped number
+void nat_overflow_extract(const std::filesystem::path& dir)
+{
+    Environment env;
+    load_prelude(env);
+    auto [e, mul_e, add_e] = overflow_terms(env);
+    std::vector<std::string> out;
+    bool ran = run_extracted(dir, "nat_overflow", env, {{"fits", e}, {"mul", mul_e}, {"add", add_e}}, out);
+    bool ok = !ran && out.size() == 3 && out[0].ends_with("= 72057594037927936") && out[1].ends_with("error: Nat overflow") &&
+              out[2].ends_with("error: Nat overflow");
+    check(ok, "extract: Nat arithmetic past 2^64 is an error");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::filesystem::path dir = argc > 1 ? argv[1] : std::filesystem::temp_directory_path() / "vl_regressions";
+    std::filesystem::create_directories(dir);
+    tampered_recursor(dir);
+    named_axioms(dir);
+    edit_after_checkpoint(dir);
+    wal_damaged_tail(dir);
+    group_commit_threads(dir);
+    reopen_after_checkpoint(dir);
+    snapshot_isolation(dir);
+    snapshot_readers(dir);
+    compact_erased_catalog(dir);
+    stale_lemma_index(dir);
+    btree_against_map(dir);
+    meta_queries(dir);
+    search_against_scan();
+    export_outcomes();
+    export_quot();
+    topo_random_edits();
+    non_positive();
+    universe_too_big();
+    mutual_rollback();
+    quot_reduction();
+    delta_without_value();
+    proof_field_eval();
+    nat_overflow();
+    nonlinear_pattern();
+    missing_and_redundant();
+    lemma_rollback();
+    proof_field_extract(dir);
+    nat_overflow_extract(dir);
+    std::filesystem::remove_all(dir);
+    return failures;
+}
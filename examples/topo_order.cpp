@@ -0,0 +1,90 @@
+// topo_order.cpp - benchmark for the workspace's incremental topological order (TopoOrder in graph.hpp)
+// usage: topo_order [nodes] [edges]
+// inserts random edges (default 200000 on 50000 nodes, the same ones every run) one at a time, as
+// drag-connects in the workspace would, with one removal for every four inserts, and prints the
+// mean and worst time per insert and how many were refused as cycles. one full re-sort of the final
+// graph (Kahn's algorithm) is timed for comparison, the cost of re-sorting per edit. exits with 1
+// if a dependency ends up after its user
+// (c) 2025 Zachary R. James
+
+#include "graph.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace vl;
+
+namespace {
+
+using us = std::chrono::duration<double, std::micro>;
+
+// a topological order of g from scratch: dependencies first
+std::vector<Node> resort(const TopoOrder& g)
+{
+    std::vector<std::uint32_t> missing(g.size());
+    std::vector<Node> out;
+    for(Node v = 0; v < g.size(); ++v)
+    {
+        missing[v] = std::uint32_t(g.deps(v).size());
+        if(missing[v] == 0) out.push_back(v);
+    }
+    for(std::size_t i = 0; i < out.size(); ++i)
+        for(Node u : g.users(out[i]))
+            if(--missing[u] == 0) out.push_back(u);
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 50000;
+    std::size_t m = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200000;
+
+    TopoOrder g(n);
+    std::mt19937 rng(42);
+    std::vector<std::pair<Node, Node>> edges;
+    std::size_t refused = 0, removed = 0;
+    double total = 0, worst = 0;
+    for(std::size_t i = 0; i < m; ++i)
+    {
+        // a user somewhere after its dependency in node order most of the time, as libraries grow,
+        // and anywhere otherwise
+        Node a = Node(rng() % n), b = Node(rng() % n);
+        Node u = rng() % 4 ? std::max(a, b) : a, v = rng() % 4 ? std::min(a, b) : b;
+        auto t0 = std::chrono::steady_clock::now();
+        bool added = g.add_edge(u, v);
+        double t = us(std::chrono::steady_clock::now() - t0).count();
+        total += t;
+        worst = std::max(worst, t);
+        if(added) edges.push_back({u, v});
+        else ++refused;
+        if(i % 4 == 3 && !edges.empty())
+        {
+            std::size_t k = rng() % edges.size();
+            g.remove_edge(edges[k].first, edges[k].second);
+            edges[k] = edges.back();
+            edges.pop_back();
+            ++removed;
+        }
+    }
+    std::printf("%zu nodes, %zu inserts: %.2f us mean, %.0f us worst, %zu refused as cycles, %zu removed, %zu edges left\n", n, m,
+                total / double(m), worst, refused, removed, edges.size());
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<Node> sorted = resort(g);
+    std::printf("full re-sort: %.0f us\n", us(std::chrono::steady_clock::now() - t0).count());
+
+    bool ok = sorted.size() == n;
+    for(auto [u, v] : edges) ok = ok && g.position(v) < g.position(u);
+    if(!ok)
+    {
+        std::printf("FAIL: the order is not topological\n");
+        return 1;
+    }
+}
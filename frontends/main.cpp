@@ -0,0 +1,169 @@
+// main.cpp - native dev frontend: opens the prelude snapshot and prints declarations
+// usage: visual_lean [--rebuild] [--snapshot <path>] [name...]
+//        visual_lean compact <library dir>
+//        visual_lean meta <library dir> <prefix>
+// --rebuild checks the prelude again and rewrites the snapshot; with no names it lists every
+// declaration, so a run doubles as a startup benchmark (the time printed covers opening only)
+// compact rewrites a library database (see COMPACTION in storage.hpp) and reports its size and how
+// long reading every named declaration and its dependencies takes from a cold cache, before and after
+// meta records the prelude's kinds and uses in the library's MetaStore (root/meta) and lists the
+// names starting with prefix, each with its kind, what it uses and what uses it
+// (c) 2025 Zachary R. James
+
+#include "prelude.hpp"
+#include "storage.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using namespace vl;
+
+// drops a directory's files from the page cache so the next read goes to the disk (best effort)
+static void evict(const std::filesystem::path& root)
+{
+#ifdef VL_HAVE_MMAP
+    for(const auto& f : std::filesystem::recursive_directory_iterator(root))
+    {
+        if(!f.is_regular_file()) continue;
+        int fd = ::open(f.path().c_str(), O_RDONLY);
+        if(fd < 0) continue;
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        ::close(fd);
+    }
+#else
+    (void)root;
+#endif
+}
+
+// ms to read the objects a library's names reach (all of them without a catalog), dependencies
+// first, as loading it would
+static double cold_load(const std::filesystem::path& root, std::size_t& objects)
+{
+    evict(root);
+    auto t0 = std::chrono::steady_clock::now();
+    Environment env;
+    ContentStore store(env, root);
+    std::optional<std::vector<Digest>> roots = catalog_roots(root);
+    std::vector<Digest> todo = roots ? std::move(*roots) : store.objects();
+    std::unordered_set<Digest, DigestHash> seen;
+    std::reverse(todo.begin(), todo.end());
+    while(!todo.empty())
+    {
+        Digest h = todo.back();
+        todo.pop_back();
+        if(!seen.insert(h).second || !store.contains(h)) continue;
+        for(const Digest& d : store.dependencies(h)) todo.push_back(d);
+    }
+    objects = seen.size();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static int compact(const std::filesystem::path& root)
+{
+    try
+    {
+        std::size_t before_objects = 0, after_objects = 0;
+        double before = cold_load(root, before_objects);
+        CompactStats s = compact_library(root);
+        double after = cold_load(root, after_objects);
+        std::printf("%s: %zu objects, %zu kept\n", root.string().c_str(), s.objects_before, s.objects_after);
+        std::printf("  before  %8.2f MB  cold load %8.1f ms (%zu objects)\n", double(s.bytes_before) / 1e6, before, before_objects);
+        std::printf("  after   %8.2f MB  cold load %8.1f ms (%zu objects)\n", double(s.bytes_after) / 1e6, after, after_objects);
+    }
+    catch(const std::exception& e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+static int meta(const std::filesystem::path& root, std::string_view prefix)
+{
+    try
+    {
+        Environment env;
+        open_snapshot(env, snapshot_path("prelude.img"), prelude_key, load_prelude);
+        std::filesystem::create_directories(root);
+        MetaStore m(root / "meta");
+        record_declarations(m, env);
+        m.commit();
+
+        auto t0 = std::chrono::steady_clock::now();
+        std::vector<std::pair<std::string, std::string>> names; // the range first: the tree must not change during the walk
+        m.for_each([&](std::string_view name, std::string_view attr, std::string_view value) {
+            if(attr == "kind") names.emplace_back(name, value);
+        }, prefix);
+        for(const auto& [name, kind] : names)
+        {
+            std::string uses, users;
+            m.uses(name, [&](std::string_view t) { uses += " " + std::string(t); });
+            m.used_by(name, [&](std::string_view u) { users += " " + std::string(u); });
+            std::printf("%s (%s)\n  uses:%s\n  used by:%s\n", name.c_str(), kind.c_str(), uses.empty() ? " -" : uses.c_str(),
+                        users.empty() ? " -" : users.c_str());
+        }
+        std::fprintf(stderr, "%zu names in %.2f ms\n", names.size(),
+                     std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+    }
+    catch(const std::exception& e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if(argc == 3 && std::strcmp(argv[1], "compact") == 0) return compact(argv[2]);
+    if(argc == 4 && std::strcmp(argv[1], "meta") == 0) return meta(argv[2], argv[3]);
+
+    std::string path = snapshot_path("prelude.img");
+    bool rebuild = false;
+    std::vector<std::string> names;
+    for(int i = 1; i < argc; ++i)
+    {
+        if(std::strcmp(argv[i], "--rebuild") == 0) rebuild = true;
+        else if(std::strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) path = argv[++i];
+        else names.push_back(argv[i]);
+    }
+    if(rebuild && !path.empty())
+    {
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+    }
+
+    Environment env;
+    auto t0 = std::chrono::steady_clock::now();
+    bool mapped = open_snapshot(env, path, prelude_key, load_prelude);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    TypeChecker tc(env);
+    try
+    {
+        if(names.empty())
+            for(const Declaration& d : env.decls()) std::printf("%s : %s\n", env.pool.names.str(d.name).c_str(), tc.to_string(d.type).c_str());
+        for(const std::string& n : names)
+        {
+            const Declaration& d = env.get(env.pool.names.intern(n));
+            std::printf("%s : %s\n", n.c_str(), tc.to_string(d.type).c_str());
+            if(d.unfoldable()) std::printf("  := %s\n", tc.to_string(d.value).c_str());
+        }
+    }
+    catch(const kernel_exception& e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    std::fprintf(stderr, "%zu declarations in %.2f ms (%s)\n", env.decls().size(), ms,
+                 mapped ? ("snapshot " + path).c_str() : "checked");
+}
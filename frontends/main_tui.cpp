@@ -0,0 +1,194 @@
+// main_tui.cpp - line-oriented TUI over the prelude: inspect terms, reductions and run #eval
+// terms are applications of constants, numerals and (parenthesized) subterms, universe
+// levels are explicit: List.{0} Nat, Eq.{1} Nat 2 2. numerals are Nat.succ chains to the kernel,
+// which checks them recursively, so they stop at max_numeral (build larger ones with Nat.mul)
+// the prelude is kept as a snapshot image in the user's cache, so only the first start checks it
+// (c) 2025 Zachary R. James
+
+#include "eval.hpp"
+#include "prelude.hpp"
+#include "storage.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace vl;
+
+// a chain this long checks well within the default 8 MiB stack (16000 overflowed it)
+constexpr std::uint64_t max_numeral = 4096;
+
+class TermParser
+{
+public:
+    TermParser(Environment& env, std::string_view src) : env_(env), p_(env.pool), s_(src) {}
+
+    Expr parse()
+    {
+        Expr e = app();
+        skip();
+        if(i_ < s_.size()) fail("unexpected '" + std::string(1, s_[i_]) + "'");
+        return e;
+    }
+
+private:
+    [[noreturn]] void fail(const std::string& msg) { throw kernel_exception("parse error: " + msg); }
+
+    void skip() { while(i_ < s_.size() && std::isspace(static_cast<unsigned char>(s_[i_]))) ++i_; }
+
+    bool ident_char(char c) const
+    {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.' || static_cast<unsigned char>(c) >= 0x80;
+    }
+
+    bool at_atom()
+    {
+        skip();
+        return i_ < s_.size() && (s_[i_] == '(' || ident_char(s_[i_]));
+    }
+
+    std::uint64_t number()
+    {
+        std::uint64_t n = 0;
+        while(i_ < s_.size() && std::isdigit(static_cast<unsigned char>(s_[i_])))
+            n = std::min<std::uint64_t>(n * 10 + std::uint64_t(s_[i_++] - '0'), UINT32_MAX); // only compared with small bounds
+        return n;
+    }
+
+    Expr app()
+    {
+        Expr e = atom();
+        while(at_atom()) e = p_.app(e, atom());
+        return e;
+    }
+
+    Expr atom()
+    {
+        skip();
+        if(i_ >= s_.size()) fail("unexpected end of input");
+        if(s_[i_] == '(')
+        {
+            ++i_;
+            Expr e = app();
+            skip();
+            if(i_ >= s_.size() || s_[i_] != ')') fail("expected ')'");
+            ++i_;
+            return e;
+        }
+        if(std::isdigit(static_cast<unsigned char>(s_[i_])))
+        {
+            std::size_t start = i_;
+            std::uint64_t n = number();
+            if(n > max_numeral)
+                fail("numeral " + std::string(s_.substr(start, i_ - start)) + " is above " + std::to_string(max_numeral) +
+                     "; write larger ones as products, e.g. Nat.mul 1000 1000");
+            Expr e = p_.cnst("Nat.zero");
+            while(n--) e = p_.app(p_.cnst("Nat.succ"), e);
+            return e;
+        }
+        std::size_t start = i_;
+        while(i_ < s_.size() && ident_char(s_[i_]) && !(s_[i_] == '.' && i_ + 1 < s_.size() && s_[i_ + 1] == '{')) ++i_;
+        std::string id(s_.substr(start, i_ - start));
+        if(id == "Prop") return p_.sort(p_.levels.zero());
+        if(id == "Type") return p_.sort(p_.levels.one());
+        if(id == "Sort")
+        {
+            skip();
+            return p_.sort(p_.levels.succ_n(p_.levels.zero(), std::uint32_t(number())));
+        }
+
+        std::vector<Level> ls;
+        if(i_ + 1 < s_.size() && s_[i_] == '.' && s_[i_ + 1] == '{')
+        {
+            i_ += 2;
+            for(;;)
+            {
+                skip();
+                ls.push_back(p_.levels.succ_n(p_.levels.zero(), std::uint32_t(number())));
+                skip();
+                if(i_ < s_.size() && s_[i_] == ',') { ++i_; continue; }
+                if(i_ < s_.size() && s_[i_] == '}') { ++i_; break; }
+                fail("expected '}'");
+            }
+        }
+        const Declaration& d = env_.get(p_.names.intern(id));
+        if(ls.empty()) ls.assign(d.lparams.size(), p_.levels.zero());
+        if(ls.size() != d.lparams.size()) fail("'" + id + "' expects " + std::to_string(d.lparams.size()) + " universe levels");
+        return p_.cnst(d.name, ls);
+    }
+
+    Environment& env_;
+    Pool& p_;
+    std::string_view s_;
+    std::size_t i_ = 0;
+};
+
+void help()
+{
+    std::cout << "#check e   type of e\n"
+                 "#whnf e    weak head normal form of e\n"
+                 "#eval e    run e with types and proofs erased\n"
+                 "#print n   declaration n\n"
+                 "#quit\n";
+}
+
+} // namespace
+
+int main()
+{
+    Environment env;
+    auto t0 = std::chrono::steady_clock::now();
+    bool mapped = open_snapshot(env, snapshot_path("prelude.img"), prelude_key, load_prelude);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << env.decls().size() << " declarations in " << ms << " ms" << (mapped ? " (snapshot)" : "") << ", #help for commands\n";
+    Evaluator ev(env);
+    Pool& p = env.pool;
+
+    std::string line;
+    while(std::cout << "> " << std::flush, std::getline(std::cin, line))
+    {
+        std::size_t sp = line.find(' ');
+        std::string cmd = line.substr(0, sp);
+        std::string arg = sp == std::string::npos ? "" : line.substr(sp + 1);
+        try
+        {
+            TypeChecker tc(env);
+            if(cmd.empty()) continue;
+            else if(cmd == "#quit") break;
+            else if(cmd == "#help") help();
+            else if(cmd == "#check")
+            {
+                Expr e = TermParser(env, arg).parse();
+                std::cout << tc.to_string(e) << " : " << tc.to_string(tc.check(e)) << "\n";
+            }
+            else if(cmd == "#whnf")
+            {
+                Expr e = TermParser(env, arg).parse();
+                tc.check(e);
+                std::cout << tc.to_string(tc.whnf(e)) << "\n";
+            }
+            else if(cmd == "#eval")
+            {
+                Expr e = TermParser(env, arg).parse();
+                tc.check(e);
+                std::cout << ev.to_string(ev.eval(e)) << "\n";
+            }
+            else if(cmd == "#print")
+            {
+                const Declaration& d = env.get(p.names.intern(arg));
+                std::cout << p.names.str(d.name) << " : " << tc.to_string(d.type) << "\n";
+                if(d.unfoldable()) std::cout << "  := " << tc.to_string(d.value) << "\n";
+            }
+            else std::cout << "unknown command '" << cmd << "', try #help\n";
+        }
+        catch(const std::exception& ex)
+        {
+            std::cout << "error: " << ex.what() << "\n";
+        }
+    }
+}